@@ -184,6 +184,54 @@ struct CAddressIndexIteratorKey {
     }
 };
 
+//! Running totals of every address index entry for one (type, hash), kept so
+//! balance queries don't have to walk the full history of the address.
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(balance);
+        READWRITE(received);
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+    }
+
+    bool IsNull() const {
+        return balance == 0 && received == 0;
+    }
+
+    //! Account for an address index entry being added
+    void Add(CAmount nDelta) {
+        balance += nDelta;
+        if (nDelta > 0)
+            received += nDelta;
+    }
+
+    //! Account for an address index entry being removed
+    void Remove(CAmount nDelta) {
+        balance -= nDelta;
+        if (nDelta > 0)
+            received -= nDelta;
+    }
+
+    CAddressBalanceValue& operator+=(const CAddressBalanceValue& other) {
+        balance += other.balance;
+        received += other.received;
+        return *this;
+    }
+};
+
 struct CAddressIndexIteratorHeightKey {
     unsigned int type;
     uint160 hashBytes;
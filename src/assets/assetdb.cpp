@@ -14,27 +14,31 @@
 
 static const char ASSET_FLAG = 'A';
 static const char ASSET_ADDRESS_QUANTITY_FLAG = 'B';
+static const char ADDRESS_ASSET_QUANTITY_FLAG = 'C';
+static const char DB_FLAG = 'F';
 static const char MY_ASSET_FLAG = 'M';
 static const char BLOCK_ASSET_UNDO_DATA = 'U';
 static const char MEMPOOL_REISSUED_TX = 'Z';
 
-CAssetsDB::CAssetsDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "assets", nCacheSize, fMemory, fWipe) {
+CAssetsDB::CAssetsDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "assets", nCacheSize, fMemory, fWipe, false, 2 << 20, IsDBCompressionEnabled("assets")) {
 }
 
-bool CAssetsDB::WriteAssetData(const CNewAsset &asset, const int nHeight, const uint256& blockHash)
+void CAssetsDB::WriteAssetData(CDBBatch& batch, const CNewAsset &asset, const int nHeight, const uint256& blockHash)
 {
     CDatabasedAssetData data(asset, nHeight, blockHash);
-    return Write(std::make_pair(ASSET_FLAG, asset.strName), data);
+    batch.Write(std::make_pair(ASSET_FLAG, asset.strName), data);
 }
 
-bool CAssetsDB::WriteMyAssetsData(const std::string &strName, const std::set<COutPoint>& setOuts)
+void CAssetsDB::WriteMyAssetsData(CDBBatch& batch, const std::string &strName, const std::set<COutPoint>& setOuts)
 {
-    return Write(std::make_pair(MY_ASSET_FLAG, strName), setOuts);
+    batch.Write(std::make_pair(MY_ASSET_FLAG, strName), setOuts);
 }
 
-bool CAssetsDB::WriteAssetAddressQuantity(const std::string &assetName, const std::string &address, const CAmount &quantity)
+void CAssetsDB::WriteAssetAddressQuantity(CDBBatch& batch, const std::string &assetName, const std::string &address, const CAmount &quantity)
 {
-    return Write(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)), quantity);
+    // Every balance is kept under <Asset Name, Address> and under <Address, Asset Name>
+    batch.Write(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)), quantity);
+    batch.Write(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, assetName)), quantity);
 }
 
 bool CAssetsDB::ReadAssetData(const std::string& strName, CNewAsset& asset, int& nHeight, uint256& blockHash)
@@ -62,9 +66,29 @@ bool CAssetsDB::ReadAssetAddressQuantity(const std::string& assetName, const std
     return Read(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)), quantity);
 }
 
-bool CAssetsDB::EraseAssetData(const std::string& assetName)
+bool CAssetsDB::ReadAssetAddresses(const std::string& assetName, std::set<std::string>& setAddresses)
 {
-    return Erase(std::make_pair(ASSET_FLAG, assetName));
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, std::string())));
+
+    // The quantities are keyed by <Asset Name, Address>, so all the addresses of an asset are next to each other
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, std::pair<std::string, std::string> > key;
+        if (pcursor->GetKey(key) && key.first == ASSET_ADDRESS_QUANTITY_FLAG && key.second.first == assetName) {
+            setAddresses.insert(key.second.second);
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+void CAssetsDB::EraseAssetData(CDBBatch& batch, const std::string& assetName)
+{
+    batch.Erase(std::make_pair(ASSET_FLAG, assetName));
 }
 
 bool CAssetsDB::EraseMyAssetData(const std::string& assetName)
@@ -72,8 +96,9 @@ bool CAssetsDB::EraseMyAssetData(const std::string& assetName)
     return Erase(std::make_pair(MY_ASSET_FLAG, assetName));
 }
 
-bool CAssetsDB::EraseAssetAddressQuantity(const std::string &assetName, const std::string &address) {
-    return Erase(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)));
+void CAssetsDB::EraseAssetAddressQuantity(CDBBatch& batch, const std::string &assetName, const std::string &address) {
+    batch.Erase(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)));
+    batch.Erase(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, assetName)));
 }
 
 bool CAssetsDB::EraseMyOutPoints(const std::string& assetName)
@@ -159,31 +184,86 @@ bool CAssetsDB::LoadAssets()
         }
     }
 
-    std::unique_ptr<CDBIterator> pcursor3(NewIterator());
-    pcursor3->Seek(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(std::string(), std::string())));
-    // Load mapMyUnspentAssets
-    while (pcursor3->Valid()) {
+    // Address balances aren't loaded here, the cache reads them from the database when they are first needed
+
+    return true;
+}
+
+void CAssetsDB::WriteAddressAssetIndexTip(CDBBatch& batch, const uint256& hashBestBlock)
+{
+    batch.Write(std::make_pair(DB_FLAG, std::string("addressassetindex")), hashBestBlock);
+}
+
+bool CAssetsDB::CheckAddressAssetIndex(const uint256& hashBestBlock)
+{
+    // Binaries from before the index update the <Asset Name, Address> balances but not the index. They
+    // do move the chainstate's best block, so an index stamped with another one may be out of date
+    uint256 hashIndexed;
+    if (Read(std::make_pair(DB_FLAG, std::string("addressassetindex")), hashIndexed) && hashIndexed == hashBestBlock)
+        return true;
+
+    if (!BuildAddressAssetIndex(hashBestBlock))
+        return error("%s: failed to build the address asset index", __func__);
+    return true;
+}
+
+bool CAssetsDB::BuildAddressAssetIndex(const uint256& hashBestBlock)
+{
+    LogPrintf("%s: Indexing the asset balances by address...\n", __func__);
+
+    CDBBatch batch(*this);
+
+    // Drop whatever an earlier index holds, balances spent since would otherwise linger
+    std::unique_ptr<CDBIterator> pcursorOld(NewIterator());
+    pcursorOld->Seek(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(std::string(), std::string())));
+    while (pcursorOld->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, std::pair<std::string, std::string> > key; // <Address, Asset Name> -> Quantity
+        if (!pcursorOld->GetKey(key) || key.first != ADDRESS_ASSET_QUANTITY_FLAG)
+            break;
+        batch.Erase(key);
+        if (batch.SizeEstimate() > 16 << 20) {
+            if (!WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+        pcursorOld->Next();
+    }
+    // Write the erasures before the rebuild, which may write some of the same keys again
+    if (!WriteBatch(batch))
+        return false;
+    batch.Clear();
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(std::string(), std::string())));
+
+    size_t nBalances = 0;
+    while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<char, std::pair<std::string, std::string> > key; // <Asset Name, Address> -> Quantity
-        if (pcursor3->GetKey(key) && key.first == ASSET_ADDRESS_QUANTITY_FLAG) {
+        if (pcursor->GetKey(key) && key.first == ASSET_ADDRESS_QUANTITY_FLAG) {
             CAmount value;
-            if (pcursor3->GetValue(value)) {
-                if (!passets->mapAssetsAddresses.count(key.second.first)) {
-                    std::set<std::string> setAddresses;
-                    passets->mapAssetsAddresses.insert(std::make_pair(key.second.first, setAddresses));
-                }
-                if (!passets->mapAssetsAddresses[key.second.first].insert(key.second.second).second)
-                    return error("%s: failed to read my address quantity from database", __func__);
-                passets->mapAssetsAddressAmount.insert(std::make_pair(std::make_pair(key.second.first, key.second.second), value));
-                pcursor3->Next();
-            } else {
-                return error("%s: failed to read my address quantity from database", __func__);
+            if (!pcursor->GetValue(value))
+                return error("%s: failed to read address quantity from database", __func__);
+            batch.Write(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(key.second.second, key.second.first)), value);
+            nBalances++;
+            if (batch.SizeEstimate() > 16 << 20) {
+                if (!WriteBatch(batch))
+                    return false;
+                batch.Clear();
             }
+            pcursor->Next();
         } else {
             break;
         }
     }
 
+    // The flag goes in last, so that an interrupted build starts over on the next start
+    WriteAddressAssetIndexTip(batch, hashBestBlock);
+    if (!WriteBatch(batch, true))
+        return false;
+
+    LogPrintf("%s: Indexed %u asset balances\n", __func__, nBalances);
     return true;
 }
 
@@ -261,4 +341,27 @@ bool CAssetsDB::AssetDir(std::vector<CDatabasedAssetData>& assets, const std::st
 bool CAssetsDB::AssetDir(std::vector<CDatabasedAssetData>& assets)
 {
     return CAssetsDB::AssetDir(assets, "*", MAX_SIZE, 0);
+}
+
+bool CAssetsDB::AddressDir(std::vector<std::pair<std::string, CAmount> >& vecAssetAmounts, const std::string& address)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, std::string())));
+
+    // Keyed by <Address, Asset Name>, so all the balances of an address are next to each other
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, std::pair<std::string, std::string> > key; // <Address, Asset Name> -> Quantity
+        if (pcursor->GetKey(key) && key.first == ADDRESS_ASSET_QUANTITY_FLAG && key.second.first == address) {
+            CAmount value;
+            if (!pcursor->GetValue(value))
+                return error("%s: failed to read address quantity from database", __func__);
+            vecAssetAmounts.emplace_back(std::make_pair(key.second.second, value));
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return true;
 }
\ No newline at end of file
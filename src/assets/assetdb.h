@@ -10,6 +10,8 @@
 
 #include <string>
 #include <map>
+#include <set>
+#include <vector>
 #include <dbwrapper.h>
 
 class CNewAsset;
@@ -44,10 +46,10 @@ public:
     CAssetsDB(const CAssetsDB&) = delete;
     CAssetsDB& operator=(const CAssetsDB&) = delete;
 
-    // Write to database functions
-    bool WriteAssetData(const CNewAsset& asset, const int nHeight, const uint256& blockHash);
-    bool WriteMyAssetsData(const std::string &strName, const std::set<COutPoint>& setOuts);
-    bool WriteAssetAddressQuantity(const std::string& assetName, const std::string& address, const CAmount& quantity);
+    // Write to database functions, the asset changes of a flush go into one batch
+    void WriteAssetData(CDBBatch& batch, const CNewAsset& asset, const int nHeight, const uint256& blockHash);
+    void WriteMyAssetsData(CDBBatch& batch, const std::string &strName, const std::set<COutPoint>& setOuts);
+    void WriteAssetAddressQuantity(CDBBatch& batch, const std::string& assetName, const std::string& address, const CAmount& quantity);
     bool WriteBlockUndoAssetData(const uint256& blockhash, const std::vector<std::pair<std::string, CBlockAssetUndo> >& assetUndoData);
     bool WriteReissuedMempoolState();
 
@@ -55,19 +57,29 @@ public:
     bool ReadAssetData(const std::string& strName, CNewAsset& asset, int& nHeight, uint256& blockHash);
     bool ReadMyAssetsData(const std::string &strName, std::set<COutPoint>& setOuts);
     bool ReadAssetAddressQuantity(const std::string& assetName, const std::string& address, CAmount& quantity);
+    bool ReadAssetAddresses(const std::string& assetName, std::set<std::string>& setAddresses);
     bool ReadBlockUndoAssetData(const uint256& blockhash, std::vector<std::pair<std::string, CBlockAssetUndo> >& assetUndoData);
     bool ReadReissuedMempoolState();
 
     // Erase from database functions
-    bool EraseAssetData(const std::string& assetName);
+    void EraseAssetData(CDBBatch& batch, const std::string& assetName);
     bool EraseMyAssetData(const std::string& assetName);
-    bool EraseAssetAddressQuantity(const std::string &assetName, const std::string &address);
+    void EraseAssetAddressQuantity(CDBBatch& batch, const std::string &assetName, const std::string &address);
 
     // Helper functions
     bool EraseMyOutPoints(const std::string& assetName);
     bool LoadAssets();
+    //! Record that the <Address, Asset Name> index matches the balances as of the chainstate's best block
+    void WriteAddressAssetIndexTip(CDBBatch& batch, const uint256& hashBestBlock);
+    //! Rebuild the <Address, Asset Name> index unless it is recorded to match the balances as of hashBestBlock
+    bool CheckAddressAssetIndex(const uint256& hashBestBlock);
     bool AssetDir(std::vector<CDatabasedAssetData>& assets, const std::string filter, const size_t count, const long start);
     bool AssetDir(std::vector<CDatabasedAssetData>& assets);
+    bool AddressDir(std::vector<std::pair<std::string, CAmount> >& vecAssetAmounts, const std::string& address);
+
+private:
+    //! Build the <Address, Asset Name> index afresh from the balances, as of the chainstate's best block hashBestBlock
+    bool BuildAddressAssetIndex(const uint256& hashBestBlock);
 };
 
 
@@ -2,7 +2,6 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
-#include <regex>
 #include <script/script.h>
 #include <version.h>
 #include <streams.h>
@@ -32,100 +31,202 @@
 std::map<uint256, std::string> mapReissuedTx;
 std::map<std::string, uint256> mapReissuedAssets;
 
+bool fTrackPossiblyMine = true;
+
 // excluding owner tag ('!')
 static const auto MAX_NAME_LENGTH = 31;
 static const auto MAX_CHANNEL_NAME_LENGTH = 12;
 
-// min lengths are expressed by quantifiers
-static const std::regex ROOT_NAME_CHARACTERS("^[A-Z0-9._]{3,}$");
-static const std::regex SUB_NAME_CHARACTERS("^[A-Z0-9._]+$");
-static const std::regex UNIQUE_TAG_CHARACTERS("^[-A-Za-z0-9@$%&*()[\\]{}_.?:]+$");
-static const std::regex CHANNEL_TAG_CHARACTERS("^[A-Z0-9._]+$");
-static const std::regex VOTE_TAG_CHARACTERS("^[A-Z0-9._]+$");
-
-static const std::regex DOUBLE_PUNCTUATION("^.*[._]{2,}.*$");
-static const std::regex LEADING_PUNCTUATION("^[._].*$");
-static const std::regex TRAILING_PUNCTUATION("^.*[._]$");
-
 static const std::string SUB_NAME_DELIMITER = "/";
 static const std::string UNIQUE_TAG_DELIMITER = "#";
 static const std::string CHANNEL_TAG_DELIMITER = "~";
 static const std::string VOTE_TAG_DELIMITER = "^";
 
-static const std::regex UNIQUE_INDICATOR(R"(^[^^~#!]+#[^~#!\/]+$)");
-static const std::regex CHANNEL_INDICATOR(R"(^[^^~#!]+~[^~#!\/]+$)");
-static const std::regex OWNER_INDICATOR(R"(^[^^~#!]+!$)");
-static const std::regex VOTE_INDICATOR(R"(^[^^~#!]+\^[^~#!\/]+$)");
+// Names are checked on every asset script during transaction validation, so they are matched by hand
+// instead of with std::regex. The expression each check is equivalent to is noted above it.
+
+// [A-Z0-9._]
+static inline bool IsNameCharacter(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '_';
+}
+
+// [._]
+static inline bool IsPunctuation(char c)
+{
+    return c == '.' || c == '_';
+}
+
+// [-A-Za-z0-9@$%&*()[\]{}_.?:]
+static inline bool IsUniqueTagCharacter(char c)
+{
+    if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))
+        return true;
+
+    switch (c) {
+        case '-': case '@': case '$': case '%': case '&': case '*': case '(': case ')':
+        case '[': case ']': case '{': case '}': case '_': case '.': case '?': case ':':
+            return true;
+        default:
+            return false;
+    }
+}
 
-static const std::regex RAVEN_NAMES("^ASTRAL$|^RAVEN$|^RAVENCOIN$");
+// ^[A-Z0-9._]{nMinLength,}$
+// and if fCheckPunctuation, none of ^.*[._]{2,}.*$ ^[._].*$ ^.*[._]$
+static bool IsNameRangeValid(const char* pbegin, const char* pend, size_t nMinLength, bool fCheckPunctuation)
+{
+    if ((size_t)(pend - pbegin) < nMinLength)
+        return false;
+
+    // Starting as if the previous character was punctuation also catches leading punctuation
+    bool fPrevPunctuation = true;
+    for (const char* p = pbegin; p != pend; p++) {
+        if (!IsNameCharacter(*p))
+            return false;
+
+        bool fPunctuation = IsPunctuation(*p);
+        if (fCheckPunctuation && fPunctuation && fPrevPunctuation)
+            return false;
+        fPrevPunctuation = fPunctuation;
+    }
+
+    return !fCheckPunctuation || !fPrevPunctuation;
+}
+
+static inline bool IsRangeEqual(const char* pbegin, const char* pend, const char* str)
+{
+    size_t nLength = strlen(str);
+    return (size_t)(pend - pbegin) == nLength && memcmp(pbegin, str, nLength) == 0;
+}
+
+static bool IsRootNameValid(const char* pbegin, const char* pend)
+{
+    // ^ASTRAL$|^RAVEN$|^RAVENCOIN$ are reserved
+    return IsNameRangeValid(pbegin, pend, 3, true)
+        && !IsRangeEqual(pbegin, pend, "ASTRAL")
+        && !IsRangeEqual(pbegin, pend, "RAVEN")
+        && !IsRangeEqual(pbegin, pend, "RAVENCOIN");
+}
+
+static bool IsSubNameValid(const char* pbegin, const char* pend)
+{
+    return IsNameRangeValid(pbegin, pend, 1, true);
+}
+
+// ^[-A-Za-z0-9@$%&*()[\]{}_.?:]+$
+static bool IsUniqueTagValid(const char* pbegin, const char* pend)
+{
+    if (pbegin == pend)
+        return false;
+
+    for (const char* p = pbegin; p != pend; p++) {
+        if (!IsUniqueTagCharacter(*p))
+            return false;
+    }
+
+    return true;
+}
+
+static bool IsVoteTagValid(const char* pbegin, const char* pend)
+{
+    return IsNameRangeValid(pbegin, pend, 1, false);
+}
+
+static bool IsChannelTagValid(const char* pbegin, const char* pend)
+{
+    return IsNameRangeValid(pbegin, pend, 1, true);
+}
+
+//! The first part boost::split would return: everything before the first delimiter
+static inline const char* SplitFrontEnd(const std::string& name, char delimiter)
+{
+    size_t pos = name.find(delimiter);
+    return name.data() + (pos == std::string::npos ? name.size() : pos);
+}
+
+//! The last part boost::split would return: everything after the last delimiter
+static inline const char* SplitBackBegin(const std::string& name, char delimiter)
+{
+    size_t pos = name.rfind(delimiter);
+    return name.data() + (pos == std::string::npos ? 0 : pos + 1);
+}
+
+static bool IsNameValidBeforeTag(const char* pbegin, const char* pend)
+{
+    // The root is everything up to the first SUB_NAME_DELIMITER, every part after that is a sub name
+    const char* pdelimiter = std::find(pbegin, pend, SUB_NAME_DELIMITER[0]);
+    if (!IsRootNameValid(pbegin, pdelimiter)) return false;
+
+    while (pdelimiter != pend) {
+        const char* pnext = std::find(pdelimiter + 1, pend, SUB_NAME_DELIMITER[0]);
+        if (!IsSubNameValid(pdelimiter + 1, pnext)) return false;
+        pdelimiter = pnext;
+    }
+
+    return true;
+}
+
+// ^[^^~#!]+<delimiter>[^~#!\/]+$
+static bool HasTagIndicator(const std::string& name, char delimiter)
+{
+    size_t pos = name.find_first_of("^~#!");
+    if (pos == 0 || pos == std::string::npos || name[pos] != delimiter || pos + 1 == name.size())
+        return false;
+
+    return name.find_first_of("~#!/", pos + 1) == std::string::npos;
+}
+
+// ^[^^~#!]+!$
+static bool HasOwnerIndicator(const std::string& name)
+{
+    size_t pos = name.find_first_of("^~#!");
+    return pos != 0 && pos != std::string::npos && name[pos] == '!' && pos + 1 == name.size();
+}
 
 bool IsRootNameValid(const std::string& name)
 {
-    return std::regex_match(name, ROOT_NAME_CHARACTERS)
-        && !std::regex_match(name, DOUBLE_PUNCTUATION)
-        && !std::regex_match(name, LEADING_PUNCTUATION)
-        && !std::regex_match(name, TRAILING_PUNCTUATION)
-        && !std::regex_match(name, RAVEN_NAMES);
+    return IsRootNameValid(name.data(), name.data() + name.size());
 }
 
 bool IsSubNameValid(const std::string& name)
 {
-    return std::regex_match(name, SUB_NAME_CHARACTERS)
-        && !std::regex_match(name, DOUBLE_PUNCTUATION)
-        && !std::regex_match(name, LEADING_PUNCTUATION)
-        && !std::regex_match(name, TRAILING_PUNCTUATION);
+    return IsSubNameValid(name.data(), name.data() + name.size());
 }
 
 bool IsUniqueTagValid(const std::string& tag)
 {
-    return std::regex_match(tag, UNIQUE_TAG_CHARACTERS);
+    return IsUniqueTagValid(tag.data(), tag.data() + tag.size());
 }
 
 bool IsVoteTagValid(const std::string& tag)
 {
-    return std::regex_match(tag, VOTE_TAG_CHARACTERS);
+    return IsVoteTagValid(tag.data(), tag.data() + tag.size());
 }
 
 bool IsChannelTagValid(const std::string& tag)
 {
-    return std::regex_match(tag, CHANNEL_TAG_CHARACTERS)
-        && !std::regex_match(tag, DOUBLE_PUNCTUATION)
-        && !std::regex_match(tag, LEADING_PUNCTUATION)
-        && !std::regex_match(tag, TRAILING_PUNCTUATION);
+    return IsChannelTagValid(tag.data(), tag.data() + tag.size());
 }
 
 bool IsNameValidBeforeTag(const std::string& name)
 {
-    std::vector<std::string> parts;
-    boost::split(parts, name, boost::is_any_of(SUB_NAME_DELIMITER));
-
-    if (!IsRootNameValid(parts.front())) return false;
-
-    if (parts.size() > 1)
-    {
-        for (unsigned long i = 1; i < parts.size(); i++)
-        {
-            if (!IsSubNameValid(parts[i])) return false;
-        }
-    }
-
-    return true;
+    return IsNameValidBeforeTag(name.data(), name.data() + name.size());
 }
 
 bool IsAssetNameASubasset(const std::string& name)
 {
-    std::vector<std::string> parts;
-    boost::split(parts, name, boost::is_any_of(SUB_NAME_DELIMITER));
+    const char* pend = SplitFrontEnd(name, SUB_NAME_DELIMITER[0]);
 
-    if (!IsRootNameValid(parts.front())) return false;
+    if (!IsRootNameValid(name.data(), pend)) return false;
 
-    return parts.size() > 1;
+    return pend != name.data() + name.size();
 }
 
 bool IsAssetNameValid(const std::string& name, AssetType& assetType, std::string& error)
 {
     assetType = AssetType::INVALID;
-    if (std::regex_match(name, UNIQUE_INDICATOR))
+    if (HasTagIndicator(name, UNIQUE_TAG_DELIMITER[0]))
     {
         bool ret = IsTypeCheckNameValid(AssetType::UNIQUE, name, error);
         if (ret)
@@ -133,7 +234,7 @@ bool IsAssetNameValid(const std::string& name, AssetType& assetType, std::string
 
         return ret;
     }
-    else if (std::regex_match(name, CHANNEL_INDICATOR))
+    else if (HasTagIndicator(name, CHANNEL_TAG_DELIMITER[0]))
     {
         bool ret = IsTypeCheckNameValid(AssetType::MSGCHANNEL, name, error);
         if (ret)
@@ -141,7 +242,7 @@ bool IsAssetNameValid(const std::string& name, AssetType& assetType, std::string
 
         return ret;
     }
-    else if (std::regex_match(name, OWNER_INDICATOR))
+    else if (HasOwnerIndicator(name))
     {
         bool ret = IsTypeCheckNameValid(AssetType::OWNER, name, error);
         if (ret)
@@ -149,7 +250,7 @@ bool IsAssetNameValid(const std::string& name, AssetType& assetType, std::string
 
         return ret;
     }
-    else if (std::regex_match(name, VOTE_INDICATOR))
+    else if (HasTagIndicator(name, VOTE_TAG_DELIMITER[0]))
     {
         bool ret = IsTypeCheckNameValid(AssetType::VOTE, name, error);
         if (ret)
@@ -183,43 +284,41 @@ bool IsAssetNameValid(const std::string& name, AssetType& assetType)
 
 bool IsAssetNameAnOwner(const std::string& name)
 {
-    return IsAssetNameValid(name) && std::regex_match(name, OWNER_INDICATOR);
+    return IsAssetNameValid(name) && HasOwnerIndicator(name);
 }
 
 // TODO get the string translated below
 bool IsTypeCheckNameValid(const AssetType type, const std::string& name, std::string& error)
 {
+    const char* pbegin = name.data();
+    const char* pend = name.data() + name.size();
+
     if (type == AssetType::UNIQUE) {
         if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
-        std::vector<std::string> parts;
-        boost::split(parts, name, boost::is_any_of(UNIQUE_TAG_DELIMITER));
-        bool valid = IsNameValidBeforeTag(parts.front()) && IsUniqueTagValid(parts.back());
+        bool valid = IsNameValidBeforeTag(pbegin, SplitFrontEnd(name, UNIQUE_TAG_DELIMITER[0])) && IsUniqueTagValid(SplitBackBegin(name, UNIQUE_TAG_DELIMITER[0]), pend);
         if (!valid) { error = "Unique name contains invalid characters (Valid characters are: A-Z a-z 0-9 @ $ % & * ( ) [ ] { } _ . ? : -)";  return false; }
         return true;
     } else if (type == AssetType::MSGCHANNEL) {
         if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
-        std::vector<std::string> parts;
-        boost::split(parts, name, boost::is_any_of(CHANNEL_TAG_DELIMITER));
-        bool valid = IsNameValidBeforeTag(parts.front()) && IsChannelTagValid(parts.back());
-        if (parts.back().size() > MAX_CHANNEL_NAME_LENGTH) { error = "Channel name is greater than max length of " + std::to_string(MAX_CHANNEL_NAME_LENGTH); return false; }
+        const char* ptag = SplitBackBegin(name, CHANNEL_TAG_DELIMITER[0]);
+        bool valid = IsNameValidBeforeTag(pbegin, SplitFrontEnd(name, CHANNEL_TAG_DELIMITER[0])) && IsChannelTagValid(ptag, pend);
+        if ((size_t)(pend - ptag) > MAX_CHANNEL_NAME_LENGTH) { error = "Channel name is greater than max length of " + std::to_string(MAX_CHANNEL_NAME_LENGTH); return false; }
         if (!valid) { error = "Message Channel name contains invalid characters (Valid characters are: A-Z 0-9 _ .) (special characters can't be the first or last characters)";  return false; }
         return true;
     } else if (type == AssetType::OWNER) {
         if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
-        bool valid = IsNameValidBeforeTag(name.substr(0, name.size() - 1));
+        bool valid = IsNameValidBeforeTag(pbegin, name.empty() ? pend : pend - 1);
         if (!valid) { error = "Owner name contains invalid characters (Valid characters are: A-Z 0-9 _ .) (special characters can't be the first or last characters)";  return false; }
         return true;
     } else if (type == AssetType::VOTE) {
         if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
-        std::vector<std::string> parts;
-        boost::split(parts, name, boost::is_any_of(VOTE_TAG_DELIMITER));
-        bool valid = IsNameValidBeforeTag(parts.front()) && IsVoteTagValid(parts.back());
+        bool valid = IsNameValidBeforeTag(pbegin, SplitFrontEnd(name, VOTE_TAG_DELIMITER[0])) && IsVoteTagValid(SplitBackBegin(name, VOTE_TAG_DELIMITER[0]), pend);
         if (!valid) { error = "Vote name contains invalid characters (Valid characters are: A-Z 0-9 _ .) (special characters can't be the first or last characters)";  return false; }
         return true;
     } else {
         if (name.size() > MAX_NAME_LENGTH - 1) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH - 1); return false; }  //Assets and sub-assets need to leave one extra char for OWNER indicator
         if (!IsAssetNameASubasset(name) && name.size() < MIN_ASSET_LENGTH) { error = "Name must be contain " + std::to_string(MIN_ASSET_LENGTH) + " characters"; return false; }
-        bool valid = IsNameValidBeforeTag(name);
+        bool valid = IsNameValidBeforeTag(pbegin, pend);
         if (!valid && IsAssetNameASubasset(name) && name.size() < 3) { error = "Name must have at least 3 characters (Valid characters are: A-Z 0-9 _ .)";  return false; }
         if (!valid) { error = "Name contains invalid characters (Valid characters are: A-Z 0-9 _ .) (special characters can't be the first or last characters)";  return false; }
         return true;
@@ -1036,7 +1135,7 @@ bool CReissueAsset::IsNull() const
 
 bool CAssetsCache::GetAssetsOutPoints(const std::string& strName, std::set<COutPoint>& outpoints)
 {
-    if (mapMyUnspentAssets.count(strName)) {
+    if (FetchMyUnspentAssets(strName)) {
         outpoints = mapMyUnspentAssets.at(strName);
         return true;
     }
@@ -1077,22 +1176,10 @@ void CAssetsCache::AddToAssetBalance(const std::string& strName, const std::stri
         mapAssetsAddressAmount.at(pair) = OWNER_ASSET_AMOUNT;
     else
         mapAssetsAddressAmount.at(pair) += nAmount;
-
-    // Add to map of addresses
-    if (!mapAssetsAddresses.count(strName)) {
-        mapAssetsAddresses.insert(std::make_pair(strName, std::set<std::string>()));
-    }
-    mapAssetsAddresses.at(strName).insert(address);
 }
 
 bool CAssetsCache::TrySpendCoin(const COutPoint& out, const CTxOut& txOut)
 {
-    if (vpwallets.size() == 0) {
-        CAssetCachePossibleMine possibleMine("", out, txOut);
-        setPossiblyMineRemove.insert(possibleMine);
-        return true;
-    }
-
     // Placeholder strings that will get set if you successfully get the transfer or asset from the script
     std::string address = "";
     std::string assetName = "";
@@ -1142,9 +1229,6 @@ bool CAssetsCache::TrySpendCoin(const COutPoint& out, const CTxOut& txOut)
 
             if (mapAssetsAddressAmount.at(pair) < 0)
                 mapAssetsAddressAmount.at(pair) = 0;
-            if (mapAssetsAddressAmount.at(pair) == 0 &&
-                mapAssetsAddresses.count(assetName))
-                mapAssetsAddresses.at(assetName).erase(address);
 
             // Update the cache so we can save to database
             vSpentAssets.push_back(spend);
@@ -1153,7 +1237,7 @@ bool CAssetsCache::TrySpendCoin(const COutPoint& out, const CTxOut& txOut)
         return error("%s : ERROR Failed to get asset from the OutPoint: %s", __func__, out.ToString());
     }
     // If we own one of the assets, we need to update our databases and memory
-    if (mapMyUnspentAssets.count(assetName)) {
+    if (FetchMyUnspentAssets(assetName)) {
         if (mapMyUnspentAssets.at(assetName).count(out)) {
             mapMyUnspentAssets.at(assetName).erase(out);
 
@@ -1167,7 +1251,7 @@ bool CAssetsCache::TrySpendCoin(const COutPoint& out, const CTxOut& txOut)
 
 bool CAssetsCache::AddToMyUpspentOutPoints(const std::string& strName, const COutPoint& out)
 {
-    if (!mapMyUnspentAssets.count(strName)) {
+    if (!FetchMyUnspentAssets(strName)) {
         std::set<COutPoint> setOuts;
         setOuts.insert(out);
         mapMyUnspentAssets.insert(std::make_pair(strName, setOuts));
@@ -1195,7 +1279,8 @@ bool CAssetsCache::ContainsAsset(const std::string& assetName)
 bool CAssetsCache::AddPossibleOutPoint(const CAssetCachePossibleMine& possibleMine)
 {
     if (vpwallets.size() == 0) {
-        setPossiblyMineAdd.insert(possibleMine);
+        if (fTrackPossiblyMine)
+            setPossiblyMineAdd.insert(possibleMine);
         return true;
     }
 
@@ -1271,13 +1356,7 @@ bool CAssetsCache::UndoAssetCoin(const Coin& coin, const COutPoint& out)
 //! Changes Memory Only
 bool CAssetsCache::AddBackSpentAsset(const Coin& coin, const std::string& assetName, const std::string& address, const CAmount& nAmount, const COutPoint& out)
 {
-    // Add back the asset to its previous address
-    if (!mapAssetsAddresses.count(assetName))
-        mapAssetsAddresses.insert(std::make_pair(assetName, std::set<std::string>()));
-
-    mapAssetsAddresses.at(assetName).insert(address);
-
-    // Update the assets address balance
+    // Add back the asset to its previous address by updating the assets address balance
     auto pair = std::make_pair(assetName, address);
 
     // Get the map address amount from database if the map doesn't have it already
@@ -1311,22 +1390,11 @@ bool CAssetsCache::UndoTransfer(const CAssetTransfer& transfer, const std::strin
     if (mapAssetsAddressAmount.at(pair) < transfer.nAmount)
         return error("%s : Tried undoing a transfer and the map of address amount had less than the amount we are trying to undo. Asset : %s Address : %s" , __func__, transfer.strName, address);
 
-    if (!mapAssetsAddresses.count(transfer.strName))
-        return error("%s : Map asset address, didn't contain an entry for this asset we are trying to undo. Asset : %s Address : %s" , __func__, transfer.strName, address);
-
-    if (!mapAssetsAddresses.at(transfer.strName).count(address))
-        return error("%s : Map of asset address didn't have the address we are trying to undo. Asset : %s Address : %s" , __func__, transfer.strName, address);
-
-    // Change the in memory balance of the asset at the address
+    // Change the in memory balance of the asset at the address, a balance of 0 means the address no longer holds it
     mapAssetsAddressAmount[pair] -= transfer.nAmount;
 
-    // If the balance is now 0, remove it from the list
-    if (mapAssetsAddressAmount.at(pair) == 0) {
-        mapAssetsAddresses.at(transfer.strName).erase(address);
-    }
-
     // If this transfer asset was added to my map of unspents remove the COutPoint
-    if (mapMyUnspentAssets.count(transfer.strName))
+    if (FetchMyUnspentAssets(transfer.strName))
         if (mapMyUnspentAssets.at(transfer.strName).count(outToRemove))
             mapMyUnspentAssets.at(transfer.strName).erase(outToRemove);
 
@@ -1334,22 +1402,19 @@ bool CAssetsCache::UndoTransfer(const CAssetTransfer& transfer, const std::strin
 }
 
 //! Changes Memory Only
-bool CAssetsCache::RemoveNewAsset(const CNewAsset& asset, const std::string address)
+bool CAssetsCache::RemoveNewAsset(const CNewAsset& asset, const std::string address, const COutPoint& out)
 {
     if (!CheckIfAssetExists(asset.strName))
         return error("%s : Tried removing an asset that didn't exist. Asset Name : %s", __func__, asset.strName);
 
-    // Remove the new asset from my unspent outpoints
-    if (mapMyUnspentAssets.count(asset.strName)) {
-        mapMyUnspentAssets.erase(asset.strName);
+    // Remove the issuing outpoint from my unspent outpoints
+    if (FetchMyUnspentAssets(asset.strName) && mapMyUnspentAssets.at(asset.strName).count(out)) {
+        mapMyUnspentAssets.at(asset.strName).erase(out);
 
         // Add the asset name to the set, so I know which asset outpoint changes to write to database
         setChangeOwnedOutPoints.insert(asset.strName);
     }
 
-    if (mapAssetsAddresses.count(asset.strName))
-        mapAssetsAddresses[asset.strName].erase(address);
-
     mapAssetsAddressAmount[std::make_pair(asset.strName, address)] = 0;
 
     CAssetCacheNewAsset newAsset(asset, address, 0 , uint256());
@@ -1368,20 +1433,12 @@ bool CAssetsCache::AddNewAsset(const CNewAsset& asset, const std::string address
     if(CheckIfAssetExists(asset.strName))
         return error("%s: Tried adding new asset, but it already existed in the set of assets: %s", __func__, asset.strName);
 
-    // Insert the asset into the assets address map
-    if (mapAssetsAddresses.count(asset.strName)) {
-        if (mapAssetsAddresses[asset.strName].count(address))
-            return error("%s : Tried adding a new asset and saving its quantity, but it already existed in the map of assets addresses: %s", __func__, asset.strName);
-
-        mapAssetsAddresses[asset.strName].insert(address);
-    } else {
-        std::set<std::string> setAddresses;
-        setAddresses.insert(address);
-        mapAssetsAddresses.insert(std::make_pair(asset.strName, setAddresses));
-    }
-
     // Insert the asset into the assests address amount map
-    mapAssetsAddressAmount[std::make_pair(asset.strName, address)] = asset.nAmount;
+    auto pair = std::make_pair(asset.strName, address);
+    if (FetchAssetAddressAmount(asset.strName, address) && mapAssetsAddressAmount.at(pair) > 0)
+        return error("%s : Tried adding a new asset and saving its quantity, but the address already held it: %s", __func__, asset.strName);
+
+    mapAssetsAddressAmount[pair] = asset.nAmount;
 
     CAssetCacheNewAsset newAsset(asset, address, nHeight, blockHash);
 
@@ -1405,16 +1462,6 @@ bool CAssetsCache::AddReissueAsset(const CReissueAsset& reissue, const std::stri
         return error("%s: Failed to get the original asset that is getting reissued. Asset Name : %s",
                      __func__, reissue.strName);
 
-    // Insert the asset into the assets address map
-    if (mapAssetsAddresses.count(reissue.strName)) {
-        if (!mapAssetsAddresses[reissue.strName].count(address))
-            mapAssetsAddresses[reissue.strName].insert(address);
-    } else {
-        std::set<std::string> setAddresses;
-        setAddresses.insert(address);
-        mapAssetsAddresses.insert(std::make_pair(reissue.strName, setAddresses));
-    }
-
     // Add the reissued amount to the address amount map
     if (!GetBestAssetAddressAmount(*this, reissue.strName, address))
         mapAssetsAddressAmount.insert(make_pair(pair, 0));
@@ -1465,7 +1512,7 @@ bool CAssetsCache::RemoveReissueAsset(const CReissueAsset& reissue, const std::s
         return error("%s: Tried undoing reissue of an asset, but that asset didn't exist: %s", __func__, reissue.strName);
 
     // Remove the reissued asset outpoint if it belongs to my unspent assets
-    if (mapMyUnspentAssets.count(reissue.strName)) {
+    if (FetchMyUnspentAssets(reissue.strName)) {
         mapMyUnspentAssets.at(reissue.strName).erase(out);
 
         // Add the asset name to the set, so I know which asset outpoint changes to write to database
@@ -1481,11 +1528,6 @@ bool CAssetsCache::RemoveReissueAsset(const CReissueAsset& reissue, const std::s
     if (mapAssetsAddressAmount[pair] < 0)
         return error("%s : Tried undoing reissue of an asset, but the assets amount went negative: %s", __func__, reissue.strName);
 
-    // If the undid amount is now 0. Remove the address from the set of addresses
-    if (mapAssetsAddresses.count(reissue.strName) && mapAssetsAddressAmount[pair] == 0) {
-        mapAssetsAddresses.at(reissue.strName).erase(address);
-    }
-
     // Change the asset data by undoing what was reissued
     assetData.nAmount -= reissue.nAmount;
     assetData.nReissuable = 1;
@@ -1518,21 +1560,13 @@ bool CAssetsCache::RemoveReissueAsset(const CReissueAsset& reissue, const std::s
 //! Changes Memory Only
 bool CAssetsCache::AddOwnerAsset(const std::string& assetsName, const std::string address)
 {
-    if (mapAssetsAddresses.count(assetsName)) {
-        if (mapAssetsAddresses[assetsName].count(address))
-            return error("%s : Tried adding an owner asset, but it already existed in the map of assets addresses: %s",
-                         __func__, assetsName);
-
-        mapAssetsAddresses[assetsName].insert(address);
-
-    } else {
-        std::set<std::string> setAddresses;
-        setAddresses.insert(address);
-        mapAssetsAddresses.insert(std::make_pair(assetsName, setAddresses));
-    }
-
     // Insert the asset into the assests address amount map
-    mapAssetsAddressAmount[std::make_pair(assetsName, address)] = OWNER_ASSET_AMOUNT;
+    auto pair = std::make_pair(assetsName, address);
+    if (FetchAssetAddressAmount(assetsName, address) && mapAssetsAddressAmount.at(pair) > 0)
+        return error("%s : Tried adding an owner asset, but the address already held it: %s",
+                     __func__, assetsName);
+
+    mapAssetsAddressAmount[pair] = OWNER_ASSET_AMOUNT;
 
 
     // Update the cache
@@ -1547,13 +1581,12 @@ bool CAssetsCache::AddOwnerAsset(const std::string& assetsName, const std::strin
 }
 
 //! Changes Memory Only
-bool CAssetsCache::RemoveOwnerAsset(const std::string& assetsName, const std::string address)
+bool CAssetsCache::RemoveOwnerAsset(const std::string& assetsName, const std::string address, const COutPoint& out)
 {
-    if (mapMyUnspentAssets.count(assetsName))
-        mapMyUnspentAssets.erase(assetsName);
-
-    if (mapAssetsAddresses.count(assetsName))
-        mapAssetsAddresses[assetsName].erase(address);
+    if (FetchMyUnspentAssets(assetsName) && mapMyUnspentAssets.at(assetsName).count(out)) {
+        mapMyUnspentAssets.at(assetsName).erase(out);
+        setChangeOwnedOutPoints.insert(assetsName);
+    }
 
     auto pair = std::make_pair(assetsName, address);
 
@@ -1591,80 +1624,36 @@ bool CAssetsCache::Flush(bool fSoftCopy, bool fFlushDB)
 {
     try {
         if (fFlushDB) {
-            bool dirty = false;
-            std::string message;
+            // Every change goes into one batch, so the database never holds half of a flush
+            CDBBatch batch(*passetsdb);
+            // Asset data that the batch changes is dropped from the meta data cache once the batch is written,
+            // so that no reader caches what it read before the change, and new assets are only added then
+            std::vector<std::string> vChangedAssetData;
 
             // Remove new assets from the database
             for (auto newAsset : setNewAssetsToRemove) {
-                passetsCache->Erase(newAsset.asset.strName);
-                if (!passetsdb->EraseAssetData(newAsset.asset.strName)) {
-                    dirty = true;
-                    message = "_Failed Erasing New Asset Data from database";
-                }
-
-                if (dirty) {
-                    return error("%s : %s", __func__, message);
-                }
-
-                if (!passetsdb->EraseAssetAddressQuantity(newAsset.asset.strName, newAsset.address)) {
-                    dirty = true;
-                    message = "_Failed Erasing Address Balance from database";
-                }
-
-                if (dirty) {
-                    return error("%s : %s", __func__, message);
-                }
+                passetsdb->EraseAssetData(batch, newAsset.asset.strName);
+                vChangedAssetData.push_back(newAsset.asset.strName);
+                passetsdb->EraseAssetAddressQuantity(batch, newAsset.asset.strName, newAsset.address);
             }
 
             // Add the new assets to the database
             for (auto newAsset : setNewAssetsToAdd) {
-
-                passetsCache->Put(newAsset.asset.strName, CDatabasedAssetData(newAsset.asset, newAsset.blockHeight, newAsset.blockHash));
-                if (!passetsdb->WriteAssetData(newAsset.asset, newAsset.blockHeight, newAsset.blockHash)) {
-                    dirty = true;
-                    message = "_Failed Writing New Asset Data to database";
-                }
-
-                if (dirty) {
-                    return error("%s : %s", __func__, message);
-                }
-
-                if (!passetsdb->WriteAssetAddressQuantity(newAsset.asset.strName, newAsset.address,
-                                                          newAsset.asset.nAmount)) {
-                    dirty = true;
-                    message = "_Failed Writing Address Balance to database";
-                }
-
-                if (dirty) {
-                    return error("%s : %s", __func__, message);
-                }
+                passetsdb->WriteAssetData(batch, newAsset.asset, newAsset.blockHeight, newAsset.blockHash);
+                passetsdb->WriteAssetAddressQuantity(batch, newAsset.asset.strName, newAsset.address, newAsset.asset.nAmount);
             }
 
             // Remove the new owners from database
             for (auto ownerAsset : setNewOwnerAssetsToRemove) {
-                if (!passetsdb->EraseAssetAddressQuantity(ownerAsset.assetName, ownerAsset.address)) {
-                    dirty = true;
-                    message = "_Failed Erasing Owner Address Balance from database";
-                }
-
-                if (dirty) {
-                    return error("%s : %s", __func__, message);
-                }
+                passetsdb->EraseAssetAddressQuantity(batch, ownerAsset.assetName, ownerAsset.address);
             }
 
             // Add the new owners to database
             for (auto ownerAsset : setNewOwnerAssetsToAdd) {
                 auto pair = std::make_pair(ownerAsset.assetName, ownerAsset.address);
                 if (mapAssetsAddressAmount.count(pair) && mapAssetsAddressAmount.at(pair) > 0) {
-                    if (!passetsdb->WriteAssetAddressQuantity(ownerAsset.assetName, ownerAsset.address,
-                                                              mapAssetsAddressAmount.at(pair))) {
-                        dirty = true;
-                        message = "_Failed Writing Owner Address Balance to database";
-                    }
-
-                    if (dirty) {
-                        return error("%s : %s", __func__, message);
-                    }
+                    passetsdb->WriteAssetAddressQuantity(batch, ownerAsset.assetName, ownerAsset.address,
+                                                         mapAssetsAddressAmount.at(pair));
                 }
             }
 
@@ -1673,25 +1662,10 @@ bool CAssetsCache::Flush(bool fSoftCopy, bool fFlushDB)
                 auto pair = std::make_pair(undoTransfer.transfer.strName, undoTransfer.address);
                 if (mapAssetsAddressAmount.count(pair)) {
                     if (mapAssetsAddressAmount.at(pair) == 0) {
-                        if (!passetsdb->EraseAssetAddressQuantity(undoTransfer.transfer.strName,
-                                                                  undoTransfer.address)) {
-                            dirty = true;
-                            message = "_Failed Erasing Address Quantity from database";
-                        }
-
-                        if (dirty) {
-                            return error("%s : %s", __func__, message);
-                        }
+                        passetsdb->EraseAssetAddressQuantity(batch, undoTransfer.transfer.strName, undoTransfer.address);
                     } else {
-                        if (!passetsdb->WriteAssetAddressQuantity(undoTransfer.transfer.strName, undoTransfer.address,
-                                                                  mapAssetsAddressAmount.at(pair))) {
-                            dirty = true;
-                            message = "_Failed Writing updated Address Quantity to database when undoing transfers";
-                        }
-
-                        if (dirty) {
-                            return error("%s : %s", __func__, message);
-                        }
+                        passetsdb->WriteAssetAddressQuantity(batch, undoTransfer.transfer.strName, undoTransfer.address,
+                                                             mapAssetsAddressAmount.at(pair));
                     }
                 }
             }
@@ -1701,15 +1675,8 @@ bool CAssetsCache::Flush(bool fSoftCopy, bool fFlushDB)
                 auto pair = std::make_pair(newTransfer.transfer.strName, newTransfer.address);
                 // During init and reindex it disconnects and verifies blocks, can create a state where vNewTransfer will contain transfers that have already been spent. So if they aren't in the map, we can skip them.
                 if (mapAssetsAddressAmount.count(pair)) {
-                    if (!passetsdb->WriteAssetAddressQuantity(newTransfer.transfer.strName, newTransfer.address,
-                                                              mapAssetsAddressAmount.at(pair))) {
-                        dirty = true;
-                        message = "_Failed Writing new address quantity to database";
-                    }
-
-                    if (dirty) {
-                        return error("%s : %s", __func__, message);
-                    }
+                    passetsdb->WriteAssetAddressQuantity(batch, newTransfer.transfer.strName, newTransfer.address,
+                                                         mapAssetsAddressAmount.at(pair));
                 }
             }
 
@@ -1717,27 +1684,11 @@ bool CAssetsCache::Flush(bool fSoftCopy, bool fFlushDB)
                 auto reissue_name = newReissue.reissue.strName;
                 auto pair = make_pair(reissue_name, newReissue.address);
                 if (mapReissuedAssetData.count(reissue_name)) {
-                    if(!passetsdb->WriteAssetData(mapReissuedAssetData.at(reissue_name), newReissue.blockHeight, newReissue.blockHash)) {
-                        dirty = true;
-                        message = "_Failed Writing reissue asset data to database";
-                    }
-
-                    if (dirty) {
-                        return error("%s : %s", __func__, message);
-                    }
-
-                    passetsCache->Erase(reissue_name);
+                    passetsdb->WriteAssetData(batch, mapReissuedAssetData.at(reissue_name), newReissue.blockHeight, newReissue.blockHash);
+                    vChangedAssetData.push_back(reissue_name);
 
                     if (mapAssetsAddressAmount.count(pair)) {
-                        if (!passetsdb->WriteAssetAddressQuantity(pair.first, pair.second,
-                                                                  mapAssetsAddressAmount.at(pair))) {
-                            dirty = true;
-                            message = "_Failed Writing reissue asset quantity to the address quantity database";
-                        }
-
-                        if (dirty) {
-                            return error("%s, %s", __func__, message);
-                        }
+                        passetsdb->WriteAssetAddressQuantity(batch, pair.first, pair.second, mapAssetsAddressAmount.at(pair));
                     }
                 }
             }
@@ -1754,31 +1705,18 @@ bool CAssetsCache::Flush(bool fSoftCopy, bool fFlushDB)
 
                 auto reissue_name = undoReissue.reissue.strName;
                 if (mapReissuedAssetData.count(reissue_name)) {
-                    if(!passetsdb->WriteAssetData(mapReissuedAssetData.at(reissue_name), undoReissue.blockHeight, undoReissue.blockHash)) {
-                        dirty = true;
-                        message = "_Failed Writing undo reissue asset data to database";
-                    }
+                    passetsdb->WriteAssetData(batch, mapReissuedAssetData.at(reissue_name), undoReissue.blockHeight, undoReissue.blockHash);
 
                     auto pair = make_pair(undoReissue.reissue.strName, undoReissue.address);
                     if (mapAssetsAddressAmount.count(pair)) {
                         if (mapAssetsAddressAmount.at(pair) == 0) {
-                            if (!passetsdb->EraseAssetAddressQuantity(reissue_name, undoReissue.address)) {
-                                dirty = true;
-                                message = "_Failed Erasing Address Balance from database";
-                            }
+                            passetsdb->EraseAssetAddressQuantity(batch, reissue_name, undoReissue.address);
                         } else {
-                            if (!passetsdb->WriteAssetAddressQuantity(reissue_name, undoReissue.address, mapAssetsAddressAmount.at(pair))) {
-                                dirty = true;
-                                message = "_Failed Writing the undo of reissue of asset from database";
-                            }
+                            passetsdb->WriteAssetAddressQuantity(batch, reissue_name, undoReissue.address, mapAssetsAddressAmount.at(pair));
                         }
                     }
 
-                    if (dirty) {
-                        return error("%s : %s", __func__, message);
-                    }
-
-                    passetsCache->Erase(reissue_name);
+                    vChangedAssetData.push_back(reissue_name);
                 }
             }
 
@@ -1786,29 +1724,15 @@ bool CAssetsCache::Flush(bool fSoftCopy, bool fFlushDB)
             for (auto undoSpend : vUndoAssetAmount) {
                 auto pair = std::make_pair(undoSpend.assetName, undoSpend.address);
                 if (mapAssetsAddressAmount.count(pair)) {
-                    if (!passetsdb->WriteAssetAddressQuantity(undoSpend.assetName, undoSpend.address,
-                                                              mapAssetsAddressAmount.at(pair))) {
-                        dirty = true;
-                        message = "_Failed Writing updated Address Quantity to database when undoing spends";
-                    }
-
-                    if (dirty) {
-                        return error("%s : %s", __func__, message);
-                    }
+                    passetsdb->WriteAssetAddressQuantity(batch, undoSpend.assetName, undoSpend.address,
+                                                         mapAssetsAddressAmount.at(pair));
                 }
             }
 
             // Save my outpoints to the database
             for (auto updateOutPoints : setChangeOwnedOutPoints) {
                 if (mapMyUnspentAssets.count(updateOutPoints)) {
-                    if (!passetsdb->WriteMyAssetsData(updateOutPoints, mapMyUnspentAssets.at(updateOutPoints))) {
-                        dirty = true;
-                        message = "_Failed Writing my set of outpoints to database";
-                    }
-
-                    if (dirty) {
-                        return error("%s : %s", __func__, message);
-                    }
+                    passetsdb->WriteMyAssetsData(batch, updateOutPoints, mapMyUnspentAssets.at(updateOutPoints));
                 }
             }
 
@@ -1816,33 +1740,39 @@ bool CAssetsCache::Flush(bool fSoftCopy, bool fFlushDB)
             for (auto spentAsset : vSpentAssets) {
                 auto pair = make_pair(spentAsset.assetName, spentAsset.address);
                 if (mapAssetsAddressAmount.count(pair)) {
-                    if (mapAssetsAddressAmount.at(make_pair(spentAsset.assetName, spentAsset.address)) == 0) {
-                        if (!passetsdb->EraseAssetAddressQuantity(spentAsset.assetName, spentAsset.address)) {
-                            dirty = true;
-                            message = "_Failed Erasing a Spent Asset, from database";
-                        }
-
-                        if (dirty) {
-                            return error("%s : %s", __func__, message);
-                        }
-                    } else  {
-                        if (!passetsdb->WriteAssetAddressQuantity(spentAsset.assetName, spentAsset.address, mapAssetsAddressAmount.at(pair))) {
-                            dirty = true;
-                            message = "_Failed Erasing a Spent Asset, from database";
-                        }
-
-                        if (dirty) {
-                            return error("%s : %s", __func__, message);
-                        }
+                    if (mapAssetsAddressAmount.at(pair) == 0) {
+                        passetsdb->EraseAssetAddressQuantity(batch, spentAsset.assetName, spentAsset.address);
+                    } else {
+                        passetsdb->WriteAssetAddressQuantity(batch, spentAsset.assetName, spentAsset.address, mapAssetsAddressAmount.at(pair));
                     }
                 }
             }
 
+            // The chainstate is flushed first, so its best block is the one these balances are as of
+            if (pcoinsTip)
+                passetsdb->WriteAddressAssetIndexTip(batch, pcoinsTip->GetBestBlock());
+
+            if (!passetsdb->WriteBatch(batch)) {
+                return error("%s : Failed Writing the asset changes to database", __func__);
+            }
+
+            // Only cache what the database now holds. Puts go first so that a new asset that was also
+            // changed in this flush is dropped again below
+            for (auto newAsset : setNewAssetsToAdd)
+                passetsCache->Put(newAsset.asset.strName, CDatabasedAssetData(newAsset.asset, newAsset.blockHeight, newAsset.blockHash));
+
+            for (const auto& name : vChangedAssetData)
+                passetsCache->Erase(name);
+
             ClearDirtyCache();
+            TrimAddressCaches();
         }
 
         if (fSoftCopy) {
-            passets->Copy(*this);
+            if (pbase)
+                FlushToBase();
+            else
+                passets->Copy(*this);
         }
 
         return true;
@@ -1851,11 +1781,207 @@ bool CAssetsCache::Flush(bool fSoftCopy, bool fFlushDB)
     }
 }
 
+//! Changes Memory Only
+void CAssetsCache::FlushToBase()
+{
+    // The entries in this layer were fetched from the base and then modified, so they replace the base entries
+    for (auto& item : mapMyUnspentAssets)
+        pbase->mapMyUnspentAssets[item.first] = std::move(item.second);
+
+    for (const auto& item : mapAssetsAddressAmount)
+        pbase->mapAssetsAddressAmount[item.first] = item.second;
+
+    for (const auto& item : mapReissuedAssetData)
+        pbase->mapReissuedAssetData[item.first] = item.second;
+
+    // Replay the dirty sets on top of the base ones, the same way the add and remove functions update them
+    for (const auto& item : setNewAssetsToRemove) {
+        pbase->setNewAssetsToAdd.erase(item);
+        pbase->setNewAssetsToRemove.erase(item);
+        pbase->setNewAssetsToRemove.insert(item);
+    }
+    for (const auto& item : setNewAssetsToAdd) {
+        pbase->setNewAssetsToRemove.erase(item);
+        pbase->setNewAssetsToAdd.erase(item);
+        pbase->setNewAssetsToAdd.insert(item);
+    }
+
+    for (const auto& item : setNewReissueToRemove) {
+        pbase->setNewReissueToAdd.erase(item);
+        pbase->setNewReissueToRemove.erase(item);
+        pbase->setNewReissueToRemove.insert(item);
+    }
+    for (const auto& item : setNewReissueToAdd) {
+        pbase->setNewReissueToRemove.erase(item);
+        pbase->setNewReissueToAdd.erase(item);
+        pbase->setNewReissueToAdd.insert(item);
+    }
+
+    for (const auto& item : setNewOwnerAssetsToRemove) {
+        pbase->setNewOwnerAssetsToAdd.erase(item);
+        pbase->setNewOwnerAssetsToRemove.erase(item);
+        pbase->setNewOwnerAssetsToRemove.insert(item);
+    }
+    for (const auto& item : setNewOwnerAssetsToAdd) {
+        pbase->setNewOwnerAssetsToRemove.erase(item);
+        pbase->setNewOwnerAssetsToAdd.erase(item);
+        pbase->setNewOwnerAssetsToAdd.insert(item);
+    }
+
+    for (const auto& item : setNewTransferAssetsToRemove) {
+        pbase->setNewTransferAssetsToAdd.erase(item);
+        pbase->setNewTransferAssetsToRemove.erase(item);
+        pbase->setNewTransferAssetsToRemove.insert(item);
+    }
+    for (const auto& item : setNewTransferAssetsToAdd) {
+        pbase->setNewTransferAssetsToRemove.erase(item);
+        pbase->setNewTransferAssetsToAdd.erase(item);
+        pbase->setNewTransferAssetsToAdd.insert(item);
+    }
+
+    pbase->vSpentAssets.insert(pbase->vSpentAssets.end(), vSpentAssets.begin(), vSpentAssets.end());
+    pbase->vUndoAssetAmount.insert(pbase->vUndoAssetAmount.end(), vUndoAssetAmount.begin(), vUndoAssetAmount.end());
+    pbase->setChangeOwnedOutPoints.insert(setChangeOwnedOutPoints.begin(), setChangeOwnedOutPoints.end());
+    pbase->setPossiblyMineAdd.insert(setPossiblyMineAdd.begin(), setPossiblyMineAdd.end());
+
+    // Everything now lives in the base, start over as an empty layer
+    SetNull();
+    ClearDirtyCache();
+    setPossiblyMineAdd.clear();
+}
+
+bool CAssetsCache::FetchMyUnspentAssets(const std::string& assetName)
+{
+    if (mapMyUnspentAssets.count(assetName))
+        return true;
+
+    for (const CAssetsCache* cache = pbase; cache; cache = cache->pbase) {
+        auto it = cache->mapMyUnspentAssets.find(assetName);
+        if (it != cache->mapMyUnspentAssets.end()) {
+            mapMyUnspentAssets.insert(*it);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool CAssetsCache::FetchAssetAddressAmount(const std::string& assetName, const std::string& address)
+{
+    auto pair = make_pair(assetName, address);
+
+    // If the caches map has the pair, return true because the map already contains the best dirty amount
+    if (mapAssetsAddressAmount.count(pair))
+        return true;
+
+    // A base cache may hold a dirty amount that hasn't been written to the database yet
+    for (const CAssetsCache* cache = pbase; cache; cache = cache->pbase) {
+        auto it = cache->mapAssetsAddressAmount.find(pair);
+        if (it != cache->mapAssetsAddressAmount.end()) {
+            mapAssetsAddressAmount.insert(*it);
+            return true;
+        }
+    }
+
+    // If the database contains the assets address amount, insert it into the database and return true
+    CAmount nDBAmount;
+    if (passetsdb && passetsdb->ReadAssetAddressQuantity(pair.first, pair.second, nDBAmount)) {
+        mapAssetsAddressAmount.insert(make_pair(pair, nDBAmount));
+        return true;
+    }
+
+    // The amount wasn't found return false
+    return false;
+}
+
+// Asset names and addresses are too long for the small string optimization, count one allocation for each
+static const size_t ASSET_STRING_USAGE = memusage::MallocUsage(MAX_NAME_LENGTH + 1);
+
+//! Changes Memory Only
+void CAssetsCache::TrimAddressCaches()
+{
+    // Spent balances were erased from the database, don't keep them around as zero
+    for (auto it = mapAssetsAddressAmount.begin(); it != mapAssetsAddressAmount.end(); ) {
+        if (it->second == 0)
+            it = mapAssetsAddressAmount.erase(it);
+        else
+            ++it;
+    }
+
+    size_t nUsage = AddressCacheMemoryUsage();
+    if (nUsage <= nAssetCacheUsage)
+        return;
+
+    // Only called right after the dirty entries were written, so every balance is a single read to get back
+    LogPrint(BCLog::DB, "%s : Asset address cache is %u bytes, over the limit of %u bytes, evicting entries\n", __func__, nUsage, nAssetCacheUsage);
+    const size_t nAmountUsage = memusage::IncrementalDynamicUsage(mapAssetsAddressAmount) + 2 * ASSET_STRING_USAGE;
+    for (auto it = mapAssetsAddressAmount.begin(); it != mapAssetsAddressAmount.end() && nUsage > nAssetCacheUsage; ) {
+        it = mapAssetsAddressAmount.erase(it);
+        nUsage -= nAmountUsage;
+    }
+}
+
 //! Get the amount of memory the cache is using
 size_t CAssetsCache::DynamicMemoryUsage() const
 {
-    // TODO make sure this is accurate
-    return memusage::DynamicUsage(mapAssetsAddresses) + memusage::DynamicUsage(mapAssetsAddressAmount) + memusage::DynamicUsage(mapMyUnspentAssets);
+    size_t nUsage = AddressCacheMemoryUsage() + memusage::DynamicUsage(mapMyUnspentAssets);
+
+    for (const auto& item : mapMyUnspentAssets)
+        nUsage += memusage::DynamicUsage(item.second) + ASSET_STRING_USAGE;
+
+    return nUsage;
+}
+
+size_t CAssetsCache::AddressCacheMemoryUsage() const
+{
+    return memusage::DynamicUsage(mapAssetsAddressAmount) + 2 * ASSET_STRING_USAGE * mapAssetsAddressAmount.size();
+}
+
+bool CAssetsCache::GetAssetAddresses(const std::string& assetName, std::set<std::string>& setAddresses) const
+{
+    setAddresses.clear();
+    if (passetsdb && !passetsdb->ReadAssetAddresses(assetName, setAddresses))
+        return false;
+
+    // The database has the holders as of the last flush. Apply the balances that changed since, base caches first.
+    std::vector<const CAssetsCache*> vCaches;
+    for (const CAssetsCache* cache = this; cache; cache = cache->pbase)
+        vCaches.push_back(cache);
+
+    for (auto cache = vCaches.rbegin(); cache != vCaches.rend(); ++cache) {
+        const auto& mapAmounts = (*cache)->mapAssetsAddressAmount;
+        for (auto it = mapAmounts.lower_bound(std::make_pair(assetName, std::string())); it != mapAmounts.end() && it->first.first == assetName; ++it) {
+            if (it->second > 0)
+                setAddresses.insert(it->first.second);
+            else
+                setAddresses.erase(it->first.second);
+        }
+    }
+
+    return true;
+}
+
+void CAssetsCache::ApplyAddressAmounts(const std::string& address, std::map<std::string, CAmount>& mapAmounts) const
+{
+    // Entries that haven't been written yet are always in mapAssetsAddressAmount, the clean ones match the database
+    for (const auto& item : mapAssetsAddressAmount) {
+        if (item.first.second == address)
+            mapAmounts[item.first.first] = item.second;
+    }
+
+    // Undone issues erase the issuer's balance from the database when flushed
+    for (const auto& newAsset : setNewAssetsToRemove) {
+        if (newAsset.address == address)
+            mapAmounts.erase(newAsset.asset.strName);
+    }
+
+    // Spent balances are erased from the database when flushed
+    for (auto it = mapAmounts.begin(); it != mapAmounts.end(); ) {
+        if (it->second == 0)
+            it = mapAmounts.erase(it);
+        else
+            ++it;
+    }
 }
 
 //! Get an estimated size of the cache in bytes that will be needed inorder to save to database
@@ -2080,38 +2206,33 @@ bool IsScriptTransferAsset(const CScript& scriptPubKey, int& nStartingIndex)
 
 void UpdatePossibleAssets()
 {
-    if (passets) {
-        for (auto item : passets->setPossiblyMineRemove) {
-            // If the CTxOut is mine add it to the list of unspent outpoints
-            if (vpwallets[0]->IsMine(item.txOut) == ISMINE_SPENDABLE) {
-                if (!passets->TrySpendCoin(item.out, item.txOut)) // Boolean true means only change the in memory data. We will want to save at the same time that ASTRAL coin saves its cache
-                    error("%s: Failed to add an asset I own to my Unspent Asset Database. asset %s",
-                          __func__, item.assetName);
-            }
-        }
+    if (!passets)
+        return;
 
-        for (auto item : passets->setPossiblyMineAdd) {
-            // If the CTxOut is mine add it to the list of unspent outpoints
-            if (vpwallets[0]->IsMine(item.txOut) == ISMINE_SPENDABLE) {
-                if (!passets->AddToMyUpspentOutPoints(item.assetName, item.out)) // Boolean true means only change the in memory data. We will want to save at the same time that ASTRAL coin saves its cache
-                    error("%s: Failed to add an asset I own to my Unspent Asset Database. asset %s",
-                                 __func__, item.assetName);
-            }
-        }
+    if (vpwallets.empty()) {
+        // No wallet is going to look at them, so stop collecting outputs
+        LOCK(cs_main);
+        fTrackPossiblyMine = false;
+        passets->setPossiblyMineAdd.clear();
+        return;
+    }
 
-        std::vector<std::pair<std::string, COutPoint> > toRemove;
-        for (auto item : passets->mapMyUnspentAssets) {
-            for (auto out : item.second) {
-                if (pcoinsTip->AccessCoin(out).IsSpent())
-                    toRemove.emplace_back(std::make_pair(item.first, out));
-            }
-        }
+    // Spends never need the wallet, TrySpendCoin drops spent outpoints from mapMyUnspentAssets
+    // as blocks connect. Only outputs created before the wallet was loaded are left to check.
+    LOCK(cs_main);
+    for (const auto& item : passets->setPossiblyMineAdd) {
+        // Outputs spent or disconnected in the meantime can't be added
+        if (pcoinsTip->AccessCoin(item.out).IsSpent())
+            continue;
 
-        for (auto remove : toRemove) {
-            passets->mapMyUnspentAssets.at(remove.first).erase(remove.second);
+        // If the CTxOut is mine add it to the list of unspent outpoints
+        if (vpwallets[0]->IsMine(item.txOut) == ISMINE_SPENDABLE) {
+            if (!passets->AddToMyUpspentOutPoints(item.assetName, item.out))
+                error("%s: Failed to add an asset I own to my Unspent Asset Database. asset %s",
+                             __func__, item.assetName);
         }
-
     }
+    passets->setPossiblyMineAdd.clear();
 }
 
 
@@ -2125,21 +2246,30 @@ bool CAssetsCache::CheckIfAssetExists(const std::string& name, bool fForceDuplic
     asset.strName = name;
     CAssetCacheNewAsset cachedAsset(asset, "", 0, uint256());
 
-    // Check the dirty caches first and see if it was recently added or removed
-    if (setNewAssetsToRemove.count(cachedAsset))
-        return false;
+    // Check the dirty caches first and see if it was recently added or removed, starting with this layer
+    for (const CAssetsCache* cache = this; cache; cache = cache->pbase) {
+        if (cache->setNewAssetsToRemove.count(cachedAsset))
+            return false;
 
-    if (setNewAssetsToAdd.count(cachedAsset)) {
-        if (fForceDuplicateCheck)
-            return true;
-        else {
-            LogPrintf("%s : Found asset %s in setNewAssetsToAdd but force duplicate check wasn't true\n", __func__, name);
+        if (cache->setNewAssetsToAdd.count(cachedAsset)) {
+            if (fForceDuplicateCheck)
+                return true;
+            else {
+                LogPrintf("%s : Found asset %s in setNewAssetsToAdd but force duplicate check wasn't true\n", __func__, name);
+                break;
+            }
         }
     }
 
     // Check the cache, if it doesn't exist in the cache. Try and read it from database
     if (passetsCache) {
-        if (passetsCache->Exists(name)) {
+        CAssetsMetaCache::DataRef data;
+        uint64_t nGeneration;
+        if (passetsCache->Lookup(name, data, &nGeneration)) {
+            // A null entry means the database is known to not have it
+            if (!data)
+                return false;
+
             if (fForceDuplicateCheck)
                 return true;
             else {
@@ -2151,12 +2281,14 @@ bool CAssetsCache::CheckIfAssetExists(const std::string& name, bool fForceDuplic
                 int nHeight;
                 uint256 hash;
                 if (passetsdb->ReadAssetData(name, readAsset, nHeight, hash)) {
-                    passetsCache->Put(readAsset.strName, CDatabasedAssetData(readAsset, nHeight, hash));
+                    passetsCache->PutLoaded(readAsset.strName, CDatabasedAssetData(readAsset, nHeight, hash), nGeneration);
                     if (fForceDuplicateCheck)
                         return true;
                     else {
                         LogPrintf("%s : Found asset %s in passetsdb but force duplicate check wasn't true\n", __func__, name);
                     }
+                } else {
+                    passetsCache->PutAbsent(name, nGeneration);
                 }
             }
         }
@@ -2174,38 +2306,43 @@ bool CAssetsCache::GetAssetMetaDataIfExists(const std::string &name, CNewAsset &
 
 bool CAssetsCache::GetAssetMetaDataIfExists(const std::string &name, CNewAsset &asset, int& nHeight, uint256& blockHash)
 {
-    // Check the map that contains the reissued asset data. If it is in this map, it hasn't been saved to disk yet
-    if (mapReissuedAssetData.count(name)) {
-        asset = mapReissuedAssetData.at(name);
-        return true;
-    }
-
     // Create objects that will be used to check the dirty cache
     CNewAsset tempAsset;
     tempAsset.strName = name;
     CAssetCacheNewAsset cachedAsset(tempAsset, "", 0, uint256());
 
-    // Check the dirty caches first and see if it was recently added or removed
-    if (setNewAssetsToRemove.count(cachedAsset)) {
-        return false;
-    }
+    for (const CAssetsCache* cache = this; cache; cache = cache->pbase) {
+        // Check the map that contains the reissued asset data. If it is in this map, it hasn't been saved to disk yet
+        if (cache->mapReissuedAssetData.count(name)) {
+            asset = cache->mapReissuedAssetData.at(name);
+            return true;
+        }
 
-    auto setIterator = setNewAssetsToAdd.find(cachedAsset);
-    if (setIterator != setNewAssetsToAdd.end()) {
-        asset = setIterator->asset;
-        nHeight = setIterator->blockHeight;
-        blockHash = setIterator->blockHash;
-        return true;
+        // Check the dirty caches first and see if it was recently added or removed
+        if (cache->setNewAssetsToRemove.count(cachedAsset)) {
+            return false;
+        }
+
+        auto setIterator = cache->setNewAssetsToAdd.find(cachedAsset);
+        if (setIterator != cache->setNewAssetsToAdd.end()) {
+            asset = setIterator->asset;
+            nHeight = setIterator->blockHeight;
+            blockHash = setIterator->blockHash;
+            return true;
+        }
     }
 
     // Check the cache, if it doesn't exist in the cache. Try and read it from database
+    uint64_t nGeneration = 0;
     if (passetsCache) {
-        if (passetsCache->Exists(name)) {
-            CDatabasedAssetData data;
-            data = passetsCache->Get(name);
-            asset = data.asset;
-            nHeight = data.nHeight;
-            blockHash = data.blockHash;
+        CAssetsMetaCache::DataRef data;
+        if (passetsCache->Lookup(name, data, &nGeneration)) {
+            if (!data)
+                return false;
+
+            asset = data->asset;
+            nHeight = data->nHeight;
+            blockHash = data->blockHash;
             return true;
         }
     }
@@ -2218,9 +2355,10 @@ bool CAssetsCache::GetAssetMetaDataIfExists(const std::string &name, CNewAsset &
             asset = readAsset;
             nHeight = height;
             blockHash = hash;
-            passetsCache->Put(readAsset.strName, CDatabasedAssetData(readAsset, height, hash));
+            passetsCache->PutLoaded(readAsset.strName, CDatabasedAssetData(readAsset, height, hash), nGeneration);
             return true;
         }
+        passetsCache->PutAbsent(name, nGeneration);
     }
 
     return false;
@@ -2415,21 +2553,7 @@ std::string GetBurnAddress(const AssetType type)
 //! This will get the amount that an address for a certain asset contains from the database if they cache doesn't already have it
 bool GetBestAssetAddressAmount(CAssetsCache& cache, const std::string& assetName, const std::string& address)
 {
-    auto pair = make_pair(assetName, address);
-
-    // If the caches map has the pair, return true because the map already contains the best dirty amount
-    if (cache.mapAssetsAddressAmount.count(pair))
-        return true;
-
-    // If the database contains the assets address amount, insert it into the database and return true
-    CAmount nDBAmount;
-    if (passetsdb->ReadAssetAddressQuantity(pair.first, pair.second, nDBAmount)) {
-        cache.mapAssetsAddressAmount.insert(make_pair(pair, nDBAmount));
-        return true;
-    }
-
-    // The amount wasn't found return false
-    return false;
+    return cache.FetchAssetAddressAmount(assetName, address);
 }
 
 //! sets _assetNames_ to the set of names of owned assets
@@ -2453,7 +2577,11 @@ bool GetMyOwnedAssets(CAssetsCache& cache, const std::string prefix, std::vector
 //! sets _balance_ to the total quantity of _assetName_ owned across all addresses
 bool GetMyAssetBalance(CAssetsCache& cache, const std::string& assetName, CAmount& balance) {
     balance = 0;
-    for (auto const& address : cache.mapAssetsAddresses[assetName]) {
+    std::set<std::string> setAddresses;
+    if (!cache.GetAssetAddresses(assetName, setAddresses))
+        return false;
+
+    for (auto const& address : setAddresses) {
         if (vpwallets.size() == 0)
             return false;
 
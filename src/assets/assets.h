@@ -54,18 +54,26 @@ struct CBlockAssetUndo;
 
 // 50000 * 82 Bytes == 4.1 Mb
 #define MAX_CACHE_ASSETS_SIZE 50000
+#define MAX_CACHE_ASSETS_ABSENT_SIZE 10000
+
+// Default memory in MiB kept for asset address balances (-assetcache), taken out of -dbcache
+#define DEFAULT_ASSET_CACHE 32
 
 // Create map that store that state of current reissued transaction that the mempool as accepted.
 // If an asset name is in this map, any other reissue transactions wont be accepted into the mempool
 extern std::map<uint256, std::string> mapReissuedTx;
 extern std::map<std::string, uint256> mapReissuedAssets;
 
+//! Whether asset outputs seen while no wallet is loaded are kept for UpdatePossibleAssets() (protected by cs_main)
+extern bool fTrackPossiblyMine;
+
 class CAssets {
 public:
     std::map<std::string, std::set<COutPoint> > mapMyUnspentAssets; // Asset Name -> COutPoint
 
 
-    std::map<std::string, std::set<std::string> > mapAssetsAddresses; // Asset Name -> set <Addresses>
+    // Read from the database on demand, trimmed back to -assetcache after being flushed. An address holds
+    // an asset while its balance is above 0, the set of holders is only put together when asked for.
     std::map<std::pair<std::string, std::string>, CAmount> mapAssetsAddressAmount; // pair < Asset Name , Address > -> Quantity of tokens in the address
 
     // Dirty, Gets wiped once flushed to database
@@ -74,14 +82,12 @@ public:
     CAssets(const CAssets& assets) {
         this->mapMyUnspentAssets = assets.mapMyUnspentAssets;
         this->mapAssetsAddressAmount = assets.mapAssetsAddressAmount;
-        this->mapAssetsAddresses = assets.mapAssetsAddresses;
         this->mapReissuedAssetData = assets.mapReissuedAssetData;
     }
 
     CAssets& operator=(const CAssets& other) {
         mapMyUnspentAssets = other.mapMyUnspentAssets;
         mapAssetsAddressAmount = other.mapAssetsAddressAmount;
-        mapAssetsAddresses = other.mapAssetsAddresses;
         mapReissuedAssetData = other.mapReissuedAssetData;
         return *this;
     }
@@ -92,7 +98,6 @@ public:
 
     void SetNull() {
         mapMyUnspentAssets.clear();
-        mapAssetsAddresses.clear();
         mapAssetsAddressAmount.clear();
         mapReissuedAssetData.clear();
     }
@@ -104,6 +109,18 @@ private:
     bool AddBackSpentAsset(const Coin& coin, const std::string& assetName, const std::string& address, const CAmount& nAmount, const COutPoint& out);
     void AddToAssetBalance(const std::string& strName, const std::string& address, const CAmount& nAmount);
     bool UndoTransfer(const CAssetTransfer& transfer, const std::string& address, const COutPoint& outToRemove);
+
+    //! Cache this one is layered on top of, nullptr when this cache holds the full state (passets)
+    CAssetsCache* pbase;
+
+    //! Pull the per asset entries down from the base caches if this layer doesn't have them yet
+    bool FetchMyUnspentAssets(const std::string& assetName);
+
+    //! Evict clean address balance entries until the address caches fit in the -assetcache budget
+    void TrimAddressCaches();
+
+    //! Merge the changes made in this layer into its base cache
+    void FlushToBase();
 public :
     //! These are memory only containers that show dirty entries that will be databased when flushed
     std::vector<CAssetCacheUndoAssetAmount> vUndoAssetAmount;
@@ -126,21 +143,27 @@ public :
     std::set<CAssetCacheNewTransfer> setNewTransferAssetsToAdd;
     std::set<CAssetCacheNewTransfer> setNewTransferAssetsToRemove;
 
-    //! During init, the wallet isn't enabled, there for if we disconnect any blocks
-    //! We need to store possible unspends of assets that could be ours and check back when the wallet is enabled.
+    //! Asset outputs created while no wallet was loaded. They could be ours, so they are kept
+    //! (across database flushes) until UpdatePossibleAssets() can check them against the wallet.
+    //! Nothing is kept once it's known that no wallet will be loaded, see fTrackPossiblyMine.
     std::set<CAssetCachePossibleMine> setPossiblyMineAdd;
-    std::set<CAssetCachePossibleMine> setPossiblyMineRemove;
 
-    CAssetsCache() : CAssets()
+    CAssetsCache() : CAssets(), pbase(nullptr)
     {
         SetNull();
     }
 
-    CAssetsCache(const CAssetsCache& cache) : CAssets(cache)
+    //! Create an empty layer on top of baseIn. Entries are read through from the base on demand,
+    //! and Flush(true) only writes the changes made in this layer back into baseIn.
+    explicit CAssetsCache(CAssetsCache* baseIn) : CAssets(), pbase(baseIn)
+    {
+        SetNull();
+    }
+
+    CAssetsCache(const CAssetsCache& cache) : CAssets(cache), pbase(cache.pbase)
     {
         this->mapMyUnspentAssets = cache.mapMyUnspentAssets;
         this->mapAssetsAddressAmount = cache.mapAssetsAddressAmount;
-        this->mapAssetsAddresses = cache.mapAssetsAddresses;
         this->mapReissuedAssetData = cache.mapReissuedAssetData;
 
         // Copy dirty cache also
@@ -169,9 +192,9 @@ public :
 
     CAssetsCache& operator=(const CAssetsCache& cache)
     {
+        this->pbase = cache.pbase;
         this->mapMyUnspentAssets = cache.mapMyUnspentAssets;
         this->mapAssetsAddressAmount = cache.mapAssetsAddressAmount;
-        this->mapAssetsAddresses = cache.mapAssetsAddresses;
         this->mapReissuedAssetData = cache.mapReissuedAssetData;
 
         // Copy dirty cache also
@@ -204,7 +227,6 @@ public :
     {
         this->mapMyUnspentAssets = cache.mapMyUnspentAssets;
         this->mapAssetsAddressAmount = cache.mapAssetsAddressAmount;
-        this->mapAssetsAddresses = cache.mapAssetsAddresses;
         this->mapReissuedAssetData = cache.mapReissuedAssetData;
 
         // Copy dirty cache also
@@ -232,13 +254,12 @@ public :
 
         // Copy sets of possibilymine
         this->setPossiblyMineAdd = cache.setPossiblyMineAdd;
-        this->setPossiblyMineRemove = cache.setPossiblyMineRemove;
     }
 
     // Cache only undo functions
-    bool RemoveNewAsset(const CNewAsset& asset, const std::string address);
+    bool RemoveNewAsset(const CNewAsset& asset, const std::string address, const COutPoint& out);
     bool RemoveTransfer(const CAssetTransfer& transfer, const std::string& address, const COutPoint& out);
-    bool RemoveOwnerAsset(const std::string& assetsName, const std::string address);
+    bool RemoveOwnerAsset(const std::string& assetsName, const std::string address, const COutPoint& out);
     bool RemoveReissueAsset(const CReissueAsset& reissue, const std::string address, const COutPoint& out, const std::vector<std::pair<std::string, CBlockAssetUndo> >& vUndoIPFS);
     bool UndoAssetCoin(const Coin& coin, const COutPoint& out);
 
@@ -252,6 +273,10 @@ public :
     // Cache only validation functions
     bool TrySpendCoin(const COutPoint& out, const CTxOut& coin);
 
+    //! Make sure the best known amount for the asset address pair is in mapAssetsAddressAmount,
+    //! looking in the base caches and then the database. Returns false if the pair wasn't found
+    bool FetchAssetAddressAmount(const std::string& assetName, const std::string& address);
+
     // Help functions
     bool GetAssetsOutPoints(const std::string& strName, std::set<COutPoint>& outpoints);
     bool ContainsAsset(const CNewAsset& asset);
@@ -264,11 +289,19 @@ public :
 
     //! Calculate the size of the CAssets (in bytes)
     size_t DynamicMemoryUsage() const;
+    //! Calculate the size of the address caches, the part of DynamicMemoryUsage() that TrimAddressCaches() can free
+    size_t AddressCacheMemoryUsage() const;
+
+    //! Get the addresses holding the asset, from the database and the balances not written to it yet
+    bool GetAssetAddresses(const std::string& assetName, std::set<std::string>& setAddresses) const;
+
+    //! Update balances read from the database for an address with the ones not written to it yet
+    void ApplyAddressAmounts(const std::string& address, std::map<std::string, CAmount>& mapAmounts) const;
 
     //! Get the size of the none databased cache
     size_t GetCacheSize() const;
 
-    //! Flush a cache to a different cache (usually passets), save to database if fToDataBase is true
+    //! Flush a cache to its base cache (or passets if it has none), save to database if fToDataBase is true
     bool Flush(bool fSoftCopy = false, bool fToDataBase = false);
 
     void ClearDirtyCache() {
@@ -291,11 +324,8 @@ public :
         setChangeOwnedOutPoints.clear();
 
         mapReissuedAssetData.clear();
-        mapAssetsAddressAmount.clear();
 
-        // Copy sets of possibilymine
-        setPossiblyMineAdd.clear();
-        setPossiblyMineRemove.clear();
+        // setPossiblyMineAdd is left alone, it is only cleared once a wallet has looked at it
     }
 
    std::string CacheToString() const {
@@ -10,4 +10,114 @@ int IntFromAssetType(AssetType type) {
 
 AssetType AssetTypeFromInt(int nType) {
     return (AssetType)nType;
-}
\ No newline at end of file
+}
+
+CAssetsMetaCache::CAssetsMetaCache(size_t nMaxSize, size_t nMaxAbsentSize) : nHits(0), nAbsentHits(0), nMisses(0)
+{
+    for (Shard& shard : shards) {
+        shard.known.SetSize((nMaxSize + ASSETS_CACHE_SHARDS - 1) / ASSETS_CACHE_SHARDS);
+        shard.absent.SetSize((nMaxAbsentSize + ASSETS_CACHE_SHARDS - 1) / ASSETS_CACHE_SHARDS);
+    }
+}
+
+CAssetsMetaCache::Shard& CAssetsMetaCache::GetShard(const std::string& name)
+{
+    return shards[std::hash<std::string>()(name) % ASSETS_CACHE_SHARDS];
+}
+
+bool CAssetsMetaCache::Lookup(const std::string& name, DataRef& data, uint64_t* pnGeneration)
+{
+    Shard& shard = GetShard(name);
+    LOCK(shard.cs);
+    if (shard.known.TryGet(name, data)) {
+        nHits++;
+        return true;
+    }
+
+    if (shard.absent.Exists(name)) {
+        nAbsentHits++;
+        data.reset();
+        return true;
+    }
+
+    nMisses++;
+    if (pnGeneration)
+        *pnGeneration = shard.nGeneration;
+    return false;
+}
+
+void CAssetsMetaCache::Put(const std::string& name, const CDatabasedAssetData& data)
+{
+    DataRef ref = std::make_shared<const CDatabasedAssetData>(data);
+
+    Shard& shard = GetShard(name);
+    LOCK(shard.cs);
+    shard.nGeneration++;
+    shard.absent.Erase(name);
+    shard.known.Put(name, ref);
+}
+
+void CAssetsMetaCache::PutLoaded(const std::string& name, const CDatabasedAssetData& data, uint64_t nGeneration)
+{
+    DataRef ref = std::make_shared<const CDatabasedAssetData>(data);
+
+    Shard& shard = GetShard(name);
+    LOCK(shard.cs);
+    if (shard.nGeneration != nGeneration || shard.known.Exists(name))
+        return;
+    shard.absent.Erase(name);
+    shard.known.Put(name, ref);
+}
+
+void CAssetsMetaCache::PutAbsent(const std::string& name, uint64_t nGeneration)
+{
+    Shard& shard = GetShard(name);
+    LOCK(shard.cs);
+    if (shard.nGeneration != nGeneration || shard.known.Exists(name))
+        return;
+    shard.absent.Put(name, true);
+}
+
+void CAssetsMetaCache::Erase(const std::string& name)
+{
+    Shard& shard = GetShard(name);
+    LOCK(shard.cs);
+    shard.nGeneration++;
+    shard.known.Erase(name);
+    shard.absent.Erase(name);
+}
+
+void CAssetsMetaCache::Clear()
+{
+    for (Shard& shard : shards) {
+        LOCK(shard.cs);
+        shard.known.Clear();
+        shard.absent.Clear();
+    }
+}
+
+size_t CAssetsMetaCache::Size() const
+{
+    size_t nSize = 0;
+    for (const Shard& shard : shards) {
+        LOCK(shard.cs);
+        nSize += shard.known.Size();
+    }
+    return nSize;
+}
+
+CAssetsMetaCache::Stats CAssetsMetaCache::GetStats() const
+{
+    Stats stats;
+    stats.nHits = nHits;
+    stats.nAbsentHits = nAbsentHits;
+    stats.nMisses = nMisses;
+    stats.nEntries = 0;
+    stats.nAbsentEntries = 0;
+    for (const Shard& shard : shards) {
+        LOCK(shard.cs);
+        stats.nEntries += shard.known.Size();
+        stats.nAbsentEntries += shard.absent.Size();
+    }
+    return stats;
+}
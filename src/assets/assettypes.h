@@ -10,8 +10,11 @@
 #include <sstream>
 #include <list>
 #include <unordered_map>
+#include <memory>
+#include <atomic>
 #include "amount.h"
 #include "primitives/transaction.h"
+#include "sync.h"
 
 #define MAX_UNIT 8
 #define MIN_UNIT 0
@@ -425,6 +428,18 @@ public:
         return cacheItemsMap.find(key) != cacheItemsMap.end();
     }
 
+    //! Same as Exists() followed by Get(), without looking the key up twice
+    bool TryGet(const cache_key_t& key, cache_value_t& value)
+    {
+        auto it = cacheItemsMap.find(key);
+        if (it == cacheItemsMap.end())
+            return false;
+
+        cacheItemsList.splice(cacheItemsList.begin(), cacheItemsList, it->second);
+        value = it->second->second;
+        return true;
+    }
+
     size_t Size() const
     {
         return cacheItemsMap.size();
@@ -468,4 +483,74 @@ private:
     size_t maxSize;
 };
 
+// Number of independently locked parts of CAssetsMetaCache
+#define ASSETS_CACHE_SHARDS 16
+
+/**
+ * Cache of the asset meta data stored in the assets database, safe to use from multiple threads.
+ * Names are spread over shards that each have their own lock and LRU order, so lookups of different
+ * assets rarely wait on each other. Entries are handed out as shared pointers instead of copies.
+ * Names that were looked up but aren't in the database are remembered too (in a separate, smaller LRU
+ * so they can't push out real assets), which keeps repeated lookups of unknown names off LevelDB.
+ *
+ * The cache has to be kept in sync with the database by whoever writes to it: Put() or Erase()
+ * a name whenever its database entry changes, Erase() only after the database write.
+ *
+ * Readers that miss and go to the database race with those writers, so they only add what they
+ * read with PutLoaded() or PutAbsent(), passing the generation that Lookup() returned on the miss.
+ * Every Put() and Erase() bumps the generation of the shard, and a reader's entry is dropped if
+ * the generation changed in between (its read may be stale) or the name is known by now.
+ */
+class CAssetsMetaCache
+{
+public:
+    typedef std::shared_ptr<const CDatabasedAssetData> DataRef;
+
+    struct Stats
+    {
+        uint64_t nHits;
+        uint64_t nAbsentHits;
+        uint64_t nMisses;
+        size_t nEntries;
+        size_t nAbsentEntries;
+    };
+
+    CAssetsMetaCache(size_t nMaxSize, size_t nMaxAbsentSize);
+
+    /**
+     * Returns true if the name is cached. data is set to null if the name is cached as not existing.
+     * On a miss, pnGeneration (if given) is set to what PutLoaded() or PutAbsent() expect.
+     */
+    bool Lookup(const std::string& name, DataRef& data, uint64_t* pnGeneration = nullptr);
+    //! Store data written to the database
+    void Put(const std::string& name, const CDatabasedAssetData& data);
+    //! Remember data read from the database, unless it may have changed since the Lookup() miss
+    void PutLoaded(const std::string& name, const CDatabasedAssetData& data, uint64_t nGeneration);
+    //! Remember that the database doesn't have this name, unless it may have changed since the Lookup() miss
+    void PutAbsent(const std::string& name, uint64_t nGeneration);
+    void Erase(const std::string& name);
+    void Clear();
+
+    //! Number of cached assets, not counting absent names
+    size_t Size() const;
+    Stats GetStats() const;
+
+private:
+    struct Shard
+    {
+        mutable CCriticalSection cs;
+        CLRUCache<std::string, DataRef> known;
+        CLRUCache<std::string, bool> absent;
+        //! Bumped by every Put() and Erase() on the shard
+        uint64_t nGeneration = 0;
+    };
+
+    Shard& GetShard(const std::string& name);
+
+    Shard shards[ASSETS_CACHE_SHARDS];
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nAbsentHits;
+    std::atomic<uint64_t> nMisses;
+};
+
 #endif //RAVENCOIN_NEWASSET_H
@@ -0,0 +1,28 @@
+// Copyright (c) 2017 The Astral Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "assets/assets.h"
+
+#include <string>
+#include <vector>
+
+
+static void AssetNameValidation(benchmark::State& state)
+{
+    static const std::vector<std::string> names = {
+        "ASTRAL_ASSET", "ASTRAL_ASSET/SUB.NAME", "ASTRAL_ASSET/SUB#Unique-Tag", "ASTRAL_ASSET!",
+        "ASTRAL_ASSET~CHANNEL", "ASTRAL_ASSET^VOTE", "_INVALID", "invalid", "ASTRAL"
+    };
+
+    AssetType type;
+    std::string error;
+    while (state.KeepRunning()) {
+        for (const auto& name : names)
+            IsAssetNameValid(name, type, error);
+    }
+}
+
+BENCHMARK(AssetNameValidation);
@@ -6,6 +6,7 @@
 #include "bench.h"
 
 #include "crypto/sha256.h"
+#include "hash.h"
 #include "key.h"
 #include "validation.h"
 #include "util.h"
@@ -15,6 +16,7 @@ int
 main(int argc, char** argv)
 {
     SHA256AutoDetect();
+    X20RAutoDetect();
     RandomInit();
     ECC_Start();
     SetupEnvironment();
@@ -0,0 +1,205 @@
+// Copyright (c) 2017 The Astral Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "arith_uint256.h"
+#include "consensus/params.h"
+#include "hash.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "uint256.h"
+#include "util.h"
+#include "validation.h"
+#include "workerpool.h"
+
+#include <string.h>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+/* Number of hashes per iteration */
+static const int X20R_ITERATIONS = 1000;
+
+/* Run primitive nAlgo over nLen byte inputs, as stage 0 (80) or a later stage (64) of X20R */
+static void X20RPrimitive(benchmark::State& state, int nAlgo, size_t nLen)
+{
+    std::vector<unsigned char> in(nLen, 0);
+    uint512 out;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < X20R_ITERATIONS; i++) {
+            HashX20RStage(nAlgo, in.data(), in.size(), out);
+            in[0] = *out.begin();
+        }
+    }
+}
+
+#define X20R_PRIMITIVE_BENCHMARKS(n, name)                                                          \
+    static void X20R_##name##_80b(benchmark::State& state) { X20RPrimitive(state, n, 80); }         \
+    static void X20R_##name##_64b(benchmark::State& state) { X20RPrimitive(state, n, 64); }         \
+    BENCHMARK(X20R_##name##_80b);                                                                   \
+    BENCHMARK(X20R_##name##_64b);
+
+X20R_PRIMITIVE_BENCHMARKS(0, blake512)
+X20R_PRIMITIVE_BENCHMARKS(1, bmw512)
+X20R_PRIMITIVE_BENCHMARKS(2, groestl512)
+X20R_PRIMITIVE_BENCHMARKS(3, jh512)
+X20R_PRIMITIVE_BENCHMARKS(4, keccak512)
+X20R_PRIMITIVE_BENCHMARKS(5, skein512)
+X20R_PRIMITIVE_BENCHMARKS(6, luffa512)
+X20R_PRIMITIVE_BENCHMARKS(7, cubehash512)
+X20R_PRIMITIVE_BENCHMARKS(8, shavite512)
+X20R_PRIMITIVE_BENCHMARKS(9, simd512)
+X20R_PRIMITIVE_BENCHMARKS(10, echo512)
+X20R_PRIMITIVE_BENCHMARKS(11, hamsi512)
+X20R_PRIMITIVE_BENCHMARKS(12, fugue512)
+X20R_PRIMITIVE_BENCHMARKS(13, shabal512)
+X20R_PRIMITIVE_BENCHMARKS(14, whirlpool)
+X20R_PRIMITIVE_BENCHMARKS(15, sha512)
+X20R_PRIMITIVE_BENCHMARKS(16, haval256_5)
+X20R_PRIMITIVE_BENCHMARKS(17, gost512)
+X20R_PRIMITIVE_BENCHMARKS(18, radiogatun64)
+X20R_PRIMITIVE_BENCHMARKS(19, panama)
+
+/* Previous block hashes covering a spread of algorithm orders */
+static std::vector<uint256> X20RPrevBlockHashes()
+{
+    FastRandomContext rng(true);
+    std::vector<uint256> hashes;
+    for (int i = 0; i < 64; i++)
+        hashes.push_back(rng.rand256());
+    return hashes;
+}
+
+static void X20R_Header(benchmark::State& state)
+{
+    const std::vector<uint256> prevHashes = X20RPrevBlockHashes();
+    std::vector<unsigned char> header(80, 0);
+    while (state.KeepRunning()) {
+        for (const uint256& hashPrevBlock : prevHashes) {
+            uint256 hash = HashX20R(header.begin(), header.end(), hashPrevBlock);
+            header[0] = *hash.begin();
+        }
+    }
+}
+
+/* The miner's inner loop: one header per nonce, from a stage 0 midstate of the header prefix */
+static void X20R_HeaderMidstate(benchmark::State& state)
+{
+    std::vector<unsigned char> header(X20R_MIDSTATE_SIZE + X20R_HEADER_TAIL_SIZE, 0);
+    std::vector<CX20RMidstate> midstates;
+    for (const uint256& hashPrevBlock : X20RPrevBlockHashes())
+        midstates.emplace_back(header.data(), hashPrevBlock);
+    unsigned char* ptail = header.data() + X20R_MIDSTATE_SIZE;
+    while (state.KeepRunning()) {
+        for (const CX20RMidstate& midstate : midstates) {
+            uint256 hash = midstate.Hash(ptail);
+            ptail[X20R_HEADER_TAIL_SIZE - 1] = *hash.begin();
+        }
+    }
+}
+
+/* Headers with differing algorithm orders hashed together, sharing the multi-lane kernels where they meet */
+static void X20R_HeaderBatch(benchmark::State& state)
+{
+    const std::vector<uint256> prevHashes = X20RPrevBlockHashes();
+    std::vector<unsigned char> headers(80 * prevHashes.size(), 0);
+    for (size_t n = 0; n < prevHashes.size(); n++)
+        memcpy(&headers[80 * n + 4], prevHashes[n].begin(), 32);
+    std::vector<uint256> hashes(prevHashes.size());
+    while (state.KeepRunning()) {
+        HashX20RHeaders(headers.data(), prevHashes.size(), hashes.data());
+        headers[0] = *hashes[0].begin();
+    }
+}
+
+/* The miner's inner loop as it runs: X20R_KERNEL_LANES nonces per call from the midstate */
+static void X20R_HeaderMidstateBatch(benchmark::State& state)
+{
+    std::vector<unsigned char> header(X20R_MIDSTATE_SIZE + X20R_HEADER_TAIL_SIZE, 0);
+    std::vector<CX20RMidstate> midstates;
+    const std::vector<uint256> prevHashes = X20RPrevBlockHashes();
+    for (size_t n = 0; n < prevHashes.size(); n += X20R_KERNEL_LANES)
+        midstates.emplace_back(header.data(), prevHashes[n]);
+    std::vector<unsigned char> tails(X20R_HEADER_TAIL_SIZE * X20R_KERNEL_LANES, 0);
+    for (size_t k = 0; k < X20R_KERNEL_LANES; k++)
+        tails[X20R_HEADER_TAIL_SIZE * (k + 1) - 4] = k;
+    uint256 hashes[X20R_KERNEL_LANES];
+    while (state.KeepRunning()) {
+        for (const CX20RMidstate& midstate : midstates) {
+            midstate.HashBatch(tails.data(), X20R_KERNEL_LANES, hashes);
+            tails[X20R_HEADER_TAIL_SIZE - 1] = *hashes[0].begin();
+        }
+    }
+}
+
+/* Hash a headers message of nHeaders headers serially, or with HashBlockHeaders on the worker pool */
+static void X20RHeadersMessage(benchmark::State& state, size_t nHeaders, bool fParallel)
+{
+    // With the easiest possible target next to no header fails the proof of work check, which
+    // would skip the headers after it
+    Consensus::Params params;
+    params.powLimit = ArithToUint256(~arith_uint256());
+    const std::vector<uint256> prevHashes = X20RPrevBlockHashes();
+    std::vector<CBlockHeader> headers(nHeaders);
+    for (size_t i = 0; i < headers.size(); i++) {
+        headers[i].hashPrevBlock = prevHashes[i % prevHashes.size()];
+        headers[i].nBits = UintToArith256(params.powLimit).GetCompact();
+        headers[i].nNonce = i;
+    }
+
+    const int nWorkers = std::max(1, GetNumCores() - 1);
+    boost::thread_group threadGroup;
+    if (fParallel) {
+        for (int i = 0; i < nWorkers; i++)
+            threadGroup.create_thread(&ThreadWorkerPool);
+        while (workerpool.ThreadCount() < nWorkers)
+            MilliSleep(1);
+    }
+
+    while (state.KeepRunning()) {
+        // A changed header is hashed again
+        for (CBlockHeader& header : headers)
+            ++header.nTime;
+        if (fParallel) {
+            HashBlockHeaders(headers, params);
+        } else {
+            for (const CBlockHeader& header : headers)
+                header.GetHash();
+        }
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+static void X20R_HeadersMessage(benchmark::State& state)
+{
+    X20RHeadersMessage(state, MAX_HEADERS_RESULTS, false);
+}
+
+static void X20R_HeadersMessageParallel(benchmark::State& state)
+{
+    X20RHeadersMessage(state, MAX_HEADERS_RESULTS, true);
+}
+
+/* The smallest headers message HashBlockHeaders hands to the worker pool */
+static void X20R_HeadersMessageSmall(benchmark::State& state)
+{
+    X20RHeadersMessage(state, 8, false);
+}
+
+static void X20R_HeadersMessageSmallParallel(benchmark::State& state)
+{
+    X20RHeadersMessage(state, 8, true);
+}
+
+BENCHMARK(X20R_Header);
+BENCHMARK(X20R_HeaderMidstate);
+BENCHMARK(X20R_HeaderBatch);
+BENCHMARK(X20R_HeaderMidstateBatch);
+BENCHMARK(X20R_HeadersMessage);
+BENCHMARK(X20R_HeadersMessageParallel);
+BENCHMARK(X20R_HeadersMessageSmall);
+BENCHMARK(X20R_HeadersMessageSmallParallel);
@@ -162,6 +162,9 @@ enum BlockStatus: uint32_t {
     BLOCK_FAILED_MASK        =   BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
 
     BLOCK_OPT_WITNESS       =   128, //!< block data in blk*.data was received with a witness-enforcing client
+
+    BLOCK_WITNESS_KNOWN     =   256, //!< BLOCK_HAVE_WITNESS is set for the block data in blk*.dat
+    BLOCK_HAVE_WITNESS      =   512, //!< a transaction of the block data in blk*.dat has witness data
 };
 
 /** The block chain is a tree shaped structure starting with the
@@ -409,7 +412,7 @@ public:
         READWRITE(nNonce);
     }
 
-    uint256 GetBlockHash() const
+    CBlockHeader GetBlockHeader() const
     {
         CBlockHeader block;
         block.nVersion        = nVersion;
@@ -418,7 +421,12 @@ public:
         block.nTime           = nTime;
         block.nBits           = nBits;
         block.nNonce          = nNonce;
-        return block.GetHash();
+        return block;
+    }
+
+    uint256 GetBlockHash() const
+    {
+        return GetBlockHeader().GetHash();
     }
 
 
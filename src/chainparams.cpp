@@ -16,11 +16,6 @@
 
 #include "chainparamsseeds.h"
 
-//TODO: Take these out
-extern double algoHashTotal[20];
-extern int algoHashHits[20];
-
-
 static CBlock CreateGenesisBlock(const char* pszTimestamp, const CScript& genesisOutputScript, uint32_t nTime, uint32_t nNonce, uint32_t nBits, int32_t nVersion, const CAmount& genesisReward)
 {
     CMutableTransaction txNew;
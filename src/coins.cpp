@@ -22,6 +22,15 @@ std::vector<uint256> CCoinsView::GetHeadBlocks() const { return std::vector<uint
 bool CCoinsView::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) { return false; }
 CCoinsViewCursor *CCoinsView::Cursor() const { return nullptr; }
 
+void CCoinsView::GetCoins(const std::vector<COutPoint> &vOutpoints, std::vector<Coin> &vCoins) const
+{
+    vCoins.resize(vOutpoints.size());
+    for (size_t i = 0; i < vOutpoints.size(); i++) {
+        if (!GetCoin(vOutpoints[i], vCoins[i]))
+            vCoins[i].Clear();
+    }
+}
+
 bool CCoinsView::HaveCoin(const COutPoint &outpoint) const
 {
     Coin coin;
@@ -72,6 +81,36 @@ bool CCoinsViewCache::GetCoin(const COutPoint &outpoint, Coin &coin) const {
     return false;
 }
 
+void CCoinsViewCache::GetCoins(const std::vector<COutPoint> &vOutpoints, std::vector<Coin> &vCoins) const {
+    std::vector<COutPoint> vMissing;
+    for (const COutPoint &outpoint : vOutpoints) {
+        if (!cacheCoins.count(outpoint))
+            vMissing.push_back(outpoint);
+    }
+
+    if (!vMissing.empty()) {
+        std::vector<Coin> vFetched;
+        base->GetCoins(vMissing, vFetched);
+        for (size_t i = 0; i < vMissing.size(); i++) {
+            // Same as FetchCoin, only cache what the base actually has
+            if (vFetched[i].IsSpent())
+                continue;
+            auto ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(vMissing[i]), std::forward_as_tuple(std::move(vFetched[i])));
+            if (ret.second)
+                cachedCoinsUsage += ret.first->second.coin.DynamicMemoryUsage();
+        }
+    }
+
+    vCoins.resize(vOutpoints.size());
+    for (size_t i = 0; i < vOutpoints.size(); i++) {
+        CCoinsMap::const_iterator it = cacheCoins.find(vOutpoints[i]);
+        if (it != cacheCoins.end())
+            vCoins[i] = it->second.coin;
+        else
+            vCoins[i].Clear();
+    }
+}
+
 void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possible_overwrite) {
     assert(!coin.IsSpent());
     if (coin.out.scriptPubKey.IsUnspendable()) return;
@@ -158,6 +158,12 @@ public:
      */
     virtual bool GetCoin(const COutPoint &outpoint, Coin &coin) const;
 
+    /** Retrieve the Coins for several outpoints at once. vCoins ends up the same size as
+     *  vOutpoints, outpoints without an unspent coin get a spent (cleared) Coin.
+     *  The default does one GetCoin() at a time, views that can batch lookups override it.
+     */
+    virtual void GetCoins(const std::vector<COutPoint> &vOutpoints, std::vector<Coin> &vCoins) const;
+
     //! Just check whether a given outpoint is unspent.
     virtual bool HaveCoin(const COutPoint &outpoint) const;
 
@@ -228,6 +234,8 @@ public:
 
     // Standard CCoinsView methods
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    //! Everything missing from this cache is requested from the base in one batch, and cached
+    void GetCoins(const std::vector<COutPoint> &vOutpoints, std::vector<Coin> &vCoins) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
     void SetBestBlock(const uint256 &hashBlock);
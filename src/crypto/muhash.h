@@ -0,0 +1,107 @@
+// Copyright (c) 2017-2020 The Bitcoin Core developers
+// Copyright (c) 2017 The Astral Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAVEN_CRYPTO_MUHASH_H
+#define RAVEN_CRYPTO_MUHASH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** An element of the multiplicative group of integers modulo the prime 2^3072 - 1103717. */
+class Num3072
+{
+public:
+    static const size_t BYTE_SIZE = 384;
+
+#if defined(__SIZEOF_INT128__)
+    typedef unsigned __int128 double_limb_t;
+    typedef uint64_t limb_t;
+    static const int LIMBS = 48;
+    static const int LIMB_SIZE = 64;
+#else
+    typedef uint64_t double_limb_t;
+    typedef uint32_t limb_t;
+    static const int LIMBS = 96;
+    static const int LIMB_SIZE = 32;
+#endif
+
+    limb_t limbs[LIMBS];
+
+    //! Sets the number to one
+    Num3072() { SetToOne(); }
+    //! Reads a little endian number of BYTE_SIZE bytes (which may be larger than the modulus)
+    explicit Num3072(const unsigned char (&data)[BYTE_SIZE]);
+
+    void SetToOne();
+    void Multiply(const Num3072& a);
+    void Divide(const Num3072& a);
+    //! Writes the number, fully reduced, as BYTE_SIZE little endian bytes
+    void ToBytes(unsigned char (&out)[BYTE_SIZE]);
+
+private:
+    bool IsOverflow() const;
+    void FullReduce();
+    Num3072 GetInverse() const;
+};
+
+/**
+ * A multiplicative hash of a set of byte strings, as proposed for UTXO set commitments
+ * (https://cseweb.ucsd.edu/~mihir/papers/inchash.pdf). Each element is hashed to a number modulo
+ * a 3072 bit prime, and the set hash is their product, so elements can be added (multiplied in)
+ * and removed (divided out) in any order. Unlike an additive hash, finding a collision is as
+ * hard as the discrete logarithm problem in that group.
+ *
+ * Divisions are only carried out by Finalize(): removals are multiplied into a separate
+ * denominator, which keeps Insert() and Remove() equally cheap.
+ */
+class MuHash3072
+{
+private:
+    Num3072 numerator;
+    Num3072 denominator;
+
+    static Num3072 ToNum3072(const unsigned char* data, size_t len);
+
+public:
+    //! The hash of the empty set
+    MuHash3072() {}
+    //! The hash of the set holding just this element
+    MuHash3072(const unsigned char* data, size_t len);
+
+    MuHash3072& Insert(const unsigned char* data, size_t len);
+    MuHash3072& Remove(const unsigned char* data, size_t len);
+
+    //! Union of two sets
+    MuHash3072& operator*=(const MuHash3072& mul);
+    //! Difference of two sets, the second of which must be a subset of the first
+    MuHash3072& operator/=(const MuHash3072& div);
+
+    //! Writes the 32 byte hash of the set. Folds the denominator into the numerator first.
+    void Finalize(unsigned char out[32]);
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        unsigned char data[Num3072::BYTE_SIZE];
+        Num3072 num = numerator;
+        num.ToBytes(data);
+        s.write((char*)data, sizeof(data));
+        num = denominator;
+        num.ToBytes(data);
+        s.write((char*)data, sizeof(data));
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        unsigned char data[Num3072::BYTE_SIZE];
+        s.read((char*)data, sizeof(data));
+        numerator = Num3072(data);
+        s.read((char*)data, sizeof(data));
+        denominator = Num3072(data);
+    }
+};
+
+#endif // RAVEN_CRYPTO_MUHASH_H
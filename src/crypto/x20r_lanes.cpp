@@ -0,0 +1,909 @@
+// Copyright (c) 2017 The Astral Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/x20r_lanes.h"
+
+#include "crypto/common.h"
+
+#if X20R_HAVE_LANES
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace x20r_lanes
+{
+
+#if X20R_HAVE_LANES
+
+bool Supported()
+{
+    uint32_t eax, ebx, ecx, edx;
+    // The OS has to save the ymm registers (OSXSAVE, then XCR0 bits 1 and 2) besides the CPU having AVX and AVX2
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !((ecx >> 27) & 1) || !((ecx >> 28) & 1))
+        return false;
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6) != 6)
+        return false;
+    if (__get_cpuid_max(0, nullptr) < 7)
+        return false;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx >> 5) & 1;
+}
+
+#define X20R_AVX2 __attribute__((target("avx2")))
+
+namespace
+{
+
+/** One 64 bit word of every lane. */
+typedef uint64_t u64x4 __attribute__((vector_size(32)));
+/** One 32 bit word of every lane. */
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+
+static_assert(LANES == 4, "the lane vectors hold four lanes");
+
+inline X20R_AVX2 u64x4 Splat64(uint64_t x) { return u64x4{x, x, x, x}; }
+
+inline X20R_AVX2 u64x4 Rotl64(u64x4 x, int n) { return (x << n) | (x >> (64 - n)); }
+inline X20R_AVX2 u64x4 Rotr64(u64x4 x, int n) { return (x >> n) | (x << (64 - n)); }
+inline X20R_AVX2 u32x4 Splat32(uint32_t x) { return u32x4{x, x, x, x}; }
+inline X20R_AVX2 u32x4 Rotl32(u32x4 x, int n) { return (x << n) | (x >> (32 - n)); }
+
+inline X20R_AVX2 u64x4 LoadLE64(const unsigned char* const in[LANES], size_t pos)
+{
+    return u64x4{ReadLE64(in[0] + pos), ReadLE64(in[1] + pos), ReadLE64(in[2] + pos), ReadLE64(in[3] + pos)};
+}
+
+inline X20R_AVX2 u64x4 LoadBE64(const unsigned char* const in[LANES], size_t pos)
+{
+    return u64x4{ReadBE64(in[0] + pos), ReadBE64(in[1] + pos), ReadBE64(in[2] + pos), ReadBE64(in[3] + pos)};
+}
+
+inline X20R_AVX2 u32x4 LoadBE32(const unsigned char* const in[LANES], size_t pos)
+{
+    return u32x4{ReadBE32(in[0] + pos), ReadBE32(in[1] + pos), ReadBE32(in[2] + pos), ReadBE32(in[3] + pos)};
+}
+
+inline X20R_AVX2 void StoreLE64(unsigned char* const out[LANES], size_t pos, u64x4 x)
+{
+    for (size_t i = 0; i < LANES; i++)
+        WriteLE64(out[i] + pos, x[i]);
+}
+
+inline X20R_AVX2 void StoreBE64(unsigned char* const out[LANES], size_t pos, u64x4 x)
+{
+    for (size_t i = 0; i < LANES; i++)
+        WriteBE64(out[i] + pos, x[i]);
+}
+
+inline X20R_AVX2 void StoreBE32(unsigned char* const out[LANES], size_t pos, u32x4 x)
+{
+    for (size_t i = 0; i < LANES; i++)
+        WriteBE32(out[i] + pos, x[i]);
+}
+
+// Keccak-512 as sph_keccak512 computes it: the original Keccak padding, 72 byte rate
+
+const uint64_t KECCAK_RC[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+    0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+// The rho and pi steps move each lane along a single cycle through the state, rotating it as it goes
+#define KECCAK_RHO_PI(j, r) do { const u64x4 next = st[j]; st[j] = Rotl64(t, r); t = next; } while (0)
+
+#define KECCAK_THETA(i) do { \
+        const u64x4 d = bc[(i + 4) % 5] ^ Rotl64(bc[(i + 1) % 5], 1); \
+        st[i] ^= d; st[i + 5] ^= d; st[i + 10] ^= d; st[i + 15] ^= d; st[i + 20] ^= d; \
+    } while (0)
+
+#define KECCAK_CHI(j) do { \
+        const u64x4 a0 = st[j], a1 = st[j + 1], a2 = st[j + 2], a3 = st[j + 3], a4 = st[j + 4]; \
+        st[j] ^= ~a1 & a2; st[j + 1] ^= ~a2 & a3; st[j + 2] ^= ~a3 & a4; st[j + 3] ^= ~a4 & a0; st[j + 4] ^= ~a0 & a1; \
+    } while (0)
+
+X20R_AVX2 void KeccakF1600(u64x4 st[25])
+{
+    for (int round = 0; round < 24; round++) {
+        u64x4 bc[5];
+        for (int i = 0; i < 5; i++)
+            bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20];
+        KECCAK_THETA(0); KECCAK_THETA(1); KECCAK_THETA(2); KECCAK_THETA(3); KECCAK_THETA(4);
+
+        u64x4 t = st[1];
+        KECCAK_RHO_PI(10, 1); KECCAK_RHO_PI(7, 3); KECCAK_RHO_PI(11, 6); KECCAK_RHO_PI(17, 10);
+        KECCAK_RHO_PI(18, 15); KECCAK_RHO_PI(3, 21); KECCAK_RHO_PI(5, 28); KECCAK_RHO_PI(16, 36);
+        KECCAK_RHO_PI(8, 45); KECCAK_RHO_PI(21, 55); KECCAK_RHO_PI(24, 2); KECCAK_RHO_PI(4, 14);
+        KECCAK_RHO_PI(15, 27); KECCAK_RHO_PI(23, 41); KECCAK_RHO_PI(19, 56); KECCAK_RHO_PI(13, 8);
+        KECCAK_RHO_PI(12, 25); KECCAK_RHO_PI(2, 43); KECCAK_RHO_PI(20, 62); KECCAK_RHO_PI(14, 18);
+        KECCAK_RHO_PI(22, 39); KECCAK_RHO_PI(9, 61); KECCAK_RHO_PI(6, 20); KECCAK_RHO_PI(1, 44);
+
+        KECCAK_CHI(0); KECCAK_CHI(5); KECCAK_CHI(10); KECCAK_CHI(15); KECCAK_CHI(20);
+        st[0] ^= Splat64(KECCAK_RC[round]);
+    }
+}
+
+#undef KECCAK_CHI
+#undef KECCAK_THETA
+#undef KECCAK_RHO_PI
+
+// SHA-512
+
+const uint64_t SHA512_K[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+const uint64_t SHA512_IV[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+// BLAKE-512, 16 rounds. Its IV is the SHA-512 one.
+
+const uint64_t BLAKE512_C[16] = {
+    0x243f6a8885a308d3ULL, 0x13198a2e03707344ULL, 0xa4093822299f31d0ULL, 0x082efa98ec4e6c89ULL,
+    0x452821e638d01377ULL, 0xbe5466cf34e90c6cULL, 0xc0ac29b7c97c50ddULL, 0x3f84d5b5b5470917ULL,
+    0x9216d5d98979fb1bULL, 0xd1310ba698dfb5acULL, 0x2ffd72dbd01adfb7ULL, 0xb8e1afed6a267e96ULL,
+    0xba7c9045f12c7f99ULL, 0x24a19947b3916cf7ULL, 0x0801f2e2858efc16ULL, 0x636920d871574e69ULL
+};
+
+const uint8_t BLAKE_SIGMA[10][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0}
+};
+
+inline X20R_AVX2 void BlakeG(const u64x4 m[16], const uint8_t* s, int i, u64x4& a, u64x4& b, u64x4& c, u64x4& d)
+{
+    a += b + (m[s[2 * i]] ^ Splat64(BLAKE512_C[s[2 * i + 1]]));
+    d = Rotr64(d ^ a, 32);
+    c += d;
+    b = Rotr64(b ^ c, 25);
+    a += b + (m[s[2 * i + 1]] ^ Splat64(BLAKE512_C[s[2 * i]]));
+    d = Rotr64(d ^ a, 16);
+    c += d;
+    b = Rotr64(b ^ c, 11);
+}
+
+// Skein-512-512: one UBI message block, then the output block
+
+const uint64_t SKEIN512_IV[8] = {
+    0x4903adff749c51ceULL, 0x0d95de399746df03ULL, 0x8fd1934127c79bceULL, 0x9a255629ff352cb1ULL,
+    0x5db62599df6ca7b0ULL, 0xeabe394ca9d5c3f4ULL, 0x991112c71a75b523ULL, 0xae18a40b660fcc33ULL
+};
+
+const uint64_t SKEIN_KS_PARITY = 0x1bd11bdaa9fc1a22ULL;
+const uint64_t SKEIN_T1_FIRST_FINAL = 3ULL << 62;
+const uint64_t SKEIN_T1_MSG = 48ULL << 56;
+const uint64_t SKEIN_T1_OUT = 63ULL << 56;
+
+#define SKEIN_MIX(a, b, r) do { a += b; b = Rotl64(b, r) ^ a; } while (0)
+
+#define SKEIN_ROUNDS(r00, r01, r02, r03, r10, r11, r12, r13, r20, r21, r22, r23, r30, r31, r32, r33) do { \
+        SKEIN_MIX(x0, x1, r00); SKEIN_MIX(x2, x3, r01); SKEIN_MIX(x4, x5, r02); SKEIN_MIX(x6, x7, r03); \
+        SKEIN_MIX(x2, x1, r10); SKEIN_MIX(x4, x7, r11); SKEIN_MIX(x6, x5, r12); SKEIN_MIX(x0, x3, r13); \
+        SKEIN_MIX(x4, x1, r20); SKEIN_MIX(x6, x3, r21); SKEIN_MIX(x0, x5, r22); SKEIN_MIX(x2, x7, r23); \
+        SKEIN_MIX(x6, x1, r30); SKEIN_MIX(x0, x7, r31); SKEIN_MIX(x2, x5, r32); SKEIN_MIX(x4, x3, r33); \
+    } while (0)
+
+#define SKEIN_INJECT(s) do { \
+        x0 += ks[(s) % 9]; \
+        x1 += ks[((s) + 1) % 9]; \
+        x2 += ks[((s) + 2) % 9]; \
+        x3 += ks[((s) + 3) % 9]; \
+        x4 += ks[((s) + 4) % 9]; \
+        x5 += ks[((s) + 5) % 9] + Splat64(ts[(s) % 3]); \
+        x6 += ks[((s) + 6) % 9] + Splat64(ts[((s) + 1) % 3]); \
+        x7 += ks[((s) + 7) % 9] + Splat64((uint64_t)(s)); \
+    } while (0)
+
+/** One UBI block: Threefish-512 of p under key k and tweak (t0, t1), fed forward, so p ends up holding the new chaining value. */
+X20R_AVX2 void SkeinUBI(const u64x4 k[8], uint64_t t0, uint64_t t1, u64x4 p[8])
+{
+    u64x4 ks[9];
+    ks[8] = Splat64(SKEIN_KS_PARITY);
+    for (int i = 0; i < 8; i++) {
+        ks[i] = k[i];
+        ks[8] ^= k[i];
+    }
+    const uint64_t ts[3] = {t0, t1, t0 ^ t1};
+
+    u64x4 x0 = p[0], x1 = p[1], x2 = p[2], x3 = p[3], x4 = p[4], x5 = p[5], x6 = p[6], x7 = p[7];
+    for (int s = 0; s < 18; s += 2) {
+        SKEIN_INJECT(s);
+        SKEIN_ROUNDS(46, 36, 19, 37, 33, 27, 14, 42, 17, 49, 36, 39, 44, 9, 54, 56);
+        SKEIN_INJECT(s + 1);
+        SKEIN_ROUNDS(39, 30, 34, 24, 13, 50, 10, 17, 25, 29, 39, 43, 8, 35, 56, 22);
+    }
+    SKEIN_INJECT(18);
+    p[0] ^= x0;
+    p[1] ^= x1;
+    p[2] ^= x2;
+    p[3] ^= x3;
+    p[4] ^= x4;
+    p[5] ^= x5;
+    p[6] ^= x6;
+    p[7] ^= x7;
+}
+
+#undef SKEIN_INJECT
+#undef SKEIN_ROUNDS
+#undef SKEIN_MIX
+
+// BMW-512: one compression of the padded message, then the final one keyed with 0xaaaaaaaaaaaaaaa0 + i
+
+const uint64_t BMW512_IV[16] = {
+    0x8081828384858687ULL, 0x88898a8b8c8d8e8fULL, 0x9091929394959697ULL, 0x98999a9b9c9d9e9fULL,
+    0xa0a1a2a3a4a5a6a7ULL, 0xa8a9aaabacadaeafULL, 0xb0b1b2b3b4b5b6b7ULL, 0xb8b9babbbcbdbebfULL,
+    0xc0c1c2c3c4c5c6c7ULL, 0xc8c9cacbcccdcecfULL, 0xd0d1d2d3d4d5d6d7ULL, 0xd8d9dadbdcdddedfULL,
+    0xe0e1e2e3e4e5e6e7ULL, 0xe8e9eaebecedeeefULL, 0xf0f1f2f3f4f5f6f7ULL, 0xf8f9fafbfcfdfeffULL
+};
+
+inline X20R_AVX2 u64x4 BmwS0(u64x4 x) { return (x >> 1) ^ (x << 3) ^ Rotl64(x, 4) ^ Rotl64(x, 37); }
+inline X20R_AVX2 u64x4 BmwS1(u64x4 x) { return (x >> 1) ^ (x << 2) ^ Rotl64(x, 13) ^ Rotl64(x, 43); }
+inline X20R_AVX2 u64x4 BmwS2(u64x4 x) { return (x >> 2) ^ (x << 1) ^ Rotl64(x, 19) ^ Rotl64(x, 53); }
+inline X20R_AVX2 u64x4 BmwS3(u64x4 x) { return (x >> 2) ^ (x << 2) ^ Rotl64(x, 28) ^ Rotl64(x, 59); }
+inline X20R_AVX2 u64x4 BmwS4(u64x4 x) { return (x >> 1) ^ x; }
+inline X20R_AVX2 u64x4 BmwS5(u64x4 x) { return (x >> 2) ^ x; }
+
+//! The five (M ^ H) words each W_j of f0 sums, and which of them it subtracts instead (bit k for word k)
+const uint8_t BMW_W_IDX[16][5] = {
+    {5, 7, 10, 13, 14}, {6, 8, 11, 14, 15}, {0, 7, 9, 12, 15}, {0, 1, 8, 10, 13},
+    {1, 2, 9, 11, 14}, {3, 2, 10, 12, 15}, {4, 0, 3, 11, 13}, {1, 4, 5, 12, 14},
+    {2, 5, 6, 13, 15}, {0, 3, 6, 7, 14}, {8, 1, 4, 7, 15}, {8, 0, 2, 5, 9},
+    {1, 3, 6, 9, 10}, {2, 4, 7, 10, 11}, {3, 5, 8, 11, 12}, {12, 4, 6, 9, 13}
+};
+const uint8_t BMW_W_NEG[16] = {
+    0x02, 0x12, 0x08, 0x0a, 0x18, 0x0a, 0x0e, 0x1e,
+    0x16, 0x0a, 0x0e, 0x0e, 0x0c, 0x00, 0x1a, 0x0e
+};
+
+/** The BMW-512 compression of message m under chaining value h, which it replaces with the result. */
+X20R_AVX2 void BmwCompress(const u64x4 m[16], u64x4 h[16])
+{
+    u64x4 mh[16];
+    for (int i = 0; i < 16; i++)
+        mh[i] = m[i] ^ h[i];
+
+    u64x4 q[32];
+    for (int j = 0; j < 16; j++) {
+        u64x4 w = mh[BMW_W_IDX[j][0]];
+        for (int k = 1; k < 5; k++) {
+            if (BMW_W_NEG[j] & (1 << k))
+                w -= mh[BMW_W_IDX[j][k]];
+            else
+                w += mh[BMW_W_IDX[j][k]];
+        }
+        switch (j % 5) {
+        case 0: w = BmwS0(w); break;
+        case 1: w = BmwS1(w); break;
+        case 2: w = BmwS2(w); break;
+        case 3: w = BmwS3(w); break;
+        default: w = BmwS4(w); break;
+        }
+        q[j] = w + h[(j + 1) % 16];
+    }
+    for (int j = 16; j < 32; j++) {
+        const int i = j - 16;
+        const u64x4 add = (Rotl64(m[i], i + 1) + Rotl64(m[(i + 3) % 16], (i + 3) % 16 + 1) -
+                           Rotl64(m[(i + 10) % 16], (i + 10) % 16 + 1) + Splat64(j * 0x0555555555555555ULL)) ^
+                          h[(i + 7) % 16];
+        if (j < 18) {
+            q[j] = BmwS1(q[j - 16]) + BmwS2(q[j - 15]) + BmwS3(q[j - 14]) + BmwS0(q[j - 13]) +
+                   BmwS1(q[j - 12]) + BmwS2(q[j - 11]) + BmwS3(q[j - 10]) + BmwS0(q[j - 9]) +
+                   BmwS1(q[j - 8]) + BmwS2(q[j - 7]) + BmwS3(q[j - 6]) + BmwS0(q[j - 5]) +
+                   BmwS1(q[j - 4]) + BmwS2(q[j - 3]) + BmwS3(q[j - 2]) + BmwS0(q[j - 1]) + add;
+        } else {
+            q[j] = q[j - 16] + Rotl64(q[j - 15], 5) + q[j - 14] + Rotl64(q[j - 13], 11) +
+                   q[j - 12] + Rotl64(q[j - 11], 27) + q[j - 10] + Rotl64(q[j - 9], 32) +
+                   q[j - 8] + Rotl64(q[j - 7], 37) + q[j - 6] + Rotl64(q[j - 5], 43) +
+                   q[j - 4] + Rotl64(q[j - 3], 53) + BmwS4(q[j - 2]) + BmwS5(q[j - 1]) + add;
+        }
+    }
+
+    const u64x4 xl = q[16] ^ q[17] ^ q[18] ^ q[19] ^ q[20] ^ q[21] ^ q[22] ^ q[23];
+    const u64x4 xh = xl ^ q[24] ^ q[25] ^ q[26] ^ q[27] ^ q[28] ^ q[29] ^ q[30] ^ q[31];
+    h[0] = ((xh << 5) ^ (q[16] >> 5) ^ m[0]) + (xl ^ q[24] ^ q[0]);
+    h[1] = ((xh >> 7) ^ (q[17] << 8) ^ m[1]) + (xl ^ q[25] ^ q[1]);
+    h[2] = ((xh >> 5) ^ (q[18] << 5) ^ m[2]) + (xl ^ q[26] ^ q[2]);
+    h[3] = ((xh >> 1) ^ (q[19] << 5) ^ m[3]) + (xl ^ q[27] ^ q[3]);
+    h[4] = ((xh >> 3) ^ q[20] ^ m[4]) + (xl ^ q[28] ^ q[4]);
+    h[5] = ((xh << 6) ^ (q[21] >> 6) ^ m[5]) + (xl ^ q[29] ^ q[5]);
+    h[6] = ((xh >> 4) ^ (q[22] << 6) ^ m[6]) + (xl ^ q[30] ^ q[6]);
+    h[7] = ((xh >> 11) ^ (q[23] << 2) ^ m[7]) + (xl ^ q[31] ^ q[7]);
+    h[8] = Rotl64(h[4], 9) + (xh ^ q[24] ^ m[8]) + ((xl << 8) ^ q[23] ^ q[8]);
+    h[9] = Rotl64(h[5], 10) + (xh ^ q[25] ^ m[9]) + ((xl >> 6) ^ q[16] ^ q[9]);
+    h[10] = Rotl64(h[6], 11) + (xh ^ q[26] ^ m[10]) + ((xl << 6) ^ q[17] ^ q[10]);
+    h[11] = Rotl64(h[7], 12) + (xh ^ q[27] ^ m[11]) + ((xl << 4) ^ q[18] ^ q[11]);
+    h[12] = Rotl64(h[0], 13) + (xh ^ q[28] ^ m[12]) + ((xl >> 3) ^ q[19] ^ q[12]);
+    h[13] = Rotl64(h[1], 14) + (xh ^ q[29] ^ m[13]) + ((xl >> 4) ^ q[20] ^ q[13]);
+    h[14] = Rotl64(h[2], 15) + (xh ^ q[30] ^ m[14]) + ((xl >> 7) ^ q[21] ^ q[14]);
+    h[15] = Rotl64(h[3], 16) + (xh ^ q[31] ^ m[15]) + ((xl >> 2) ^ q[22] ^ q[15]);
+}
+
+// JH-512, on the bitsliced state of sph_jh: eight 128 bit words kept as high and low 64 bit halves
+
+const uint64_t JH_C[168] = {
+    0x72d5dea2df15f867ULL, 0x7b84150ab7231557ULL, 0x81abd6904d5a87f6ULL, 0x4e9f4fc5c3d12b40ULL,
+    0xea983ae05c45fa9cULL, 0x03c5d29966b2999aULL, 0x660296b4f2bb538aULL, 0xb556141a88dba231ULL,
+    0x03a35a5c9a190edbULL, 0x403fb20a87c14410ULL, 0x1c051980849e951dULL, 0x6f33ebad5ee7cddcULL,
+    0x10ba139202bf6b41ULL, 0xdc786515f7bb27d0ULL, 0x0a2c813937aa7850ULL, 0x3f1abfd2410091d3ULL,
+    0x422d5a0df6cc7e90ULL, 0xdd629f9c92c097ceULL, 0x185ca70bc72b44acULL, 0xd1df65d663c6fc23ULL,
+    0x976e6c039ee0b81aULL, 0x2105457e446ceca8ULL, 0xeef103bb5d8e61faULL, 0xfd9697b294838197ULL,
+    0x4a8e8537db03302fULL, 0x2a678d2dfb9f6a95ULL, 0x8afe7381f8b8696cULL, 0x8ac77246c07f4214ULL,
+    0xc5f4158fbdc75ec4ULL, 0x75446fa78f11bb80ULL, 0x52de75b7aee488bcULL, 0x82b8001e98a6a3f4ULL,
+    0x8ef48f33a9a36315ULL, 0xaa5f5624d5b7f989ULL, 0xb6f1ed207c5ae0fdULL, 0x36cae95a06422c36ULL,
+    0xce2935434efe983dULL, 0x533af974739a4ba7ULL, 0xd0f51f596f4e8186ULL, 0x0e9dad81afd85a9fULL,
+    0xa7050667ee34626aULL, 0x8b0b28be6eb91727ULL, 0x47740726c680103fULL, 0xe0a07e6fc67e487bULL,
+    0x0d550aa54af8a4c0ULL, 0x91e3e79f978ef19eULL, 0x8676728150608dd4ULL, 0x7e9e5a41f3e5b062ULL,
+    0xfc9f1fec4054207aULL, 0xe3e41a00cef4c984ULL, 0x4fd794f59dfa95d8ULL, 0x552e7e1124c354a5ULL,
+    0x5bdf7228bdfe6e28ULL, 0x78f57fe20fa5c4b2ULL, 0x05897cefee49d32eULL, 0x447e9385eb28597fULL,
+    0x705f6937b324314aULL, 0x5e8628f11dd6e465ULL, 0xc71b770451b920e7ULL, 0x74fe43e823d4878aULL,
+    0x7d29e8a3927694f2ULL, 0xddcb7a099b30d9c1ULL, 0x1d1b30fb5bdc1be0ULL, 0xda24494ff29c82bfULL,
+    0xa4e7ba31b470bfffULL, 0x0d324405def8bc48ULL, 0x3baefc3253bbd339ULL, 0x459fc3c1e0298ba0ULL,
+    0xe5c905fdf7ae090fULL, 0x947034124290f134ULL, 0xa271b701e344ed95ULL, 0xe93b8e364f2f984aULL,
+    0x88401d63a06cf615ULL, 0x47c1444b8752afffULL, 0x7ebb4af1e20ac630ULL, 0x4670b6c5cc6e8ce6ULL,
+    0xa4d5a456bd4fca00ULL, 0xda9d844bc83e18aeULL, 0x7357ce453064d1adULL, 0xe8a6ce68145c2567ULL,
+    0xa3da8cf2cb0ee116ULL, 0x33e906589a94999aULL, 0x1f60b220c26f847bULL, 0xd1ceac7fa0d18518ULL,
+    0x32595ba18ddd19d3ULL, 0x509a1cc0aaa5b446ULL, 0x9f3d6367e4046bbaULL, 0xf6ca19ab0b56ee7eULL,
+    0x1fb179eaa9282174ULL, 0xe9bdf7353b3651eeULL, 0x1d57ac5a7550d376ULL, 0x3a46c2fea37d7001ULL,
+    0xf735c1af98a4d842ULL, 0x78edec209e6b6779ULL, 0x41836315ea3adba8ULL, 0xfac33b4d32832c83ULL,
+    0xa7403b1f1c2747f3ULL, 0x5940f034b72d769aULL, 0xe73e4e6cd2214ffdULL, 0xb8fd8d39dc5759efULL,
+    0x8d9b0c492b49ebdaULL, 0x5ba2d74968f3700dULL, 0x7d3baed07a8d5584ULL, 0xf5a5e9f0e4f88e65ULL,
+    0xa0b8a2f436103b53ULL, 0x0ca8079e753eec5aULL, 0x9168949256e8884fULL, 0x5bb05c55f8babc4cULL,
+    0xe3bb3b99f387947bULL, 0x75daf4d6726b1c5dULL, 0x64aeac28dc34b36dULL, 0x6c34a550b828db71ULL,
+    0xf861e2f2108d512aULL, 0xe3db643359dd75fcULL, 0x1cacbcf143ce3fa2ULL, 0x67bbd13c02e843b0ULL,
+    0x330a5bca8829a175ULL, 0x7f34194db416535cULL, 0x923b94c30e794d1eULL, 0x797475d7b6eeaf3fULL,
+    0xeaa8d4f7be1a3921ULL, 0x5cf47e094c232751ULL, 0x26a32453ba323cd2ULL, 0x44a3174a6da6d5adULL,
+    0xb51d3ea6aff2c908ULL, 0x83593d98916b3c56ULL, 0x4cf87ca17286604dULL, 0x46e23ecc086ec7f6ULL,
+    0x2f9833b3b1bc765eULL, 0x2bd666a5efc4e62aULL, 0x06f4b6e8bec1d436ULL, 0x74ee8215bcef2163ULL,
+    0xfdc14e0df453c969ULL, 0xa77d5ac406585826ULL, 0x7ec1141606e0fa16ULL, 0x7e90af3d28639d3fULL,
+    0xd2c9f2e3009bd20cULL, 0x5faace30b7d40c30ULL, 0x742a5116f2e03298ULL, 0x0deb30d8e3cef89aULL,
+    0x4bc59e7bb5f17992ULL, 0xff51e66e048668d3ULL, 0x9b234d57e6966731ULL, 0xcce6a6f3170a7505ULL,
+    0xb17681d913326cceULL, 0x3c175284f805a262ULL, 0xf42bcbb378471547ULL, 0xff46548223936a48ULL,
+    0x38df58074e5e6565ULL, 0xf2fc7c89fc86508eULL, 0x31702e44d00bca86ULL, 0xf04009a23078474eULL,
+    0x65a0ee39d1f73883ULL, 0xf75ee937e42c3abdULL, 0x2197b2260113f86fULL, 0xa344edd1ef9fdee7ULL,
+    0x8ba0df15762592d9ULL, 0x3c85f7f612dc42beULL, 0xd8a7ec7cab27b07eULL, 0x538d7ddaaa3ea8deULL,
+    0xaa25ce93bd0269d8ULL, 0x5af643fd1a7308f9ULL, 0xc05fefda174a19a5ULL, 0x974d66334cfd216aULL,
+    0x35b49831db411570ULL, 0xea1e0fbbedcd549bULL, 0x9ad063a151974072ULL, 0xf6759dbf91476fe2ULL
+};
+
+const uint64_t JH512_IV[16] = {
+    0x6fd14b963e00aa17ULL, 0x636a2e057a15d543ULL, 0x8a225e8d0c97ef0bULL, 0xe9341259f2b3c361ULL,
+    0x891da0c1536f801eULL, 0x2aa9056bea2b6d80ULL, 0x588eccdb2075baa6ULL, 0xa90f3a76baf83bf7ULL,
+    0x0169e60541e34a69ULL, 0x46b58a8e2e6fe65aULL, 0x1047a7d0c1843c24ULL, 0x3b6e71b12d5ac199ULL,
+    0xcf57f6ec9db1f856ULL, 0xa706887c5716b156ULL, 0xe3c2fcdfe68517fbULL, 0x545a4678cc8cdd4bULL
+};
+
+inline X20R_AVX2 void JhSbox(u64x4& x0, u64x4& x1, u64x4& x2, u64x4& x3, u64x4 c)
+{
+    x3 = ~x3;
+    x0 ^= c & ~x2;
+    const u64x4 tmp = c ^ (x0 & x1);
+    x0 ^= x2 & x3;
+    x3 ^= ~x1 & x2;
+    x1 ^= x0 & x2;
+    x2 ^= x0 & ~x3;
+    x0 ^= x1 | x3;
+    x3 ^= x1 & x2;
+    x1 ^= tmp & x0;
+    x2 ^= tmp;
+}
+
+inline X20R_AVX2 void JhLinear(u64x4& x0, u64x4& x1, u64x4& x2, u64x4& x3, u64x4& x4, u64x4& x5, u64x4& x6, u64x4& x7)
+{
+    x4 ^= x1;
+    x5 ^= x2;
+    x6 ^= x3 ^ x0;
+    x7 ^= x0;
+    x0 ^= x5;
+    x1 ^= x6;
+    x2 ^= x7 ^ x4;
+    x3 ^= x4;
+}
+
+//! Round r swaps adjacent groups of 2^(r % 7) bits in the odd words, the groups of 64 being the halves
+const uint64_t JH_SWAP_MASK[6] = {
+    0x5555555555555555ULL, 0x3333333333333333ULL, 0x0f0f0f0f0f0f0f0fULL,
+    0x00ff00ff00ff00ffULL, 0x0000ffff0000ffffULL, 0x00000000ffffffffULL
+};
+
+inline X20R_AVX2 void JhSwap(int ro, u64x4& h, u64x4& l)
+{
+    if (ro == 6) {
+        const u64x4 t = h;
+        h = l;
+        l = t;
+        return;
+    }
+    const int n = 1 << ro;
+    const u64x4 c = Splat64(JH_SWAP_MASK[ro]);
+    h = ((h >> n) & c) | ((h & c) << n);
+    l = ((l >> n) & c) | ((l & c) << n);
+}
+
+X20R_AVX2 void JhE8(u64x4 hh[8], u64x4 hl[8])
+{
+    for (int r = 0; r < 42; r++) {
+        JhSbox(hh[0], hh[2], hh[4], hh[6], Splat64(JH_C[4 * r + 0]));
+        JhSbox(hl[0], hl[2], hl[4], hl[6], Splat64(JH_C[4 * r + 1]));
+        JhSbox(hh[1], hh[3], hh[5], hh[7], Splat64(JH_C[4 * r + 2]));
+        JhSbox(hl[1], hl[3], hl[5], hl[7], Splat64(JH_C[4 * r + 3]));
+        JhLinear(hh[0], hh[2], hh[4], hh[6], hh[1], hh[3], hh[5], hh[7]);
+        JhLinear(hl[0], hl[2], hl[4], hl[6], hl[1], hl[3], hl[5], hl[7]);
+        for (int i = 1; i < 8; i += 2)
+            JhSwap(r % 7, hh[i], hl[i]);
+    }
+}
+
+// CubeHash16/32-512
+
+const uint32_t CUBEHASH512_IV[32] = {
+    0x2aea2a61, 0x50f494d4, 0x2d538b8b, 0x4167d83e, 0x3fee2313, 0xc701cf8c, 0xcc39968e, 0x50ac5695,
+    0x4d42c787, 0xa647a8b3, 0x97cf0bef, 0x825b4537, 0xeef864d2, 0xf22090c4, 0xd0e5cd33, 0xa23911ae,
+    0xfcd398d9, 0x148fe485, 0x1b017bef, 0xb6444532, 0x6a536159, 0x2ff5781c, 0x91fa7934, 0x0dbadea9,
+    0xd65c8a2b, 0xa5a70e75, 0xb1c62456, 0xbc796576, 0x1921c8f7, 0xe7989af1, 0x7795d246, 0xd43e3b44
+};
+
+inline X20R_AVX2 __m256i Rotl32x8(__m256i x, int n)
+{
+    return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
+}
+
+/**
+ * Sixteen CubeHash rounds over the state of each lane, held as its words 0-7,
+ * 8-15, 16-23 and 24-31 in a, b, c and d. CubeHash is built for SIMD within
+ * one message, so unlike the other kernels the vectors hold words of a single
+ * lane: the word swaps of a round become swapping a and b, and shuffles
+ * within c, d and the halves of a and b. The lanes only share the rounds to
+ * overlap their latencies.
+ */
+inline X20R_AVX2 void CubeHashRounds(__m256i a[LANES], __m256i b[LANES], __m256i c[LANES], __m256i d[LANES])
+{
+    for (int r = 0; r < 16; r++) {
+        for (size_t k = 0; k < LANES; k++) {
+            c[k] = _mm256_add_epi32(c[k], a[k]);
+            d[k] = _mm256_add_epi32(d[k], b[k]);
+            // x[i] is swapped with x[i ^ 8]
+            const __m256i t = Rotl32x8(a[k], 7);
+            a[k] = _mm256_xor_si256(Rotl32x8(b[k], 7), c[k]);
+            b[k] = _mm256_xor_si256(t, d[k]);
+            // x[16 + i] with x[16 + (i ^ 2)]
+            c[k] = _mm256_shuffle_epi32(c[k], 0x4e);
+            d[k] = _mm256_shuffle_epi32(d[k], 0x4e);
+            c[k] = _mm256_add_epi32(c[k], a[k]);
+            d[k] = _mm256_add_epi32(d[k], b[k]);
+            // x[i] with x[i ^ 4]
+            a[k] = _mm256_xor_si256(_mm256_permute4x64_epi64(Rotl32x8(a[k], 11), 0x4e), c[k]);
+            b[k] = _mm256_xor_si256(_mm256_permute4x64_epi64(Rotl32x8(b[k], 11), 0x4e), d[k]);
+            // x[16 + i] with x[16 + (i ^ 1)]
+            c[k] = _mm256_shuffle_epi32(c[k], 0xb1);
+            d[k] = _mm256_shuffle_epi32(d[k], 0xb1);
+        }
+    }
+}
+
+// Luffa-512: five 256 bit sub-states, 32 byte message blocks
+
+const uint32_t LUFFA512_IV[5][8] = {
+    {0x6d251e69, 0x44b051e0, 0x4eaa6fb4, 0xdbf78465, 0x6e292011, 0x90152df4, 0xee058139, 0xdef610bb},
+    {0xc3b44b95, 0xd9d2f256, 0x70eee9a0, 0xde099fa3, 0x5d9b0557, 0x8fc944b3, 0xcf1ccf0e, 0x746cd581},
+    {0xf7efc89d, 0x5dba5781, 0x04016ce5, 0xad659c05, 0x0306194f, 0x666d1836, 0x24aa230a, 0x8b264ae7},
+    {0x858075d5, 0x36d79cce, 0xe571f7d7, 0x204b1f67, 0x35870c6a, 0x57e9e923, 0x14bcb808, 0x7cde72ce},
+    {0x6c68e9be, 0x5ec41e22, 0xc825b7c7, 0xaffb4363, 0xf5df3999, 0x0fc688f1, 0xb07224cc, 0x03e86cea}
+};
+
+/** Round constants of each sub-state's permutation, added to its words 0 and 4. */
+const uint32_t LUFFA_RC[5][2][8] = {
+    {{0x303994a6, 0xc0e65299, 0x6cc33a12, 0xdc56983e, 0x1e00108f, 0x7800423d, 0x8f5b7882, 0x96e1db12},
+     {0xe0337818, 0x441ba90d, 0x7f34d442, 0x9389217f, 0xe5a8bce6, 0x5274baf4, 0x26889ba7, 0x9a226e9d}},
+    {{0xb6de10ed, 0x70f47aae, 0x0707a3d4, 0x1c1e8f51, 0x707a3d45, 0xaeb28562, 0xbaca1589, 0x40a46f3e},
+     {0x01685f3d, 0x05a17cf4, 0xbd09caca, 0xf4272b28, 0x144ae5cc, 0xfaa7ae2b, 0x2e48f1c1, 0xb923c704}},
+    {{0xfc20d9d2, 0x34552e25, 0x7ad8818f, 0x8438764a, 0xbb6de032, 0xedb780c8, 0xd9847356, 0xa2c78434},
+     {0xe25e72c1, 0xe623bb72, 0x5c58a4a4, 0x1e38e2e7, 0x78e38b9d, 0x27586719, 0x36eda57f, 0x703aace7}},
+    {{0xb213afa5, 0xc84ebe95, 0x4e608a22, 0x56d858fe, 0x343b138f, 0xd0ec4e3d, 0x2ceb4882, 0xb3ad2208},
+     {0xe028c9bf, 0x44756f91, 0x7e8fce32, 0x956548be, 0xfe191be2, 0x3cb226e5, 0x5944a28e, 0xa1c4c355}},
+    {{0xf0d2e9e3, 0xac11d7fa, 0x1bcb66f2, 0x6f2d9bc9, 0x78602649, 0x8edae952, 0x3b6ba548, 0xedae9520},
+     {0x5090d577, 0x2d1925ab, 0xb46496ac, 0xd1925ab0, 0x29131ab6, 0x0fc053c3, 0x3f014f0c, 0xfc053c31}}
+};
+
+/** Multiply the 256 bit word x by 2 in Luffa's field, in place. */
+inline X20R_AVX2 void LuffaMul2(u32x4 x[8])
+{
+    const u32x4 t = x[7];
+    x[7] = x[6];
+    x[6] = x[5];
+    x[5] = x[4];
+    x[4] = x[3] ^ t;
+    x[3] = x[2] ^ t;
+    x[2] = x[1];
+    x[1] = x[0] ^ t;
+    x[0] = t;
+}
+
+/** Mix the message block m into the sub-states. */
+inline X20R_AVX2 void LuffaInject(u32x4 v[5][8], u32x4 m[8])
+{
+    u32x4 a[8], b[8];
+    for (int i = 0; i < 8; i++)
+        a[i] = v[0][i] ^ v[1][i] ^ v[2][i] ^ v[3][i] ^ v[4][i];
+    LuffaMul2(a);
+    for (int j = 0; j < 5; j++)
+        for (int i = 0; i < 8; i++)
+            v[j][i] ^= a[i];
+
+    for (int i = 0; i < 8; i++)
+        b[i] = v[0][i];
+    LuffaMul2(b);
+    for (int i = 0; i < 8; i++)
+        b[i] ^= v[1][i];
+    for (int j = 1; j < 5; j++) {
+        LuffaMul2(v[j]);
+        for (int i = 0; i < 8; i++)
+            v[j][i] ^= v[(j + 1) % 5][i];
+    }
+    for (int i = 0; i < 8; i++)
+        v[0][i] = b[i];
+    LuffaMul2(v[0]);
+    for (int i = 0; i < 8; i++)
+        v[0][i] ^= v[4][i];
+    for (int j = 4; j > 0; j--) {
+        LuffaMul2(v[j]);
+        for (int i = 0; i < 8; i++)
+            v[j][i] ^= j > 1 ? v[j - 1][i] : b[i];
+    }
+
+    for (int j = 0; j < 5; j++) {
+        if (j > 0)
+            LuffaMul2(m);
+        for (int i = 0; i < 8; i++)
+            v[j][i] ^= m[i];
+    }
+}
+
+template <typename T>
+inline X20R_AVX2 void LuffaSubCrumb(T& a0, T& a1, T& a2, T& a3)
+{
+    T t = a0;
+    a0 |= a1;
+    a2 ^= a3;
+    a1 = ~a1;
+    a0 ^= a3;
+    a3 &= t;
+    a1 ^= a3;
+    a3 ^= a2;
+    a2 &= a0;
+    a0 = ~a0;
+    a2 ^= a1;
+    a1 |= a3;
+    t ^= a1;
+    a3 ^= a2;
+    a2 &= a1;
+    a1 ^= a0;
+    a0 = t;
+}
+
+template <typename T>
+inline X20R_AVX2 void LuffaMixWord(T& u, T& v)
+{
+    v ^= u;
+    u = ((u << 2) | (u >> 30)) ^ v;
+    v = ((v << 14) | (v >> 18)) ^ u;
+    u = ((u << 10) | (u >> 22)) ^ v;
+    v = (v << 1) | (v >> 31);
+}
+
+/** Eight rounds of the permutation over x, with the round constants in rc0 and rc4. */
+template <typename T>
+inline X20R_AVX2 void LuffaRounds(T x[8], const T rc0[8], const T rc4[8])
+{
+    for (int r = 0; r < 8; r++) {
+        LuffaSubCrumb(x[0], x[1], x[2], x[3]);
+        LuffaSubCrumb(x[5], x[6], x[7], x[4]);
+        LuffaMixWord(x[0], x[4]);
+        LuffaMixWord(x[1], x[5]);
+        LuffaMixWord(x[2], x[6]);
+        LuffaMixWord(x[3], x[7]);
+        x[0] ^= rc0[r];
+        x[4] ^= rc4[r];
+    }
+}
+
+/** Two 32 bit words of every lane, one from each of a pair of sub-states. */
+typedef uint32_t u32x8 __attribute__((vector_size(32)));
+
+inline X20R_AVX2 u32x8 Pair32(u32x4 lo, u32x4 hi)
+{
+    return (u32x8)_mm256_inserti128_si256(_mm256_castsi128_si256((__m128i)lo), (__m128i)hi, 1);
+}
+
+/**
+ * The permutation of each sub-state, after the tweak rotating its upper half
+ * by its index. The rounds of sub-states 0 and 1, and of 2 and 3, run side by
+ * side in the halves of 256 bit vectors.
+ */
+inline X20R_AVX2 void LuffaPermute(u32x4 v[5][8])
+{
+    for (int j = 1; j < 5; j++)
+        for (int i = 4; i < 8; i++)
+            v[j][i] = Rotl32(v[j][i], j);
+    for (int j = 0; j < 4; j += 2) {
+        u32x8 x[8], rc0[8], rc4[8];
+        for (int i = 0; i < 8; i++) {
+            x[i] = Pair32(v[j][i], v[j + 1][i]);
+            rc0[i] = Pair32(Splat32(LUFFA_RC[j][0][i]), Splat32(LUFFA_RC[j + 1][0][i]));
+            rc4[i] = Pair32(Splat32(LUFFA_RC[j][1][i]), Splat32(LUFFA_RC[j + 1][1][i]));
+        }
+        LuffaRounds(x, rc0, rc4);
+        for (int i = 0; i < 8; i++) {
+            v[j][i] = (u32x4)_mm256_castsi256_si128((__m256i)x[i]);
+            v[j + 1][i] = (u32x4)_mm256_extracti128_si256((__m256i)x[i], 1);
+        }
+    }
+    u32x4 rc0[8], rc4[8];
+    for (int i = 0; i < 8; i++) {
+        rc0[i] = Splat32(LUFFA_RC[4][0][i]);
+        rc4[i] = Splat32(LUFFA_RC[4][1][i]);
+    }
+    LuffaRounds(v[4], rc0, rc4);
+}
+
+} // namespace
+
+X20R_AVX2 void Blake512(const unsigned char* const in[LANES], unsigned char* const out[LANES])
+{
+    u64x4 m[16];
+    for (int i = 0; i < 8; i++)
+        m[i] = LoadBE64(in, 8 * i);
+    // The padding: 0x80, the 0x01 that marks a 512 bit digest and the 128 bit length
+    m[8] = Splat64(0x8000000000000000ULL);
+    for (int i = 9; i < 16; i++)
+        m[i] = Splat64(0);
+    m[13] = Splat64(1);
+    m[15] = Splat64(512);
+
+    u64x4 v[16];
+    for (int i = 0; i < 8; i++) {
+        v[i] = Splat64(SHA512_IV[i]);
+        v[8 + i] = Splat64(BLAKE512_C[i]);
+    }
+    // The counter covers the 512 bits of message in the block
+    v[12] ^= Splat64(512);
+    v[13] ^= Splat64(512);
+    for (int r = 0; r < 16; r++) {
+        const uint8_t* s = BLAKE_SIGMA[r % 10];
+        BlakeG(m, s, 0, v[0], v[4], v[8], v[12]);
+        BlakeG(m, s, 1, v[1], v[5], v[9], v[13]);
+        BlakeG(m, s, 2, v[2], v[6], v[10], v[14]);
+        BlakeG(m, s, 3, v[3], v[7], v[11], v[15]);
+        BlakeG(m, s, 4, v[0], v[5], v[10], v[15]);
+        BlakeG(m, s, 5, v[1], v[6], v[11], v[12]);
+        BlakeG(m, s, 6, v[2], v[7], v[8], v[13]);
+        BlakeG(m, s, 7, v[3], v[4], v[9], v[14]);
+    }
+    for (int i = 0; i < 8; i++)
+        StoreBE64(out, 8 * i, Splat64(SHA512_IV[i]) ^ v[i] ^ v[8 + i]);
+}
+
+X20R_AVX2 void Bmw512(const unsigned char* const in[LANES], unsigned char* const out[LANES])
+{
+    u64x4 m[16];
+    for (int i = 0; i < 8; i++)
+        m[i] = LoadLE64(in, 8 * i);
+    // The padding, with the 64 bit length in the last word
+    m[8] = Splat64(0x80);
+    for (int i = 9; i < 15; i++)
+        m[i] = Splat64(0);
+    m[15] = Splat64(512);
+
+    u64x4 h[16];
+    for (int i = 0; i < 16; i++)
+        h[i] = Splat64(BMW512_IV[i]);
+    BmwCompress(m, h);
+
+    u64x4 f[16];
+    for (int i = 0; i < 16; i++)
+        f[i] = Splat64(0xaaaaaaaaaaaaaaa0ULL + i);
+    BmwCompress(h, f);
+    for (int i = 0; i < 8; i++)
+        StoreLE64(out, 8 * i, f[8 + i]);
+}
+
+X20R_AVX2 void CubeHash512(const unsigned char* const in[LANES], unsigned char* const out[LANES])
+{
+    const __m256i* iv = (const __m256i*)CUBEHASH512_IV;
+    __m256i a[LANES], b[LANES], c[LANES], d[LANES];
+    for (size_t k = 0; k < LANES; k++) {
+        a[k] = _mm256_loadu_si256(iv);
+        b[k] = _mm256_loadu_si256(iv + 1);
+        c[k] = _mm256_loadu_si256(iv + 2);
+        d[k] = _mm256_loadu_si256(iv + 3);
+    }
+    // Two 32 byte message blocks, then the padding block holding only 0x80
+    for (int n = 0; n < 2; n++) {
+        for (size_t k = 0; k < LANES; k++)
+            a[k] = _mm256_xor_si256(a[k], _mm256_loadu_si256((const __m256i*)(in[k] + 32 * n)));
+        CubeHashRounds(a, b, c, d);
+    }
+    for (size_t k = 0; k < LANES; k++)
+        a[k] = _mm256_xor_si256(a[k], _mm256_set_epi32(0, 0, 0, 0, 0, 0, 0, 0x80));
+    CubeHashRounds(a, b, c, d);
+    // Finalization: flip a bit of the last word, then ten more times sixteen rounds
+    for (size_t k = 0; k < LANES; k++)
+        d[k] = _mm256_xor_si256(d[k], _mm256_set_epi32(1, 0, 0, 0, 0, 0, 0, 0));
+    for (int i = 0; i < 10; i++)
+        CubeHashRounds(a, b, c, d);
+    for (size_t k = 0; k < LANES; k++) {
+        _mm256_storeu_si256((__m256i*)out[k], a[k]);
+        _mm256_storeu_si256((__m256i*)(out[k] + 32), b[k]);
+    }
+}
+
+X20R_AVX2 void Jh512(const unsigned char* const in[LANES], unsigned char* const out[LANES])
+{
+    u64x4 hh[8], hl[8];
+    for (int i = 0; i < 8; i++) {
+        hh[i] = Splat64(JH512_IV[2 * i]);
+        hl[i] = Splat64(JH512_IV[2 * i + 1]);
+    }
+    // Each block is xored into the first half of the state before E8 and into the second half after
+    u64x4 mh[4], ml[4];
+    for (int i = 0; i < 4; i++) {
+        mh[i] = LoadBE64(in, 16 * i);
+        ml[i] = LoadBE64(in, 16 * i + 8);
+        hh[i] ^= mh[i];
+        hl[i] ^= ml[i];
+    }
+    JhE8(hh, hl);
+    for (int i = 0; i < 4; i++) {
+        hh[4 + i] ^= mh[i];
+        hl[4 + i] ^= ml[i];
+    }
+    // The padding block: 0x80, zeros and the 128 bit length
+    hh[0] ^= Splat64(0x8000000000000000ULL);
+    hl[3] ^= Splat64(512);
+    JhE8(hh, hl);
+    hh[4] ^= Splat64(0x8000000000000000ULL);
+    hl[7] ^= Splat64(512);
+    for (int i = 0; i < 4; i++) {
+        StoreBE64(out, 16 * i, hh[4 + i]);
+        StoreBE64(out, 16 * i + 8, hl[4 + i]);
+    }
+}
+
+X20R_AVX2 void Keccak512(const unsigned char* const in[LANES], unsigned char* const out[LANES])
+{
+    u64x4 st[25];
+    for (int i = 0; i < 8; i++)
+        st[i] = LoadLE64(in, 8 * i);
+    // The padding 0x01 ... 0x80 fills the rest of the block
+    st[8] = Splat64(0x8000000000000001ULL);
+    for (int i = 9; i < 25; i++)
+        st[i] = Splat64(0);
+    KeccakF1600(st);
+    for (int i = 0; i < 8; i++)
+        StoreLE64(out, 8 * i, st[i]);
+}
+
+X20R_AVX2 void Skein512(const unsigned char* const in[LANES], unsigned char* const out[LANES])
+{
+    u64x4 g[8];
+    for (int i = 0; i < 8; i++)
+        g[i] = Splat64(SKEIN512_IV[i]);
+    u64x4 p[8];
+    for (int i = 0; i < 8; i++)
+        p[i] = LoadLE64(in, 8 * i);
+    SkeinUBI(g, 64, SKEIN_T1_FIRST_FINAL | SKEIN_T1_MSG, p);
+    // The output block is the 64 bit counter 0, zero padded
+    u64x4 o[8];
+    for (int i = 0; i < 8; i++)
+        o[i] = Splat64(0);
+    SkeinUBI(p, 8, SKEIN_T1_FIRST_FINAL | SKEIN_T1_OUT, o);
+    for (int i = 0; i < 8; i++)
+        StoreLE64(out, 8 * i, o[i]);
+}
+
+X20R_AVX2 void Luffa512(const unsigned char* const in[LANES], unsigned char* const out[LANES])
+{
+    u32x4 v[5][8];
+    for (int j = 0; j < 5; j++)
+        for (int i = 0; i < 8; i++)
+            v[j][i] = Splat32(LUFFA512_IV[j][i]);
+    // The two message blocks, the padding block and two blank blocks, the
+    // last two each giving half of the digest
+    u32x4 m[8];
+    for (int n = 0; n < 5; n++) {
+        for (int i = 0; i < 8; i++)
+            m[i] = n < 2 ? LoadBE32(in, 32 * n + 4 * i) : Splat32(0);
+        if (n == 2)
+            m[0] = Splat32(0x80000000);
+        LuffaInject(v, m);
+        LuffaPermute(v);
+        if (n >= 3) {
+            for (int i = 0; i < 8; i++)
+                StoreBE32(out, 32 * (n - 3) + 4 * i, v[0][i] ^ v[1][i] ^ v[2][i] ^ v[3][i] ^ v[4][i]);
+        }
+    }
+}
+
+X20R_AVX2 void Sha512(const unsigned char* const in[LANES], unsigned char* const out[LANES])
+{
+    u64x4 w[16];
+    for (int i = 0; i < 8; i++)
+        w[i] = LoadBE64(in, 8 * i);
+    // The padding and the 128 bit length fill the rest of the single block
+    w[8] = Splat64(0x8000000000000000ULL);
+    for (int i = 9; i < 15; i++)
+        w[i] = Splat64(0);
+    w[15] = Splat64(512);
+
+    u64x4 s[8];
+    for (int i = 0; i < 8; i++)
+        s[i] = Splat64(SHA512_IV[i]);
+    for (int t = 0; t < 80; t++) {
+        if (t >= 16) {
+            const u64x4 w15 = w[(t - 15) & 15], w2 = w[(t - 2) & 15];
+            w[t & 15] += (Rotr64(w15, 1) ^ Rotr64(w15, 8) ^ (w15 >> 7)) + w[(t - 7) & 15] +
+                         (Rotr64(w2, 19) ^ Rotr64(w2, 61) ^ (w2 >> 6));
+        }
+        const u64x4 t1 = s[7] + (Rotr64(s[4], 14) ^ Rotr64(s[4], 18) ^ Rotr64(s[4], 41)) +
+                         (s[6] ^ (s[4] & (s[5] ^ s[6]))) + Splat64(SHA512_K[t]) + w[t & 15];
+        const u64x4 t2 = (Rotr64(s[0], 28) ^ Rotr64(s[0], 34) ^ Rotr64(s[0], 39)) +
+                         ((s[0] & s[1]) | (s[2] & (s[0] | s[1])));
+        s[7] = s[6];
+        s[6] = s[5];
+        s[5] = s[4];
+        s[4] = s[3] + t1;
+        s[3] = s[2];
+        s[2] = s[1];
+        s[1] = s[0];
+        s[0] = t1 + t2;
+    }
+    for (int i = 0; i < 8; i++)
+        StoreBE64(out, 8 * i, s[i] + Splat64(SHA512_IV[i]));
+}
+
+#undef X20R_AVX2
+
+#else
+
+bool Supported()
+{
+    return false;
+}
+
+#endif // X20R_HAVE_LANES
+
+} // namespace x20r_lanes
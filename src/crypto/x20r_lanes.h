@@ -0,0 +1,62 @@
+// Copyright (c) 2017 The Astral Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAVEN_CRYPTO_X20R_LANES_H
+#define RAVEN_CRYPTO_X20R_LANES_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Multi-lane versions of the X20R primitives that are built from add, xor,
+ * rotate and boolean word operations. A kernel hashes LANES messages in one
+ * pass of the rounds, most of them keeping one word of every message in each
+ * vector. CubeHash, designed for SIMD within a message, keeps whole rows of
+ * one message in a vector instead and runs the lanes side by side. The
+ * primitives built on table lookups or AES rounds (groestl, echo, shavite,
+ * whirlpool, fugue, gost, simd) have no kernel here, nor has hamsi, whose
+ * message expansion looks up a table per message byte.
+ *
+ * The kernels only take the 64 byte messages X20R stages 1 to 19 hash, and
+ * match the sph_* functions of the same primitive over 64 bytes. They are
+ * compiled for AVX2 and may only be called when Supported() returns true.
+ * With the baseline x86-64 SSE2 most of them are slower than hashing the
+ * lanes one by one.
+ *
+ * Windows is left out as gcc does not keep the stack aligned for spilled
+ * AVX registers there.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__amd64__)) && !defined(WIN32)
+#define X20R_HAVE_LANES 1
+#else
+#define X20R_HAVE_LANES 0
+#endif
+
+namespace x20r_lanes
+{
+/** Number of messages a kernel hashes at once. */
+static const size_t LANES = 4;
+
+/**
+ * Hash the LANES 64 byte messages at in[0..LANES) into the 64 byte outputs
+ * at out[0..LANES). An output may overlap its own input.
+ */
+typedef void (*Kernel)(const unsigned char* const in[LANES], unsigned char* const out[LANES]);
+
+/** Whether the CPU and OS run the kernels below. Always false without X20R_HAVE_LANES. */
+bool Supported();
+
+#if X20R_HAVE_LANES
+void Blake512(const unsigned char* const in[LANES], unsigned char* const out[LANES]);
+void Bmw512(const unsigned char* const in[LANES], unsigned char* const out[LANES]);
+void CubeHash512(const unsigned char* const in[LANES], unsigned char* const out[LANES]);
+void Jh512(const unsigned char* const in[LANES], unsigned char* const out[LANES]);
+void Keccak512(const unsigned char* const in[LANES], unsigned char* const out[LANES]);
+void Luffa512(const unsigned char* const in[LANES], unsigned char* const out[LANES]);
+void Skein512(const unsigned char* const in[LANES], unsigned char* const out[LANES]);
+void Sha512(const unsigned char* const in[LANES], unsigned char* const out[LANES]);
+#endif
+} // namespace x20r_lanes
+
+#endif // RAVEN_CRYPTO_X20R_LANES_H
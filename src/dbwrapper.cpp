@@ -15,6 +15,7 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <memory>
 
 class CAstralLevelDBLogger : public leveldb::Logger {
 public:
@@ -99,13 +100,23 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize, size_t maxFileSize)
+bool IsDBCompressionEnabled(const std::string& strName)
+{
+    for (const std::string& strCompress : gArgs.GetArgs("-dbcompression")) {
+        if (strCompress == strName || strCompress == "all")
+            return true;
+    }
+    return false;
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, size_t maxFileSize, bool fCompress)
 {
     leveldb::Options options;
     options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
     options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
     options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
+    // Without Snappy in the leveldb build, leveldb silently stores the blocks uncompressed
+    options.compression = fCompress ? leveldb::kSnappyCompression : leveldb::kNoCompression;
     options.info_log = new CAstralLevelDBLogger();
     options.max_file_size = maxFileSize;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
@@ -117,14 +128,14 @@ static leveldb::Options GetOptions(size_t nCacheSize, size_t maxFileSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate, size_t maxFileSize)
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate, size_t maxFileSize, bool fCompress)
 {
     penv = nullptr;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize, maxFileSize);
+    options = GetOptions(nCacheSize, maxFileSize, fCompress);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -140,7 +151,7 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     }
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
-    LogPrintf("Opened LevelDB successfully\n");
+    LogPrintf("Opened LevelDB successfully%s\n", fCompress ? " (compressed)" : "");
 
     if (gArgs.GetBoolArg("-forcecompactdb", false)) {
         LogPrintf("Starting database compaction of %s\n", path.string());
@@ -182,6 +193,30 @@ CDBWrapper::~CDBWrapper()
     options.env = nullptr;
 }
 
+void CDBWrapper::Rewrite()
+{
+    // Compaction alone doesn't touch tables in the lowest level that nothing overlaps. Writing
+    // the entries again gives every table a newer overlapping copy, so compacting afterwards
+    // replaces all of them. Keys and values are copied as stored, obfuscation doesn't change.
+    std::unique_ptr<leveldb::Iterator> pcursor(pdb->NewIterator(iteroptions));
+    leveldb::WriteBatch batch;
+    size_t nBatchSize = 0;
+    for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next()) {
+        batch.Put(pcursor->key(), pcursor->value());
+        nBatchSize += pcursor->key().size() + pcursor->value().size();
+        if (nBatchSize >= DBWRAPPER_REWRITE_BATCH_SIZE) {
+            dbwrapper_private::HandleError(pdb->Write(writeoptions, &batch));
+            batch.Clear();
+            nBatchSize = 0;
+        }
+    }
+    dbwrapper_private::HandleError(pcursor->status());
+    dbwrapper_private::HandleError(pdb->Write(syncoptions, &batch));
+    pcursor.reset();
+
+    pdb->CompactRange(nullptr, nullptr);
+}
+
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
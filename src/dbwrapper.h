@@ -19,6 +19,16 @@
 
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
+//! Flush CDBWrapper::Rewrite batches once they hold this many bytes
+static const size_t DBWRAPPER_REWRITE_BATCH_SIZE = 16 << 20;
+//! -rewritedb default
+static const bool DEFAULT_REWRITEDB = false;
+
+//! Names accepted by -dbcompression
+static const char* const DB_COMPRESSION_NAMES[] = {"chainstate", "blockindex", "assets"};
+
+/** Whether -dbcompression asks for the named database to be stored compressed */
+bool IsDBCompressionEnabled(const std::string& strName);
 
 class dbwrapper_error : public std::runtime_error
 {
@@ -218,10 +228,18 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
+     * @param[in] fCompress   If true, newly written tables are Snappy compressed (when leveldb
+     *                        was built with Snappy). Existing tables are read either way.
      */
-    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, size_t maxFileSize = 2 << 20);
+    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, size_t maxFileSize = 2 << 20, bool fCompress = false);
     ~CDBWrapper();
 
+    /**
+     * Write every entry back unchanged and compact the whole database, so all of it ends up
+     * stored with the current options (such as compression). Slow, meant to be run once.
+     */
+    void Rewrite();
+
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
     {
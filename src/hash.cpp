@@ -6,11 +6,44 @@
 #include "hash.h"
 #include "crypto/common.h"
 #include "crypto/hmac_sha512.h"
+#include "crypto/x20r_lanes.h"
 #include "pubkey.h"
 
-//TODO remove these
-double algoHashTotal[20];
-int algoHashHits[20];
+#include <algorithm>
+#include <assert.h>
+
+const char* const X20R_ALGO_NAMES[20] = {
+    "blake512", "bmw512", "groestl512", "jh512", "keccak512",
+    "skein512", "luffa512", "cubehash512", "shavite512", "simd512",
+    "echo512", "hamsi512", "fugue512", "shabal512", "whirlpool",
+    "sha512", "haval256_5", "gost512", "radiogatun64", "panama",
+};
+
+std::atomic<bool> fX20RStats(false);
+
+namespace {
+std::atomic<uint64_t> x20rStatsCalls[20];
+std::atomic<int64_t> x20rStatsNanos[20];
+} // namespace
+
+void RecordX20RStats(int nAlgo, uint64_t nCalls, int64_t nNanos)
+{
+    x20rStatsCalls[nAlgo].fetch_add(nCalls, std::memory_order_relaxed);
+    x20rStatsNanos[nAlgo].fetch_add(nNanos, std::memory_order_relaxed);
+}
+
+void GetX20RStats(X20RAlgoStats (&stats)[20], bool fReset)
+{
+    for (int i = 0; i < 20; i++) {
+        if (fReset) {
+            stats[i].nCalls = x20rStatsCalls[i].exchange(0, std::memory_order_relaxed);
+            stats[i].nNanos = x20rStatsNanos[i].exchange(0, std::memory_order_relaxed);
+        } else {
+            stats[i].nCalls = x20rStatsCalls[i].load(std::memory_order_relaxed);
+            stats[i].nNanos = x20rStatsNanos[i].load(std::memory_order_relaxed);
+        }
+    }
+}
 
 inline uint32_t ROTL32(uint32_t x, int8_t r)
 {
@@ -250,3 +283,284 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint3
     SIPROUND;
     return v0 ^ v1 ^ v2 ^ v3;
 }
+
+namespace {
+
+/** Entry points of one X20R primitive, indexed by GetHashSelection(). */
+struct X20RAlgo {
+    void (*init)(void* cc);
+    void (*write)(void* cc, const void* data, size_t len);
+    void (*close)(void* cc, void* dst);
+    size_t nContextSize;
+    //! Whether writing the X20R_MIDSTATE_SIZE byte header prefix compresses all of it, see CX20RMidstate
+    bool fMidstate;
+};
+
+const X20RAlgo x20rAlgos[20] = {
+    {sph_blake512_init,     sph_blake512,     sph_blake512_close,     sizeof(sph_blake512_context),      false},
+    {sph_bmw512_init,       sph_bmw512,       sph_bmw512_close,       sizeof(sph_bmw512_context),        false},
+    {sph_groestl512_init,   sph_groestl512,   sph_groestl512_close,   sizeof(sph_groestl512_context),    false},
+    {sph_jh512_init,        sph_jh512,        sph_jh512_close,        sizeof(sph_jh512_context),         true},
+    {sph_keccak512_init,    sph_keccak512,    sph_keccak512_close,    sizeof(sph_keccak512_context),     false},
+    {sph_skein512_init,     sph_skein512,     sph_skein512_close,     sizeof(sph_skein512_context),      false},
+    {sph_luffa512_init,     sph_luffa512,     sph_luffa512_close,     sizeof(sph_luffa512_context),      true},
+    {sph_cubehash512_init,  sph_cubehash512,  sph_cubehash512_close,  sizeof(sph_cubehash512_context),   true},
+    {sph_shavite512_init,   sph_shavite512,   sph_shavite512_close,   sizeof(sph_shavite512_context),    false},
+    {sph_simd512_init,      sph_simd512,      sph_simd512_close,      sizeof(sph_simd512_context),       false},
+    {sph_echo512_init,      sph_echo512,      sph_echo512_close,      sizeof(sph_echo512_context),       false},
+    {sph_hamsi512_init,     sph_hamsi512,     sph_hamsi512_close,     sizeof(sph_hamsi512_context),      true},
+    {sph_fugue512_init,     sph_fugue512,     sph_fugue512_close,     sizeof(sph_fugue512_context),      true},
+    {sph_shabal512_init,    sph_shabal512,    sph_shabal512_close,    sizeof(sph_shabal512_context),     true},
+    {sph_whirlpool_init,    sph_whirlpool,    sph_whirlpool_close,    sizeof(sph_whirlpool_context),     true},
+    {sph_sha512_init,       sph_sha512,       sph_sha512_close,       sizeof(sph_sha512_context),        false},
+    {sph_haval256_5_init,   sph_haval256_5,   sph_haval256_5_close,   sizeof(sph_haval256_5_context),    false},
+    {sph_gost512_init,      sph_gost512,      sph_gost512_close,      sizeof(sph_gost512_context),       false},
+    {sph_radiogatun64_init, sph_radiogatun64, sph_radiogatun64_close, sizeof(sph_radiogatun64_context),  false},
+    {sph_panama_init,       sph_panama,       sph_panama_close,       sizeof(sph_panama_context),        true},
+};
+
+/** Freshly initialized context of every X20R primitive, copied instead of re-running init. */
+class CX20RInitialContexts
+{
+public:
+    X20RContext ctx[20];
+
+    CX20RInitialContexts()
+    {
+        for (int i = 0; i < 20; i++) {
+            x20rAlgos[i].init(&ctx[i]);
+        }
+    }
+};
+
+void X20RStart(int nAlgo, X20RContext& ctx)
+{
+    static const CX20RInitialContexts initial;
+    memcpy(&ctx, &initial.ctx[nAlgo], x20rAlgos[nAlgo].nContextSize);
+}
+
+/** Times a run of nCalls uses of one primitive when fX20RStats is set. */
+class CX20RStatsTimer
+{
+private:
+    const bool fEnabled;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    CX20RStatsTimer() : fEnabled(fX20RStats.load(std::memory_order_relaxed))
+    {
+        if (fEnabled)
+            start = std::chrono::steady_clock::now();
+    }
+
+    void Stop(int nAlgo, uint64_t nCalls)
+    {
+        if (fEnabled)
+            RecordX20RStats(nAlgo, nCalls, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+};
+
+static_assert(X20R_KERNEL_LANES == x20r_lanes::LANES, "X20R_KERNEL_LANES is the lane count of the kernels");
+
+/** Multi-lane kernel of each X20R primitive that has one, set by X20RAutoDetect(). */
+x20r_lanes::Kernel x20rKernels[20] = {};
+
+/** A stage only hands this many lanes or more of one primitive to its kernel, fewer are hashed one by one. */
+const size_t X20R_KERNEL_MIN_LANES = 3;
+
+/**
+ * Run X20R stages 1 to 19 over the nCount stage 0 outputs at pLanes, lane n
+ * taking its algorithm order from ppAlgos[n], and store the results in
+ * phashes. Each stage sorts the lanes by the primitive they select, so the
+ * lanes sharing one with a kernel go through it X20R_KERNEL_LANES at a time.
+ */
+void X20RFinishBatch(const int* const* ppAlgos, uint512* pLanes, size_t nCount, uint256* phashes)
+{
+    X20RContext ctx;
+    std::vector<size_t> vOrder(nCount);
+    for (int i = 1; i < 20; i++) {
+        // Counting sort of the lanes by primitive, those of nAlgo end up in vOrder[vStart[nAlgo]..vStart[nAlgo + 1])
+        size_t vStart[21] = {};
+        for (size_t n = 0; n < nCount; n++)
+            vStart[ppAlgos[n][i] + 1]++;
+        for (int nAlgo = 0; nAlgo < 20; nAlgo++)
+            vStart[nAlgo + 1] += vStart[nAlgo];
+        size_t vNext[20];
+        memcpy(vNext, vStart, sizeof(vNext));
+        for (size_t n = 0; n < nCount; n++)
+            vOrder[vNext[ppAlgos[n][i]]++] = n;
+
+        for (int nAlgo = 0; nAlgo < 20; nAlgo++) {
+            size_t nDone = vStart[nAlgo];
+            const size_t nEnd = vStart[nAlgo + 1];
+            if (nDone == nEnd)
+                continue;
+            const X20RAlgo& algo = x20rAlgos[nAlgo];
+            CX20RStatsTimer timer;
+            if (x20rKernels[nAlgo]) {
+                while (nEnd - nDone >= X20R_KERNEL_MIN_LANES) {
+                    // A short group fills its last lanes with a spare block, whose hash is dropped
+                    uint512 spare;
+                    const unsigned char* in[X20R_KERNEL_LANES];
+                    unsigned char* out[X20R_KERNEL_LANES];
+                    for (size_t k = 0; k < X20R_KERNEL_LANES; k++) {
+                        unsigned char* plane = nDone < nEnd ? pLanes[vOrder[nDone++]].begin() : spare.begin();
+                        in[k] = plane;
+                        out[k] = plane;
+                    }
+                    x20rKernels[nAlgo](in, out);
+                }
+            }
+            for (; nDone < nEnd; nDone++) {
+                // Primitives with a 256 bit output leave the upper half zeroed, as in HashX20R
+                uint512& lane = pLanes[vOrder[nDone]];
+                uint512 output;
+                X20RStart(nAlgo, ctx);
+                algo.write(&ctx, &lane, 64);
+                algo.close(&ctx, &output);
+                lane = output;
+            }
+            timer.Stop(nAlgo, nEnd - vStart[nAlgo]);
+        }
+    }
+    for (size_t n = 0; n < nCount; n++) {
+        phashes[n] = pLanes[n].trim256();
+    }
+}
+
+/** Check the kernels set in x20rKernels against the sph primitives. */
+bool X20RSelfTest()
+{
+    unsigned char in[X20R_KERNEL_LANES][64];
+    for (size_t k = 0; k < X20R_KERNEL_LANES; k++)
+        for (int j = 0; j < 64; j++)
+            in[k][j] = k * 64 + j;
+    for (int nAlgo = 0; nAlgo < 20; nAlgo++) {
+        if (!x20rKernels[nAlgo])
+            continue;
+        unsigned char out[X20R_KERNEL_LANES][64];
+        const unsigned char* pin[X20R_KERNEL_LANES];
+        unsigned char* pout[X20R_KERNEL_LANES];
+        for (size_t k = 0; k < X20R_KERNEL_LANES; k++) {
+            pin[k] = in[k];
+            pout[k] = out[k];
+        }
+        x20rKernels[nAlgo](pin, pout);
+        for (size_t k = 0; k < X20R_KERNEL_LANES; k++) {
+            uint512 expected;
+            HashX20RStage(nAlgo, in[k], 64, expected);
+            if (memcmp(out[k], expected.begin(), 64) != 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void HashX20RStage(int nAlgo, const void* pdata, size_t nLen, uint512& output)
+{
+    X20RContext ctx;
+    output.SetNull();
+    X20RStart(nAlgo, ctx);
+    x20rAlgos[nAlgo].write(&ctx, pdata, nLen);
+    x20rAlgos[nAlgo].close(&ctx, &output);
+}
+
+std::string X20RAutoDetect()
+{
+    std::string ret = "standard";
+    std::fill(std::begin(x20rKernels), std::end(x20rKernels), nullptr);
+#if X20R_HAVE_LANES
+    if (x20r_lanes::Supported()) {
+        x20rKernels[0] = x20r_lanes::Blake512;
+        x20rKernels[1] = x20r_lanes::Bmw512;
+        x20rKernels[3] = x20r_lanes::Jh512;
+        x20rKernels[4] = x20r_lanes::Keccak512;
+        x20rKernels[5] = x20r_lanes::Skein512;
+        x20rKernels[6] = x20r_lanes::Luffa512;
+        x20rKernels[7] = x20r_lanes::CubeHash512;
+        x20rKernels[15] = x20r_lanes::Sha512;
+        ret = "avx2";
+    }
+#endif
+
+    assert(X20RSelfTest());
+    return ret;
+}
+
+void HashX20RHeaders(const unsigned char* pheaders, size_t nCount, uint256* phashes)
+{
+    std::vector<int> vAlgos(20 * nCount);
+    std::vector<const int*> vpAlgos(nCount);
+    std::vector<uint512> vLanes(nCount);
+    X20RContext ctx;
+    for (size_t n = 0; n < nCount; n++) {
+        // The algorithm order comes from hashPrevBlock, which follows the 4 byte nVersion
+        const unsigned char* pheader = pheaders + 80 * n;
+        uint256 hashPrevBlock;
+        memcpy(hashPrevBlock.begin(), pheader + 4, 32);
+        int* pAlgos = &vAlgos[20 * n];
+        for (int i = 0; i < 20; i++) {
+            pAlgos[i] = GetHashSelection(hashPrevBlock, i);
+        }
+        vpAlgos[n] = pAlgos;
+
+        const X20RAlgo& first = x20rAlgos[pAlgos[0]];
+        CX20RStatsTimer timer;
+        X20RStart(pAlgos[0], ctx);
+        first.write(&ctx, pheader, 80);
+        first.close(&ctx, &vLanes[n]);
+        timer.Stop(pAlgos[0], 1);
+    }
+    X20RFinishBatch(vpAlgos.data(), vLanes.data(), nCount, phashes);
+}
+
+CX20RMidstate::CX20RMidstate(const unsigned char* pheader, const uint256& PrevBlockHash)
+{
+    for (int i = 0; i < 20; i++) {
+        algos[i] = GetHashSelection(PrevBlockHash, i);
+    }
+    fMidstate = x20rAlgos[algos[0]].fMidstate;
+    memcpy(prefix, pheader, X20R_MIDSTATE_SIZE);
+    if (fMidstate) {
+        X20RStart(algos[0], ctx);
+        x20rAlgos[algos[0]].write(&ctx, pheader, X20R_MIDSTATE_SIZE);
+    }
+}
+
+void CX20RMidstate::HashBatch(const unsigned char* ptails, size_t nCount, uint256* phashes) const
+{
+    const X20RAlgo& first = x20rAlgos[algos[0]];
+
+    X20RContext tail;
+    unsigned char header[X20R_MIDSTATE_SIZE + X20R_HEADER_TAIL_SIZE];
+    memcpy(header, prefix, X20R_MIDSTATE_SIZE);
+    std::vector<uint512> vLanes(nCount);
+    CX20RStatsTimer timer;
+    for (size_t n = 0; n < nCount; n++) {
+        const unsigned char* ptail = ptails + X20R_HEADER_TAIL_SIZE * n;
+        if (fMidstate) {
+            memcpy(&tail, &ctx, first.nContextSize);
+            first.write(&tail, ptail, X20R_HEADER_TAIL_SIZE);
+        } else {
+            // Plain X20R stage 0 over the whole header, in a single write
+            memcpy(header + X20R_MIDSTATE_SIZE, ptail, X20R_HEADER_TAIL_SIZE);
+            X20RStart(algos[0], tail);
+            first.write(&tail, header, sizeof(header));
+        }
+        first.close(&tail, &vLanes[n]);
+    }
+    timer.Stop(algos[0], nCount);
+
+    // Every lane takes the same algorithm order
+    std::vector<const int*> vpAlgos(nCount, algos);
+    X20RFinishBatch(vpAlgos.data(), vLanes.data(), nCount, phashes);
+}
+
+uint256 CX20RMidstate::Hash(const unsigned char* ptail) const
+{
+    uint256 hash;
+    HashBatch(ptail, 1, &hash);
+    return hash;
+}
@@ -7,6 +7,7 @@
 
 #ifndef RAVEN_HASH_H
 #define RAVEN_HASH_H
+#include <atomic>
 #include <iostream>
 #include <chrono>
 #include "crypto/ripemd160.h"
@@ -36,8 +37,10 @@ extern "C" {
 }
 #include "crypto/sph_haval.h"
 #include "crypto/sph_streebog.h"
+extern "C" {
 #include "crypto/sph_radiogatun.h"
 #include "crypto/sph_panama.h"
+}
 #include <vector>
 
 typedef uint256 ChainCode;
@@ -358,15 +361,33 @@ inline int GetHashSelection(const uint256 PrevBlockHash, int index) {
     return(hashSelection);
 }
 
-extern double algoHashTotal[20];
-extern int algoHashHits[20];
+/** Names of the X20R primitives, indexed by GetHashSelection(). */
+extern const char* const X20R_ALGO_NAMES[20];
+
+/** Whether X20R hashing records per-primitive counters (see RecordX20RStats). */
+extern std::atomic<bool> fX20RStats;
+
+/** Add nCalls runs of primitive nAlgo taking nNanos nanoseconds in total to its counters. */
+void RecordX20RStats(int nAlgo, uint64_t nCalls, int64_t nNanos);
+
+/** Counters of one X20R primitive since start-up or the last reset. */
+struct X20RAlgoStats {
+    uint64_t nCalls;
+    int64_t nNanos;
+};
+
+/** Copy the counters of every X20R primitive into stats, optionally clearing them. */
+void GetX20RStats(X20RAlgoStats (&stats)[20], bool fReset);
 
+/** Run X20R primitive nAlgo alone over nLen bytes, as one stage of HashX20R. */
+void HashX20RStage(int nAlgo, const void* pdata, size_t nLen, uint512& output);
 
 template<typename T1>
 inline uint256 HashX20R(const T1 pbegin, const T1 pend, const uint256 PrevBlockHash)
 {
-//	static std::chrono::duration<double>[20];
     int hashSelection;
+    const bool fStats = fX20RStats.load(std::memory_order_relaxed);
+    std::chrono::steady_clock::time_point start;
 
     sph_blake512_context     ctx_blake;     
     sph_bmw512_context       ctx_bmw;       
@@ -407,6 +428,9 @@ inline uint256 HashX20R(const T1 pbegin, const T1 pend, const uint256 PrevBlockH
 
         hashSelection = GetHashSelection(PrevBlockHash, i);
 
+        if (fStats)
+            start = std::chrono::steady_clock::now();
+
         switch(hashSelection) {
             case 0:
                 sph_blake512_init(&ctx_blake);
@@ -509,10 +533,99 @@ inline uint256 HashX20R(const T1 pbegin, const T1 pend, const uint256 PrevBlockH
                 sph_panama_close(&ctx_panama, static_cast<void*>(&hash[i]));
                 break;
         }
+
+        if (fStats)
+            RecordX20RStats(hashSelection, 1, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
     }
 
     return hash[19].trim256();
 }
 
+/** Storage large enough for the context of any X20R primitive. */
+union X20RContext {
+    sph_blake512_context     blake;
+    sph_bmw512_context       bmw;
+    sph_groestl512_context   groestl;
+    sph_jh512_context        jh;
+    sph_keccak512_context    keccak;
+    sph_skein512_context     skein;
+    sph_luffa512_context     luffa;
+    sph_cubehash512_context  cubehash;
+    sph_shavite512_context   shavite;
+    sph_simd512_context      simd;
+    sph_echo512_context      echo;
+    sph_hamsi512_context     hamsi;
+    sph_fugue512_context     fugue;
+    sph_shabal512_context    shabal;
+    sph_whirlpool_context    whirlpool;
+    sph_sha512_context       sha512;
+    sph_haval256_5_context   haval;
+    sph_gost512_context      gost;
+    sph_radiogatun64_context radiogatun;
+    sph_panama_context       panama;
+};
+
+/** Number of messages the multi-lane kernels of the X20R primitives hash at once. */
+static const size_t X20R_KERNEL_LANES = 4;
+
+/**
+ * Hand the X20R primitives that have a multi-lane kernel (blake, bmw, jh,
+ * keccak, skein, luffa, cubehash and sha512) over to it if the CPU runs it,
+ * and return the name of the kernels picked. Until then batches are hashed
+ * one lane at a time. Call before anything hashes in batches.
+ */
+std::string X20RAutoDetect();
+
+/**
+ * Compute the X20R hash of nCount serialized 80 byte block headers, stored
+ * back to back at pheaders, into phashes. Each header takes its algorithm
+ * order from the hashPrevBlock it holds, so the headers need not share one.
+ * Stages 1 to 19 hash the headers that select the same primitive together,
+ * through its multi-lane kernel where there is one; the more headers in a
+ * call, the more of them get to share.
+ */
+void HashX20RHeaders(const unsigned char* pheaders, size_t nCount, uint256* phashes);
+
+/** Bytes of an 80 byte block header that CX20RMidstate absorbs up front. */
+static const size_t X20R_MIDSTATE_SIZE = 64;
+/** Bytes of an 80 byte block header left to hash per nonce, ending with nNonce. */
+static const size_t X20R_HEADER_TAIL_SIZE = 16;
+
+/**
+ * X20R stage 0 with the first X20R_MIDSTATE_SIZE bytes of a serialized block
+ * header (nVersion, hashPrevBlock and most of hashMerkleRoot) already
+ * absorbed. Those bytes stay fixed while a miner walks nTime and nNonce, so
+ * each candidate header only has to feed its 16 byte tail to stage 0.
+ *
+ * That only saves work when stage 0 compresses the whole prefix right away,
+ * as jh, luffa, cubehash, hamsi, fugue, shabal and whirlpool do. The other
+ * primitives a nibble can select would just buffer it (128 byte blocks,
+ * keccak's 72 byte rate, skein keeping its last block back), so for them
+ * stage 0 runs over the whole header as in HashX20R.
+ */
+class CX20RMidstate
+{
+private:
+    int algos[20];
+    bool fMidstate;
+    unsigned char prefix[X20R_MIDSTATE_SIZE];
+    X20RContext ctx;
+
+public:
+    /** Absorb the nonce-invariant prefix of the 80 byte header at pheader. */
+    CX20RMidstate(const unsigned char* pheader, const uint256& PrevBlockHash);
+
+    /** Finish X20R for the header ending in the X20R_HEADER_TAIL_SIZE byte tail at ptail. */
+    uint256 Hash(const unsigned char* ptail) const;
+
+    /**
+     * Finish X20R for nCount headers given by their X20R_HEADER_TAIL_SIZE byte
+     * tails, stored back to back at ptails, into phashes. They share the
+     * algorithm order, so a batch of X20R_KERNEL_LANES keeps the multi-lane
+     * kernels full at every stage that has one.
+     */
+    void HashBatch(const unsigned char* ptails, size_t nCount, uint256* phashes) const;
+};
+
 
 #endif // RAVEN_HASH_H
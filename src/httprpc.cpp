@@ -82,6 +82,25 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     req->WriteReply(nStatus, strReply);
 }
 
+/**
+ * Reply to a call whose result can be written as it is produced, sending it in chunks
+ * rather than building the whole reply first. Returns false, without replying, if the
+ * call has to go through CRPCTable::execute.
+ */
+static bool StreamJSONRPCReply(HTTPRequest* req, const JSONRPCRequest& jreq)
+{
+    return req->WriteJSONReplyStream([&jreq](JSONStreamWriter& writer) {
+        writer.BeginObject();
+        writer.Key("result");
+        if (!tableRPC.executeStream(jreq, writer))
+            return false;
+        writer.KeyValue("error", NullUniValue);
+        writer.KeyValue("id", jreq.id);
+        writer.EndObject();
+        return true;
+    });
+}
+
 //This function checks username and password against -rpcauth
 //entries from config file.
 static bool multiUserAuthorized(std::string strUserPass)
@@ -186,6 +205,9 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
+            if (StreamJSONRPCReply(req, jreq))
+                return true;
+
             UniValue result = tableRPC.execute(jreq);
 
             // Send reply
@@ -193,7 +215,7 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 
         // array of requests
         } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(jreq, valRequest.get_array());
+            strReply = JSONRPCExecBatch(jreq, valRequest.get_array(), HTTPRunOnIdleWorker);
         else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
 
@@ -10,6 +10,7 @@
 #include "util.h"
 #include "utilstrencodings.h"
 #include "netbase.h"
+#include "rpc/jsonstream.h"
 #include "rpc/protocol.h" // For HTTP status codes
 #include "sync.h"
 #include "ui_interface.h"
@@ -74,6 +75,8 @@ private:
     bool running;
     size_t maxDepth;
     int numThreads;
+    //! Worker threads waiting for an item
+    int numIdle;
 
     /** RAII object to keep track of number of running worker threads */
     class ThreadCounter
@@ -96,7 +99,8 @@ private:
 public:
     explicit WorkQueue(size_t _maxDepth) : running(true),
                                  maxDepth(_maxDepth),
-                                 numThreads(0)
+                                 numThreads(0),
+                                 numIdle(0)
     {
     }
     /** Precondition: worker threads have all stopped
@@ -116,6 +120,17 @@ public:
         cond.notify_one();
         return true;
     }
+    /** Enqueue a work item only if an idle worker thread will pick it up right away */
+    bool EnqueueIfIdle(WorkItem* item)
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        if (!running || queue.size() >= (size_t)numIdle) {
+            return false;
+        }
+        queue.emplace_back(std::unique_ptr<WorkItem>(item));
+        cond.notify_one();
+        return true;
+    }
     /** Thread function */
     void Run()
     {
@@ -124,8 +139,11 @@ public:
             std::unique_ptr<WorkItem> i;
             {
                 std::unique_lock<std::mutex> lock(cs);
-                while (running && queue.empty())
+                while (running && queue.empty()) {
+                    numIdle++;
                     cond.wait(lock);
+                    numIdle--;
+                }
                 if (!running)
                     break;
                 i = std::move(queue.front());
@@ -176,6 +194,60 @@ static WorkQueue<HTTPClosure>* workQueue = nullptr;
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
 std::vector<evhttp_bound_socket *> boundSockets;
+//! Seconds a chunked reply waits for the client to read earlier chunks before giving up
+static int64_t nReplyTimeout = DEFAULT_HTTP_SERVER_TIMEOUT;
+
+//! Bytes of a chunked reply that may wait for the client to read them before WriteReplyChunk blocks
+static const size_t MAX_HTTP_REPLY_PENDING = 1024 * 1024;
+
+/** Flow control of a chunked reply, shared between the worker writing it and the event loop */
+struct HTTPChunkedReply
+{
+    std::mutex cs;
+    std::condition_variable cond;
+    //! Bytes handed to the event loop that the client didn't read yet
+    size_t nPending;
+    //! Part of nPending already in the connection's output buffer
+    size_t nBuffered;
+    //! Set when the connection closed before the reply ended
+    bool fClosed;
+
+    HTTPChunkedReply() : nPending(0), nBuffered(0), fClosed(false) {}
+};
+
+/** Called by libevent when the connection's output buffer was written out */
+static void http_reply_drained_cb(struct evhttp_connection*, void* arg)
+{
+    HTTPChunkedReply* reply = (HTTPChunkedReply*)arg;
+    std::lock_guard<std::mutex> lock(reply->cs);
+    reply->nPending -= reply->nBuffered;
+    reply->nBuffered = 0;
+    reply->cond.notify_all();
+}
+
+/**
+ * Called by libevent when the connection of a chunked reply closes before the reply ended. The
+ * unfinished request is detached from the connection rather than freed; evhttp_send_reply_end
+ * frees it.
+ */
+static void http_reply_closed_cb(struct evhttp_connection*, void* arg)
+{
+    HTTPChunkedReply* reply = (HTTPChunkedReply*)arg;
+    std::lock_guard<std::mutex> lock(reply->cs);
+    reply->fClosed = true;
+    reply->cond.notify_all();
+}
+
+/** HTTP work item running a function queued by HTTPRunOnIdleWorker */
+class HTTPFunctionItem final : public HTTPClosure
+{
+public:
+    explicit HTTPFunctionItem(std::function<void()> _func) : func(std::move(_func)) {}
+    void operator()() override { func(); }
+
+private:
+    std::function<void()> func;
+};
 
 /** Check if a network address is allowed to access the HTTP server */
 static bool ClientAllowed(const CNetAddr& netaddr)
@@ -402,7 +474,8 @@ bool InitHTTPServer()
         return false;
     }
 
-    evhttp_set_timeout(http, gArgs.GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
+    nReplyTimeout = gArgs.GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT);
+    evhttp_set_timeout(http, nReplyTimeout);
     evhttp_set_max_headers_size(http, MAX_HEADERS_SIZE);
     evhttp_set_max_body_size(http, MAX_SIZE);
     evhttp_set_gencb(http, http_request_cb, nullptr);
@@ -456,6 +529,17 @@ bool StartHTTPServer()
     return true;
 }
 
+bool HTTPRunOnIdleWorker(std::function<void()> func)
+{
+    if (!workQueue)
+        return false;
+    std::unique_ptr<HTTPFunctionItem> item(new HTTPFunctionItem(std::move(func)));
+    if (!workQueue->EnqueueIfIdle(item.get()))
+        return false;
+    item.release(); /* queue took ownership */
+    return true;
+}
+
 void InterruptHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Interrupting HTTP server\n");
@@ -544,7 +628,10 @@ HTTPRequest::HTTPRequest(struct evhttp_request* _req) : req(_req),
 }
 HTTPRequest::~HTTPRequest()
 {
-    if (!replySent) {
+    if (!replySent && chunkedReply) {
+        LogPrintf("%s: Unfinished chunked reply\n", __func__);
+        WriteReplyEnd(false);
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL, "Unhandled request");
@@ -609,6 +696,126 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = nullptr; // transferred back to main thread
 }
 
+bool HTTPRequest::WriteReplyChunk(const std::string& strChunk)
+{
+    assert(!replySent && req);
+    struct evhttp_request* r = req;
+    if (!chunkedReply) {
+        chunkedReply = std::make_shared<HTTPChunkedReply>();
+        std::shared_ptr<HTTPChunkedReply> reply = chunkedReply;
+        HTTPEvent* ev = new HTTPEvent(eventBase, true, [r, reply]() {
+            struct evhttp_connection* evcon = evhttp_request_get_connection(r);
+            if (!evcon) {
+                // Closed while the request was being handled
+                http_reply_closed_cb(nullptr, reply.get());
+                return;
+            }
+            evhttp_connection_set_closecb(evcon, http_reply_closed_cb, reply.get());
+            evhttp_send_reply_start(r, HTTP_OK, nullptr);
+        });
+        ev->trigger(nullptr);
+    }
+    std::shared_ptr<HTTPChunkedReply> reply = chunkedReply;
+
+    {
+        // Don't produce the reply faster than the client reads it
+        std::unique_lock<std::mutex> lock(reply->cs);
+        if (!reply->cond.wait_for(lock, std::chrono::seconds(nReplyTimeout),
+                [&reply]() { return reply->fClosed || reply->nPending < MAX_HTTP_REPLY_PENDING; })) {
+            LogPrint(BCLog::HTTP, "%s: client stopped reading the reply\n", __func__);
+            return false;
+        }
+        if (reply->fClosed)
+            return false;
+        reply->nPending += strChunk.size();
+    }
+
+    // Chunks are handed over in their own buffer, the events run in the order they are triggered
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, strChunk.data(), strChunk.size());
+    const size_t nSize = strChunk.size();
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [r, evb, reply, nSize]() {
+        // fClosed is only set on this thread, so it can't change until this returns
+        if (!reply->fClosed) {
+            {
+                std::lock_guard<std::mutex> lock(reply->cs);
+                reply->nBuffered += nSize;
+            }
+            evhttp_send_reply_chunk_with_cb(r, evb, http_reply_drained_cb, reply.get());
+        }
+        evbuffer_free(evb);
+    });
+    ev->trigger(nullptr);
+    return true;
+}
+
+void HTTPRequest::WriteReplyEnd(bool fComplete)
+{
+    assert(!replySent && req && chunkedReply);
+    struct evhttp_request* r = req;
+    std::shared_ptr<HTTPChunkedReply> reply = chunkedReply;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [r, reply, fComplete]() {
+        if (reply->fClosed) {
+            // Only frees the request, it has no connection anymore
+            evhttp_send_reply_end(r);
+            return;
+        }
+        struct evhttp_connection* evcon = evhttp_request_get_connection(r);
+        evhttp_connection_set_closecb(evcon, nullptr, nullptr);
+        if (fComplete) {
+            evhttp_send_reply_end(r);
+        } else {
+            // Without the last chunk the client sees the reply was cut short, rather than a
+            // complete reply holding truncated JSON. Frees the request too.
+            evhttp_connection_free(evcon);
+        }
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req = nullptr; // transferred back to main thread
+}
+
+bool HTTPRequest::WriteJSONReplyStream(const std::function<bool(JSONStreamWriter&)>& write)
+{
+    bool fStarted = false;
+    JSONStreamWriter writer([this, &fStarted](const std::string& chunk) {
+        if (!fStarted) {
+            WriteHeader("Content-Type", "application/json");
+            fStarted = true;
+        }
+        if (!WriteReplyChunk(chunk))
+            throw std::runtime_error("client stopped reading the reply");
+    });
+    try {
+        if (!write(writer))
+            return false;
+        writer.WriteRaw("\n");
+        if (fStarted)
+            writer.Flush();
+    } catch (const std::exception& e) {
+        if (!fStarted)
+            throw;
+        LogPrintf("%s: %s failed after part of the reply was sent: %s\n", __func__, GetURI(), e.what());
+        WriteReplyEnd(false);
+        return true;
+    } catch (...) {
+        if (!fStarted)
+            throw;
+        LogPrintf("%s: %s failed after part of the reply was sent\n", __func__, GetURI());
+        WriteReplyEnd(false);
+        return true;
+    }
+
+    if (fStarted) {
+        WriteReplyEnd();
+    } else {
+        WriteHeader("Content-Type", "application/json");
+        WriteReply(HTTP_OK, writer.TakeBuffer());
+    }
+    return true;
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
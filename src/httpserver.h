@@ -9,6 +9,7 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <memory>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
@@ -18,6 +19,8 @@ struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct HTTPChunkedReply;
+class JSONStreamWriter;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -28,6 +31,10 @@ bool InitHTTPServer();
  * to register their handlers between InitHTTPServer and StartHTTPServer.
  */
 bool StartHTTPServer();
+/** Run func on an HTTP worker thread that is idle right now. Returns false, without
+ * queuing func, if none is. Lets a handler spread a request over otherwise unused workers.
+ */
+bool HTTPRunOnIdleWorker(std::function<void()> func);
 /** Interrupt HTTP server threads */
 void InterruptHTTPServer();
 /** Stop HTTP server */
@@ -60,6 +67,8 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    //! State shared with the event loop once a chunked reply was started by WriteReplyChunk
+    std::shared_ptr<HTTPChunkedReply> chunkedReply;
 
 public:
     explicit HTTPRequest(struct evhttp_request* req);
@@ -115,6 +124,37 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Write part of the reply body. The first call starts a chunked reply
+     * with status HTTP_OK, finish it with WriteReplyEnd.
+     * Blocks while the client is behind on reading earlier chunks. Returns
+     * false if the connection was closed, or the client didn't read anything
+     * for -rpcservertimeout seconds; the reply should then be abandoned.
+     *
+     * @note call WriteHeader before the first chunk.
+     */
+    bool WriteReplyChunk(const std::string& strChunk);
+
+    /**
+     * Finish a reply started by WriteReplyChunk. Like WriteReply, this gives
+     * the request back to the main thread.
+     * If fComplete is false the connection is closed instead of ending the
+     * reply, so the client can tell the reply is incomplete.
+     */
+    void WriteReplyEnd(bool fComplete = true);
+
+    /**
+     * Reply with the JSON body written by write, sent in chunks as it is produced rather than
+     * built in full first. A body that never outgrows the writer's buffer goes out as a regular
+     * reply. Returns false, without replying, if write does.
+     * An exception thrown before anything was sent is passed on, so the caller can still reply
+     * with an error. After that the connection is dropped instead, so the client can't take the
+     * part it got for the whole body.
+     *
+     * @note call WriteHeader for any header other than Content-Type beforehand.
+     */
+    bool WriteJSONReplyStream(const std::function<bool(JSONStreamWriter&)>& write);
 };
 
 /** Event handler closure.
@@ -18,6 +18,7 @@
 #include "compat/sanity.h"
 #include "consensus/validation.h"
 #include "fs.h"
+#include "hash.h"
 #include "httpserver.h"
 #include "httprpc.h"
 #include "key.h"
@@ -49,8 +50,10 @@
 #include "assets/assetdb.h"
 #ifdef ENABLE_WALLET
 #include "wallet/init.h"
+#include "wallet/wallet.h"
 #endif
 #include "warnings.h"
+#include "workerpool.h"
 #include "tinyformat.h"
 #include <stdint.h>
 #include <stdio.h>
@@ -154,6 +157,15 @@ public:
             abort();
         }
     }
+    void GetCoins(const std::vector<COutPoint> &vOutpoints, std::vector<Coin> &vCoins) const override {
+        try {
+            base->GetCoins(vOutpoints, vCoins);
+        } catch(const std::runtime_error& e) {
+            uiInterface.ThreadSafeMessageBox(_("Error reading from database, shutting down."), "", CClientUIInterface::MSG_ERROR);
+            LogPrintf("Error reading from database: %s\n", e.what());
+            abort();
+        }
+    }
     // Writes do not need similar protection, as failure to write is handled by the caller.
 };
 
@@ -354,7 +366,10 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug) {
         strUsage += HelpMessageOpt("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize));
     }
+    strUsage += HelpMessageOpt("-assetcache=<n>", strprintf(_("Maximum memory in megabytes used for cached asset address balances, taken out of -dbcache (default: %u)"), DEFAULT_ASSET_CACHE));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-dbcompression=<db>", strprintf(_("Snappy compress newly written data of a database, can be specified multiple times (%s or all, default: none)"), "chainstate, blockindex, assets"));
+    strUsage += HelpMessageOpt("-rewritedb", strprintf(_("Rewrite the databases on startup so existing data is stored as set by -dbcompression (slow, default: %u)"), DEFAULT_REWRITEDB));
     if (showDebug)
         strUsage += HelpMessageOpt("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
@@ -371,6 +386,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-workerthreads=<n>", strprintf(_("Set the number of threads preparing blocks, reading coins, handling peer messages and hashing headers and imported blocks (1 to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        MAX_WORKER_THREADS, DEFAULT_WORKER_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), RAVEN_PID_FILENAME));
 #endif
@@ -387,6 +404,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-coinstatsindex", strprintf(_("Keep statistics about the UTXO set up to date as blocks are connected, used by gettxoutsetinfo \"muhash\" (default: %u)"), DEFAULT_COINSTATSINDEX));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open (see the `addnode` RPC command help for more info)"));
@@ -446,6 +464,7 @@ std::string HelpMessage(HelpMessageMode mode)
     {
         strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), DEFAULT_CHECKBLOCKS));
         strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
+        strUsage += HelpMessageOpt("-checkblockindexpow", strprintf("Re-hash every block header in the block index at startup instead of a random sample (default: %u)", DEFAULT_CHECKBLOCKINDEXPOW));
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
@@ -703,6 +722,9 @@ void ThreadImport(std::vector<fs::path> vImportFiles)
         LoadMempool();
         fDumpMempoolLater = !fRequestShutdown;
     }
+
+    if (fCoinStatsIndex && !fRequestShutdown && !BuildRollingCoinsStats())
+        LogPrintf("Failed to compute the UTXO set statistics\n");
 }
 
 /** Sanity checks
@@ -838,6 +860,7 @@ namespace { // Variables internal to initialization process only
 int nMaxConnections;
 int nUserMaxConnections;
 int nFD;
+int nWorkerThreads;
 ServiceFlags nLocalServices = NODE_NETWORK;
 
 } // namespace
@@ -923,12 +946,15 @@ bool AppInitParameterInteraction()
     }
 
     // Make sure enough file descriptors are available
-    int nBind = std::max(nUserBind, size_t(1));
     nUserMaxConnections = gArgs.GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
     // Trim requested connection counts, to fit into system limitations
+#ifndef USE_EPOLL
+    // select() can only watch descriptors below FD_SETSIZE
+    int nBind = std::max(nUserBind, size_t(1));
     nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
+#endif
     nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -964,6 +990,16 @@ bool AppInitParameterInteraction()
         logCategories &= ~flag;
     }
 
+    const std::vector<std::string> vCompressDBs = gArgs.GetArgs("-dbcompression");
+    for (const std::string& strDB : vCompressDBs) {
+        if (strDB != "all" && std::find(std::begin(DB_COMPRESSION_NAMES), std::end(DB_COMPRESSION_NAMES), strDB) == std::end(DB_COMPRESSION_NAMES))
+            return InitError(strprintf(_("Unknown database for -dbcompression: '%s'"), strDB));
+    }
+#ifndef USE_SNAPPY
+    if (!vCompressDBs.empty())
+        InitWarning(_("This build has no Snappy support, -dbcompression is ignored."));
+#endif
+
     // Check for -debugnet
     if (gArgs.GetBoolArg("-debugnet", false))
         InitWarning(_("Unsupported argument -debugnet ignored, use -debug=net."));
@@ -990,6 +1026,7 @@ bool AppInitParameterInteraction()
     }
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    fCoinStatsIndex = gArgs.GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX);
 
     hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
     if (!hashAssumeValid.IsNull())
@@ -1035,6 +1072,12 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    // The worker pool is sized on its own, so -par=1 doesn't turn it off as well
+    nWorkerThreads = gArgs.GetArg("-workerthreads", DEFAULT_WORKER_THREADS);
+    if (nWorkerThreads <= 0)
+        nWorkerThreads += GetNumCores();
+    nWorkerThreads = std::max(1, std::min(nWorkerThreads, MAX_WORKER_THREADS));
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = gArgs.GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1197,6 +1240,8 @@ bool AppInitSanityChecks()
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string x20r_kernels = X20RAutoDetect();
+    LogPrintf("Using the '%s' X20R kernels\n", x20r_kernels);
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1255,6 +1300,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             threadGroup.create_thread(&ThreadScriptCheck);
     }
 
+    LogPrintf("Using %u worker threads\n", nWorkerThreads);
+    for (int i=0; i<nWorkerThreads; i++)
+        threadGroup.create_thread(&ThreadWorkerPool);
+
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
@@ -1416,6 +1465,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     int64_t nBlockTreeDBCache = nTotalCache / 8;
     nBlockTreeDBCache = std::min(nBlockTreeDBCache, (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
     nTotalCache -= nBlockTreeDBCache;
+    int64_t nAssetCache = std::min(gArgs.GetArg("-assetcache", DEFAULT_ASSET_CACHE) << 20, nTotalCache / 4); // at most a quarter of the remainder
+    nAssetCache = std::max<int64_t>(nAssetCache, 0);
+    nTotalCache -= nAssetCache;
+    nAssetCacheUsage = nAssetCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1424,6 +1477,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for in-memory asset address balances\n", nAssetCacheUsage * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
     bool fLoaded = false;
@@ -1450,7 +1504,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete passetsCache;
                 passetsdb = new CAssetsDB(nBlockTreeDBCache, false, fReset);
                 passets = new CAssetsCache();
-                passetsCache = new CLRUCache<std::string, CDatabasedAssetData>(MAX_CACHE_ASSETS_SIZE);
+#ifdef ENABLE_WALLET
+                fTrackPossiblyMine = !gArgs.GetBoolArg("-disablewallet", DEFAULT_DISABLE_WALLET);
+#else
+                fTrackPossiblyMine = false;
+#endif
+                passetsCache = new CAssetsMetaCache(MAX_CACHE_ASSETS_SIZE, MAX_CACHE_ASSETS_ABSENT_SIZE);
 
 
                 // Need to load assets before we verify the database
@@ -1550,6 +1609,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 // The on-disk coinsdb is now in a good state, create the cache
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 
+                // A binary without the address asset index may have changed the asset balances since it was written
+                if (!passetsdb->CheckAddressAssetIndex(pcoinsTip->GetBestBlock())) {
+                    strLoadError = _("Failed to load Assets Database");
+                    break;
+                }
+
                 bool is_coinsview_empty = fReset || fReindexChainState || pcoinsTip->GetBestBlock().IsNull();
                 if (!is_coinsview_empty) {
                     // LoadChainTip sets chainActive based on pcoinsTip's best block
@@ -1637,6 +1702,21 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
     }
 
+    // Rewrite the databases opened above once, the load loop may have opened them more than once
+    if (gArgs.GetBoolArg("-rewritedb", DEFAULT_REWRITEDB)) {
+        uiInterface.InitMessage(_("Rewriting databases..."));
+        nStart = GetTimeMillis();
+        try {
+            pblocktree->Rewrite();
+            passetsdb->Rewrite();
+            pcoinsdbview->Rewrite();
+        } catch (const std::exception& e) {
+            LogPrintf("%s\n", e.what());
+            return InitError(_("Error rewriting the databases"));
+        }
+        LogPrintf(" rewrite databases %15dms\n", GetTimeMillis() - nStart);
+    }
+
     fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
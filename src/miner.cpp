@@ -14,6 +14,7 @@
 #include "consensus/tx_verify.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
+#include "crypto/common.h"
 #include "hash.h"
 #include "validation.h"
 #include "net.h"
@@ -22,6 +23,7 @@
 #include "pow.h"
 #include "primitives/transaction.h"
 #include "script/standard.h"
+#include "streams.h"
 #include "timedata.h"
 #include "txmempool.h"
 #include "util.h"
@@ -597,35 +599,65 @@ void static AstralMiner(const CChainParams& chainparams)
             //
             int64_t nStart = GetTime();
             arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
+
+            // Stage 0 midstate of the header prefix, and the header tail hashed per nonce.
+            // The prefix (nVersion, hashPrevBlock, most of hashMerkleRoot) is fixed for
+            // this block; only nTime and nBits in the tail change between passes below.
+            CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+            ssHeader << pblock->GetBlockHeader();
+            assert(ssHeader.size() == X20R_MIDSTATE_SIZE + X20R_HEADER_TAIL_SIZE);
+            const unsigned char* pheader = (const unsigned char*)ssHeader.data();
+            const CX20RMidstate midstate(pheader, pblock->hashPrevBlock);
+            // One tail per nonce of a batch, so the multi-lane kernels run full
+            unsigned char vTails[X20R_KERNEL_LANES][X20R_HEADER_TAIL_SIZE];
+            uint256 vHashes[X20R_KERNEL_LANES];
+            for (size_t nLane = 0; nLane < X20R_KERNEL_LANES; nLane++)
+                memcpy(vTails[nLane], pheader + X20R_MIDSTATE_SIZE, X20R_HEADER_TAIL_SIZE);
+
             while (true)
             {
+                // Tail layout: last 4 bytes of hashMerkleRoot, nTime, nBits, nNonce
+                for (size_t nLane = 0; nLane < X20R_KERNEL_LANES; nLane++) {
+                    WriteLE32(vTails[nLane] + 4, pblock->nTime);
+                    WriteLE32(vTails[nLane] + 8, pblock->nBits);
+                }
 
-                uint256 hash;
+                bool fFound = false;
                 while (true)
                 {
-                    hash = pblock->GetHash();
-                    if (UintToArith256(hash) <= hashTarget)
-                    {
-                        // Found a solution
-                        SetThreadPriority(THREAD_PRIORITY_NORMAL);
-                        LogPrintf("AstralMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
-                        ProcessBlockFound(pblock, chainparams);
-                        SetThreadPriority(THREAD_PRIORITY_LOWEST);
-                        coinbaseScript->KeepScript();
-
-                        // In regression test mode, stop mining after a block is found. This
-                        // allows developers to controllably generate a block on demand.
-                        if (chainparams.MineBlocksOnDemand())
-                            throw boost::thread_interrupted();
+                    for (size_t nLane = 0; nLane < X20R_KERNEL_LANES; nLane++)
+                        WriteLE32(vTails[nLane] + X20R_HEADER_TAIL_SIZE - 4, pblock->nNonce + nLane);
+                    midstate.HashBatch(vTails[0], X20R_KERNEL_LANES, vHashes);
 
-                        break;
+                    for (size_t nLane = 0; nLane < X20R_KERNEL_LANES; nLane++)
+                    {
+                        if (UintToArith256(vHashes[nLane]) <= hashTarget)
+                        {
+                            // Found a solution
+                            pblock->nNonce += nLane;
+                            fFound = true;
+                            SetThreadPriority(THREAD_PRIORITY_NORMAL);
+                            LogPrintf("AstralMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", vHashes[nLane].GetHex(), hashTarget.GetHex());
+                            ProcessBlockFound(pblock, chainparams);
+                            SetThreadPriority(THREAD_PRIORITY_LOWEST);
+                            coinbaseScript->KeepScript();
+
+                            // In regression test mode, stop mining after a block is found. This
+                            // allows developers to controllably generate a block on demand.
+                            if (chainparams.MineBlocksOnDemand())
+                                throw boost::thread_interrupted();
+
+                            break;
+                        }
                     }
-                    pblock->nNonce += 1;
-                    nHashesDone += 1;
-                    if (nHashesDone % 500000 == 0) {   //Calculate hashing speed
+                    if (fFound)
+                        break;
+                    pblock->nNonce += X20R_KERNEL_LANES;
+                    nHashesDone += X20R_KERNEL_LANES;
+                    if (nHashesDone % 500000 < X20R_KERNEL_LANES) {   //Calculate hashing speed
                         nHashesPerSec = nHashesDone / (((GetTimeMicros() - nMiningTimeStart) / 1000000) + 1);
                     } 
-                    if ((pblock->nNonce & 0xFF) == 0)
+                    if ((pblock->nNonce & 0xFF) < X20R_KERNEL_LANES)
                         break;
                 }
 
@@ -27,6 +27,11 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
 #endif
 
 #ifdef USE_UPNP
@@ -49,6 +54,16 @@
 // We add a random period time (0 to 1 seconds) to feeler connections to prevent synchronization.
 #define FEELER_SLEEP_WINDOW 1
 
+// How long the socket handler waits for socket events before polling pnode->vSend again
+static const int SELECT_TIMEOUT_MILLISECONDS = 50;
+
+// Payloads up to this size are copied behind their header into a single send buffer
+static const size_t MAX_COALESCED_PAYLOAD_SIZE = 1024;
+// Number of sent buffers a connection keeps around for its next messages
+static const size_t MAX_SEND_BUFFER_POOL_SIZE = 16;
+// Maximum number of queued buffers handed to the kernel in one sendmsg() call
+static const int MAX_SEND_IOV = 64;
+
 #if !defined(HAVE_MSG_NOSIGNAL)
 #define MSG_NOSIGNAL 0
 #endif
@@ -737,7 +752,7 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
         // get current incomplete message, or create a new one
         if (vRecvMsg.empty() ||
             vRecvMsg.back().complete())
-            vRecvMsg.push_back(CNetMessage(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION));
+            vRecvMsg.emplace_back(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
 
         CNetMessage& msg = vRecvMsg.back();
 
@@ -777,6 +792,17 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
     return true;
 }
 
+char* CNode::GetRecvDataSpace(unsigned int nMinRemaining, unsigned int& nBytes)
+{
+    LOCK(cs_vRecv);
+    if (vRecvMsg.empty())
+        return nullptr;
+    CNetMessage& msg = vRecvMsg.back();
+    if (!msg.in_data || msg.hdr.nMessageSize - msg.nDataPos < std::max(nMinRemaining, 1U))
+        return nullptr;
+    return msg.GetDataSpace(nBytes);
+}
+
 void CNode::SetSendVersion(int nVersionIn)
 {
     // Send version may only be changed in the version message, and
@@ -804,22 +830,87 @@ int CNode::GetSendVersion() const
 }
 
 
-int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
+namespace {
+
+/**
+ * Keeps the receive buffers of processed messages around, so that the socket
+ * handler doesn't allocate (and later cleanse and free) a new one for every
+ * message it receives. Buffers that grew large are not kept. Buffers keep
+ * their size, so that reusing one doesn't zero-fill what is overwritten anyway.
+ */
+class CRecvBufferPool
 {
-    // copy data to temporary parsing buffer
-    unsigned int nRemaining = 24 - nHdrPos;
-    unsigned int nCopy = std::min(nRemaining, nBytes);
+private:
+    CCriticalSection cs;
+    std::vector<CSerializeData> vFree;
+
+public:
+    static const size_t MAX_BUFFERS = 64;
+    static const size_t MAX_BUFFER_CAPACITY = 128 * 1024;
+
+    //! Give the empty stream s a recycled buffer with stale contents, if there is one
+    void Take(CDataStream& s)
+    {
+        CSerializeData buf;
+        {
+            LOCK(cs);
+            if (vFree.empty())
+                return;
+            buf.swap(vFree.back());
+            vFree.pop_back();
+        }
+        s.swap(buf);
+    }
+
+    //! Take s's buffer for reuse, leaving s empty
+    void Put(CDataStream& s)
+    {
+        CSerializeData buf;
+        s.swap(buf);
+        if (buf.capacity() == 0 || buf.capacity() > MAX_BUFFER_CAPACITY)
+            return;
+        LOCK(cs);
+        if (vFree.size() < MAX_BUFFERS) {
+            vFree.emplace_back();
+            vFree.back().swap(buf);
+        }
+    }
+};
 
-    memcpy(&hdrbuf[nHdrPos], pch, nCopy);
-    nHdrPos += nCopy;
+CRecvBufferPool recvbufferpool;
 
-    // if header incomplete, exit
-    if (nHdrPos < 24)
-        return nCopy;
+} // namespace
+
+CNetMessage::~CNetMessage()
+{
+    recvbufferpool.Put(vRecv);
+}
 
-    // deserialize to CMessageHeader
+int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
+{
+    unsigned int nCopy;
     try {
-        hdrbuf >> hdr;
+        if (nHdrPos == 0 && nBytes >= CMessageHeader::HEADER_SIZE) {
+            // The whole header is in the received data, parse it from there
+            nCopy = CMessageHeader::HEADER_SIZE;
+            CSpanReader(hdrbuf.GetType(), hdrbuf.GetVersion(), pch, pch + nCopy) >> hdr;
+            nHdrPos = nCopy;
+        } else {
+            // copy data to temporary parsing buffer
+            unsigned int nRemaining = CMessageHeader::HEADER_SIZE - nHdrPos;
+            nCopy = std::min(nRemaining, nBytes);
+
+            hdrbuf.resize(CMessageHeader::HEADER_SIZE);
+            memcpy(&hdrbuf[nHdrPos], pch, nCopy);
+            nHdrPos += nCopy;
+
+            // if header incomplete, exit
+            if (nHdrPos < CMessageHeader::HEADER_SIZE)
+                return nCopy;
+
+            // deserialize to CMessageHeader
+            hdrbuf >> hdr;
+        }
     }
     catch (const std::exception&) {
         return -1;
@@ -835,20 +926,41 @@ int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
     return nCopy;
 }
 
+void CNetMessage::ReserveData(unsigned int nBytes)
+{
+    if (nDataPos == 0 && vRecv.empty())
+        recvbufferpool.Take(vRecv);
+    if (vRecv.size() < nDataPos + nBytes) {
+        // Grow up to 256 KiB ahead, but never past the message size. Beyond
+        // that the buffer grows with the data that actually arrives.
+        vRecv.resize(std::min(hdr.nMessageSize, std::max(nDataPos + nBytes, nDataPos + 256 * 1024)));
+    }
+}
+
+char* CNetMessage::GetDataSpace(unsigned int& nBytes)
+{
+    nBytes = std::min(nBytes, hdr.nMessageSize - nDataPos);
+    ReserveData(nBytes);
+    return vRecv.data() + nDataPos;
+}
+
 int CNetMessage::readData(const char *pch, unsigned int nBytes)
 {
     unsigned int nRemaining = hdr.nMessageSize - nDataPos;
     unsigned int nCopy = std::min(nRemaining, nBytes);
 
-    if (vRecv.size() < nDataPos + nCopy) {
-        // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
-    }
-
-    hasher.Write((const unsigned char*)pch, nCopy);
-    memcpy(&vRecv[nDataPos], pch, nCopy);
+    ReserveData(nCopy);
+    char* pchDest = vRecv.data() + nDataPos;
+    // Skip the copy if the bytes were received into GetDataSpace
+    if (pch != pchDest)
+        memcpy(pchDest, pch, nCopy);
+    hasher.Write((const unsigned char*)pchDest, nCopy);
     nDataPos += nCopy;
 
+    // Drop what is left beyond the payload, of the step ahead or a recycled buffer
+    if (complete())
+        vRecv.resize(nDataPos);
+
     return nCopy;
 }
 
@@ -875,27 +987,51 @@ size_t CConnman::SocketSendData(CNode *pnode) const
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert(it->size() > pnode->nSendOffset);
+        size_t nOffered = 0;
         int nBytes = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifdef WIN32
+            nOffered = it->size() - pnode->nSendOffset;
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(it->data()) + pnode->nSendOffset, nOffered, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            // Hand the kernel as many queued buffers as possible in one call,
+            // instead of one send() per buffer
+            struct iovec iov[MAX_SEND_IOV];
+            int nIov = 0;
+            size_t nOffset = pnode->nSendOffset;
+            for (auto next = it; next != pnode->vSendMsg.end() && nIov < MAX_SEND_IOV; ++next, ++nIov) {
+                iov[nIov].iov_base = next->data() + nOffset;
+                iov[nIov].iov_len = next->size() - nOffset;
+                nOffered += iov[nIov].iov_len;
+                nOffset = 0;
+            }
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = nIov;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // Step over the buffers that went out completely
+            size_t nLeft = nBytes;
+            while (nLeft > 0 && nLeft >= it->size() - pnode->nSendOffset) {
+                nLeft -= it->size() - pnode->nSendOffset;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                pnode->nSendSize -= it->size();
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            pnode->nSendOffset += nLeft;
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if ((size_t)nBytes < nOffered) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -917,6 +1053,13 @@ size_t CConnman::SocketSendData(CNode *pnode) const
         assert(pnode->nSendOffset == 0);
         assert(pnode->nSendSize == 0);
     }
+    // Keep small buffers for the next messages to this peer
+    for (auto sent = pnode->vSendMsg.begin(); sent != it && pnode->vSendBufferPool.size() < MAX_SEND_BUFFER_POOL_SIZE; ++sent) {
+        if (sent->capacity() <= CMessageHeader::HEADER_SIZE + MAX_COALESCED_PAYLOAD_SIZE) {
+            sent->clear();
+            pnode->vSendBufferPool.push_back(std::move(*sent));
+        }
+    }
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
     return nSentSize;
 }
@@ -1148,6 +1291,193 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     }
 }
 
+// Implement the following logic:
+// * If there is data to send, wait for the socket to become writable. As this only
+//   happens when optimistic write failed, we choose to first drain the
+//   write buffer in this case before receiving more. This avoids
+//   needlessly queueing received data, if the remote peer is not themselves
+//   receiving data. This means properly utilizing TCP flow control signalling.
+// * Otherwise, if there is space left in the receive buffer, wait for
+//   receivable data.
+// * Hand off all complete messages to the processor, to be handled without
+//   blocking here.
+static void GetSocketInterest(CNode* pnode, bool& select_recv, bool& select_send)
+{
+    select_recv = !pnode->fPauseRecv;
+    LOCK(pnode->cs_vSend);
+    select_send = !pnode->vSendMsg.empty();
+}
+
+#ifdef USE_EPOLL
+bool CConnman::InitEpoll()
+{
+    epollfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollfd == -1) {
+        LogPrintf("epoll_create1 failed: %s\n", NetworkErrorString(errno));
+        return false;
+    }
+    // Listening sockets are only ever polled for incoming connections
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = hListenSocket.socket;
+        if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hListenSocket.socket, &event) == SOCKET_ERROR) {
+            LogPrintf("epoll_ctl failed to add listening socket: %s\n", NetworkErrorString(errno));
+            return false;
+        }
+    }
+    return true;
+}
+
+void CConnman::SocketEventsEpoll(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+    // Registrations persist across calls, so only sockets whose wanted events
+    // changed since the last round cost a system call here, and epoll_wait
+    // only reports the sockets that are actually ready.
+    size_t nSockets = vhListenSocket.size();
+    {
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodes)
+        {
+            bool select_recv, select_send;
+            GetSocketInterest(pnode, select_recv, select_send);
+
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+            nSockets++;
+
+            uint32_t nEvents = select_send ? (uint32_t)EPOLLOUT : (select_recv ? (uint32_t)EPOLLIN : 0u);
+            if ((int)nEvents == pnode->nEpollEvents)
+                continue;
+
+            struct epoll_event event;
+            event.events = nEvents;
+            event.data.fd = pnode->hSocket;
+            int op = pnode->nEpollEvents == -1 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+            if (epoll_ctl(epollfd, op, pnode->hSocket, &event) == SOCKET_ERROR) {
+                LogPrintf("epoll_ctl failed for peer=%d: %s, disconnecting\n", pnode->GetId(), NetworkErrorString(errno));
+                // Don't retry every round; the socket can't be waited on, so drop the peer
+                pnode->fDisconnect = true;
+                continue;
+            }
+            pnode->nEpollEvents = (int)nEvents;
+        }
+    }
+
+    std::vector<struct epoll_event> vEvents(std::max<size_t>(nSockets, 1));
+    int nReady = epoll_wait(epollfd, vEvents.data(), vEvents.size(), SELECT_TIMEOUT_MILLISECONDS);
+    if (interruptNet)
+        return;
+
+    if (nReady == SOCKET_ERROR)
+    {
+        if (errno != EINTR)
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(errno));
+        interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        return;
+    }
+
+    for (int i = 0; i < nReady; i++)
+    {
+        SOCKET hSocket = vEvents[i].data.fd;
+        if (vEvents[i].events & EPOLLIN)
+            recv_set.insert(hSocket);
+        if (vEvents[i].events & EPOLLOUT)
+            send_set.insert(hSocket);
+        if (vEvents[i].events & (EPOLLERR | EPOLLHUP))
+            error_set.insert(hSocket);
+    }
+}
+#endif
+
+void CConnman::SocketEventsSelect(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+    //
+    // Find which sockets have data to receive
+    //
+    struct timeval timeout;
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = SELECT_TIMEOUT_MILLISECONDS * 1000; // frequency to poll pnode->vSend
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    std::vector<SOCKET> vSockets;
+
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        FD_SET(hListenSocket.socket, &fdsetRecv);
+        hSocketMax = std::max(hSocketMax, hListenSocket.socket);
+        vSockets.push_back(hListenSocket.socket);
+    }
+
+    {
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodes)
+        {
+            bool select_recv, select_send;
+            GetSocketInterest(pnode, select_recv, select_send);
+
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+
+            FD_SET(pnode->hSocket, &fdsetError);
+            hSocketMax = std::max(hSocketMax, pnode->hSocket);
+            vSockets.push_back(pnode->hSocket);
+
+            if (select_send) {
+                FD_SET(pnode->hSocket, &fdsetSend);
+                continue;
+            }
+            if (select_recv) {
+                FD_SET(pnode->hSocket, &fdsetRecv);
+            }
+        }
+    }
+
+    bool have_fds = !vSockets.empty();
+    int nSelect = select(have_fds ? hSocketMax + 1 : 0,
+                         &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (interruptNet)
+        return;
+
+    if (nSelect == SOCKET_ERROR)
+    {
+        if (have_fds)
+        {
+            int nErr = WSAGetLastError();
+            LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+            recv_set.insert(vSockets.begin(), vSockets.end());
+        }
+        interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        return;
+    }
+
+    for (SOCKET hSocket : vSockets)
+    {
+        if (FD_ISSET(hSocket, &fdsetRecv))
+            recv_set.insert(hSocket);
+        if (FD_ISSET(hSocket, &fdsetSend))
+            send_set.insert(hSocket);
+        if (FD_ISSET(hSocket, &fdsetError))
+            error_set.insert(hSocket);
+    }
+}
+
+void CConnman::SocketEvents(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+#ifdef USE_EPOLL
+    SocketEventsEpoll(recv_set, send_set, error_set);
+#else
+    SocketEventsSelect(recv_set, send_set, error_set);
+#endif
+}
+
 void CConnman::ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
@@ -1214,94 +1544,17 @@ void CConnman::ThreadSocketHandler()
                 clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
         }
 
-        //
-        // Find which sockets have data to receive
-        //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        for (const ListenSocket& hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
-
-        {
-            LOCK(cs_vNodes);
-            for (CNode* pnode : vNodes)
-            {
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
-                //   receiving data.
-                // * Hand off all complete messages to the processor, to be handled without
-                //   blocking here.
-
-                bool select_recv = !pnode->fPauseRecv;
-                bool select_send;
-                {
-                    LOCK(pnode->cs_vSend);
-                    select_send = !pnode->vSendMsg.empty();
-                }
-
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
-            }
-        }
-
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        std::set<SOCKET> recv_set, send_set, error_set;
+        SocketEvents(recv_set, send_set, error_set);
         if (interruptNet)
             return;
 
-        if (nSelect == SOCKET_ERROR)
-        {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
-                return;
-        }
-
         //
         // Accept new connections
         //
         for (const ListenSocket& hListenSocket : vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (hListenSocket.socket != INVALID_SOCKET && recv_set.count(hListenSocket.socket) > 0)
             {
                 AcceptConnection(hListenSocket);
             }
@@ -1332,25 +1585,34 @@ void CConnman::ThreadSocketHandler()
                 LOCK(pnode->cs_hSocket);
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+                recvSet = recv_set.count(pnode->hSocket) > 0;
+                sendSet = send_set.count(pnode->hSocket) > 0;
+                errorSet = error_set.count(pnode->hSocket) > 0;
             }
             if (recvSet || errorSet)
             {
                 // typical socket buffer is 8K-64K
                 char pchBuf[0x10000];
+                char* pchRecv = pchBuf;
+                unsigned int nRecvSize = sizeof(pchBuf);
+                // The rest of a payload that doesn't fit pchBuf is received
+                // straight into the message, up to 256 KiB at a time
+                unsigned int nSpace = 256 * 1024;
+                if (char* pchSpace = pnode->GetRecvDataSpace(sizeof(pchBuf), nSpace)) {
+                    pchRecv = pchSpace;
+                    nRecvSize = nSpace;
+                }
                 int nBytes = 0;
                 {
                     LOCK(pnode->cs_hSocket);
                     if (pnode->hSocket == INVALID_SOCKET)
                         continue;
-                    nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+                    nBytes = recv(pnode->hSocket, pchRecv, nRecvSize, MSG_DONTWAIT);
                 }
                 if (nBytes > 0)
                 {
                     bool notify = false;
-                    if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
+                    if (!pnode->ReceiveMsgBytes(pchRecv, nBytes, notify))
                         pnode->CloseSocketDisconnect();
                     RecordBytesRecv(nBytes);
                     if (notify) {
@@ -2003,6 +2265,11 @@ void CConnman::ThreadMessageHandler()
 
         bool fMoreWork = false;
 
+        // Messages that don't need chainstate are handled for all peers at once
+        m_msgproc->ProcessMessagesParallel(vNodesCopy, flagInterruptMsgProc);
+        if (flagInterruptMsgProc)
+            return;
+
         for (CNode* pnode : vNodesCopy)
         {
             if (pnode->fDisconnect)
@@ -2224,6 +2491,9 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
     semOutbound = nullptr;
     semAddnode = nullptr;
     flagInterruptMsgProc = false;
+#ifdef USE_EPOLL
+    epollfd = -1;
+#endif
 
     Options connOptions;
     Init(connOptions);
@@ -2285,6 +2555,17 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         return false;
     }
 
+#ifdef USE_EPOLL
+    if (!InitEpoll()) {
+        if (clientInterface) {
+            clientInterface->ThreadSafeMessageBox(
+                _("Failed to initialize the network event loop."),
+                "", CClientUIInterface::MSG_ERROR);
+        }
+        return false;
+    }
+#endif
+
     LogPrintf("Connection Manager: Adding Seed Nodes\n");
 
     for (const auto& strDest : connOptions.vSeedNodes) {
@@ -2460,6 +2741,12 @@ void CConnman::Stop()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+#ifdef USE_EPOLL
+    if (epollfd != -1) {
+        close(epollfd);
+        epollfd = -1;
+    }
+#endif
     delete semOutbound;
     semOutbound = nullptr;
     delete semAddnode;
@@ -2739,6 +3026,9 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nRefCount = 0;
     nSendSize = 0;
     nSendOffset = 0;
+#ifdef USE_EPOLL
+    nEpollEvents = -1;
+#endif
     hashContinue = uint256();
     nStartingHeight = -1;
     filterInventoryKnown.reset();
@@ -2829,13 +3119,10 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
     size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
 
-    std::vector<unsigned char> serializedHeader;
-    serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
     uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
     CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
-
-    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
+    bool fCoalesce = nMessageSize <= MAX_COALESCED_PAYLOAD_SIZE;
 
     size_t nBytesSent = 0;
     {
@@ -2848,8 +3135,21 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
+
+        // Serialize the header into a recycled buffer, followed by the payload
+        // if it is small, so the message takes a single queue entry
+        std::vector<unsigned char> serializedHeader;
+        if (!pnode->vSendBufferPool.empty()) {
+            serializedHeader.swap(pnode->vSendBufferPool.back());
+            pnode->vSendBufferPool.pop_back();
+        } else {
+            serializedHeader.reserve(CMessageHeader::HEADER_SIZE + MAX_COALESCED_PAYLOAD_SIZE);
+        }
+        CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
+        if (fCoalesce)
+            serializedHeader.insert(serializedHeader.end(), msg.data.begin(), msg.data.end());
         pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
+        if (!fCoalesce)
             pnode->vSendMsg.push_back(std::move(msg.data));
 
         // If write queue empty, attempt "optimistic write"
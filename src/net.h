@@ -16,6 +16,7 @@
 #include "limitedmap.h"
 #include "netaddress.h"
 #include "policy/feerate.h"
+#include "primitives/transaction.h"
 #include "protocol.h"
 #include "random.h"
 #include "streams.h"
@@ -313,6 +314,12 @@ private:
     void ThreadOpenConnections(std::vector<std::string> connect);
     void ThreadMessageHandler();
     void AcceptConnection(const ListenSocket& hListenSocket);
+#ifdef USE_EPOLL
+    bool InitEpoll();
+    void SocketEventsEpoll(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+#endif
+    void SocketEventsSelect(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+    void SocketEvents(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
 
@@ -369,6 +376,10 @@ private:
     unsigned int nReceiveFloodSize;
 
     std::vector<ListenSocket> vhListenSocket;
+#ifdef USE_EPOLL
+    /** epoll instance the socket handler waits on, -1 when not started */
+    int epollfd;
+#endif
     std::atomic<bool> fNetworkActive;
     banmap_t setBanned;
     CCriticalSection cs_setBanned;
@@ -414,6 +425,8 @@ private:
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadMessageHandler;
+
+    friend struct CConnmanTest;
 };
 extern std::unique_ptr<CConnman> g_connman;
 void Discover(boost::thread_group& threadGroup);
@@ -443,6 +456,8 @@ class NetEventsInterface
 {
 public:
     virtual bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) = 0;
+    //! Handle whatever can run concurrently across peers, ahead of the serial ProcessMessages pass
+    virtual void ProcessMessagesParallel(const std::vector<CNode*>& vNodes, std::atomic<bool>& interrupt) = 0;
     virtual bool SendMessages(CNode* pnode, std::atomic<bool>& interrupt) = 0;
     virtual void InitializeNode(CNode* pnode) = 0;
     virtual void FinalizeNode(NodeId id, bool& update_connection_time) = 0;
@@ -535,7 +550,7 @@ private:
 public:
     bool in_data;                   // parsing header (false) or data (true)
 
-    CDataStream hdrbuf;             // partially received header
+    CDataStream hdrbuf;             // partially received header, only used if it arrives in pieces
     CMessageHeader hdr;             // complete header
     unsigned int nHdrPos;
 
@@ -545,12 +560,14 @@ public:
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
     CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
-        hdrbuf.resize(24);
         in_data = false;
         nHdrPos = 0;
         nDataPos = 0;
         nTime = 0;
     }
+    CNetMessage(const CNetMessage&) = default;
+    // Hands the vRecv buffer back for reuse by later messages
+    ~CNetMessage();
 
     bool complete() const
     {
@@ -569,6 +586,13 @@ public:
 
     int readHeader(const char *pch, unsigned int nBytes);
     int readData(const char *pch, unsigned int nBytes);
+
+    // Room for up to nBytes of the payload in vRecv, for receiving into it
+    // directly. readData then only accounts for the bytes.
+    char* GetDataSpace(unsigned int& nBytes);
+
+private:
+    void ReserveData(unsigned int nBytes);
 };
 
 
@@ -584,13 +608,24 @@ public:
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
     std::deque<std::vector<unsigned char>> vSendMsg;
+    std::vector<std::vector<unsigned char>> vSendBufferPool; // sent buffers kept for reuse, guarded by cs_vSend
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
+#ifdef USE_EPOLL
+    // events hSocket is registered for with CConnman::epollfd, -1 if not
+    // registered yet. Only touched by the socket handler thread.
+    int nEpollEvents;
+#endif
 
     CCriticalSection cs_vProcessMsg;
     std::list<CNetMessage> vProcessMsg;
-    size_t nProcessQueueSize;
+    // Changed under cs_vProcessMsg, atomic so that the message handler can
+    // skip peers with nothing queued without taking the lock.
+    std::atomic<size_t> nProcessQueueSize;
+    // Transaction of the "tx" message at the front of vProcessMsg, if the
+    // parallel message pass deserialized it already. Guarded by cs_vProcessMsg.
+    CTransactionRef txPreparsed;
 
     CCriticalSection cs_sendProcessing;
 
@@ -645,6 +680,9 @@ public:
     std::atomic<int> nStartingHeight;
 
     // flood relay
+    // cs_addrKnown guards vAddrToSend and addrKnown, which other peers' messages
+    // can touch from the parallel message pass through address relay
+    CCriticalSection cs_addrKnown;
     std::vector<CAddress> vAddrToSend;
     CRollingBloomFilter addrKnown;
     bool fGetAddr;
@@ -736,6 +774,9 @@ public:
     }
 
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete);
+    // Room for up to nBytes in the payload of the message being received, if
+    // at least nMinRemaining of it are still to come. nullptr otherwise.
+    char* GetRecvDataSpace(unsigned int nMinRemaining, unsigned int& nBytes);
 
     void SetRecvVersion(int nVersionIn)
     {
@@ -767,6 +808,7 @@ public:
 
     void AddAddressKnown(const CAddress& _addr)
     {
+        LOCK(cs_addrKnown);
         addrKnown.insert(_addr.GetKey());
     }
 
@@ -775,6 +817,7 @@ public:
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
+        LOCK(cs_addrKnown);
         if (_addr.IsValid() && !addrKnown.contains(_addr.GetKey())) {
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[insecure_rand.randrange(vAddrToSend.size())] = _addr;
@@ -31,6 +31,7 @@
 #include "utilmoneystr.h"
 #include "utilstrencodings.h"
 #include "validationinterface.h"
+#include "workerpool.h"
 
 #if defined(NDEBUG)
 # error "Astral cannot be compiled without assertions."
@@ -261,6 +262,26 @@ struct CNodeState {
 /** Map maintaining per-node state. Requires cs_main. */
 std::map<NodeId, CNodeState> mapNodeState;
 
+/**
+ * Nodes whose CNodeState has queued rejects or is marked to be banned, so that
+ * message processing only takes cs_main to act on them when there's something
+ * to do. Entries are added with cs_main held, next to the change they announce.
+ */
+CCriticalSection cs_nodesPendingRejects;
+std::set<NodeId> setNodesPendingRejects;
+
+// Requires cs_main.
+void MarkPendingRejects(NodeId nodeid) {
+    LOCK(cs_nodesPendingRejects);
+    setNodesPendingRejects.insert(nodeid);
+}
+
+//! Returns whether the node was marked, and unmarks it.
+bool TakePendingRejects(NodeId nodeid) {
+    LOCK(cs_nodesPendingRejects);
+    return setNodesPendingRejects.erase(nodeid) != 0;
+}
+
 // Requires cs_main.
 CNodeState *State(NodeId pnode) {
     std::map<NodeId, CNodeState>::iterator it = mapNodeState.find(pnode);
@@ -577,6 +598,7 @@ void PeerLogicValidation::FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTim
     assert(g_outbound_peers_with_protect_from_disconnect >= 0);
 
     mapNodeState.erase(nodeid);
+    TakePendingRejects(nodeid);
 
     if (mapNodeState.empty()) {
         // Do a consistency check after the last peer is removed.
@@ -738,6 +760,7 @@ void Misbehaving(NodeId pnode, int howmuch)
     {
         LogPrintf("%s: %s peer=%d (%d -> %d) BAN THRESHOLD EXCEEDED\n", __func__, state->name, pnode, state->nMisbehavior-howmuch, state->nMisbehavior);
         state->fShouldBan = true;
+        MarkPendingRejects(pnode);
     } else
         LogPrintf("%s: %s peer=%d (%d -> %d)\n", __func__, state->name, pnode, state->nMisbehavior-howmuch, state->nMisbehavior);
 }
@@ -891,6 +914,7 @@ void PeerLogicValidation::BlockChecked(const CBlock& block, const CValidationSta
         if (it != mapBlockSource.end() && State(it->second.first) && state.GetRejectCode() > 0 && state.GetRejectCode() < REJECT_INTERNAL) {
             CBlockReject reject = {(unsigned char)state.GetRejectCode(), state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), hash};
             State(it->second.first)->rejects.push_back(reject);
+            MarkPendingRejects(it->second.first);
             if (nDoS > 0 && it->second.second)
                 Misbehaving(it->second.first, nDoS);
         }
@@ -1069,6 +1093,31 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                     std::shared_ptr<const CBlock> pblock;
                     if (a_recent_block && a_recent_block->GetHash() == (*mi).second->GetBlockHash()) {
                         pblock = a_recent_block;
+                    } else if (inv.type == MSG_BLOCK || inv.type == MSG_WITNESS_BLOCK) {
+                        // Full blocks are sent as stored, skipping the X20R check of ReadBlockFromDisk.
+                        // The stored bytes are the witness serialization, which is also what MSG_BLOCK
+                        // gets unless the block carries witnesses.
+                        CSerializedNetMsg msg;
+                        msg.command = NetMsgType::BLOCK;
+                        if (!ReadRawBlockFromDisk(msg.data, (*mi).second, Params().MessageStart()))
+                            assert(!"cannot load block from disk");
+                        if (inv.type == MSG_BLOCK) {
+                            // Deserialize in place only if the block has witnesses to strip, or for index
+                            // entries from before that was recorded. msg.data is only handed on after this.
+                            CBlockIndex* pindex = (*mi).second;
+                            std::shared_ptr<CBlock> pblockRead;
+                            const char* pdata = reinterpret_cast<const char*>(msg.data.data());
+                            if (!(pindex->nStatus & BLOCK_WITNESS_KNOWN) || (pindex->nStatus & BLOCK_HAVE_WITNESS)) {
+                                pblockRead = std::make_shared<CBlock>();
+                                CSpanReader(SER_NETWORK, PROTOCOL_VERSION, pdata, pdata + msg.data.size()) >> *pblockRead;
+                            }
+                            if (!(pindex->nStatus & BLOCK_WITNESS_KNOWN))
+                                SetBlockHaveWitness(pindex, *pblockRead);
+                            if (pindex->nStatus & BLOCK_HAVE_WITNESS)
+                                pblock = pblockRead;
+                        }
+                        if (!pblock)
+                            connman->PushMessage(pfrom, std::move(msg));
                     } else {
                         // Send block from disk
                         std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
@@ -1076,9 +1125,9 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                             assert(!"cannot load block from disk");
                         pblock = pblockRead;
                     }
-                    if (inv.type == MSG_BLOCK)
+                    if (pblock && inv.type == MSG_BLOCK)
                         connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
-                    else if (inv.type == MSG_WITNESS_BLOCK)
+                    else if (pblock && inv.type == MSG_WITNESS_BLOCK)
                         connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
                     else if (inv.type == MSG_FILTERED_BLOCK)
                     {
@@ -1209,7 +1258,7 @@ inline void static SendBlockTransactions(const CBlock& block, const BlockTransac
     connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::BLOCKTXN, resp));
 }
 
-bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc)
+bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc, const CTransactionRef& ptxPreparsed = nullptr)
 {
     LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->GetId());
     if (gArgs.IsArgSet("-dropmessagestest") && GetRand(gArgs.GetArg("-dropmessagestest", 0)) == 0)
@@ -1836,8 +1885,9 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
         std::deque<COutPoint> vWorkQueue;
         std::vector<uint256> vEraseQueue;
-        CTransactionRef ptx;
-        vRecv >> ptx;
+        CTransactionRef ptx = ptxPreparsed;
+        if (!ptx)
+            vRecv >> ptx;
         const CTransaction& tx = *ptx;
 
         CInv inv(MSG_TX, tx.GetHash());
@@ -2317,6 +2367,9 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
+        // Work out the (X20R) hashes of all headers in parallel before they're needed under cs_main
+        HashBlockHeaders(headers, chainparams.GetConsensus());
+
         const CBlockIndex *pindexLast = nullptr;
         {
         LOCK(cs_main);
@@ -2481,15 +2534,15 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     {
         std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
         vRecv >> *pblock;
+        const uint256 hash(pblock->GetHash());
 
-        LogPrint(BCLog::NET, "received block %s peer=%d\n", pblock->GetHash().ToString(), pfrom->GetId());
+        LogPrint(BCLog::NET, "received block %s peer=%d\n", hash.ToString(), pfrom->GetId());
 
         // Process all blocks from whitelisted peers, even if not requested,
         // unless we're still syncing with the network.
         // Such an unrequested block may still be processed, subject to the
         // conditions in AcceptBlock().
         bool forceProcessing = pfrom->fWhitelisted && !IsInitialBlockDownload();
-        const uint256 hash(pblock->GetHash());
         {
             LOCK(cs_main);
             // Also always process if we requested the block explicitly, as we may
@@ -2505,7 +2558,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             pfrom->nLastBlockTime = GetTime();
         } else {
             LOCK(cs_main);
-            mapBlockSource.erase(pblock->GetHash());
+            mapBlockSource.erase(hash);
         }
     }
 
@@ -2530,7 +2583,10 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         }
         pfrom->fSentAddr = true;
 
-        pfrom->vAddrToSend.clear();
+        {
+            LOCK(pfrom->cs_addrKnown);
+            pfrom->vAddrToSend.clear();
+        }
         std::vector<CAddress> vAddr = connman->GetAddresses();
         FastRandomContext insecure_rand;
         for (const CAddress &addr : vAddr)
@@ -2752,9 +2808,14 @@ static bool SendRejectsAndCheckIfBanned(CNode* pnode, CConnman* connman)
     return false;
 }
 
-bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
+/**
+ * Check and process a single message taken off pfrom's queue. ptxPreparsed is
+ * the transaction of a "tx" message if it was already deserialized. Returns
+ * false if the message start was wrong, in which case the node is being
+ * disconnected.
+ */
+static bool ProcessNetMessage(CNode* pfrom, CNetMessage& msg, const CTransactionRef& ptxPreparsed, const CChainParams& chainparams, CConnman* connman, std::atomic<bool>& interruptMsgProc)
 {
-    const CChainParams& chainparams = Params();
     //
     // Message format
     //  (4) message start
@@ -2763,34 +2824,6 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     //  (4) checksum
     //  (x) data
     //
-    bool fMoreWork = false;
-
-    if (!pfrom->vRecvGetData.empty())
-        ProcessGetData(pfrom, chainparams.GetConsensus(), connman, interruptMsgProc);
-
-    if (pfrom->fDisconnect)
-        return false;
-
-    // this maintains the order of responses
-    if (!pfrom->vRecvGetData.empty()) return true;
-
-    // Don't bother if send buffer is too full to respond anyway
-    if (pfrom->fPauseSend)
-        return false;
-
-    std::list<CNetMessage> msgs;
-    {
-        LOCK(pfrom->cs_vProcessMsg);
-        if (pfrom->vProcessMsg.empty())
-            return false;
-        // Just take one message
-        msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
-        pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
-        pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
-        fMoreWork = !pfrom->vProcessMsg.empty();
-    }
-    CNetMessage& msg(msgs.front());
-
     msg.SetVersion(pfrom->GetRecvVersion());
     // Scan for message start
     if (memcmp(msg.hdr.pchMessageStart, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0) {
@@ -2804,7 +2837,7 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     if (!hdr.IsValid(chainparams.MessageStart()))
     {
         LogPrintf("PROCESSMESSAGE: ERRORS IN HEADER %s peer=%d\n", SanitizeString(hdr.GetCommand()), pfrom->GetId());
-        return fMoreWork;
+        return true;
     }
     std::string strCommand = hdr.GetCommand();
 
@@ -2820,18 +2853,14 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
            SanitizeString(strCommand), nMessageSize,
            HexStr(hash.begin(), hash.begin()+CMessageHeader::CHECKSUM_SIZE),
            HexStr(hdr.pchChecksum, hdr.pchChecksum+CMessageHeader::CHECKSUM_SIZE));
-        return fMoreWork;
+        return true;
     }
 
     // Process message
     bool fRet = false;
     try
     {
-        fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc);
-        if (interruptMsgProc)
-            return false;
-        if (!pfrom->vRecvGetData.empty())
-            fMoreWork = true;
+        fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, ptxPreparsed);
     }
     catch (const std::ios_base::failure& e)
     {
@@ -2862,16 +2891,174 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         PrintExceptionContinue(nullptr, "ProcessMessages()");
     }
 
+    if (interruptMsgProc)
+        return true;
+
     if (!fRet) {
         LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
     }
 
-    LOCK(cs_main);
-    SendRejectsAndCheckIfBanned(pfrom, connman);
+    // Rejects and bans are also sent from SendMessages; cs_main is only worth
+    // taking here if something is actually queued for this peer.
+    if (TakePendingRejects(pfrom->GetId())) {
+        LOCK(cs_main);
+        SendRejectsAndCheckIfBanned(pfrom, connman);
+    }
+
+    return true;
+}
+
+bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
+{
+    const CChainParams& chainparams = Params();
+    bool fMoreWork = false;
+
+    if (!pfrom->vRecvGetData.empty())
+        ProcessGetData(pfrom, chainparams.GetConsensus(), connman, interruptMsgProc);
+
+    if (pfrom->fDisconnect)
+        return false;
+
+    // this maintains the order of responses
+    if (!pfrom->vRecvGetData.empty()) return true;
+
+    // Don't bother if send buffer is too full to respond anyway
+    if (pfrom->fPauseSend)
+        return false;
+
+    std::list<CNetMessage> msgs;
+    CTransactionRef ptxPreparsed;
+    {
+        LOCK(pfrom->cs_vProcessMsg);
+        if (pfrom->vProcessMsg.empty())
+            return false;
+        // Just take one message
+        msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
+        pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+        pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
+        fMoreWork = !pfrom->vProcessMsg.empty();
+        ptxPreparsed.swap(pfrom->txPreparsed);
+    }
+    CNetMessage& msg(msgs.front());
+
+    if (!ProcessNetMessage(pfrom, msg, ptxPreparsed, chainparams, connman, interruptMsgProc) || interruptMsgProc)
+        return false;
+    if (!pfrom->vRecvGetData.empty())
+        fMoreWork = true;
 
     return fMoreWork;
 }
 
+namespace {
+
+/**
+ * Whether a message only touches the sending peer, the address manager or
+ * other state behind its own locks, so that it can be handled outside the
+ * serial message handler pass. Anything reading or changing chainstate, the
+ * mempool or CNodeState stays serial.
+ */
+bool IsParallelMessage(const std::string& strCommand)
+{
+    return strCommand == NetMsgType::ADDR ||
+           strCommand == NetMsgType::GETADDR ||
+           strCommand == NetMsgType::MEMPOOL ||
+           strCommand == NetMsgType::PING ||
+           strCommand == NetMsgType::PONG ||
+           strCommand == NetMsgType::FILTERLOAD ||
+           strCommand == NetMsgType::FILTERADD ||
+           strCommand == NetMsgType::FILTERCLEAR ||
+           strCommand == NetMsgType::FEEFILTER ||
+           strCommand == NetMsgType::NOTFOUND;
+}
+
+/**
+ * Whether the message at the front of the queue of pfrom can be handled by
+ * the parallel pass. The checks that need no lock come first, so that idle
+ * peers only cost a few atomic reads.
+ */
+bool HasParallelMessage(CNode* pfrom)
+{
+    if (pfrom->nProcessQueueSize == 0 || pfrom->fDisconnect || pfrom->fPauseSend || !pfrom->fSuccessfullyConnected || !pfrom->vRecvGetData.empty())
+        return false;
+
+    LOCK(pfrom->cs_vProcessMsg);
+    if (pfrom->vProcessMsg.empty())
+        return false;
+    const std::string strCommand = pfrom->vProcessMsg.front().hdr.GetCommand();
+    return IsParallelMessage(strCommand) || (strCommand == NetMsgType::TX && !pfrom->txPreparsed);
+}
+
+} // namespace
+
+void PeerLogicValidation::ProcessPeerMessageParallel(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
+{
+    // Handshake messages are left to the serial pass, and so is everything
+    // queued behind outstanding getdata requests so replies keep their order.
+    if (interruptMsgProc || pfrom->fDisconnect || pfrom->fPauseSend || !pfrom->fSuccessfullyConnected || !pfrom->vRecvGetData.empty())
+        return;
+
+    std::list<CNetMessage> msgs;
+    const CDataStream* pvTx = nullptr;
+    {
+        LOCK(pfrom->cs_vProcessMsg);
+        if (pfrom->vProcessMsg.empty())
+            return;
+        CNetMessage& front = pfrom->vProcessMsg.front();
+        const std::string strCommand = front.hdr.GetCommand();
+        if (IsParallelMessage(strCommand)) {
+            msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
+            pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+            pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
+        } else if (strCommand == NetMsgType::TX && !pfrom->txPreparsed) {
+            // The transaction itself is accepted serially, but it can be
+            // deserialized and hashed here. The message is left untouched for
+            // the serial pass, so read it in place instead of consuming it.
+            pvTx = &front.vRecv;
+        } else {
+            return;
+        }
+    }
+
+    if (!msgs.empty()) {
+        ProcessNetMessage(pfrom, msgs.front(), nullptr, Params(), connman, interruptMsgProc);
+        return;
+    }
+
+    // Only this node's message processing removes messages from the front of
+    // vProcessMsg, and it's waiting for this pass to finish, so the message
+    // stays in place (and the same) while it's read without the lock.
+    CTransactionRef ptx;
+    try {
+        CSpanReader(pvTx->GetType(), pfrom->GetRecvVersion(), pvTx->data(), pvTx->data() + pvTx->size()) >> ptx;
+    } catch (const std::exception&) {
+        // Leave reporting the malformed message to the serial pass
+        return;
+    }
+    LOCK(pfrom->cs_vProcessMsg);
+    pfrom->txPreparsed = std::move(ptx);
+}
+
+void PeerLogicValidation::ProcessMessagesParallel(const std::vector<CNode*>& vNodes, std::atomic<bool>& interruptMsgProc)
+{
+    // Only wake the worker pool for peers that have something for it
+    std::vector<CNode*> vWork;
+    for (CNode* pnode : vNodes) {
+        if (HasParallelMessage(pnode))
+            vWork.push_back(pnode);
+    }
+
+    if (vWork.empty() || interruptMsgProc)
+        return;
+    if (vWork.size() == 1) {
+        ProcessPeerMessageParallel(vWork[0], interruptMsgProc);
+        return;
+    }
+    workerpool.ParallelFor(vWork.size(), [this, &vWork, &interruptMsgProc](size_t i) {
+        ProcessPeerMessageParallel(vWork[i], interruptMsgProc);
+        return true;
+    });
+}
+
 void PeerLogicValidation::ConsiderEviction(CNode *pto, int64_t time_in_seconds)
 {
     AssertLockHeld(cs_main);
@@ -3001,6 +3188,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
         //
         if (pto->nNextAddrSend < nNow) {
             pto->nNextAddrSend = PoissonNextSend(nNow, AVG_ADDRESS_BROADCAST_INTERVAL);
+            LOCK(pto->cs_addrKnown);
             std::vector<CAddress> vAddr;
             vAddr.reserve(pto->vAddrToSend.size());
             for (const CAddress& addr : pto->vAddrToSend)
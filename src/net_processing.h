@@ -47,6 +47,17 @@ public:
     /** Process protocol messages received from a given node */
     bool ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt) override;
     /**
+    * Process the next message of each node if it doesn't need chainstate, and
+    * deserialize the next transaction of each node, spread over the message
+    * processing threads. Messages of one node are still handled in order.
+    *
+    * @param[in]   vNodes          The nodes whose queued messages to look at
+    * @param[in]   interrupt       Interrupt condition for processing threads
+    */
+    void ProcessMessagesParallel(const std::vector<CNode*>& vNodes, std::atomic<bool>& interrupt) override;
+    /** Handle the next message of a node on a message processing thread */
+    void ProcessPeerMessageParallel(CNode* pfrom, std::atomic<bool>& interrupt);
+    /**
     * Send queued protocol messages to be sent to a give node.
     *
     * @param[in]   pto             The node which we are sending messages to.
@@ -23,6 +23,10 @@
 #include <fcntl.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <poll.h>
+#endif
+
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
 #include <boost/algorithm/string/predicate.hpp> // for startswith() and endswith()
 
@@ -185,6 +189,28 @@ struct timeval MillisToTimeval(int64_t nTimeout)
     return timeout;
 }
 
+/**
+ * Wait until hSocket is readable (or writable, if fWrite), for at most nTimeout milliseconds.
+ * Returns like select(): the number of ready sockets, 0 on timeout or SOCKET_ERROR.
+ * With epoll, sockets aren't limited to FD_SETSIZE, so poll() is used instead of an fd_set.
+ */
+static int WaitOnSocket(const SOCKET& hSocket, bool fWrite, int64_t nTimeout)
+{
+#ifdef USE_EPOLL
+    struct pollfd pfd;
+    pfd.fd = hSocket;
+    pfd.events = fWrite ? POLLOUT : POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, nTimeout);
+#else
+    struct timeval tval = MillisToTimeval(nTimeout);
+    fd_set fdset;
+    FD_ZERO(&fdset);
+    FD_SET(hSocket, &fdset);
+    return select(hSocket + 1, fWrite ? nullptr : &fdset, fWrite ? &fdset : nullptr, nullptr, &tval);
+#endif
+}
+
 /** SOCKS version */
 enum SOCKSVersion: uint8_t {
     SOCKS4 = 0x04,
@@ -266,11 +292,7 @@ static IntrRecvError InterruptibleRecv(uint8_t* data, size_t len, int timeout, c
                 if (!IsSelectableSocket(hSocket)) {
                     return IntrRecvError::NetworkError;
                 }
-                struct timeval tval = MillisToTimeval(std::min(endTime - curTime, maxWait));
-                fd_set fdset;
-                FD_ZERO(&fdset);
-                FD_SET(hSocket, &fdset);
-                int nRet = select(hSocket + 1, &fdset, nullptr, nullptr, &tval);
+                int nRet = WaitOnSocket(hSocket, false, std::min(endTime - curTime, maxWait));
                 if (nRet == SOCKET_ERROR) {
                     return IntrRecvError::NetworkError;
                 }
@@ -489,11 +511,12 @@ bool ConnectSocketDirectly(const CService &addrConnect, SOCKET& hSocketRet, int
         // WSAEINVAL is here because some legacy version of winsock uses it
         if (nErr == WSAEINPROGRESS || nErr == WSAEWOULDBLOCK || nErr == WSAEINVAL)
         {
-            struct timeval timeout = MillisToTimeval(nTimeout);
-            fd_set fdset;
-            FD_ZERO(&fdset);
-            FD_SET(hSocket, &fdset);
-            int nRet = select(hSocket + 1, nullptr, &fdset, nullptr, &timeout);
+            if (!IsSelectableSocket(hSocket)) {
+                LogPrintf("Cannot wait for connection to %s: unselectable socket\n", addrConnect.ToString());
+                CloseSocket(hSocket);
+                return false;
+            }
+            int nRet = WaitOnSocket(hSocket, true, nTimeout);
             if (nRet == 0)
             {
                 LogPrint(BCLog::NET, "connection to %s timeout\n", addrConnect.ToString());
@@ -11,9 +11,53 @@
 #include "utilstrencodings.h"
 #include "crypto/common.h"
 
+#include <string.h>
+
+bool CBlockHeader::IsHashCached() const
+{
+    std::shared_ptr<const CHashCache> cache = std::atomic_load(&hashCache);
+    return cache && memcmp(cache->header, BEGIN(nVersion), sizeof(cache->header)) == 0;
+}
+
+void CBlockHeader::StoreHash(const uint256& hash) const
+{
+    std::shared_ptr<CHashCache> fresh = std::make_shared<CHashCache>();
+    memcpy(fresh->header, BEGIN(nVersion), sizeof(fresh->header));
+    fresh->hash = hash;
+    std::atomic_store(&hashCache, std::shared_ptr<const CHashCache>(std::move(fresh)));
+}
+
 uint256 CBlockHeader::GetHash() const
 {
-    return HashX20R(BEGIN(nVersion), END(nNonce), hashPrevBlock);
+    std::shared_ptr<const CHashCache> cache = std::atomic_load(&hashCache);
+    if (cache && memcmp(cache->header, BEGIN(nVersion), sizeof(cache->header)) == 0)
+        return cache->hash;
+
+    const uint256 hash = HashX20R(BEGIN(nVersion), END(nNonce), hashPrevBlock);
+    StoreHash(hash);
+    return hash;
+}
+
+void CBlockHeader::CacheHashes(const CBlockHeader* pheaders, size_t nCount)
+{
+    static const size_t HEADER_SIZE = sizeof(CHashCache().header);
+
+    std::vector<const CBlockHeader*> vStale;
+    vStale.reserve(nCount);
+    for (size_t n = 0; n < nCount; n++) {
+        if (!pheaders[n].IsHashCached())
+            vStale.push_back(&pheaders[n]);
+    }
+    if (vStale.empty())
+        return;
+
+    std::vector<unsigned char> vData(HEADER_SIZE * vStale.size());
+    for (size_t n = 0; n < vStale.size(); n++)
+        memcpy(&vData[HEADER_SIZE * n], BEGIN(vStale[n]->nVersion), HEADER_SIZE);
+    std::vector<uint256> vHashes(vStale.size());
+    HashX20RHeaders(vData.data(), vStale.size(), vHashes.data());
+    for (size_t n = 0; n < vStale.size(); n++)
+        vStale[n]->StoreHash(vHashes[n]);
 }
 
 std::string CBlock::ToString() const
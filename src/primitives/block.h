@@ -11,6 +11,8 @@
 #include "serialize.h"
 #include "uint256.h"
 
+#include <memory>
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -34,6 +36,23 @@ public:
         SetNull();
     }
 
+    CBlockHeader(const CBlockHeader& other)
+    {
+        *this = other;
+    }
+
+    CBlockHeader& operator=(const CBlockHeader& other)
+    {
+        nVersion = other.nVersion;
+        hashPrevBlock = other.hashPrevBlock;
+        hashMerkleRoot = other.hashMerkleRoot;
+        nTime = other.nTime;
+        nBits = other.nBits;
+        nNonce = other.nNonce;
+        std::atomic_store(&hashCache, std::atomic_load(&other.hashCache));
+        return *this;
+    }
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -63,10 +82,33 @@ public:
 
     uint256 GetHash() const;
 
+    /**
+     * Compute and cache the hashes of the nCount headers at pheaders in one
+     * batch, so the GetHash() calls that follow return at once. Headers whose
+     * cached hash is still current are left as they are.
+     */
+    static void CacheHashes(const CBlockHeader* pheaders, size_t nCount);
+
     int64_t GetBlockTime() const
     {
         return (int64_t)nTime;
     }
+
+private:
+    struct CHashCache
+    {
+        unsigned char header[80];
+        uint256 hash;
+    };
+
+    // memory only: the last X20R hash computed by GetHash() and the header
+    // bytes it was computed from, so writes to the fields are noticed. It is
+    // replaced as a whole with atomic_store, so a const header can be hashed
+    // from several threads at once.
+    mutable std::shared_ptr<const CHashCache> hashCache;
+
+    bool IsHashCached() const;
+    void StoreHash(const uint256& hash) const;
 };
 
 
@@ -107,14 +149,8 @@ public:
 
     CBlockHeader GetBlockHeader() const
     {
-        CBlockHeader block;
-        block.nVersion       = nVersion;
-        block.hashPrevBlock  = hashPrevBlock;
-        block.hashMerkleRoot = hashMerkleRoot;
-        block.nTime          = nTime;
-        block.nBits          = nBits;
-        block.nNonce         = nNonce;
-        return block;
+        // Copying the header keeps any hash already computed for it
+        return *this;
     }
 
     // void SetPrevBlockHash(uint256 prevHash) 
@@ -208,6 +208,11 @@ static bool rest_block(HTTPRequest* req,
 
     CBlock block;
     CBlockIndex* pblockindex = nullptr;
+    // Binary and hex replies in witness serialization are the block as stored
+    // on disk, so those are served without deserializing the block
+    const bool fRaw = rf != RF_JSON && !(RPCSerializationFlags() & SERIALIZE_TRANSACTION_NO_WITNESS);
+    std::vector<unsigned char> blockData;
+    UniValue objHead(UniValue::VOBJ), objTail(UniValue::VOBJ);
     {
         LOCK(cs_main);
         if (mapBlockIndex.count(hash) == 0)
@@ -217,33 +222,45 @@ static bool rest_block(HTTPRequest* req,
         if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        if (fRaw) {
+            if (!ReadRawBlockFromDisk(blockData, pblockindex, Params().MessageStart()))
+                return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        } else if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus())) {
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        }
+        // The parts that depend on the chain; the transactions are written after releasing cs_main
+        if (rf == RF_JSON)
+            blockHeadTailToJSON(objHead, objTail, block, pblockindex);
     }
 
-    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-    ssBlock << block;
+    if (!fRaw && rf != RF_JSON)
+        CVectorWriter(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags(), blockData, 0, block);
 
     switch (rf) {
     case RF_BINARY: {
-        std::string binaryBlock = ssBlock.str();
+        std::string binaryBlock(blockData.begin(), blockData.end());
         req->WriteHeader("Content-Type", "application/octet-stream");
         req->WriteReply(HTTP_OK, binaryBlock);
         return true;
     }
 
     case RF_HEX: {
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
+        std::string strHex = HexStr(blockData.begin(), blockData.end()) + "\n";
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
         return true;
     }
 
     case RF_JSON: {
-        UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails);
-        std::string strJSON = objBlock.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        // Sent in chunks as it is produced, large blocks don't have to fit in memory as JSON
+        try {
+            req->WriteJSONReplyStream([&](JSONStreamWriter& writer) {
+                blockToJSON(writer, block, objHead, objTail, showTxDetails);
+                return true;
+            });
+        } catch (const std::exception& e) {
+            return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, e.what());
+        }
         return true;
     }
 
@@ -401,14 +401,20 @@ UniValue listassetbalancesbyaddress(const JSONRPCRequest& request)
     LOCK(cs_main);
     UniValue result(UniValue::VOBJ);
 
-    if (!passets)
+    if (!passetsdb)
         return NullUniValue;
 
-    for (auto it : passets->mapAssetsAddressAmount) {
-        if (address.compare(it.first.second) == 0) {
-            result.push_back(Pair(it.first.first, UnitValueFromAmount(it.second, it.first.first)));
-        }
-    }
+    std::vector<std::pair<std::string, CAmount> > vecAssetAmounts;
+    if (!passetsdb->AddressDir(vecAssetAmounts, address))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "couldn't retrieve address asset balances.");
+
+    // The database only has what was flushed, the rest is still in passets
+    std::map<std::string, CAmount> mapAmounts(vecAssetAmounts.begin(), vecAssetAmounts.end());
+    if (passets)
+        passets->ApplyAddressAmounts(address, mapAmounts);
+
+    for (auto const& item : mapAmounts)
+        result.push_back(Pair(item.first, UnitValueFromAmount(item.second, item.first)));
 
     return result;
 }
@@ -463,6 +469,42 @@ UniValue getassetdata(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+UniValue getassetcacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+                "getassetcacheinfo\n"
+                "\nReturns the state of the in memory cache of asset meta data\n"
+
+                "\nResult:\n"
+                "{\n"
+                "  \"entries\": n,          (numeric) number of assets in the cache\n"
+                "  \"absent_entries\": n,   (numeric) number of names cached as not existing\n"
+                "  \"hits\": n,             (numeric) lookups answered with cached asset data\n"
+                "  \"absent_hits\": n,      (numeric) lookups answered by a cached absent name\n"
+                "  \"misses\": n            (numeric) lookups that had to go to the database\n"
+                "}\n"
+
+                "\nExamples:\n"
+                + HelpExampleCli("getassetcacheinfo", "")
+                + HelpExampleRpc("getassetcacheinfo", "")
+        );
+
+    if (!passetsCache)
+        throw JSONRPCError(RPC_DATABASE_ERROR, "passetsCache isn't initialized");
+
+    CAssetsMetaCache::Stats stats = passetsCache->GetStats();
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("entries", (uint64_t)stats.nEntries));
+    result.push_back(Pair("absent_entries", (uint64_t)stats.nAbsentEntries));
+    result.push_back(Pair("hits", stats.nHits));
+    result.push_back(Pair("absent_hits", stats.nAbsentHits));
+    result.push_back(Pair("misses", stats.nMisses));
+
+    return result;
+}
+
 template <class Iter, class Incr>
 void safe_advance(Iter& curr, const Iter& end, Incr n)
 {
@@ -679,12 +721,12 @@ UniValue listaddressesbyasset(const JSONRPCRequest &request)
     if (!passets)
         return NullUniValue;
 
-    if (!passets->mapAssetsAddresses.count(asset_name))
+    std::set<std::string> setAddresses;
+    if (!passets->GetAssetAddresses(asset_name, setAddresses) || setAddresses.empty())
         return NullUniValue;
 
     UniValue addresses(UniValue::VOBJ);
 
-    auto setAddresses = passets->mapAssetsAddresses.at(asset_name);
     for (auto it : setAddresses) {
         auto pair = std::make_pair(asset_name, it);
 
@@ -956,9 +998,10 @@ static const CRPCCommand commands[] =
     { "assets",   "issue",                      &issue,                      {"asset_name","qty","to_address","change_address","units","reissuable","has_ipfs","ipfs_hash"} },
     { "assets",   "issueunique",                &issueunique,                {"root_name", "asset_tags", "ipfs_hashes", "to_address", "change_address"}},
     { "assets",   "listassetbalancesbyaddress", &listassetbalancesbyaddress, {"address"} },
-    { "assets",   "getassetdata",               &getassetdata,               {"asset_name"}},
+    { "assets",   "getassetdata",               &getassetdata,               {"asset_name"}, true },
+    { "assets",   "getassetcacheinfo",          &getassetcacheinfo,          {}},
     { "assets",   "listmyassets",               &listmyassets,               {"asset", "verbose", "count", "start"}},
-    { "assets",   "listaddressesbyasset",       &listaddressesbyasset,       {"asset_name"}},
+    { "assets",   "listaddressesbyasset",       &listaddressesbyasset,       {"asset_name"}, true },
     { "assets",   "transfer",                   &transfer,                   {"asset_name", "qty", "to_address"}},
     { "assets",   "reissue",                    &reissue,                    {"asset_name", "qty", "to_address", "change_address", "reissuable", "new_unit", "new_ipfs"}},
     { "assets",   "listassets",                 &listassets,                 {"asset", "verbose", "count", "start"}}
@@ -110,9 +110,26 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     return result;
 }
 
-UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
+//! Fields of the block JSON that come after its transactions
+static void blockTailToJSON(UniValue& result, const CBlock& block, const CBlockIndex* blockindex)
+{
+    result.push_back(Pair("time", block.GetBlockTime()));
+    result.push_back(Pair("mediantime", (int64_t)blockindex->GetMedianTimePast()));
+    result.push_back(Pair("nonce", (uint64_t)block.nNonce));
+    result.push_back(Pair("bits", strprintf("%08x", block.nBits)));
+    result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
+    result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
+
+    if (blockindex->pprev)
+        result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
+    CBlockIndex *pnext = chainActive.Next(blockindex);
+    if (pnext)
+        result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
+}
+
+//! Fields of blockToDeltasJSON that come before the deltas
+static void blockDeltasHeadToJSON(UniValue& result, const CBlock& block, const CBlockIndex* blockindex)
 {
-    UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", block.GetHash().GetHex()));
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
@@ -126,99 +143,123 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
     result.push_back(Pair("height", blockindex->nHeight));
     result.push_back(Pair("version", block.nVersion));
     result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
+}
 
-    UniValue deltas(UniValue::VARR);
-
-    for (unsigned int i = 0; i < block.vtx.size(); i++) {
-        const CTransaction &tx = *(block.vtx[i]);
-        const uint256 txhash = tx.GetHash();
-
-        UniValue entry(UniValue::VOBJ);
-        entry.push_back(Pair("txid", txhash.GetHex()));
-        entry.push_back(Pair("index", (int)i));
-
-        UniValue inputs(UniValue::VARR);
+//! Look up the spent index entries of the inputs of tx, they all have to be there
+static std::vector<CSpentIndexValue> GetTxSpentInfo(const CTransaction& tx)
+{
+    std::vector<CSpentIndexValue> vSpentInfo;
+    if (tx.IsCoinBase())
+        return vSpentInfo;
+
+    vSpentInfo.resize(tx.vin.size());
+    for (size_t j = 0; j < tx.vin.size(); j++) {
+        CSpentIndexKey spentKey(tx.vin[j].prevout.hash, tx.vin[j].prevout.n);
+        if (!GetSpentIndex(spentKey, vSpentInfo[j]))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Spent information not available");
+    }
+    return vSpentInfo;
+}
 
-        if (!tx.IsCoinBase()) {
+//! The entry of blockToDeltasJSON for the i'th transaction of a block, vSpentInfo is from GetTxSpentInfo
+static UniValue txToDeltasJSON(const CTransaction& tx, unsigned int i, const std::vector<CSpentIndexValue>& vSpentInfo)
+{
+    const uint256 txhash = tx.GetHash();
 
-            for (size_t j = 0; j < tx.vin.size(); j++) {
-                const CTxIn input = tx.vin[j];
+    UniValue entry(UniValue::VOBJ);
+    entry.push_back(Pair("txid", txhash.GetHex()));
+    entry.push_back(Pair("index", (int)i));
 
-                UniValue delta(UniValue::VOBJ);
+    UniValue inputs(UniValue::VARR);
 
-                CSpentIndexValue spentInfo;
-                CSpentIndexKey spentKey(input.prevout.hash, input.prevout.n);
+    if (!tx.IsCoinBase()) {
 
-                if (GetSpentIndex(spentKey, spentInfo)) {
-                    if (spentInfo.addressType == 1) {
-                        delta.push_back(Pair("address", CAstralAddress(CKeyID(spentInfo.addressHash)).ToString()));
-                    } else if (spentInfo.addressType == 2)  {
-                        delta.push_back(Pair("address", CAstralAddress(CScriptID(spentInfo.addressHash)).ToString()));
-                    } else {
-                        continue;
-                    }
-                    delta.push_back(Pair("satoshis", -1 * spentInfo.satoshis));
-                    delta.push_back(Pair("index", (int)j));
-                    delta.push_back(Pair("prevtxid", input.prevout.hash.GetHex()));
-                    delta.push_back(Pair("prevout", (int)input.prevout.n));
+        for (size_t j = 0; j < tx.vin.size(); j++) {
+            const CTxIn input = tx.vin[j];
 
-                    inputs.push_back(delta);
-                } else {
-                    throw JSONRPCError(RPC_INTERNAL_ERROR, "Spent information not available");
-                }
+            UniValue delta(UniValue::VOBJ);
 
+            const CSpentIndexValue& spentInfo = vSpentInfo[j];
+            if (spentInfo.addressType == 1) {
+                delta.push_back(Pair("address", CAstralAddress(CKeyID(spentInfo.addressHash)).ToString()));
+            } else if (spentInfo.addressType == 2)  {
+                delta.push_back(Pair("address", CAstralAddress(CScriptID(spentInfo.addressHash)).ToString()));
+            } else {
+                continue;
             }
+            delta.push_back(Pair("satoshis", -1 * spentInfo.satoshis));
+            delta.push_back(Pair("index", (int)j));
+            delta.push_back(Pair("prevtxid", input.prevout.hash.GetHex()));
+            delta.push_back(Pair("prevout", (int)input.prevout.n));
+
+            inputs.push_back(delta);
         }
+    }
 
-        entry.push_back(Pair("inputs", inputs));
+    entry.push_back(Pair("inputs", inputs));
 
-        UniValue outputs(UniValue::VARR);
+    UniValue outputs(UniValue::VARR);
 
-        for (unsigned int k = 0; k < tx.vout.size(); k++) {
-            const CTxOut &out = tx.vout[k];
+    for (unsigned int k = 0; k < tx.vout.size(); k++) {
+        const CTxOut &out = tx.vout[k];
 
-            UniValue delta(UniValue::VOBJ);
+        UniValue delta(UniValue::VOBJ);
 
-            if (out.scriptPubKey.IsPayToScriptHash()) {
-                std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-                delta.push_back(Pair("address", CAstralAddress(CScriptID(uint160(hashBytes))).ToString()));
+        if (out.scriptPubKey.IsPayToScriptHash()) {
+            std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
+            delta.push_back(Pair("address", CAstralAddress(CScriptID(uint160(hashBytes))).ToString()));
 
-            } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-                delta.push_back(Pair("address", CAstralAddress(CKeyID(uint160(hashBytes))).ToString()));
-            } else {
-                continue;
-            }
-
-            delta.push_back(Pair("satoshis", out.nValue));
-            delta.push_back(Pair("index", (int)k));
-
-            outputs.push_back(delta);
+        } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
+            std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
+            delta.push_back(Pair("address", CAstralAddress(CKeyID(uint160(hashBytes))).ToString()));
+        } else {
+            continue;
         }
 
-        entry.push_back(Pair("outputs", outputs));
-        deltas.push_back(entry);
+        delta.push_back(Pair("satoshis", out.nValue));
+        delta.push_back(Pair("index", (int)k));
 
+        outputs.push_back(delta);
     }
+
+    entry.push_back(Pair("outputs", outputs));
+    return entry;
+}
+
+UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
+{
+    UniValue result(UniValue::VOBJ);
+    blockDeltasHeadToJSON(result, block, blockindex);
+
+    UniValue deltas(UniValue::VARR);
+    for (unsigned int i = 0; i < block.vtx.size(); i++)
+        deltas.push_back(txToDeltasJSON(*block.vtx[i], i, GetTxSpentInfo(*block.vtx[i])));
     result.push_back(Pair("deltas", deltas));
-    result.push_back(Pair("time", block.GetBlockTime()));
-    result.push_back(Pair("mediantime", (int64_t)blockindex->GetMedianTimePast()));
-    result.push_back(Pair("nonce", (uint64_t)block.nNonce));
-    result.push_back(Pair("bits", strprintf("%08x", block.nBits)));
-    result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
-    result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
 
-    if (blockindex->pprev)
-        result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex *pnext = chainActive.Next(blockindex);
-    if (pnext)
-        result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
+    blockTailToJSON(result, block, blockindex);
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails)
+/**
+ * Streaming blockToDeltasJSON, with the fields around the deltas computed beforehand under cs_main
+ * and the spent index entries of every transaction looked up by GetTxSpentInfo.
+ */
+static void blockToDeltasJSON(JSONStreamWriter& writer, const CBlock& block, const UniValue& head, const UniValue& tail, const std::vector<std::vector<CSpentIndexValue> >& vSpentInfo)
+{
+    writer.BeginObject();
+    writer.KeyValues(head);
+    writer.Key("deltas");
+    writer.BeginArray();
+    for (unsigned int i = 0; i < block.vtx.size(); i++)
+        writer.Value(txToDeltasJSON(*block.vtx[i], i, vSpentInfo[i]));
+    writer.EndArray();
+    writer.KeyValues(tail);
+    writer.EndObject();
+}
+
+//! Fields of blockToJSON that come before the transactions
+static void blockHeadToJSON(UniValue& result, const CBlock& block, const CBlockIndex* blockindex)
 {
-    UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
@@ -232,34 +273,48 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.push_back(Pair("version", block.nVersion));
     result.push_back(Pair("versionHex", strprintf("%08x", block.nVersion)));
     result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
+}
+
+static UniValue blockTxToJSON(const CTransaction& tx, bool txDetails)
+{
+    if (!txDetails)
+        return tx.GetHash().GetHex();
+    UniValue objTx(UniValue::VOBJ);
+    TxToUniv(tx, uint256(), objTx, true, RPCSerializationFlags());
+    return objTx;
+}
+
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails)
+{
+    UniValue result(UniValue::VOBJ);
+    blockHeadToJSON(result, block, blockindex);
     UniValue txs(UniValue::VARR);
     for(const auto& tx : block.vtx)
-    {
-        if(txDetails)
-        {
-            UniValue objTx(UniValue::VOBJ);
-            TxToUniv(*tx, uint256(), objTx, true, RPCSerializationFlags());
-            txs.push_back(objTx);
-        }
-        else
-            txs.push_back(tx->GetHash().GetHex());
-    }
+        txs.push_back(blockTxToJSON(*tx, txDetails));
     result.push_back(Pair("tx", txs));
-    result.push_back(Pair("time", block.GetBlockTime()));
-    result.push_back(Pair("mediantime", (int64_t)blockindex->GetMedianTimePast()));
-    result.push_back(Pair("nonce", (uint64_t)block.nNonce));
-    result.push_back(Pair("bits", strprintf("%08x", block.nBits)));
-    result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
-    result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
-
-    if (blockindex->pprev)
-        result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex *pnext = chainActive.Next(blockindex);
-    if (pnext)
-        result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
+    blockTailToJSON(result, block, blockindex);
     return result;
 }
 
+void blockHeadTailToJSON(UniValue& head, UniValue& tail, const CBlock& block, const CBlockIndex* blockindex)
+{
+    blockHeadToJSON(head, block, blockindex);
+    blockTailToJSON(tail, block, blockindex);
+}
+
+void blockToJSON(JSONStreamWriter& writer, const CBlock& block, const UniValue& head, const UniValue& tail, bool txDetails)
+{
+    writer.BeginObject();
+    writer.KeyValues(head);
+    writer.Key("tx");
+    writer.BeginArray();
+    for (const auto& tx : block.vtx)
+        writer.Value(blockTxToJSON(*tx, txDetails));
+    writer.EndArray();
+    writer.KeyValues(tail);
+    writer.EndObject();
+}
+
 UniValue getblockcount(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -523,6 +578,37 @@ UniValue mempoolToJSON(bool fVerbose)
     }
 }
 
+//! Entries described per mempool.cs lock by the streaming mempoolToJSON
+static const size_t MEMPOOL_JSON_BATCH_SIZE = 1000;
+
+void mempoolToJSON(JSONStreamWriter& writer)
+{
+    // mempool.cs is only held while a batch of entries is described, not while the client reads
+    // them. Transactions that leave the mempool in the meantime are left out.
+    std::vector<uint256> vtxid;
+    mempool.queryHashes(vtxid);
+
+    writer.BeginObject();
+    std::vector<std::pair<std::string, UniValue> > vBatch;
+    for (size_t i = 0; i < vtxid.size(); i += MEMPOOL_JSON_BATCH_SIZE) {
+        vBatch.clear();
+        {
+            LOCK(mempool.cs);
+            for (size_t j = i; j < vtxid.size() && j < i + MEMPOOL_JSON_BATCH_SIZE; j++) {
+                CTxMemPool::txiter it = mempool.mapTx.find(vtxid[j]);
+                if (it == mempool.mapTx.end())
+                    continue;
+                UniValue info(UniValue::VOBJ);
+                entryToJSON(info, *it);
+                vBatch.push_back(std::make_pair(vtxid[j].ToString(), info));
+            }
+        }
+        for (const auto& entry : vBatch)
+            writer.KeyValue(entry.first, entry.second);
+    }
+    writer.EndObject();
+}
+
 UniValue getrawmempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 1)
@@ -555,6 +641,16 @@ UniValue getrawmempool(const JSONRPCRequest& request)
     return mempoolToJSON(fVerbose);
 }
 
+//! Streaming variant of getrawmempool, for verbose = true
+static bool getrawmempool_stream(const JSONRPCRequest& request, JSONStreamWriter& writer)
+{
+    if (request.fHelp || request.params.size() != 1 || !request.params[0].isBool() || !request.params[0].get_bool())
+        return false;
+
+    mempoolToJSON(writer);
+    return true;
+}
+
 UniValue getmempoolancestors(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 1 || request.params.size() > 2) {
@@ -716,18 +812,15 @@ UniValue getmempoolentry(const JSONRPCRequest& request)
     return info;
 }
 
-UniValue getblockdeltas(const JSONRPCRequest& request)
+//! Look up and read the block requested from getblockdeltas
+static CBlockIndex* ReadBlockForDeltas(const JSONRPCRequest& request, CBlock& block)
 {
-    if (request.fHelp || request.params.size() != 1)
-        throw std::runtime_error("");
-
     std::string strHash = request.params[0].get_str();
     uint256 hash(uint256S(strHash));
 
     if (mapBlockIndex.count(hash) == 0)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlock block;
     CBlockIndex* pblockindex = mapBlockIndex[hash];
 
     if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
@@ -736,9 +829,48 @@ UniValue getblockdeltas(const JSONRPCRequest& request)
     if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
+    return pblockindex;
+}
+
+UniValue getblockdeltas(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error("");
+
+    LOCK(cs_main);
+
+    CBlock block;
+    CBlockIndex* pblockindex = ReadBlockForDeltas(request, block);
+
     return blockToDeltasJSON(block, pblockindex);
 }
 
+static bool getblockdeltas_stream(const JSONRPCRequest& request, JSONStreamWriter& writer)
+{
+    if (request.fHelp || request.params.size() != 1)
+        return false;
+
+    CBlock block;
+    UniValue head(UniValue::VOBJ), tail(UniValue::VOBJ);
+    {
+        LOCK(cs_main);
+        CBlockIndex* pblockindex = ReadBlockForDeltas(request, block);
+        blockDeltasHeadToJSON(head, block, pblockindex);
+        blockTailToJSON(tail, block, pblockindex);
+    }
+
+    // The deltas only need the spent index, cs_main isn't held while the client reads them. It's
+    // looked up for the whole block before anything is written, so that a missing entry still
+    // gets a regular error reply rather than a cut off result.
+    std::vector<std::vector<CSpentIndexValue> > vSpentInfo;
+    vSpentInfo.reserve(block.vtx.size());
+    for (const CTransactionRef& tx : block.vtx)
+        vSpentInfo.push_back(GetTxSpentInfo(*tx));
+
+    blockToDeltasJSON(writer, block, head, tail, vSpentInfo);
+    return true;
+}
+
 UniValue getblockhashes(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2)
@@ -871,8 +1003,6 @@ UniValue getblockheader(const JSONRPCRequest& request)
             + HelpExampleRpc("getblockheader", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
         );
 
-    LOCK(cs_main);
-
     std::string strHash = request.params[0].get_str();
     uint256 hash(uint256S(strHash));
 
@@ -880,20 +1010,50 @@ UniValue getblockheader(const JSONRPCRequest& request)
     if (!request.params[1].isNull())
         fVerbose = request.params[1].get_bool();
 
+    // Only the lookup, and the fields that depend on the active chain, need cs_main
+    CBlockHeader header;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+
+        if (fVerbose)
+            return blockheaderToJSON(mi->second);
+        header = mi->second->GetBlockHeader();
+    }
+
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+    ssBlock << header;
+    std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
+    return strHex;
+}
+
+//! Look up and read the block with the hash given in param, for getblock
+static CBlockIndex* ReadBlockForRPC(const UniValue& param, CBlock& block)
+{
+    AssertLockHeld(cs_main);
+
+    std::string strHash = param.get_str();
+    uint256 hash(uint256S(strHash));
+
     if (mapBlockIndex.count(hash) == 0)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
     CBlockIndex* pblockindex = mapBlockIndex[hash];
 
-    if (!fVerbose)
-    {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << pblockindex->GetBlockHeader();
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
-    }
+    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
 
-    return blockheaderToJSON(pblockindex);
+    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        // Block not found on disk. This could be because we have the block
+        // header in our index but don't have the block (for example if a
+        // non-whitelisted node sends us an unrequested long chain of valid
+        // blocks, we add the headers to our index, but don't accept the
+        // block).
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+
+    return pblockindex;
 }
 
 UniValue getblock(const JSONRPCRequest& request)
@@ -948,9 +1108,6 @@ UniValue getblock(const JSONRPCRequest& request)
 
     LOCK(cs_main);
 
-    std::string strHash = request.params[0].get_str();
-    uint256 hash(uint256S(strHash));
-
     int verbosity = 1;
     if (!request.params[1].isNull()) {
         if(request.params[1].isNum())
@@ -959,22 +1116,8 @@ UniValue getblock(const JSONRPCRequest& request)
             verbosity = request.params[1].get_bool() ? 1 : 0;
     }
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
-
-    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
-        // Block not found on disk. This could be because we have the block
-        // header in our index but don't have the block (for example if a
-        // non-whitelisted node sends us an unrequested long chain of valid
-        // blocks, we add the headers to our index, but don't accept the
-        // block).
-        throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+    CBlockIndex* pblockindex = ReadBlockForRPC(request.params[0], block);
 
     if (verbosity <= 0)
     {
@@ -987,6 +1130,25 @@ UniValue getblock(const JSONRPCRequest& request)
     return blockToJSON(block, pblockindex, verbosity >= 2);
 }
 
+//! Streaming variant of getblock, for verbosity 2
+static bool getblock_stream(const JSONRPCRequest& request, JSONStreamWriter& writer)
+{
+    if (request.fHelp || request.params.size() != 2 || !request.params[1].isNum() || request.params[1].get_int() < 2)
+        return false;
+
+    CBlock block;
+    UniValue head(UniValue::VOBJ), tail(UniValue::VOBJ);
+    {
+        LOCK(cs_main);
+        CBlockIndex* pblockindex = ReadBlockForRPC(request.params[0], block);
+        blockHeadTailToJSON(head, tail, block, pblockindex);
+    }
+
+    // cs_main isn't held while the client reads the transactions
+    blockToJSON(writer, block, head, tail, true);
+    return true;
+}
+
 struct CCoinsStats
 {
     int nHeight;
@@ -1109,29 +1271,66 @@ UniValue pruneblockchain(const JSONRPCRequest& request)
 
 UniValue gettxoutsetinfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 1)
         throw std::runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( \"hash_type\" )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"hash_type\"      (string, optional, default=\"hash_serialized_2\") Which UTXO set hash to return:\n"
+            "                   \"hash_serialized_2\" scans the whole UTXO set (note this may take some time),\n"
+            "                   \"muhash\" reads statistics kept up to date as blocks are connected (requires -coinstatsindex).\n"
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
             "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
-            "  \"transactions\": n,      (numeric) The number of transactions\n"
+            "  \"transactions\": n,      (numeric) The number of transactions (hash_serialized_2 only)\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
+            "  \"asset_txouts\": n,      (numeric) The number of outputs holding assets (muhash only)\n"
             "  \"bogosize\": n,          (numeric) A meaningless metric for UTXO set size\n"
-            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash\n"
+            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash (hash_serialized_2 only)\n"
+            "  \"muhash\": \"hash\",       (string) MuHash3072 of the UTXO set, independent of the order coins were added in (muhash only)\n"
             "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxoutsetinfo", "")
+            + HelpExampleCli("gettxoutsetinfo", "\"muhash\"")
             + HelpExampleRpc("gettxoutsetinfo", "")
         );
 
+    std::string hash_type = "hash_serialized_2";
+    if (!request.params[0].isNull())
+        hash_type = request.params[0].get_str();
+
     UniValue ret(UniValue::VOBJ);
 
+    if (hash_type == "muhash") {
+        if (!fCoinStatsIndex)
+            throw JSONRPCError(RPC_MISC_ERROR, "hash_type muhash requires -coinstatsindex");
+        // Copy the statistics out, finalizing the muhash is too slow to do under cs_main
+        CRollingCoinsStats stats;
+        int nHeight;
+        {
+            LOCK(cs_main);
+            stats = pcoinsdbview->RollingStats();
+            // Until they are worked out at startup (e.g. for a chainstate written without -coinstatsindex)
+            if (pcoinsdbview->IsRollingStatsPartial() || stats.hashBlock != chainActive.Tip()->GetBlockHash())
+                throw JSONRPCError(RPC_IN_WARMUP, "The UTXO set statistics are still being computed, try again later");
+            nHeight = chainActive.Height();
+        }
+        ret.push_back(Pair("height", (int64_t)nHeight));
+        ret.push_back(Pair("bestblock", stats.hashBlock.GetHex()));
+        ret.push_back(Pair("txouts", (int64_t)stats.nTransactionOutputs));
+        ret.push_back(Pair("asset_txouts", (int64_t)stats.nAssetOutputs));
+        ret.push_back(Pair("bogosize", (int64_t)stats.nBogoSize));
+        ret.push_back(Pair("muhash", stats.GetMuHash().GetHex()));
+        ret.push_back(Pair("disk_size", pcoinsdbview->EstimateSize()));
+        ret.push_back(Pair("total_amount", ValueFromAmount(stats.nTotalAmount)));
+        return ret;
+    }
+    if (hash_type != "hash_serialized_2")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown hash_type " + hash_type);
+
     CCoinsStats stats;
     FlushStateToDisk();
     if (GetUTXOStats(pcoinsdbview, stats)) {
@@ -1803,24 +2002,24 @@ UniValue savemempool(const JSONRPCRequest& request)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
-    { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      {} },
-    { "blockchain",         "getchaintxstats",        &getchaintxstats,        {"nblocks", "blockhash"} },
-    { "blockchain",         "getbestblockhash",       &getbestblockhash,       {} },
-    { "blockchain",         "getblockcount",          &getblockcount,          {} },
-    { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"} },
-    { "blockchain",         "getblockdeltas",         &getblockdeltas,         {} },
-    { "blockchain",         "getblockhashes",         &getblockhashes,         {} },
-    { "blockchain",         "getblockhash",           &getblockhash,           {"height"} },
-    { "blockchain",         "getblockheader",         &getblockheader,         {"blockhash","verbose"} },
-    { "blockchain",         "getchaintips",           &getchaintips,           {} },
-    { "blockchain",         "getdifficulty",          &getdifficulty,          {} },
-    { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    {"txid","verbose"} },
-    { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  {"txid","verbose"} },
-    { "blockchain",         "getmempoolentry",        &getmempoolentry,        {"txid"} },
-    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         {} },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"} },
-    { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
+    { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      {}, true },
+    { "blockchain",         "getchaintxstats",        &getchaintxstats,        {"nblocks", "blockhash"}, true },
+    { "blockchain",         "getbestblockhash",       &getbestblockhash,       {}, true },
+    { "blockchain",         "getblockcount",          &getblockcount,          {}, true },
+    { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"}, true },
+    { "blockchain",         "getblockdeltas",         &getblockdeltas,         {}, true },
+    { "blockchain",         "getblockhashes",         &getblockhashes,         {}, true },
+    { "blockchain",         "getblockhash",           &getblockhash,           {"height"}, true },
+    { "blockchain",         "getblockheader",         &getblockheader,         {"blockhash","verbose"}, true },
+    { "blockchain",         "getchaintips",           &getchaintips,           {}, true },
+    { "blockchain",         "getdifficulty",          &getdifficulty,          {}, true },
+    { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    {"txid","verbose"}, true },
+    { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  {"txid","verbose"}, true },
+    { "blockchain",         "getmempoolentry",        &getmempoolentry,        {"txid"}, true },
+    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         {}, true },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"}, true },
+    { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"}, true },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {"hash_type"} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
@@ -1839,4 +2038,8 @@ void RegisterBlockchainRPCCommands(CRPCTable &t)
 {
     for (unsigned int vcidx = 0; vcidx < ARRAYLEN(commands); vcidx++)
         t.appendCommand(commands[vcidx].name, &commands[vcidx]);
+
+    t.appendStreamCommand("getblock", &getblock_stream);
+    t.appendStreamCommand("getblockdeltas", &getblockdeltas_stream);
+    t.appendStreamCommand("getrawmempool", &getrawmempool_stream);
 }
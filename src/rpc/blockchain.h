@@ -8,6 +8,7 @@
 
 class CBlock;
 class CBlockIndex;
+class JSONStreamWriter;
 class UniValue;
 
 /**
@@ -24,12 +25,18 @@ void RPCNotifyBlockChange(bool ibd, const CBlockIndex *);
 
 /** Block description to JSON */
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
+/** The fields of the block JSON around its transactions, which depend on the chain. Requires cs_main. */
+void blockHeadTailToJSON(UniValue& head, UniValue& tail, const CBlock& block, const CBlockIndex* blockindex);
+/** Block description to JSON, written to writer as it is produced. Doesn't need cs_main. */
+void blockToJSON(JSONStreamWriter& writer, const CBlock& block, const UniValue& head, const UniValue& tail, bool txDetails);
 
 /** Mempool information to JSON */
 UniValue mempoolInfoToJSON();
 
 /** Mempool to JSON */
 UniValue mempoolToJSON(bool fVerbose = false);
+/** Verbose mempool to JSON, written to writer as it is produced */
+void mempoolToJSON(JSONStreamWriter& writer);
 
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* blockindex);
@@ -154,6 +154,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getaddressutxos", 0, "addresses"},
     { "getaddressmempool", 0, "addresses"},
     { "bumpfee", 1, "options" },
+    { "setx20rstats", 0, "enable" },
+    { "setx20rstats", 1, "reset" },
     { "logging", 0, "include" },
     { "logging", 1, "exclude" },
     { "disconnectnode", 1, "nodeid" },
@@ -0,0 +1,179 @@
+// Copyright (c) 2018 The Astral Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/jsonstream.h"
+
+#include <assert.h>
+#include <utility>
+
+void JSONWriter::KeyValue(const std::string& key, const UniValue& value)
+{
+    Key(key);
+    Value(value);
+}
+
+void JSONWriter::KeyValues(const UniValue& obj)
+{
+    const std::vector<std::string>& keys = obj.getKeys();
+    const std::vector<UniValue>& values = obj.getValues();
+    for (size_t i = 0; i < keys.size(); i++)
+        KeyValue(keys[i], values[i]);
+}
+
+JSONStreamWriter::JSONStreamWriter(const Sink& sinkIn, size_t nFlushSizeIn) :
+    sink(sinkIn), nFlushSize(nFlushSizeIn), fFlushed(false), fAfterKey(false)
+{
+}
+
+void JSONStreamWriter::Separate()
+{
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (vEmpty.empty())
+        return;
+    if (!vEmpty.back())
+        strBuffer += ',';
+    vEmpty.back() = false;
+}
+
+void JSONStreamWriter::Append(const std::string& str)
+{
+    strBuffer += str;
+    if (strBuffer.size() >= nFlushSize)
+        Flush();
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    Separate();
+    strBuffer += '{';
+    vEmpty.push_back(true);
+}
+
+void JSONStreamWriter::EndObject()
+{
+    assert(!vEmpty.empty() && !fAfterKey);
+    vEmpty.pop_back();
+    Append("}");
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    Separate();
+    strBuffer += '[';
+    vEmpty.push_back(true);
+}
+
+void JSONStreamWriter::EndArray()
+{
+    assert(!vEmpty.empty() && !fAfterKey);
+    vEmpty.pop_back();
+    Append("]");
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!fAfterKey);
+    Separate();
+    strBuffer += UniValue(key).write();
+    strBuffer += ':';
+    fAfterKey = true;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    Separate();
+    Append(value.write());
+}
+
+void JSONStreamWriter::WriteRaw(const std::string& str)
+{
+    Append(str);
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (strBuffer.empty())
+        return;
+    sink(strBuffer);
+    strBuffer.clear();
+    fFlushed = true;
+}
+
+std::string JSONStreamWriter::TakeBuffer()
+{
+    std::string ret;
+    ret.swap(strBuffer);
+    return ret;
+}
+
+UniValueWriter::UniValueWriter() : fAfterKey(false)
+{
+}
+
+void UniValueWriter::Begin(UniValue::VType type)
+{
+    assert(vOpen.empty() || vOpen.back().second.isArray() || fAfterKey);
+    vOpen.push_back(std::make_pair(fAfterKey ? strKey : std::string(), UniValue(type)));
+    fAfterKey = false;
+}
+
+void UniValueWriter::End()
+{
+    assert(!vOpen.empty() && !fAfterKey);
+    std::pair<std::string, UniValue> closed;
+    closed.swap(vOpen.back());
+    vOpen.pop_back();
+    if (vOpen.empty()) {
+        result = std::move(closed.second);
+    } else if (vOpen.back().second.isObject()) {
+        vOpen.back().second.__pushKV(closed.first, closed.second);
+    } else {
+        vOpen.back().second.push_back(closed.second);
+    }
+}
+
+void UniValueWriter::BeginObject()
+{
+    Begin(UniValue::VOBJ);
+}
+
+void UniValueWriter::EndObject()
+{
+    assert(!vOpen.empty() && vOpen.back().second.isObject());
+    End();
+}
+
+void UniValueWriter::BeginArray()
+{
+    Begin(UniValue::VARR);
+}
+
+void UniValueWriter::EndArray()
+{
+    assert(!vOpen.empty() && vOpen.back().second.isArray());
+    End();
+}
+
+void UniValueWriter::Key(const std::string& key)
+{
+    assert(!vOpen.empty() && vOpen.back().second.isObject() && !fAfterKey);
+    strKey = key;
+    fAfterKey = true;
+}
+
+void UniValueWriter::Value(const UniValue& value)
+{
+    if (vOpen.empty()) {
+        result = value;
+    } else if (vOpen.back().second.isObject()) {
+        assert(fAfterKey);
+        vOpen.back().second.__pushKV(strKey, value);
+        fAfterKey = false;
+    } else {
+        vOpen.back().second.push_back(value);
+    }
+}
@@ -0,0 +1,113 @@
+// Copyright (c) 2018 The Astral Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAVEN_RPC_JSONSTREAM_H
+#define RAVEN_RPC_JSONSTREAM_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <univalue.h>
+
+//! Hand written JSON to the sink once this many bytes have accumulated
+static const size_t DEFAULT_JSON_STREAM_FLUSH_SIZE = 64 * 1024;
+
+/**
+ * Interface for writing a JSON document piece by piece. The caller opens and closes the
+ * outer objects and arrays and writes the values inside them, usually small UniValues,
+ * one at a time. This lets a call write its result once, whether it is sent as it is
+ * produced or returned as a UniValue.
+ */
+class JSONWriter
+{
+public:
+    virtual ~JSONWriter() {}
+
+    virtual void BeginObject() = 0;
+    virtual void EndObject() = 0;
+    virtual void BeginArray() = 0;
+    virtual void EndArray() = 0;
+    //! Write the key of the next value in the current object
+    virtual void Key(const std::string& key) = 0;
+    virtual void Value(const UniValue& value) = 0;
+
+    void KeyValue(const std::string& key, const UniValue& value);
+    //! Write every key/value pair of the object obj into the current object
+    void KeyValues(const UniValue& obj);
+};
+
+/**
+ * Writes a JSON document as text, so that large results don't have to be built as a
+ * single UniValue and string before being sent. Output is handed to the sink in pieces
+ * of about nFlushSize bytes and matches what UniValue::write() would produce for the
+ * whole document.
+ */
+class JSONStreamWriter : public JSONWriter
+{
+public:
+    typedef std::function<void(const std::string&)> Sink;
+
+    explicit JSONStreamWriter(const Sink& sinkIn, size_t nFlushSizeIn = DEFAULT_JSON_STREAM_FLUSH_SIZE);
+
+    void BeginObject() override;
+    void EndObject() override;
+    void BeginArray() override;
+    void EndArray() override;
+    void Key(const std::string& key) override;
+    void Value(const UniValue& value) override;
+    //! Append text outside of the JSON document, e.g. a trailing newline
+    void WriteRaw(const std::string& str);
+
+    //! Hand everything written so far to the sink
+    void Flush();
+    //! Whether part of the output was handed to the sink already
+    bool Flushed() const { return fFlushed; }
+    //! Take the output that wasn't handed to the sink yet
+    std::string TakeBuffer();
+
+private:
+    Sink sink;
+    size_t nFlushSize;
+    std::string strBuffer;
+    bool fFlushed;
+    //! For each open object or array, whether nothing was written into it yet
+    std::vector<bool> vEmpty;
+    //! Whether a key was written whose value is still to come
+    bool fAfterKey;
+
+    //! Write the separator needed before the next value or key
+    void Separate();
+    void Append(const std::string& str);
+};
+
+/** Builds the written document as a UniValue, for calls that return their result */
+class UniValueWriter : public JSONWriter
+{
+public:
+    UniValueWriter();
+
+    void BeginObject() override;
+    void EndObject() override;
+    void BeginArray() override;
+    void EndArray() override;
+    void Key(const std::string& key) override;
+    void Value(const UniValue& value) override;
+
+    //! The document, once every object and array is closed
+    const UniValue& Result() const { return result; }
+
+private:
+    UniValue result;
+    //! The objects and arrays that are still open, with the key each goes under in its parent
+    std::vector<std::pair<std::string, UniValue> > vOpen;
+    //! The key of the next value, if the current object is waiting for one
+    std::string strKey;
+    bool fAfterKey;
+
+    void Begin(UniValue::VType type);
+    void End();
+};
+
+#endif // RAVEN_RPC_JSONSTREAM_H
@@ -8,6 +8,7 @@
 #include "chain.h"
 #include "clientversion.h"
 #include "core_io.h"
+#include "hash.h"
 #include "init.h"
 #include "validation.h"
 #include "httpserver.h"
@@ -638,6 +639,74 @@ UniValue logging(const JSONRPCRequest& request)
     return result;
 }
 
+UniValue getx20rstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getx20rstats\n"
+            "\nReturns the time spent in each of the 20 X20R hash primitives.\n"
+            "Counting is off by default, use setx20rstats to turn it on.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"enabled\": true|false,     (boolean) Whether counting is on\n"
+            "  \"algorithms\": [            (array) One entry per primitive, in selection order\n"
+            "    {\n"
+            "      \"name\": \"xxxx\",         (string) The primitive\n"
+            "      \"calls\": n,             (numeric) Number of times it ran\n"
+            "      \"total_us\": n,          (numeric) Total time spent in it, in microseconds\n"
+            "      \"average_ns\": n         (numeric) Average time per call, in nanoseconds\n"
+            "    }\n"
+            "    ,...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getx20rstats", "")
+            + HelpExampleRpc("getx20rstats", "")
+        );
+
+    X20RAlgoStats stats[20];
+    GetX20RStats(stats, false);
+
+    UniValue algorithms(UniValue::VARR);
+    for (int i = 0; i < 20; i++) {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("name", X20R_ALGO_NAMES[i]));
+        entry.push_back(Pair("calls", (uint64_t)stats[i].nCalls));
+        entry.push_back(Pair("total_us", stats[i].nNanos / 1000));
+        entry.push_back(Pair("average_ns", stats[i].nCalls ? stats[i].nNanos / (int64_t)stats[i].nCalls : 0));
+        algorithms.push_back(entry);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("enabled", fX20RStats.load()));
+    result.push_back(Pair("algorithms", algorithms));
+    return result;
+}
+
+UniValue setx20rstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "setx20rstats enable ( reset )\n"
+            "\nTurn counting of the time spent in each X20R hash primitive on or off.\n"
+            "Counting adds two clock reads to every X20R stage. See getx20rstats for the counters.\n"
+            "\nArguments:\n"
+            "1. enable    (boolean, required) Turn counting on or off\n"
+            "2. reset     (boolean, optional, default=false) Clear the counters\n"
+            "\nExamples:\n"
+            + HelpExampleCli("setx20rstats", "true")
+            + HelpExampleRpc("setx20rstats", "true, true")
+        );
+
+    fX20RStats = request.params[0].get_bool();
+    if (!request.params[1].isNull() && request.params[1].get_bool()) {
+        X20RAlgoStats stats[20];
+        GetX20RStats(stats, true);
+    }
+
+    return NullUniValue;
+}
+
 UniValue echo(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -709,6 +778,301 @@ bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
     return a.second.time < b.second.time;
 }
 
+//! Read the optional "limit" and "cursor" fields used to page through the address
+//! index. Returns false if the request isn't paginated.
+static bool getAddressPaging(const UniValue& params, int& limit, std::string& cursor)
+{
+    if (!params[0].isObject()) {
+        return false;
+    }
+
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+    if (limitValue.isNull()) {
+        if (!cursorValue.isNull()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor requires a limit");
+        }
+        return false;
+    }
+
+    limit = limitValue.get_int();
+    if (limit <= 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be greater than zero");
+    }
+    if (!cursorValue.isNull()) {
+        cursor = cursorValue.get_str();
+    }
+    return true;
+}
+
+template <typename Key>
+static std::string encodeAddressCursor(const Key& key)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << key;
+    return HexStr(ss.begin(), ss.end());
+}
+
+//! Decode cursor into key and return the position of its address in addresses,
+//! which is where the next page starts. An empty cursor starts at the beginning.
+template <typename Key>
+static size_t decodeAddressCursor(const std::string& cursor, const std::vector<std::pair<uint160, int> >& addresses, Key& key)
+{
+    if (cursor.empty()) {
+        return 0;
+    }
+
+    if (!IsHex(cursor)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    }
+    CDataStream ss(ParseHex(cursor), SER_DISK, CLIENT_VERSION);
+    try {
+        ss >> key;
+    } catch (const std::exception&) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    }
+    if (!ss.empty()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    }
+
+    for (size_t i = 0; i < addresses.size(); i++) {
+        if (addresses[i].first == key.hashBytes && addresses[i].second == (int)key.type) {
+            return i;
+        }
+    }
+    throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor does not match any of the addresses");
+}
+
+static UniValue addressUnspentToJSON(const CAddressUnspentKey& key, const CAddressUnspentValue& value)
+{
+    std::string address;
+    if (!getAddressFromIndex(key.type, key.hashBytes, address)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+    }
+
+    UniValue output(UniValue::VOBJ);
+    output.push_back(Pair("address", address));
+    output.push_back(Pair("txid", key.txhash.GetHex()));
+    output.push_back(Pair("outputIndex", (int)key.index));
+    output.push_back(Pair("script", HexStr(value.script.begin(), value.script.end())));
+    output.push_back(Pair("satoshis", value.satoshis));
+    output.push_back(Pair("height", value.blockHeight));
+    return output;
+}
+
+static UniValue addressDeltaToJSON(const CAddressIndexKey& key, CAmount amount)
+{
+    std::string address;
+    if (!getAddressFromIndex(key.type, key.hashBytes, address)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+    }
+
+    UniValue delta(UniValue::VOBJ);
+    delta.push_back(Pair("satoshis", amount));
+    delta.push_back(Pair("txid", key.txhash.GetHex()));
+    delta.push_back(Pair("index", (int)key.index));
+    delta.push_back(Pair("blockindex", (int)key.txindex));
+    delta.push_back(Pair("height", key.blockHeight));
+    delta.push_back(Pair("address", address));
+    return delta;
+}
+
+//! Read the optional "start" and "end" heights. The range only applies if both are given.
+//! If fStrict is set both have to be greater than zero with end not below start, otherwise
+//! a height that is not greater than zero means there is no range, as getaddresstxids always had it.
+static void getAddressHeightRange(const UniValue& params, int& start, int& end, bool fStrict)
+{
+    start = 0;
+    end = 0;
+    if (!params[0].isObject()) {
+        return;
+    }
+
+    UniValue startValue = find_value(params[0].get_obj(), "start");
+    UniValue endValue = find_value(params[0].get_obj(), "end");
+    if (startValue.isNum() && endValue.isNum()) {
+        start = startValue.get_int();
+        end = endValue.get_int();
+        if (!fStrict) {
+            if (start <= 0 || end <= 0) {
+                start = 0;
+                end = 0;
+            }
+            return;
+        }
+        if (start <= 0 || end <= 0) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Start and end is expected to be greater than zero");
+        }
+        if (end < start) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "End value is expected to be greater than start");
+        }
+    }
+}
+
+//! Hand the deltas of addresses to fn in index order, starting at cursor. Returns the cursor
+//! of the next page once limit deltas were handed over; a limit of zero hands over all of them.
+static std::string scanAddressDeltas(const std::vector<std::pair<uint160, int> >& addresses, int start, int end,
+                                     int limit, const std::string& cursor, const std::function<void(const UniValue&)>& fn)
+{
+    std::string next;
+    int count = 0;
+
+    CAddressIndexKey cursorKey;
+    size_t first = decodeAddressCursor(cursor, addresses, cursorKey);
+    for (size_t i = first; i < addresses.size() && next.empty(); i++) {
+        CAddressIndexKey startKey(addresses[i].second, addresses[i].first, start, 0, uint256(), 0, false);
+        if (i == first && !cursor.empty()) {
+            startKey = cursorKey;
+        }
+        bool fScanned = ScanAddressIndex(startKey, end, [&](const CAddressIndexKey& key, CAmount amount) {
+            if (limit > 0 && count >= limit) {
+                next = encodeAddressCursor(key);
+                return false;
+            }
+            fn(addressDeltaToJSON(key, amount));
+            count++;
+            return true;
+        });
+        if (!fScanned) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    }
+    return next;
+}
+
+//! As scanAddressDeltas, but hands over every txid once and counts txids towards the limit.
+//! A single address keeps the index order, where the entries of a transaction are adjacent.
+//! The txids of several addresses are merged in (height, txid) order, and the cursor is the
+//! last txid handed over, so a txid shared by the addresses can't show up on two pages.
+static std::string scanAddressTxids(const std::vector<std::pair<uint160, int> >& addresses, int start, int end,
+                                    int limit, const std::string& cursor, const std::function<void(const std::string&)>& fn)
+{
+    CAddressIndexKey cursorKey;
+    decodeAddressCursor(cursor, addresses, cursorKey);
+
+    if (addresses.size() == 1) {
+        std::pair<int, unsigned int> last(-1, 0);
+        if (!cursor.empty()) {
+            last = std::make_pair(cursorKey.blockHeight, cursorKey.txindex);
+        }
+        CAddressIndexKey startKey(addresses[0].second, addresses[0].first, cursor.empty() ? start : last.first,
+                                  last.second, uint256(), 0, false);
+        std::string next;
+        int count = 0;
+        bool fScanned = ScanAddressIndex(startKey, end, [&](const CAddressIndexKey& key, CAmount amount) {
+            std::pair<int, unsigned int> tx(key.blockHeight, key.txindex);
+            if (tx <= last) {
+                return true;
+            }
+            if (limit > 0 && count >= limit) {
+                next = encodeAddressCursor(cursorKey);
+                return false;
+            }
+            last = tx;
+            cursorKey = key;
+            fn(key.txhash.GetHex());
+            count++;
+            return true;
+        });
+        if (!fScanned) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+        return next;
+    }
+
+    std::pair<int, std::string> after(-1, std::string());
+    if (!cursor.empty()) {
+        after = std::make_pair(cursorKey.blockHeight, cursorKey.txhash.GetHex());
+    }
+
+    // Take up to limit + 1 txids of each address, plus the rest of the height of the last one,
+    // so that every txid an address has left is ordered after the first limit ones taken
+    std::map<std::pair<int, std::string>, CAddressIndexKey> txids;
+    for (const auto& address : addresses) {
+        CAddressIndexKey startKey(address.second, address.first, cursor.empty() ? start : after.first, 0, uint256(), 0, false);
+        std::pair<int, unsigned int> last(-1, 0);
+        int count = 0;
+        bool fScanned = ScanAddressIndex(startKey, end, [&](const CAddressIndexKey& key, CAmount amount) {
+            std::pair<int, unsigned int> tx(key.blockHeight, key.txindex);
+            if (tx == last) {
+                return true;
+            }
+            if (limit > 0 && count > limit && key.blockHeight > last.first) {
+                return false;
+            }
+            last = tx;
+            std::pair<int, std::string> txid(key.blockHeight, key.txhash.GetHex());
+            if (txid <= after) {
+                return true;
+            }
+            txids.insert(std::make_pair(txid, key));
+            count++;
+            return true;
+        });
+        if (!fScanned) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    }
+
+    int count = 0;
+    for (const auto& txid : txids) {
+        if (limit > 0 && count >= limit) {
+            return encodeAddressCursor(cursorKey);
+        }
+        cursorKey = txid.second;
+        fn(txid.first.second);
+        count++;
+    }
+    return std::string();
+}
+
+//! Hand at most limit unspent outputs of addresses to fn in index order, starting at cursor,
+//! and return the cursor of the next page
+static std::string scanAddressUnspent(const std::vector<std::pair<uint160, int> >& addresses, int limit,
+                                     const std::string& cursor, const std::function<void(const UniValue&)>& fn)
+{
+    std::string next;
+    int count = 0;
+
+    CAddressUnspentKey cursorKey;
+    size_t first = decodeAddressCursor(cursor, addresses, cursorKey);
+    for (size_t i = first; i < addresses.size() && next.empty(); i++) {
+        CAddressUnspentKey startKey(addresses[i].second, addresses[i].first, uint256(), 0);
+        if (i == first && !cursor.empty()) {
+            startKey = cursorKey;
+        }
+        bool fScanned = ScanAddressUnspent(startKey, [&](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+            if (count >= limit) {
+                next = encodeAddressCursor(key);
+                return false;
+            }
+            fn(addressUnspentToJSON(key, value));
+            count++;
+            return true;
+        });
+        if (!fScanned) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    }
+    return next;
+}
+
+//! The hash and height of the blocks at start and end, for the chainInfo of getaddressdeltas
+static void addressRangeChainInfo(int start, int end, UniValue& startInfo, UniValue& endInfo)
+{
+    LOCK(cs_main);
+
+    if (start > chainActive.Height() || end > chainActive.Height()) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Start or end is outside chain range");
+    }
+
+    startInfo.push_back(Pair("hash", chainActive[start]->GetBlockHash().GetHex()));
+    startInfo.push_back(Pair("height", start));
+
+    endInfo.push_back(Pair("hash", chainActive[end]->GetBlockHash().GetHex()));
+    endInfo.push_back(Pair("height", end));
+}
+
 UniValue getaddressmempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -780,6 +1144,76 @@ UniValue getaddressmempool(const JSONRPCRequest& request)
     return result;
 }
 
+//! The result of getaddressutxos. A paged request walks the index from the cursor and stops
+//! after one page, rather than reading and sorting every output of every address.
+static void writeAddressUtxos(const JSONRPCRequest& request, JSONWriter& writer)
+{
+    bool includeChainInfo = false;
+    if (request.params[0].isObject()) {
+        UniValue chainInfo = find_value(request.params[0].get_obj(), "chainInfo");
+        if (chainInfo.isBool()) {
+            includeChainInfo = chainInfo.get_bool();
+        }
+    }
+
+    std::vector<std::pair<uint160, int> > addresses;
+
+    if (!getAddressesFromParams(request.params, addresses)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+
+    int limit = 0;
+    std::string cursor;
+    bool fPaged = getAddressPaging(request.params, limit, cursor);
+
+    if (includeChainInfo || fPaged) {
+        writer.BeginObject();
+        writer.Key("utxos");
+    }
+    writer.BeginArray();
+    std::string next;
+    if (fPaged) {
+        next = scanAddressUnspent(addresses, limit, cursor, [&](const UniValue& output) {
+            writer.Value(output);
+        });
+    } else {
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+        }
+
+        std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+
+        for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
+            writer.Value(addressUnspentToJSON(it->first, it->second));
+        }
+    }
+    writer.EndArray();
+
+    if (includeChainInfo || fPaged) {
+        if (!next.empty()) {
+            writer.KeyValue("next", next);
+        }
+
+        if (includeChainInfo) {
+            // Writing may wait for the client, so don't do it under cs_main
+            uint256 hashTip;
+            int nHeight;
+            {
+                LOCK(cs_main);
+                hashTip = chainActive.Tip()->GetBlockHash();
+                nHeight = chainActive.Height();
+            }
+            writer.KeyValue("hash", hashTip.GetHex());
+            writer.KeyValue("height", nHeight);
+        }
+        writer.EndObject();
+    }
+}
+
 UniValue getaddressutxos(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -794,6 +1228,8 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "      ,...\n"
             "    ],\n"
             "  \"chainInfo\"  (boolean) Include chain info with results\n"
+            "  \"limit\"  (number, optional) Return at most this many outputs, in index order, as a page\n"
+            "  \"cursor\"  (string, optional) The \"next\" value of the previous page\n"
             "}\n"
             "\nResult\n"
             "[\n"
@@ -806,18 +1242,39 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "    \"satoshis\"  (number) The number of satoshis of the output\n"
             "  }\n"
             "]\n"
+            "\nResult (with limit)\n"
+            "{\n"
+            "  \"utxos\"  (array) The outputs, as above\n"
+            "  \"next\"  (string) The cursor of the next page, absent on the last page\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
             );
 
-    bool includeChainInfo = false;
-    if (request.params[0].isObject()) {
-        UniValue chainInfo = find_value(request.params[0].get_obj(), "chainInfo");
-        if (chainInfo.isBool()) {
-            includeChainInfo = chainInfo.get_bool();
-        }
-    }
+    UniValueWriter writer;
+    writeAddressUtxos(request, writer);
+    return writer.Result();
+}
+
+static bool getaddressutxos_stream(const JSONRPCRequest& request, JSONStreamWriter& writer)
+{
+    if (request.fHelp || request.params.size() != 1)
+        return false;
+
+    writeAddressUtxos(request, writer);
+    return true;
+}
+
+//! The result of getaddressdeltas, written while walking the index
+static void writeAddressDeltas(const JSONRPCRequest& request, JSONWriter& writer)
+{
+    UniValue chainInfo = find_value(request.params[0].get_obj(), "chainInfo");
+    bool includeChainInfo = chainInfo.isBool() && chainInfo.get_bool();
+
+    int start = 0;
+    int end = 0;
+    getAddressHeightRange(request.params, start, end, true);
 
     std::vector<std::pair<uint160, int> > addresses;
 
@@ -825,44 +1282,36 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    int limit = 0;
+    std::string cursor;
+    bool fPaged = getAddressPaging(request.params, limit, cursor);
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
+    // Look the range up first, an error can't be reported once the deltas are being streamed
+    bool fChainInfo = includeChainInfo && start > 0 && end > 0;
+    UniValue startInfo(UniValue::VOBJ);
+    UniValue endInfo(UniValue::VOBJ);
+    if (fChainInfo) {
+        addressRangeChainInfo(start, end, startInfo, endInfo);
     }
 
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
-
-    UniValue utxos(UniValue::VARR);
-
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
-        UniValue output(UniValue::VOBJ);
-        std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
-        }
-
-        output.push_back(Pair("address", address));
-        output.push_back(Pair("txid", it->first.txhash.GetHex()));
-        output.push_back(Pair("outputIndex", (int)it->first.index));
-        output.push_back(Pair("script", HexStr(it->second.script.begin(), it->second.script.end())));
-        output.push_back(Pair("satoshis", it->second.satoshis));
-        output.push_back(Pair("height", it->second.blockHeight));
-        utxos.push_back(output);
+    if (fChainInfo || fPaged) {
+        writer.BeginObject();
+        writer.Key("deltas");
     }
-
-    if (includeChainInfo) {
-        UniValue result(UniValue::VOBJ);
-        result.push_back(Pair("utxos", utxos));
-
-        LOCK(cs_main);
-        result.push_back(Pair("hash", chainActive.Tip()->GetBlockHash().GetHex()));
-        result.push_back(Pair("height", (int)chainActive.Height()));
-        return result;
-    } else {
-        return utxos;
+    writer.BeginArray();
+    std::string next = scanAddressDeltas(addresses, start, end, limit, cursor, [&](const UniValue& delta) {
+        writer.Value(delta);
+    });
+    writer.EndArray();
+    if (fChainInfo || fPaged) {
+        if (!next.empty()) {
+            writer.KeyValue("next", next);
+        }
+        if (fChainInfo) {
+            writer.KeyValue("start", startInfo);
+            writer.KeyValue("end", endInfo);
+        }
+        writer.EndObject();
     }
 }
 
@@ -879,9 +1328,11 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "      \"address\"  (string) The base58check encoded address\n"
             "      ,...\n"
             "    ]\n"
-            "  \"start\" (number) The start block height\n"
-            "  \"end\" (number) The end block height\n"
+            "  \"start\" (number, optional) The start block height, only applies together with end\n"
+            "  \"end\" (number, optional) The end block height, only applies together with start\n"
             "  \"chainInfo\" (boolean) Include chain info in results, only applies if start and end specified\n"
+            "  \"limit\" (number, optional) Return at most this many deltas as a page\n"
+            "  \"cursor\" (string, optional) The \"next\" value of the previous page\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -893,102 +1344,29 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "    \"address\"  (string) The base58check encoded address\n"
             "  }\n"
             "]\n"
+            "\nResult (with limit):\n"
+            "{\n"
+            "  \"deltas\"  (array) The deltas, as above\n"
+            "  \"next\"  (string) The cursor of the next page, absent on the last page\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
         );
 
 
-    UniValue startValue = find_value(request.params[0].get_obj(), "start");
-    UniValue endValue = find_value(request.params[0].get_obj(), "end");
-
-    UniValue chainInfo = find_value(request.params[0].get_obj(), "chainInfo");
-    bool includeChainInfo = false;
-    if (chainInfo.isBool()) {
-        includeChainInfo = chainInfo.get_bool();
-    }
-
-    int start = 0;
-    int end = 0;
-
-    if (startValue.isNum() && endValue.isNum()) {
-        start = startValue.get_int();
-        end = endValue.get_int();
-        if (start <= 0 || end <= 0) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Start and end is expected to be greater than zero");
-        }
-        if (end < start) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "End value is expected to be greater than start");
-        }
-    }
-
-    std::vector<std::pair<uint160, int> > addresses;
-
-    if (!getAddressesFromParams(request.params, addresses)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
-    }
-
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
-    }
-
-    UniValue deltas(UniValue::VARR);
-
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
-        }
-
-        UniValue delta(UniValue::VOBJ);
-        delta.push_back(Pair("satoshis", it->second));
-        delta.push_back(Pair("txid", it->first.txhash.GetHex()));
-        delta.push_back(Pair("index", (int)it->first.index));
-        delta.push_back(Pair("blockindex", (int)it->first.txindex));
-        delta.push_back(Pair("height", it->first.blockHeight));
-        delta.push_back(Pair("address", address));
-        deltas.push_back(delta);
-    }
-
-    UniValue result(UniValue::VOBJ);
-
-    if (includeChainInfo && start > 0 && end > 0) {
-        LOCK(cs_main);
-
-        if (start > chainActive.Height() || end > chainActive.Height()) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Start or end is outside chain range");
-        }
-
-        CBlockIndex* startIndex = chainActive[start];
-        CBlockIndex* endIndex = chainActive[end];
-
-        UniValue startInfo(UniValue::VOBJ);
-        UniValue endInfo(UniValue::VOBJ);
-
-        startInfo.push_back(Pair("hash", startIndex->GetBlockHash().GetHex()));
-        startInfo.push_back(Pair("height", start));
-
-        endInfo.push_back(Pair("hash", endIndex->GetBlockHash().GetHex()));
-        endInfo.push_back(Pair("height", end));
+    UniValueWriter writer;
+    writeAddressDeltas(request, writer);
+    return writer.Result();
+}
 
-        result.push_back(Pair("deltas", deltas));
-        result.push_back(Pair("start", startInfo));
-        result.push_back(Pair("end", endInfo));
+static bool getaddressdeltas_stream(const JSONRPCRequest& request, JSONStreamWriter& writer)
+{
+    if (request.fHelp || request.params.size() != 1 || !request.params[0].isObject())
+        return false;
 
-        return result;
-    } else {
-        return deltas;
-    }
+    writeAddressDeltas(request, writer);
+    return true;
 }
 
 UniValue getaddressbalance(const JSONRPCRequest& request)
@@ -1021,22 +1399,17 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-
     CAmount balance = 0;
     CAmount received = 0;
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        CAmount addressBalance = 0;
+        CAmount addressReceived = 0;
+        if (!GetAddressBalance((*it).first, (*it).second, addressBalance, addressReceived)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-        balance += it->second;
+        balance += addressBalance;
+        received += addressReceived;
     }
 
     UniValue result(UniValue::VOBJ);
@@ -1047,6 +1420,41 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
 
 }
 
+//! The result of getaddresstxids. The txids of a single address are written while walking
+//! the index, those of several addresses once they are sorted by height.
+static void writeAddressTxids(const JSONRPCRequest& request, JSONWriter& writer)
+{
+    std::vector<std::pair<uint160, int> > addresses;
+
+    if (!getAddressesFromParams(request.params, addresses)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+
+    int start = 0;
+    int end = 0;
+    getAddressHeightRange(request.params, start, end, false);
+
+    int limit = 0;
+    std::string cursor;
+    bool fPaged = getAddressPaging(request.params, limit, cursor);
+
+    if (fPaged) {
+        writer.BeginObject();
+        writer.Key("txids");
+    }
+    writer.BeginArray();
+    std::string next = scanAddressTxids(addresses, start, end, limit, cursor, [&](const std::string& txid) {
+        writer.Value(txid);
+    });
+    writer.EndArray();
+    if (fPaged) {
+        if (!next.empty()) {
+            writer.KeyValue("next", next);
+        }
+        writer.EndObject();
+    }
+}
+
 UniValue getaddresstxids(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -1060,74 +1468,38 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "      \"address\"  (string) The base58check encoded address\n"
             "      ,...\n"
             "    ]\n"
-            "  \"start\" (number) The start block height\n"
-            "  \"end\" (number) The end block height\n"
+            "  \"start\" (number, optional) The start block height, only applies together with end\n"
+            "  \"end\" (number, optional) The end block height, only applies together with start\n"
+            "  \"limit\" (number, optional) Return at most this many txids as a page, in the order of the full result\n"
+            "  \"cursor\" (string, optional) The \"next\" value of the previous page\n"
             "}\n"
             "\nResult:\n"
             "[\n"
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "\nResult (with limit):\n"
+            "{\n"
+            "  \"txids\"  (array) The transaction ids, as above\n"
+            "  \"next\"  (string) The cursor of the next page, absent on the last page\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
         );
 
-    std::vector<std::pair<uint160, int> > addresses;
-
-    if (!getAddressesFromParams(request.params, addresses)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
-    }
-
-    int start = 0;
-    int end = 0;
-    if (request.params[0].isObject()) {
-        UniValue startValue = find_value(request.params[0].get_obj(), "start");
-        UniValue endValue = find_value(request.params[0].get_obj(), "end");
-        if (startValue.isNum() && endValue.isNum()) {
-            start = startValue.get_int();
-            end = endValue.get_int();
-        }
-    }
-
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
-    }
-
-    std::set<std::pair<int, std::string> > txids;
-    UniValue result(UniValue::VARR);
-
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        int height = it->first.blockHeight;
-        std::string txid = it->first.txhash.GetHex();
-
-        if (addresses.size() > 1) {
-            txids.insert(std::make_pair(height, txid));
-        } else {
-            if (txids.insert(std::make_pair(height, txid)).second) {
-                result.push_back(txid);
-            }
-        }
-    }
-
-    if (addresses.size() > 1) {
-        for (std::set<std::pair<int, std::string> >::const_iterator it=txids.begin(); it!=txids.end(); it++) {
-            result.push_back(it->second);
-        }
-    }
+    UniValueWriter writer;
+    writeAddressTxids(request, writer);
+    return writer.Result();
+}
 
-    return result;
+static bool getaddresstxids_stream(const JSONRPCRequest& request, JSONStreamWriter& writer)
+{
+    if (request.fHelp || request.params.size() != 1)
+        return false;
 
+    writeAddressTxids(request, writer);
+    return true;
 }
 
 UniValue getspentinfo(const JSONRPCRequest& request)
@@ -1183,20 +1555,22 @@ static const CRPCCommand commands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "getinfo",                &getinfo,                {} }, /* uses wallet if enabled */
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
-    { "util",               "validateaddress",        &validateaddress,        {"address"} }, /* uses wallet if enabled */
+    { "control",            "getx20rstats",           &getx20rstats,           {} },
+    { "control",            "setx20rstats",           &setx20rstats,           {"enable","reset"} },
+    { "util",               "validateaddress",        &validateaddress,        {"address"}, true }, /* uses wallet if enabled */
     { "util",               "createmultisig",         &createmultisig,         {"nrequired","keys"} },
-    { "util",               "verifymessage",          &verifymessage,          {"address","signature","message"} },
+    { "util",               "verifymessage",          &verifymessage,          {"address","signature","message"}, true },
     { "util",               "signmessagewithprivkey", &signmessagewithprivkey, {"privkey","message"} },
 
     /* Address index */
-    { "addressindex",       "getaddressmempool",      &getaddressmempool,      {} },
-    { "addressindex",       "getaddressutxos",        &getaddressutxos,        {} },
-    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       {} },
-    { "addressindex",       "getaddresstxids",        &getaddresstxids,        {} },
-    { "addressindex",       "getaddressbalance",      &getaddressbalance,      {} },
+    { "addressindex",       "getaddressmempool",      &getaddressmempool,      {}, true },
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        {}, true },
+    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       {}, true },
+    { "addressindex",       "getaddresstxids",        &getaddresstxids,        {}, true },
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      {}, true },
 
     /* Blockchain */
-    { "blockchain",         "getspentinfo",           &getspentinfo,           {} },
+    { "blockchain",         "getspentinfo",           &getspentinfo,           {}, true },
 
     /* Not shown in help */
     { "hidden",             "setmocktime",            &setmocktime,            {"timestamp"}},
@@ -1209,4 +1583,8 @@ void RegisterMiscRPCCommands(CRPCTable &t)
 {
     for (unsigned int vcidx = 0; vcidx < ARRAYLEN(commands); vcidx++)
         t.appendCommand(commands[vcidx].name, &commands[vcidx]);
+
+    t.appendStreamCommand("getaddressutxos", &getaddressutxos_stream);
+    t.appendStreamCommand("getaddressdeltas", &getaddressdeltas_stream);
+    t.appendStreamCommand("getaddresstxids", &getaddresstxids_stream);
 }
@@ -37,6 +37,8 @@
 #include <univalue.h>
 #include <tinyformat.h>
 
+static void TxBlockToJSON(const uint256& hashBlock, UniValue& entry);
+
 void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry, bool expanded = false)
 {
     // Call into TxToUniv() in astral-common to decode the transaction hex.
@@ -93,6 +95,12 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry,
         entry.pushKV("vout", newVout);
     }
 
+    TxBlockToJSON(hashBlock, entry);
+}
+
+//! Where in the chain the block containing a transaction is, for TxToJSON
+static void TxBlockToJSON(const uint256& hashBlock, UniValue& entry)
+{
     if (!hashBlock.IsNull()) {
         entry.pushKV("blockhash", hashBlock.GetHex());
         BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
@@ -183,8 +191,6 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
             + HelpExampleRpc("getrawtransaction", "\"mytxid\", true")
         );
 
-    LOCK(cs_main);
-
     uint256 hash = ParseHashV(request.params[0], "parameter 1");
 
     // Accept either a bool (true) or a num (>=1) to indicate verbose output.
@@ -205,6 +211,7 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
         }
     }
 
+    // GetTransaction takes cs_main for the lookup, the transaction is encoded without it
     CTransactionRef tx;
 
     uint256 hashBlock;
@@ -217,7 +224,11 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
         return EncodeHexTx(*tx, RPCSerializationFlags());
 
     UniValue result(UniValue::VOBJ);
-    TxToJSON(*tx, hashBlock, result, true);
+    TxToJSON(*tx, uint256(), result, true);
+    {
+        LOCK(cs_main);
+        TxBlockToJSON(hashBlock, result);
+    }
 
     return result;
 }
@@ -1425,15 +1436,15 @@ UniValue sendrawtransaction(const JSONRPCRequest& request)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
-    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      {"txid","verbose"} },
+    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      {"txid","verbose"}, true },
     { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   {"inputs","outputs","locktime"} },
-    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   {"hexstring"} },
-    { "rawtransactions",    "decodescript",           &decodescript,           {"hexstring"} },
+    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   {"hexstring"}, true },
+    { "rawtransactions",    "decodescript",           &decodescript,           {"hexstring"}, true },
     { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     {"hexstring","allowhighfees"} },
     { "rawtransactions",    "combinerawtransaction",  &combinerawtransaction,  {"txs"} },
     { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     {"hexstring","prevtxs","privkeys","sighashtype"} }, /* uses wallet if enabled */
 
-    { "blockchain",         "gettxoutproof",          &gettxoutproof,          {"txids", "blockhash"} },
+    { "blockchain",         "gettxoutproof",          &gettxoutproof,          {"txids", "blockhash"}, true },
     { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       {"proof"} },
 };
 
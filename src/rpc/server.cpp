@@ -24,7 +24,10 @@
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 
+#include <condition_variable>
 #include <memory> // for unique_ptr
+#include <mutex>
+#include <set>
 #include <unordered_map>
 
 #include "assets/assets.h"
@@ -310,6 +313,15 @@ bool CRPCTable::appendCommand(const std::string& name, const CRPCCommand* pcmd)
     return true;
 }
 
+bool CRPCTable::appendStreamCommand(const std::string& name, rpcstreamfn_type fn)
+{
+    if (IsRPCRunning() || !mapCommands.count(name))
+        return false;
+
+    mapStreamCommands[name] = fn;
+    return true;
+}
+
 bool StartRPC()
 {
     LogPrint(BCLog::RPC, "Starting RPC\n");
@@ -418,11 +430,86 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
+static bool IsParallelBatchRequest(const UniValue& req)
+{
+    if (!req.isObject())
+        return false;
+    const UniValue& method = find_value(req, "method");
+    if (!method.isStr())
+        return false;
+    const CRPCCommand *pcmd = tableRPC[method.get_str()];
+    return pcmd && pcmd->fParallelBatch;
+}
+
+/** A run of batch elements, claimed one at a time by the threads executing them */
+struct CRPCBatchRun
+{
+    const JSONRPCRequest* jreq;
+    const UniValue* vReq;
+    const size_t nBegin;
+    const size_t nEnd;
+
+    std::mutex cs;
+    std::condition_variable cond;
+    //! Next element to claim
+    size_t nNext;
+    //! Elements claimed but not finished yet
+    size_t nRunning;
+    std::vector<UniValue> vResults;
+
+    CRPCBatchRun(const JSONRPCRequest& jreqIn, const UniValue& vReqIn, size_t nBeginIn, size_t nEndIn) :
+        jreq(&jreqIn), vReq(&vReqIn), nBegin(nBeginIn), nEnd(nEndIn), nNext(nBeginIn), nRunning(0), vResults(nEndIn - nBeginIn) {}
+};
+
+static void RunBatchElements(CRPCBatchRun& run)
+{
+    while (true) {
+        size_t i;
+        {
+            std::lock_guard<std::mutex> lock(run.cs);
+            // Once everything is claimed, jreq and vReq may go away with the caller
+            if (run.nNext == run.nEnd)
+                return;
+            i = run.nNext++;
+            run.nRunning++;
+        }
+        UniValue result = JSONRPCExecOne(*run.jreq, (*run.vReq)[i]);
+        std::lock_guard<std::mutex> lock(run.cs);
+        run.vResults[i - run.nBegin] = std::move(result);
+        if (--run.nRunning == 0)
+            run.cond.notify_all();
+    }
+}
+
+std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, const RPCWorkerRunner& runner)
 {
     UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+    size_t reqIdx = 0;
+    while (reqIdx < vReq.size()) {
+        size_t nEnd = reqIdx;
+        while (runner && nEnd < vReq.size() && IsParallelBatchRequest(vReq[nEnd]))
+            nEnd++;
+        if (nEnd - reqIdx < 2) {
+            ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx++]));
+            continue;
+        }
+
+        // Hand the run to idle workers and work through it on this thread as well, so it
+        // completes even if none of them gets to it
+        std::shared_ptr<CRPCBatchRun> run = std::make_shared<CRPCBatchRun>(jreq, vReq, reqIdx, nEnd);
+        for (size_t nHelpers = 0; nHelpers < nEnd - reqIdx - 1; nHelpers++) {
+            if (!runner([run]() { RunBatchElements(*run); }))
+                break;
+        }
+        RunBatchElements(*run);
+        {
+            std::unique_lock<std::mutex> lock(run->cs);
+            run->cond.wait(lock, [&run]() { return run->nRunning == 0; });
+        }
+        for (UniValue& result : run->vResults)
+            ret.push_back(std::move(result));
+        reqIdx = nEnd;
+    }
 
     return ret.write() + "\n";
 }
@@ -508,6 +595,39 @@ UniValue CRPCTable::execute(const JSONRPCRequest &request) const
     }
 }
 
+bool CRPCTable::executeStream(const JSONRPCRequest &request, JSONStreamWriter& writer) const
+{
+    std::map<std::string, rpcstreamfn_type>::const_iterator it = mapStreamCommands.find(request.strMethod);
+    if (it == mapStreamCommands.end())
+        return false;
+
+    // Return immediately if in warmup
+    {
+        LOCK(cs_rpcWarmup);
+        if (fRPCInWarmup)
+            throw JSONRPCError(RPC_IN_WARMUP, rpcWarmupStatus);
+    }
+
+    const CRPCCommand *pcmd = tableRPC[request.strMethod];
+    assert(pcmd);
+
+    g_rpcSignals.PreCommand(*pcmd);
+
+    try
+    {
+        // Execute, convert arguments to array if necessary
+        if (request.params.isObject()) {
+            return it->second(transformNamedArguments(request, pcmd->argNames), writer);
+        } else {
+            return it->second(request, writer);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+}
+
 std::vector<std::string> CRPCTable::listCommands() const
 {
     std::vector<std::string> commandList;
@@ -8,13 +8,16 @@
 #define RAVEN_RPCSERVER_H
 
 #include "amount.h"
+#include "rpc/jsonstream.h"
 #include "rpc/protocol.h"
 #include "uint256.h"
 
+#include <functional>
 #include <list>
 #include <map>
 #include <stdint.h>
 #include <string>
+#include <utility>
 
 #include <univalue.h>
 
@@ -127,14 +130,29 @@ void RPCUnsetTimerInterface(RPCTimerInterface *iface);
 void RPCRunLater(const std::string& name, std::function<void(void)> func, int64_t nSeconds);
 
 typedef UniValue(*rpcfn_type)(const JSONRPCRequest& jsonRequest);
+/**
+ * Writes the result of a call to writer as it is produced, instead of returning it.
+ * Returns false, before writing anything, to leave calls it doesn't handle to the
+ * regular actor.
+ */
+typedef bool(*rpcstreamfn_type)(const JSONRPCRequest& jsonRequest, JSONStreamWriter& writer);
 
 class CRPCCommand
 {
 public:
+    CRPCCommand(std::string categoryIn, std::string nameIn, rpcfn_type actorIn, std::vector<std::string> argNamesIn, bool fParallelBatchIn = false) :
+        category(std::move(categoryIn)), name(std::move(nameIn)), actor(actorIn), argNames(std::move(argNamesIn)), fParallelBatch(fParallelBatchIn) {}
+
     std::string category;
     std::string name;
     rpcfn_type actor;
     std::vector<std::string> argNames;
+    /**
+     * Only reads state and is safe to run next to other such calls. Consecutive batch elements
+     * calling these may complete in any order; anything else in a batch acts as a barrier, so a
+     * call still sees the effects of every state changing call before it.
+     */
+    bool fParallelBatch;
 };
 
 /**
@@ -144,6 +162,7 @@ class CRPCTable
 {
 private:
     std::map<std::string, const CRPCCommand*> mapCommands;
+    std::map<std::string, rpcstreamfn_type> mapStreamCommands;
 public:
     CRPCTable();
     const CRPCCommand* operator[](const std::string& name) const;
@@ -157,6 +176,16 @@ public:
      */
     UniValue execute(const JSONRPCRequest &request) const;
 
+    /**
+     * Execute a method that can stream its result.
+     * @param request The JSONRPCRequest to execute
+     * @param writer Receives the result, a single JSON value
+     * @returns false, without writing anything, if the call has to go through execute().
+     * @throws an exception (UniValue) when an error happens, possibly after part of
+     * the result was written.
+     */
+    bool executeStream(const JSONRPCRequest &request, JSONStreamWriter& writer) const;
+
     /**
     * Returns a list of registered commands
     * @returns List of registered commands.
@@ -170,6 +199,12 @@ public:
      * Commands cannot be overwritten (returns false).
      */
     bool appendCommand(const std::string& name, const CRPCCommand* pcmd);
+
+    /**
+     * Registers a streaming variant of an already appended command.
+     * Returns false if RPC server is already running or there is no such command.
+     */
+    bool appendStreamCommand(const std::string& name, rpcstreamfn_type fn);
 };
 
 bool IsDeprecatedRPCEnabled(const std::string& method);
@@ -192,7 +227,13 @@ extern std::string HelpExampleRpc(const std::string& methodname, const std::stri
 bool StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq);
+/** Queues a function on another thread, returns false if it can't right now */
+typedef std::function<bool(std::function<void()>)> RPCWorkerRunner;
+/**
+ * Execute a batch request. If runner is given, consecutive read-only calls are spread over
+ * the threads it hands out; results are returned in request order either way.
+ */
+std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, const RPCWorkerRunner& runner = nullptr);
 
 // Retrieves any serialization flags requested in command line argument
 int RPCSerializationFlags();
@@ -116,6 +116,7 @@ struct PrecomputedTransactionData
     uint256 hashPrevouts, hashSequence, hashOutputs;
     bool ready = false;
 
+    PrecomputedTransactionData() = default;
     explicit PrecomputedTransactionData(const CTransaction& tx);
 };
 
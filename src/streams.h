@@ -139,6 +139,59 @@ private:
     size_t nPos;
 };
 
+/* Minimal stream for reading from an existing byte range without copying it
+ *
+ * The referenced memory must outlive the reader.
+ */
+class CSpanReader
+{
+ public:
+
+/*
+ * @param[in]  nTypeIn Serialization Type
+ * @param[in]  nVersionIn Serialization Version (including any flags)
+ * @param[in]  pbeginIn, pendIn  Range of bytes to read from
+*/
+    CSpanReader(int nTypeIn, int nVersionIn, const char* pbeginIn, const char* pendIn) : nType(nTypeIn), nVersion(nVersionIn), pbegin(pbeginIn), pend(pendIn) {}
+
+    template<typename T>
+    CSpanReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+    void read(char* pch, size_t nSize)
+    {
+        if (nSize > size()) {
+            throw std::ios_base::failure("CSpanReader::read(): end of data");
+        }
+        memcpy(pch, pbegin, nSize);
+        pbegin += nSize;
+    }
+    int GetVersion() const
+    {
+        return nVersion;
+    }
+    int GetType() const
+    {
+        return nType;
+    }
+    size_t size() const
+    {
+        return pend - pbegin;
+    }
+    bool empty() const
+    {
+        return pbegin == pend;
+    }
+private:
+    const int nType;
+    const int nVersion;
+    const char* pbegin;
+    const char* const pend;
+};
+
 /** Double ended buffer combining vector and stream-like interfaces.
  *
  * >> and << read and write unformatted data using the above serialization templates.
@@ -242,6 +295,8 @@ public:
     const_reference operator[](size_type pos) const  { return vch[pos + nReadPos]; }
     reference operator[](size_type pos)              { return vch[pos + nReadPos]; }
     void clear()                                     { vch.clear(); nReadPos = 0; }
+    //! Exchange the underlying buffer with v, so that its allocation can be handed on
+    void swap(vector_type& v)                        { vch.swap(v); nReadPos = 0; }
     iterator insert(iterator it, const char& x=char()) { return vch.insert(it, x); }
     void insert(iterator it, size_type n, const char& x) { vch.insert(it, n, x); }
     value_type* data()                               { return vch.data() + nReadPos; }
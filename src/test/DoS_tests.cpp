@@ -6,12 +6,16 @@
 // Unit tests for denial-of-service detection/prevention code
 
 #include "chainparams.h"
+#include "hash.h"
 #include "keystore.h"
+#include "merkleblock.h"
 #include "net.h"
 #include "net_processing.h"
+#include "netmessagemaker.h"
 #include "pow.h"
 #include "script/sign.h"
 #include "serialize.h"
+#include "streams.h"
 #include "util.h"
 #include "validation.h"
 
@@ -179,6 +183,154 @@ BOOST_AUTO_TEST_CASE(DoS_bantime)
     peerLogic->FinalizeNode(dummyNode.GetId(), dummy);
 }
 
+// Queue a message on a node as if it had been received from the network
+static void QueueMessage(CNode& node, const CSerializedNetMsg& msg)
+{
+    std::vector<unsigned char> wire;
+    AppendWireMessage(wire, msg);
+
+    CNetMessage netmsg(Params().MessageStart(), SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_REQUIRE_EQUAL(netmsg.readHeader((const char*)wire.data(), CMessageHeader::HEADER_SIZE), (int)CMessageHeader::HEADER_SIZE);
+    BOOST_REQUIRE_EQUAL(netmsg.readData((const char*)wire.data() + CMessageHeader::HEADER_SIZE, msg.data.size()), (int)msg.data.size());
+    BOOST_REQUIRE(netmsg.complete());
+
+    LOCK(node.cs_vProcessMsg);
+    node.nProcessQueueSize += netmsg.vRecv.size() + CMessageHeader::HEADER_SIZE;
+    node.vProcessMsg.push_back(std::move(netmsg));
+}
+
+BOOST_AUTO_TEST_CASE(parallel_message_pass)
+{
+    std::atomic<bool> interruptDummy(false);
+
+    CAddress addr(ip(0xa0b0c002), NODE_NONE);
+    CNode dummyNode(id++, NODE_NETWORK, 0, INVALID_SOCKET, addr, 5, 5, CAddress(), "", true);
+    dummyNode.SetSendVersion(PROTOCOL_VERSION);
+    dummyNode.SetRecvVersion(PROTOCOL_VERSION);
+    peerLogic->InitializeNode(&dummyNode);
+    dummyNode.nVersion = PROTOCOL_VERSION;
+    dummyNode.fSuccessfullyConnected = true;
+
+    CKey key;
+    key.MakeNewKey(true);
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout.n = 0;
+    mtx.vin[0].prevout.hash = InsecureRand256();
+    mtx.vin[0].scriptSig << OP_1;
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = 1*CENT;
+    mtx.vout[0].scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+    CTransactionRef tx = MakeTransactionRef(mtx);
+
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    QueueMessage(dummyNode, msgMaker.Make(NetMsgType::PING, (uint64_t)42));
+    QueueMessage(dummyNode, msgMaker.Make(NetMsgType::TX, *tx));
+    std::vector<CNode*> vNodes{&dummyNode};
+
+    // The ping is answered by the parallel pass
+    peerLogic->ProcessMessagesParallel(vNodes, interruptDummy);
+    BOOST_CHECK_EQUAL(dummyNode.vProcessMsg.size(), 1U);
+    BOOST_CHECK(!dummyNode.vSendMsg.empty());
+    {
+        // Drop the pong, a peer with a full send queue is skipped
+        LOCK(dummyNode.cs_vSend);
+        dummyNode.vSendMsg.clear();
+        dummyNode.nSendSize = 0;
+        dummyNode.fPauseSend = false;
+    }
+
+    // The transaction is only deserialized, and stays queued for the serial pass
+    peerLogic->ProcessMessagesParallel(vNodes, interruptDummy);
+    BOOST_CHECK_EQUAL(dummyNode.vProcessMsg.size(), 1U);
+    BOOST_REQUIRE(dummyNode.txPreparsed);
+    BOOST_CHECK(dummyNode.txPreparsed->GetHash() == tx->GetHash());
+
+    // which takes it along with the message
+    peerLogic->ProcessMessages(&dummyNode, interruptDummy);
+    BOOST_CHECK(dummyNode.vProcessMsg.empty());
+    BOOST_CHECK(!dummyNode.txPreparsed);
+    BOOST_CHECK(dummyNode.filterInventoryKnown.contains(tx->GetHash()));
+    {
+        LOCK(cs_main);
+        EraseOrphansFor(dummyNode.GetId());
+    }
+
+    bool dummy;
+    peerLogic->FinalizeNode(dummyNode.GetId(), dummy);
+}
+
+// Take everything queued for sending to node
+static std::vector<unsigned char> TakeSentData(CNode& node)
+{
+    std::vector<unsigned char> vData;
+    LOCK(node.cs_vSend);
+    for (const auto& data : node.vSendMsg)
+        vData.insert(vData.end(), data.begin(), data.end());
+    node.vSendMsg.clear();
+    node.nSendSize = 0;
+    node.fPauseSend = false;
+    return vData;
+}
+
+BOOST_FIXTURE_TEST_CASE(getdata_raw_block, TestChain100Setup)
+{
+    std::atomic<bool> interruptDummy(false);
+
+    CAddress addr(ip(0xa0b0c003), NODE_NONE);
+    CNode dummyNode(id++, NODE_NETWORK, 0, INVALID_SOCKET, addr, 6, 6, CAddress(), "", true);
+    dummyNode.SetSendVersion(PROTOCOL_VERSION);
+    dummyNode.SetRecvVersion(PROTOCOL_VERSION);
+    peerLogic->InitializeNode(&dummyNode);
+    dummyNode.nVersion = PROTOCOL_VERSION;
+    dummyNode.fSuccessfullyConnected = true;
+
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+
+    // The genesis block has no witnesses, the coinbases mined by the fixture carry the witness nonce.
+    // Each block is requested once with its witness flag cleared, as for an index from before the
+    // flag was kept, and once with it recorded.
+    for (int nHeight : {0, 50}) {
+        CBlockIndex* pindex = chainActive[nHeight];
+        CBlock block;
+        BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+        const bool fHaveWitness = nHeight > 0;
+        BOOST_CHECK_EQUAL(block.vtx[0]->HasWitness(), fHaveWitness);
+
+        // What the serializing path sends. The default filter of the node matches every transaction.
+        std::vector<unsigned char> vBlock, vWitnessBlock, vFilteredBlock;
+        AppendWireMessage(vBlock, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, block));
+        AppendWireMessage(vWitnessBlock, msgMaker.Make(NetMsgType::BLOCK, block));
+        CBloomFilter filter;
+        CMerkleBlock merkleBlock(block, filter);
+        AppendWireMessage(vFilteredBlock, msgMaker.Make(NetMsgType::MERKLEBLOCK, merkleBlock));
+        for (const auto& pair : merkleBlock.vMatchedTxn)
+            AppendWireMessage(vFilteredBlock, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::TX, *block.vtx[pair.first]));
+
+        for (bool fKnown : {false, true}) {
+            if (!fKnown) {
+                LOCK(cs_main);
+                pindex->nStatus &= ~(BLOCK_WITNESS_KNOWN | BLOCK_HAVE_WITNESS);
+            }
+            for (const auto& request : std::vector<std::pair<int, const std::vector<unsigned char>*> >{
+                     {MSG_BLOCK, &vBlock}, {MSG_WITNESS_BLOCK, &vWitnessBlock}, {MSG_FILTERED_BLOCK, &vFilteredBlock}}) {
+                std::vector<CInv> vInv{CInv(request.first, block.GetHash())};
+                QueueMessage(dummyNode, msgMaker.Make(NetMsgType::GETDATA, vInv));
+                peerLogic->ProcessMessages(&dummyNode, interruptDummy);
+                BOOST_CHECK(dummyNode.vProcessMsg.empty());
+                BOOST_CHECK(TakeSentData(dummyNode) == *request.second);
+            }
+            // MSG_BLOCK recorded whether the block has witnesses
+            LOCK(cs_main);
+            BOOST_CHECK(pindex->nStatus & BLOCK_WITNESS_KNOWN);
+            BOOST_CHECK_EQUAL((pindex->nStatus & BLOCK_HAVE_WITNESS) != 0, fHaveWitness);
+        }
+    }
+
+    bool dummy;
+    peerLogic->FinalizeNode(dummyNode.GetId(), dummy);
+}
+
 CTransactionRef RandomOrphan()
 {
     std::map<uint256, COrphanTx>::iterator it;
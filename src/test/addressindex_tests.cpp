@@ -0,0 +1,76 @@
+// Copyright (c) 2017 The Astral Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "addressindex.h"
+#include "txdb.h"
+#include "uint256.h"
+#include "test/test_astral.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(addressindex_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(address_balance_index)
+{
+    CBlockTreeDB db(1 << 20, true);
+
+    uint160 hashA(std::vector<unsigned char>(20, 0x11));
+    uint160 hashB(std::vector<unsigned char>(20, 0x22));
+    uint256 txid1 = uint256S("01");
+    uint256 txid2 = uint256S("02");
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > block1;
+    block1.push_back(std::make_pair(CAddressIndexKey(1, hashA, 1, 0, txid1, 0, false), 50 * COIN));
+    block1.push_back(std::make_pair(CAddressIndexKey(2, hashB, 1, 0, txid1, 1, false), 10 * COIN));
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > block2;
+    block2.push_back(std::make_pair(CAddressIndexKey(1, hashA, 2, 1, txid2, 0, true), -50 * COIN));
+    block2.push_back(std::make_pair(CAddressIndexKey(1, hashA, 2, 1, txid2, 0, false), 20 * COIN));
+
+    CAddressBalanceValue value;
+    BOOST_CHECK(db.WriteAddressIndex(block1));
+    BOOST_CHECK(db.WriteAddressIndex(block2));
+
+    BOOST_CHECK(db.ReadAddressBalance(hashA, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 20 * COIN);
+    BOOST_CHECK_EQUAL(value.received, 70 * COIN);
+    BOOST_CHECK(db.ReadAddressBalance(hashB, 2, value));
+    BOOST_CHECK_EQUAL(value.balance, 10 * COIN);
+    BOOST_CHECK_EQUAL(value.received, 10 * COIN);
+
+    // Same hash under another address type is a different address
+    BOOST_CHECK(db.ReadAddressBalance(hashB, 1, value));
+    BOOST_CHECK(value.IsNull());
+
+    // Writing entries that are already indexed must not count them twice when checking
+    BOOST_CHECK(db.WriteAddressIndex(block2, true));
+    BOOST_CHECK(db.ReadAddressBalance(hashA, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 20 * COIN);
+    BOOST_CHECK_EQUAL(value.received, 70 * COIN);
+
+    // Disconnecting block 2 restores the block 1 totals
+    BOOST_CHECK(db.EraseAddressIndex(block2));
+    BOOST_CHECK(db.ReadAddressBalance(hashA, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 50 * COIN);
+    BOOST_CHECK_EQUAL(value.received, 50 * COIN);
+
+    // Rebuilding from the index gives the same totals as incremental updates
+    BOOST_CHECK(db.WriteAddressIndex(block2));
+    CAddressBalanceValue before;
+    BOOST_CHECK(db.ReadAddressBalance(hashA, 1, before));
+    BOOST_CHECK(db.BuildAddressBalanceIndex());
+    BOOST_CHECK(db.ReadAddressBalance(hashA, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, before.balance);
+    BOOST_CHECK_EQUAL(value.received, before.received);
+
+    // Removing everything drops the records
+    BOOST_CHECK(db.EraseAddressIndex(block2));
+    BOOST_CHECK(db.EraseAddressIndex(block1));
+    BOOST_CHECK(db.ReadAddressBalance(hashA, 1, value));
+    BOOST_CHECK(value.IsNull());
+    BOOST_CHECK(db.ReadAddressBalance(hashB, 2, value));
+    BOOST_CHECK(value.IsNull());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -41,7 +41,8 @@ BOOST_FIXTURE_TEST_SUITE(asset_reissue_tests, BasicTestingSetup)
     // Check to see if the reissue changed the cache data correctly
     BOOST_CHECK_MESSAGE(cache.mapReissuedAssetData.count("ASTRALASSET"), "Map Reissued Asset should contain the asset \"ASTRALASSET\"");
     BOOST_CHECK_MESSAGE(cache.mapAssetsAddressAmount.at(make_pair("ASTRALASSET", Params().GlobalBurnAddress())) == CAmount(101 * COIN), "Reissued amount wasn't added to the previous total");
-    BOOST_CHECK_MESSAGE(cache.mapAssetsAddresses.at("ASTRALASSET").count(Params().GlobalBurnAddress()), "Reissued address wasn't in the map");
+    std::set<std::string> setAddresses;
+    BOOST_CHECK_MESSAGE(cache.GetAssetAddresses("ASTRALASSET", setAddresses) && setAddresses.count(Params().GlobalBurnAddress()), "Reissued address wasn't a holder");
 
     // Get the new asset data from the cache
     CNewAsset asset2;
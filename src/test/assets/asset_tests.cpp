@@ -13,6 +13,163 @@
 #include <base58.h>
 #include <chainparams.h>
 
+#include <regex>
+
+#include <boost/algorithm/string.hpp>
+
+namespace {
+
+// The std::regex based name validation the hand written matcher in assets.cpp replaced, kept as a reference
+namespace regex_reference {
+
+const std::regex ROOT_NAME_CHARACTERS("^[A-Z0-9._]{3,}$");
+const std::regex SUB_NAME_CHARACTERS("^[A-Z0-9._]+$");
+const std::regex UNIQUE_TAG_CHARACTERS("^[-A-Za-z0-9@$%&*()[\\]{}_.?:]+$");
+const std::regex CHANNEL_TAG_CHARACTERS("^[A-Z0-9._]+$");
+const std::regex VOTE_TAG_CHARACTERS("^[A-Z0-9._]+$");
+
+const std::regex DOUBLE_PUNCTUATION("^.*[._]{2,}.*$");
+const std::regex LEADING_PUNCTUATION("^[._].*$");
+const std::regex TRAILING_PUNCTUATION("^.*[._]$");
+
+const std::regex UNIQUE_INDICATOR(R"(^[^^~#!]+#[^~#!\/]+$)");
+const std::regex CHANNEL_INDICATOR(R"(^[^^~#!]+~[^~#!\/]+$)");
+const std::regex OWNER_INDICATOR(R"(^[^^~#!]+!$)");
+const std::regex VOTE_INDICATOR(R"(^[^^~#!]+\^[^~#!\/]+$)");
+
+const std::regex RAVEN_NAMES("^ASTRAL$|^RAVEN$|^RAVENCOIN$");
+
+const size_t MAX_NAME_LENGTH = 31;
+const size_t MAX_CHANNEL_NAME_LENGTH = 12;
+
+bool IsRootNameValid(const std::string& name)
+{
+    return std::regex_match(name, ROOT_NAME_CHARACTERS)
+        && !std::regex_match(name, DOUBLE_PUNCTUATION)
+        && !std::regex_match(name, LEADING_PUNCTUATION)
+        && !std::regex_match(name, TRAILING_PUNCTUATION)
+        && !std::regex_match(name, RAVEN_NAMES);
+}
+
+bool IsSubNameValid(const std::string& name)
+{
+    return std::regex_match(name, SUB_NAME_CHARACTERS)
+        && !std::regex_match(name, DOUBLE_PUNCTUATION)
+        && !std::regex_match(name, LEADING_PUNCTUATION)
+        && !std::regex_match(name, TRAILING_PUNCTUATION);
+}
+
+bool IsChannelTagValid(const std::string& tag)
+{
+    return std::regex_match(tag, CHANNEL_TAG_CHARACTERS)
+        && !std::regex_match(tag, DOUBLE_PUNCTUATION)
+        && !std::regex_match(tag, LEADING_PUNCTUATION)
+        && !std::regex_match(tag, TRAILING_PUNCTUATION);
+}
+
+bool IsNameValidBeforeTag(const std::string& name)
+{
+    std::vector<std::string> parts;
+    boost::split(parts, name, boost::is_any_of("/"));
+
+    if (!IsRootNameValid(parts.front())) return false;
+
+    for (unsigned long i = 1; i < parts.size(); i++) {
+        if (!IsSubNameValid(parts[i])) return false;
+    }
+
+    return true;
+}
+
+bool IsAssetNameASubasset(const std::string& name)
+{
+    std::vector<std::string> parts;
+    boost::split(parts, name, boost::is_any_of("/"));
+
+    if (!IsRootNameValid(parts.front())) return false;
+
+    return parts.size() > 1;
+}
+
+bool IsTypeCheckNameValid(const AssetType type, const std::string& name, std::string& error)
+{
+    std::vector<std::string> parts;
+    if (type == AssetType::UNIQUE) {
+        if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
+        boost::split(parts, name, boost::is_any_of("#"));
+        bool valid = IsNameValidBeforeTag(parts.front()) && std::regex_match(parts.back(), UNIQUE_TAG_CHARACTERS);
+        if (!valid) { error = "Unique name contains invalid characters (Valid characters are: A-Z a-z 0-9 @ $ % & * ( ) [ ] { } _ . ? : -)";  return false; }
+        return true;
+    } else if (type == AssetType::MSGCHANNEL) {
+        if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
+        boost::split(parts, name, boost::is_any_of("~"));
+        bool valid = IsNameValidBeforeTag(parts.front()) && IsChannelTagValid(parts.back());
+        if (parts.back().size() > MAX_CHANNEL_NAME_LENGTH) { error = "Channel name is greater than max length of " + std::to_string(MAX_CHANNEL_NAME_LENGTH); return false; }
+        if (!valid) { error = "Message Channel name contains invalid characters (Valid characters are: A-Z 0-9 _ .) (special characters can't be the first or last characters)";  return false; }
+        return true;
+    } else if (type == AssetType::OWNER) {
+        if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
+        bool valid = IsNameValidBeforeTag(name.substr(0, name.size() - 1));
+        if (!valid) { error = "Owner name contains invalid characters (Valid characters are: A-Z 0-9 _ .) (special characters can't be the first or last characters)";  return false; }
+        return true;
+    } else if (type == AssetType::VOTE) {
+        if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
+        boost::split(parts, name, boost::is_any_of("^"));
+        bool valid = IsNameValidBeforeTag(parts.front()) && std::regex_match(parts.back(), VOTE_TAG_CHARACTERS);
+        if (!valid) { error = "Vote name contains invalid characters (Valid characters are: A-Z 0-9 _ .) (special characters can't be the first or last characters)";  return false; }
+        return true;
+    } else {
+        if (name.size() > MAX_NAME_LENGTH - 1) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH - 1); return false; }
+        if (!IsAssetNameASubasset(name) && name.size() < MIN_ASSET_LENGTH) { error = "Name must be contain " + std::to_string(MIN_ASSET_LENGTH) + " characters"; return false; }
+        bool valid = IsNameValidBeforeTag(name);
+        if (!valid && IsAssetNameASubasset(name) && name.size() < 3) { error = "Name must have at least 3 characters (Valid characters are: A-Z 0-9 _ .)";  return false; }
+        if (!valid) { error = "Name contains invalid characters (Valid characters are: A-Z 0-9 _ .) (special characters can't be the first or last characters)";  return false; }
+        return true;
+    }
+}
+
+bool IsAssetNameValid(const std::string& name, AssetType& assetType, std::string& error)
+{
+    AssetType type;
+    if (std::regex_match(name, UNIQUE_INDICATOR))
+        type = AssetType::UNIQUE;
+    else if (std::regex_match(name, CHANNEL_INDICATOR))
+        type = AssetType::MSGCHANNEL;
+    else if (std::regex_match(name, OWNER_INDICATOR))
+        type = AssetType::OWNER;
+    else if (std::regex_match(name, VOTE_INDICATOR))
+        type = AssetType::VOTE;
+    else
+        type = IsAssetNameASubasset(name) ? AssetType::SUB : AssetType::ROOT;
+
+    bool ret = regex_reference::IsTypeCheckNameValid(type, name, error);
+    assetType = ret ? type : AssetType::INVALID;
+    return ret;
+}
+
+} // namespace regex_reference
+
+//! Random names built mostly from pieces that can form valid names, so all the branches get exercised
+std::string RandomAssetName()
+{
+    static const char* pieces[] = {"A", "Z", "0", "9", "ABC", "TEST", "ASTRAL", "RAVEN", "RAVENCOIN", "a", "z",
+                                   ".", "_", "/", "#", "~", "!", "^", "-", "@", "$", "%", "&", "*", "(", ")",
+                                   "[", "]", "{", "}", "?", ":", " ", "\n", "\\", "'"};
+
+    std::string name;
+    int nPieces = InsecureRandRange(12);
+    for (int i = 0; i < nPieces; i++) {
+        if (InsecureRandRange(8) == 0)
+            name += (char)InsecureRandBits(8);
+        else
+            name += pieces[InsecureRandRange(sizeof(pieces) / sizeof(pieces[0]))];
+    }
+
+    return name;
+}
+
+} // namespace
+
 BOOST_FIXTURE_TEST_SUITE(asset_tests, BasicTestingSetup)
 
     BOOST_AUTO_TEST_CASE(unit_validation_tests) {
@@ -170,6 +327,30 @@ BOOST_FIXTURE_TEST_SUITE(asset_tests, BasicTestingSetup)
         BOOST_CHECK(GetParentName("TEST/SUB/SUB~CHANNEL") == "TEST/SUB/SUB");
     }
 
+    BOOST_AUTO_TEST_CASE(name_validation_matches_regex) {
+        for (int i = 0; i < 20000; i++) {
+            std::string name = RandomAssetName();
+
+            AssetType type, refType;
+            std::string error, refError;
+            bool valid = IsAssetNameValid(name, type, error);
+            bool refValid = regex_reference::IsAssetNameValid(name, refType, refError);
+
+            BOOST_CHECK_MESSAGE(valid == refValid && type == refType && error == refError, "Name validation differs for \"" + name + "\"");
+            BOOST_CHECK(IsAssetNameAnOwner(name) == (refValid && std::regex_match(name, regex_reference::OWNER_INDICATOR)));
+
+            for (auto assetType : {AssetType::ROOT, AssetType::SUB, AssetType::UNIQUE, AssetType::MSGCHANNEL, AssetType::OWNER, AssetType::VOTE}) {
+                error.clear();
+                refError.clear();
+                valid = IsTypeCheckNameValid(assetType, name, error);
+                refValid = regex_reference::IsTypeCheckNameValid(assetType, name, refError);
+                BOOST_CHECK_MESSAGE(valid == refValid && error == refError, "Type checked name validation differs for \"" + name + "\"");
+            }
+
+            BOOST_CHECK(IsUniqueTagValid(name) == std::regex_match(name, regex_reference::UNIQUE_TAG_CHARACTERS));
+        }
+    }
+
     BOOST_AUTO_TEST_CASE(transfer_asset_coin_check) {
 
         SelectParams(CBaseChainParams::MAIN);
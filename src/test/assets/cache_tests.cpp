@@ -1,7 +1,13 @@
 
 #include "assets/assets.h"
+#include "assets/assetdb.h"
+#include "arith_uint256.h"
+#include "validation.h"
 #include <boost/test/unit_test.hpp>
 #include <test/test_astral.h>
+#include <chainparams.h>
+
+#include <thread>
 
 BOOST_FIXTURE_TEST_SUITE(cache_tests, BasicTestingSetup)
 
@@ -36,5 +42,274 @@ BOOST_AUTO_TEST_CASE(cache_test)
 
 }
 
+BOOST_AUTO_TEST_CASE(meta_cache_test)
+{
+    CAssetsMetaCache cache(ASSETS_CACHE_SHARDS * 2, ASSETS_CACHE_SHARDS);
+
+    CNewAsset asset("METACACHE", CAmount(1), 0, 0, 1, "43f81c6f2c0593bde5a85e09ae662816eca80797");
+    CAssetsMetaCache::DataRef data;
+    uint64_t nGeneration;
+    BOOST_CHECK(!cache.Lookup("METACACHE", data, &nGeneration));
+
+    // Names known to not exist are cached as a null entry
+    cache.PutAbsent("METACACHE", nGeneration);
+    BOOST_CHECK(cache.Lookup("METACACHE", data) && !data);
+    BOOST_CHECK(cache.Size() == 0);
+
+    // Adding the asset replaces the absent entry
+    cache.Put(asset.strName, CDatabasedAssetData(asset, 10, uint256()));
+    BOOST_CHECK(cache.Lookup("METACACHE", data) && data && data->asset.strName == "METACACHE" && data->nHeight == 10);
+    BOOST_CHECK(cache.Size() == 1);
+
+    // References handed out stay valid after the entry is dropped
+    cache.Erase("METACACHE");
+    CAssetsMetaCache::DataRef missing;
+    BOOST_CHECK(!cache.Lookup("METACACHE", missing));
+    BOOST_CHECK(data->asset.strName == "METACACHE");
+
+    CAssetsMetaCache::Stats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nHits, 1U);
+    BOOST_CHECK_EQUAL(stats.nAbsentHits, 1U);
+    BOOST_CHECK_EQUAL(stats.nMisses, 2U);
+    BOOST_CHECK_EQUAL(stats.nEntries, 0U);
+
+    // Absent names are bounded on their own and can't evict assets
+    for (int i = 0; i < 1000; i++) {
+        BOOST_CHECK(!cache.Lookup("ABSENT" + std::to_string(i), missing, &nGeneration));
+        cache.PutAbsent("ABSENT" + std::to_string(i), nGeneration);
+    }
+    cache.Put(asset.strName, CDatabasedAssetData(asset, 10, uint256()));
+    for (int i = 1000; i < 2000; i++) {
+        BOOST_CHECK(!cache.Lookup("ABSENT" + std::to_string(i), missing, &nGeneration));
+        cache.PutAbsent("ABSENT" + std::to_string(i), nGeneration);
+    }
+    stats = cache.GetStats();
+    BOOST_CHECK(stats.nAbsentEntries <= ASSETS_CACHE_SHARDS);
+    BOOST_CHECK(cache.Lookup("METACACHE", data) && data);
+}
+
+BOOST_AUTO_TEST_CASE(meta_cache_race_test)
+{
+    CAssetsMetaCache cache(ASSETS_CACHE_SHARDS * 2, ASSETS_CACHE_SHARDS * 2);
+    CNewAsset asset("RACEASSET", CAmount(1), 0, 0, 1, "");
+    CNewAsset reissued("RACEASSET", CAmount(2), 0, 0, 1, "");
+    CAssetsMetaCache::DataRef data;
+    uint64_t nGeneration;
+
+    // A reader misses, the asset is written and cached, then the reader's database miss arrives late
+    BOOST_CHECK(!cache.Lookup("RACEASSET", data, &nGeneration));
+    cache.Put(asset.strName, CDatabasedAssetData(asset, 1, uint256()));
+    cache.PutAbsent("RACEASSET", nGeneration);
+    BOOST_CHECK(cache.Lookup("RACEASSET", data) && data && data->asset.nAmount == 1);
+
+    // An absent entry never replaces a known one, whatever the generation
+    BOOST_CHECK(!cache.Lookup("RACEOTHER", data, &nGeneration));
+    cache.PutAbsent("RACEASSET", nGeneration);
+    BOOST_CHECK(cache.Lookup("RACEASSET", data) && data);
+
+    // A reader reads the old meta data, then a reissue is written and the name erased
+    cache.Erase("RACEASSET");
+    BOOST_CHECK(!cache.Lookup("RACEASSET", data, &nGeneration));
+    cache.Erase("RACEASSET");
+    cache.PutLoaded(asset.strName, CDatabasedAssetData(asset, 1, uint256()), nGeneration);
+    BOOST_CHECK(!cache.Lookup("RACEASSET", data));
+
+    // Without anything in between, what readers load is kept
+    BOOST_CHECK(!cache.Lookup("RACEASSET", data, &nGeneration));
+    cache.PutLoaded(reissued.strName, CDatabasedAssetData(reissued, 2, uint256()), nGeneration);
+    BOOST_CHECK(cache.Lookup("RACEASSET", data) && data && data->asset.nAmount == 2);
+
+    // Readers that keep missing in the database while a writer adds the names from another thread
+    const int nNames = 2000;
+    std::thread reader([&cache]() {
+        for (int i = 0; i < nNames; i++) {
+            std::string name = "RACE" + std::to_string(i);
+            CAssetsMetaCache::DataRef ref;
+            uint64_t nGen;
+            if (!cache.Lookup(name, ref, &nGen))
+                cache.PutAbsent(name, nGen);
+        }
+    });
+    for (int i = 0; i < nNames; i++) {
+        CNewAsset added("RACE" + std::to_string(i), CAmount(1), 0, 0, 1, "");
+        cache.Put(added.strName, CDatabasedAssetData(added, 1, uint256()));
+        if (!cache.Lookup(added.strName, data) || !data) {
+            BOOST_ERROR("asset " + added.strName + " written to the cache is not known");
+            break;
+        }
+    }
+    reader.join();
+}
+
+BOOST_AUTO_TEST_CASE(layered_cache_test)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    std::string address = Params().GlobalBurnAddress();
+
+    CAssetsCache base;
+    CNewAsset asset1("LAYEREDASSET", CAmount(100 * COIN), 8, 1, 0, "");
+    CNewAsset asset2("LAYEREDASSET2", CAmount(50 * COIN), 8, 1, 0, "");
+    BOOST_CHECK_MESSAGE(base.AddNewAsset(asset1, address, 0, uint256()), "Failed to add new asset to the base");
+    BOOST_CHECK_MESSAGE(base.AddNewAsset(asset2, address, 0, uint256()), "Failed to add new asset2 to the base");
+    COutPoint outIssue2(uint256S("01"), 2);
+    COutPoint outOther2(uint256S("02"), 0);
+    base.mapMyUnspentAssets["LAYEREDASSET2"] = {outIssue2, outOther2};
+
+    {
+        // A layer starts empty and reads through to its base
+        CAssetsCache layer(&base);
+        BOOST_CHECK(layer.mapAssetsAddressAmount.empty() && layer.setNewAssetsToAdd.empty());
+        BOOST_CHECK_MESSAGE(layer.CheckIfAssetExists("LAYEREDASSET"), "Layer didn't see the asset in its base");
+
+        CReissueAsset reissue("LAYEREDASSET", CAmount(1 * COIN), 8, 1, "");
+        COutPoint out(uint256S("BF50CB9A63BE0019171456252989A459A7D0A5F494735278290079D22AB704A4"), 1);
+        BOOST_CHECK_MESSAGE(layer.AddReissueAsset(reissue, address, out), "Failed to reissue in the layer");
+        BOOST_CHECK_MESSAGE(layer.RemoveNewAsset(asset2, address, outIssue2), "Failed to remove asset2 in the layer");
+
+        // Only the issuing outpoint leaves my unspent outpoints, in the layer
+        BOOST_CHECK(layer.mapMyUnspentAssets.at("LAYEREDASSET2") == std::set<COutPoint>({outOther2}));
+        BOOST_CHECK(layer.setChangeOwnedOutPoints.count("LAYEREDASSET2"));
+        BOOST_CHECK_EQUAL(base.mapMyUnspentAssets.at("LAYEREDASSET2").size(), 2U);
+
+        CNewAsset asset;
+        BOOST_CHECK(layer.GetAssetMetaDataIfExists("LAYEREDASSET", asset) && asset.nAmount == CAmount(101 * COIN));
+        BOOST_CHECK(!layer.CheckIfAssetExists("LAYEREDASSET2"));
+
+        // The layer only holds the balances it changed, the holders are put together from all the caches
+        BOOST_CHECK_EQUAL(layer.mapAssetsAddressAmount.size(), 2U);
+        std::set<std::string> setAddresses;
+        BOOST_CHECK(layer.GetAssetAddresses("LAYEREDASSET", setAddresses) && setAddresses == std::set<std::string>({address}));
+        BOOST_CHECK(layer.GetAssetAddresses("LAYEREDASSET2", setAddresses) && setAddresses.empty());
+        BOOST_CHECK(base.GetAssetAddresses("LAYEREDASSET2", setAddresses) && setAddresses == std::set<std::string>({address}));
+
+        // The base is untouched until the layer is flushed
+        BOOST_CHECK(!base.mapReissuedAssetData.count("LAYEREDASSET"));
+        BOOST_CHECK(base.mapAssetsAddressAmount.at(std::make_pair("LAYEREDASSET", address)) == CAmount(100 * COIN));
+        BOOST_CHECK(base.CheckIfAssetExists("LAYEREDASSET2"));
+
+        BOOST_CHECK(layer.Flush(true));
+        BOOST_CHECK(layer.mapAssetsAddressAmount.empty() && layer.setNewReissueToAdd.empty());
+    }
+
+    CNewAsset asset;
+    BOOST_CHECK(base.GetAssetMetaDataIfExists("LAYEREDASSET", asset) && asset.nAmount == CAmount(101 * COIN));
+    BOOST_CHECK(base.mapAssetsAddressAmount.at(std::make_pair("LAYEREDASSET", address)) == CAmount(101 * COIN));
+    BOOST_CHECK(base.setNewReissueToAdd.size() == 1);
+    BOOST_CHECK(!base.CheckIfAssetExists("LAYEREDASSET2"));
+    BOOST_CHECK(base.setNewAssetsToAdd.size() == 1 && base.setNewAssetsToRemove.size() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(address_dir_test)
+{
+    CAssetsDB db(1 << 20, true);
+
+    CDBBatch batch(db);
+    db.WriteAssetAddressQuantity(batch, "ADDRDIR", "address1", 10);
+    db.WriteAssetAddressQuantity(batch, "ADDRDIR2", "address1", 20);
+    db.WriteAssetAddressQuantity(batch, "ADDRDIR2", "address2", 30);
+    db.WriteAssetAddressQuantity(batch, "ADDRDIR3", "address1", 40);
+    db.EraseAssetAddressQuantity(batch, "ADDRDIR3", "address1");
+    BOOST_CHECK(db.WriteBatch(batch));
+
+    // Only the balances of the address, read through the address keyed index
+    std::vector<std::pair<std::string, CAmount> > vecAssetAmounts;
+    BOOST_CHECK(db.AddressDir(vecAssetAmounts, "address1"));
+    std::vector<std::pair<std::string, CAmount> > vecExpected = {{"ADDRDIR", 10}, {"ADDRDIR2", 20}};
+    BOOST_CHECK(vecAssetAmounts == vecExpected);
+
+    vecAssetAmounts.clear();
+    BOOST_CHECK(db.AddressDir(vecAssetAmounts, "address"));
+    BOOST_CHECK(vecAssetAmounts.empty());
+
+    std::set<std::string> setAddresses;
+    BOOST_CHECK(db.ReadAssetAddresses("ADDRDIR2", setAddresses));
+    BOOST_CHECK(setAddresses == std::set<std::string>({"address1", "address2"}));
+}
+
+BOOST_AUTO_TEST_CASE(address_index_rebuild_test)
+{
+    CAssetsDB db(1 << 20, true);
+    const uint256 hashTip = ArithToUint256(arith_uint256(1));
+    const uint256 hashLaterTip = ArithToUint256(arith_uint256(2));
+
+    CDBBatch batch(db);
+    db.WriteAssetAddressQuantity(batch, "REBUILD", "address1", 10);
+    db.WriteAssetAddressQuantity(batch, "REBUILD2", "address1", 20);
+    db.WriteAddressAssetIndexTip(batch, hashTip);
+    BOOST_CHECK(db.WriteBatch(batch));
+
+    // A binary without the index spends a balance, erasing only its <Asset Name, Address> entry ('B'),
+    // and moves the chainstate on
+    BOOST_CHECK(db.Erase(std::make_pair('B', std::make_pair(std::string("REBUILD"), std::string("address1")))));
+
+    // An index stamped with the best block is trusted as it is
+    std::vector<std::pair<std::string, CAmount> > vecAssetAmounts;
+    BOOST_CHECK(db.CheckAddressAssetIndex(hashTip));
+    BOOST_CHECK(db.AddressDir(vecAssetAmounts, "address1"));
+    BOOST_CHECK_EQUAL(vecAssetAmounts.size(), 2U);
+
+    // one stamped with another is rebuilt, without the spent balance
+    vecAssetAmounts.clear();
+    BOOST_CHECK(db.CheckAddressAssetIndex(hashLaterTip));
+    BOOST_CHECK(db.AddressDir(vecAssetAmounts, "address1"));
+    std::vector<std::pair<std::string, CAmount> > vecExpected = {{"REBUILD2", 20}};
+    BOOST_CHECK(vecAssetAmounts == vecExpected);
+}
+
+BOOST_AUTO_TEST_CASE(trim_address_caches_test)
+{
+    CAssetsDB* pdbOld = passetsdb;
+    size_t nOldUsage = nAssetCacheUsage;
+    passetsdb = new CAssetsDB(1 << 20, true);
+
+    CAssetsCache cache;
+    for (int i = 0; i < 1000; i++)
+        cache.mapAssetsAddressAmount[std::make_pair("TRIM" + std::to_string(i), "address")] = i;
+
+    // Only enough entries are evicted to get under the budget
+    nAssetCacheUsage = cache.AddressCacheMemoryUsage() / 2;
+    BOOST_CHECK(cache.Flush(false, true));
+    BOOST_CHECK(cache.AddressCacheMemoryUsage() <= nAssetCacheUsage);
+    BOOST_CHECK(cache.mapAssetsAddressAmount.size() > 400);
+
+    // The zero balance was spent and is dropped regardless
+    BOOST_CHECK(!cache.mapAssetsAddressAmount.count(std::make_pair("TRIM0", "address")));
+
+    delete passetsdb;
+    passetsdb = pdbOld;
+    nAssetCacheUsage = nOldUsage;
+}
+
+BOOST_AUTO_TEST_CASE(possibly_mine_no_wallet_test)
+{
+    CAssetsCache* passetsOld = passets;
+    passets = new CAssetsCache();
+
+    CScript scriptPubKey;
+    CAssetTransfer("POSSIBLE", 100).ConstructTransaction(scriptPubKey);
+    CTxOut txOut(0, scriptPubKey);
+
+    // Until init is done outputs are kept in case a wallet turns up
+    fTrackPossiblyMine = true;
+    BOOST_CHECK(passets->AddPossibleOutPoint(CAssetCachePossibleMine("POSSIBLE", COutPoint(uint256S("01"), 0), txOut)));
+    BOOST_CHECK_EQUAL(passets->setPossiblyMineAdd.size(), 1U);
+
+    // Init finishing without a wallet drops them once and stops collecting
+    UpdatePossibleAssets();
+    BOOST_CHECK(passets->setPossiblyMineAdd.empty());
+    BOOST_CHECK(!fTrackPossiblyMine);
+    BOOST_CHECK(passets->mapMyUnspentAssets.empty());
+
+    BOOST_CHECK(passets->AddPossibleOutPoint(CAssetCachePossibleMine("POSSIBLE", COutPoint(uint256S("02"), 0), txOut)));
+    BOOST_CHECK(passets->setPossiblyMineAdd.empty());
+    UpdatePossibleAssets();
+    BOOST_CHECK(passets->setPossiblyMineAdd.empty());
+    BOOST_CHECK(passets->mapMyUnspentAssets.empty());
+
+    fTrackPossiblyMine = true;
+    delete passets;
+    passets = passetsOld;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -9,7 +9,9 @@
 #include "undo.h"
 #include "utilstrencodings.h"
 #include "test/test_astral.h"
+#include "txdb.h"
 #include "validation.h"
+#include "workerpool.h"
 #include "consensus/validation.h"
 
 #include <vector>
@@ -856,4 +858,95 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_FIXTURE_TEST_CASE(ccoins_getcoins, TestingSetup)
+{
+    // Enough coins that the database reads them on the worker pool
+    BOOST_REQUIRE(workerpool.ThreadCount() > 0);
+    CCoinsViewDB db(1 << 20, true);
+    std::vector<COutPoint> vOutpoints;
+    CCoinsMap mapCoins;
+    for (int i = 0; i < 200; i++) {
+        COutPoint outpoint(InsecureRand256(), i);
+        vOutpoints.push_back(outpoint);
+        if (i % 4 == 0)
+            continue;
+        CCoinsCacheEntry entry;
+        entry.coin = Coin(CTxOut(i + 1, CScript() << i), i, false);
+        entry.flags = CCoinsCacheEntry::DIRTY;
+        mapCoins.emplace(outpoint, std::move(entry));
+    }
+    BOOST_CHECK(db.BatchWrite(mapCoins, InsecureRand256()));
+    vOutpoints.push_back(vOutpoints[1]);
+
+    std::vector<Coin> vCoins;
+    db.GetCoins(vOutpoints, vCoins);
+    BOOST_CHECK_EQUAL(vCoins.size(), vOutpoints.size());
+    for (size_t i = 0; i < vOutpoints.size(); i++) {
+        Coin coin;
+        bool fHave = db.GetCoin(vOutpoints[i], coin);
+        BOOST_CHECK_EQUAL(fHave, !vCoins[i].IsSpent());
+        BOOST_CHECK(!fHave || coin == vCoins[i]);
+    }
+
+    // A cache only asks its base for what it is missing, and keeps the result
+    CCoinsViewCacheTest cache(&db);
+    Coin spent;
+    cache.SpendCoin(vOutpoints[2], &spent);
+    BOOST_CHECK(!spent.IsSpent());
+
+    std::vector<Coin> vCached;
+    cache.GetCoins(vOutpoints, vCached);
+    cache.SelfTest();
+    BOOST_CHECK(vCached[2].IsSpent());
+    for (size_t i = 0; i < vOutpoints.size(); i++) {
+        if (i == 2)
+            continue;
+        BOOST_CHECK(vCached[i] == vCoins[i]);
+        BOOST_CHECK_EQUAL(cache.HaveCoinInCache(vOutpoints[i]), !vCoins[i].IsSpent());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(rolling_coins_stats)
+{
+    std::vector<std::pair<COutPoint, Coin>> coins;
+    for (int i = 0; i < 100; i++) {
+        CTxOut out(InsecureRandRange(MAX_MONEY), CScript() << OP_DUP << ToByteVector(InsecureRand256()));
+        coins.emplace_back(COutPoint(InsecureRand256(), InsecureRandBits(4)), Coin(out, InsecureRandRange(1000), InsecureRandBool()));
+    }
+
+    // Adding all coins and removing the first half ends in the same state as
+    // adding the second half alone, in reverse order
+    CRollingCoinsStats stats1, stats2;
+    for (const auto& entry : coins)
+        stats1.AddCoin(entry.first, entry.second);
+    for (size_t i = 0; i < coins.size() / 2; i++)
+        stats1.RemoveCoin(coins[i].first, coins[i].second);
+    for (size_t i = coins.size(); i > coins.size() / 2; i--)
+        stats2.AddCoin(coins[i - 1].first, coins[i - 1].second);
+
+    BOOST_CHECK(stats1.GetMuHash() == stats2.GetMuHash());
+    BOOST_CHECK_EQUAL(stats1.nTransactionOutputs, coins.size() - coins.size() / 2);
+    BOOST_CHECK_EQUAL(stats1.nTransactionOutputs, stats2.nTransactionOutputs);
+    BOOST_CHECK_EQUAL(stats1.nBogoSize, stats2.nBogoSize);
+    BOOST_CHECK_EQUAL(stats1.nTotalAmount, stats2.nTotalAmount);
+
+    // Removing everything gets back to the empty set
+    for (size_t i = coins.size() / 2; i < coins.size(); i++)
+        stats1.RemoveCoin(coins[i].first, coins[i].second);
+    BOOST_CHECK(stats1.GetMuHash() == CRollingCoinsStats().GetMuHash());
+    BOOST_CHECK_EQUAL(stats1.nTransactionOutputs, 0U);
+    BOOST_CHECK_EQUAL(stats1.nTotalAmount, 0);
+
+    // A different coin set commits to a different hash
+    stats2.RemoveCoin(coins.back().first, coins.back().second);
+    BOOST_CHECK(stats1.GetMuHash() != stats2.GetMuHash());
+
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << stats2;
+    CRollingCoinsStats stats3;
+    ss >> stats3;
+    BOOST_CHECK(stats3.GetMuHash() == stats2.GetMuHash());
+    BOOST_CHECK_EQUAL(stats3.nBogoSize, stats2.nBogoSize);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
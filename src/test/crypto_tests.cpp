@@ -11,7 +11,9 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "crypto/muhash.h"
 #include "random.h"
+#include "streams.h"
 #include "utilstrencodings.h"
 #include "test/test_astral.h"
 
@@ -525,6 +527,55 @@ BOOST_AUTO_TEST_CASE(chacha20_testvector)
                  "fab78c9");
 }
 
+static MuHash3072 FromInt(unsigned char i)
+{
+    unsigned char tmp[32] = {i, 0};
+    return MuHash3072(tmp, 32);
+}
+
+BOOST_AUTO_TEST_CASE(muhash_tests)
+{
+    uint256 out;
+
+    MuHash3072 acc = FromInt(0);
+    acc *= FromInt(1);
+    acc /= FromInt(2);
+    acc.Finalize(out.begin());
+    BOOST_CHECK_EQUAL(out.GetHex(), "10d312b100cbd32ada024a6646e40d3482fcff103668d2625f10002a607d5863");
+
+    // The set hash doesn't depend on the order of insertions and removals
+    uint256 out2;
+    MuHash3072 acc2 = FromInt(1);
+    acc2.Remove(std::vector<unsigned char>(32, 0).data(), 32);
+    acc2.Insert(std::vector<unsigned char>(32, 0).data(), 32);
+    acc2 /= FromInt(2);
+    acc2 *= FromInt(0);
+    acc2.Finalize(out2.begin());
+    BOOST_CHECK(out == out2);
+
+    // Serialization keeps pending removals
+    MuHash3072 acc3 = FromInt(0);
+    acc3 *= FromInt(1);
+    acc3 /= FromInt(2);
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << acc3;
+    MuHash3072 acc4;
+    ss >> acc4;
+    uint256 out3;
+    acc4.Finalize(out3.begin());
+    BOOST_CHECK(out == out3);
+
+    // Removing everything again gives the hash of the empty set
+    uint256 empty, out4;
+    MuHash3072().Finalize(empty.begin());
+    acc /= FromInt(0);
+    acc /= FromInt(1);
+    acc *= FromInt(2);
+    acc.Finalize(out4.begin());
+    BOOST_CHECK(out4 == empty);
+    BOOST_CHECK_EQUAL(empty.GetHex(), "dd5ad2a105c2d29495f577245c357409002329b9f4d6182c0af3dc2f462555c8");
+}
+
 BOOST_AUTO_TEST_CASE(countbits_tests)
 {
     FastRandomContext ctx;
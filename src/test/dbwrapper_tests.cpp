@@ -3,6 +3,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include "config/astral-config.h"
+#endif
+
 #include "dbwrapper.h"
 #include "uint256.h"
 #include "random.h"
@@ -118,6 +122,53 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
     }
 }
 
+// Test that data written without compression survives being rewritten compressed,
+// and takes less space afterwards when leveldb was built with Snappy.
+BOOST_AUTO_TEST_CASE(dbwrapper_rewrite_compressed)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    create_directories(ph);
+
+    // Repetitive values, so that Snappy has something to compress
+    std::vector<std::vector<unsigned char> > values;
+    size_t nUncompressedSize;
+    {
+        CDBWrapper dbw(ph, (1 << 20), false, false, true);
+        CDBBatch batch(dbw);
+        for (unsigned int i = 0; i < 1000; i++) {
+            values.push_back(std::vector<unsigned char>(1000, (unsigned char)InsecureRandBits(8)));
+            batch.Write(i, values.back());
+        }
+        BOOST_CHECK(dbw.WriteBatch(batch));
+
+        // Move everything out of the log into tables, which is what the size estimate covers
+        dbw.CompactRange(0u, 0xffffffffu);
+        nUncompressedSize = dbw.EstimateSize(0u, 0xffffffffu);
+        BOOST_CHECK(nUncompressedSize >= values.size() * values[0].size());
+    }
+
+    {
+        CDBWrapper cdbw(ph, (1 << 20), false, false, true, 2 << 20, true);
+        cdbw.Rewrite();
+        for (unsigned int i = 0; i < values.size(); i++) {
+            std::vector<unsigned char> res;
+            BOOST_CHECK(cdbw.Read(i, res));
+            BOOST_CHECK(res == values[i]);
+        }
+
+        size_t nRewrittenSize = cdbw.EstimateSize(0u, 0xffffffffu);
+#ifdef USE_SNAPPY
+        BOOST_CHECK(nRewrittenSize < nUncompressedSize / 4);
+#else
+        BOOST_CHECK(nRewrittenSize >= values.size() * values[0].size());
+#endif
+
+        // The obfuscation key is copied like any other entry
+        BOOST_CHECK(!is_null_key(dbwrapper_private::GetObfuscateKey(cdbw)));
+    }
+    fs::remove_all(ph);
+}
+
 // Test that we do not obfuscation if there is existing data.
 BOOST_AUTO_TEST_CASE(existing_data_no_obfuscate)
 {
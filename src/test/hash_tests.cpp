@@ -4,10 +4,14 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "crypto/x20r_lanes.h"
+#include "streams.h"
 #include "utilstrencodings.h"
 #include "test/test_astral.h"
 #include "consensus/merkle.h"
 
+#include <atomic>
+#include <thread>
 #include <vector>
 #include<iostream>
 
@@ -175,4 +179,222 @@ BOOST_AUTO_TEST_CASE(siphash)
     }
 }
 
+BOOST_AUTO_TEST_CASE(x20r_midstate)
+{
+    // Hashing header tails from a midstate must match HashX20R over the full header,
+    // with every primitive that a nibble of hashPrevBlock can select as stage 0
+    for (int nAlgo = 0; nAlgo < 16; nAlgo++) {
+        unsigned char header[X20R_MIDSTATE_SIZE + X20R_HEADER_TAIL_SIZE];
+        for (unsigned char& c : header)
+            c = InsecureRandBits(8);
+        uint256 hashPrevBlock;
+        do {
+            hashPrevBlock = InsecureRand256();
+        } while (GetHashSelection(hashPrevBlock, 0) != nAlgo);
+        CX20RMidstate midstate(header, hashPrevBlock);
+
+        // The midstate is reused for several tails, as the miner does across nonces
+        for (int j = 0; j < 4; j++) {
+            unsigned char* ptail = header + X20R_MIDSTATE_SIZE;
+            for (size_t k = 0; k < X20R_HEADER_TAIL_SIZE; k++)
+                ptail[k] = InsecureRandBits(8);
+            BOOST_CHECK(midstate.Hash(ptail) == HashX20R(header, header + sizeof(header), hashPrevBlock));
+        }
+
+        // and so is a batch of tails, one more than fills the kernels
+        unsigned char tails[X20R_KERNEL_LANES + 1][X20R_HEADER_TAIL_SIZE];
+        uint256 hashes[X20R_KERNEL_LANES + 1];
+        for (auto& tail : tails)
+            for (unsigned char& c : tail)
+                c = InsecureRandBits(8);
+        midstate.HashBatch(tails[0], X20R_KERNEL_LANES + 1, hashes);
+        for (size_t n = 0; n <= X20R_KERNEL_LANES; n++) {
+            memcpy(header + X20R_MIDSTATE_SIZE, tails[n], X20R_HEADER_TAIL_SIZE);
+            BOOST_CHECK(hashes[n] == HashX20R(header, header + sizeof(header), hashPrevBlock));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(x20r_headers)
+{
+    // Batches of headers must hash as HashX20R does one by one, both when the headers take
+    // different algorithm orders and when they all share one, so every kernel runs full
+    for (bool fShared : {false, true}) {
+        for (size_t nCount : {0, 1, 2, 3, 4, 5, 9, 64, 257}) {
+            std::vector<unsigned char> headers(80 * nCount);
+            for (unsigned char& c : headers)
+                c = InsecureRandBits(8);
+            if (fShared) {
+                for (size_t n = 1; n < nCount; n++)
+                    memcpy(&headers[80 * n + 4], &headers[4], 32);
+            }
+            std::vector<uint256> hashes(nCount);
+            HashX20RHeaders(headers.data(), nCount, hashes.data());
+            for (size_t n = 0; n < nCount; n++) {
+                const unsigned char* pheader = &headers[80 * n];
+                const uint256 hashPrevBlock(std::vector<unsigned char>(pheader + 4, pheader + 36));
+                BOOST_CHECK(hashes[n] == HashX20R(pheader, pheader + 80, hashPrevBlock));
+            }
+        }
+    }
+
+    // CacheHashes leaves every header with the hash GetHash would compute, cached or not
+    std::vector<CBlockHeader> vHeaders(10);
+    for (CBlockHeader& header : vHeaders) {
+        header.nVersion = 4;
+        header.hashPrevBlock = InsecureRand256();
+        header.nNonce = InsecureRand32();
+    }
+    const uint256 hashFirst = vHeaders[0].GetHash();
+    CBlockHeader::CacheHashes(vHeaders.data(), vHeaders.size());
+    BOOST_CHECK(vHeaders[0].GetHash() == hashFirst);
+    for (const CBlockHeader& header : vHeaders)
+        BOOST_CHECK(header.GetHash() == HashX20R(BEGIN(header.nVersion), END(header.nNonce), header.hashPrevBlock));
+}
+
+BOOST_AUTO_TEST_CASE(x20r_lane_kernels)
+{
+    // Each multi-lane kernel must match its primitive over every lane, also hashing in place
+    if (!x20r_lanes::Supported())
+        return;
+#if X20R_HAVE_LANES
+    const std::pair<int, x20r_lanes::Kernel> kernels[] = {
+        {0, x20r_lanes::Blake512}, {1, x20r_lanes::Bmw512}, {3, x20r_lanes::Jh512},
+        {4, x20r_lanes::Keccak512}, {5, x20r_lanes::Skein512}, {6, x20r_lanes::Luffa512},
+        {7, x20r_lanes::CubeHash512}, {15, x20r_lanes::Sha512},
+    };
+    for (const auto& kernel : kernels) {
+        unsigned char in[x20r_lanes::LANES][64], out[x20r_lanes::LANES][64];
+        const unsigned char* pin[x20r_lanes::LANES];
+        unsigned char* pout[x20r_lanes::LANES];
+        for (size_t k = 0; k < x20r_lanes::LANES; k++) {
+            for (unsigned char& c : in[k])
+                c = InsecureRandBits(8);
+            pin[k] = in[k];
+            pout[k] = out[k];
+        }
+        kernel.second(pin, pout);
+        for (size_t k = 0; k < x20r_lanes::LANES; k++) {
+            uint512 expected;
+            HashX20RStage(kernel.first, in[k], 64, expected);
+            BOOST_CHECK(memcmp(out[k], expected.begin(), 64) == 0);
+            pout[k] = in[k];
+        }
+        kernel.second(pin, pout);
+        BOOST_CHECK(memcmp(in, out, sizeof(in)) == 0);
+    }
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(x20r_stages)
+{
+    // Chaining the single primitives in selection order must reproduce HashX20R
+    unsigned char header[80];
+    for (unsigned char& c : header)
+        c = InsecureRandBits(8);
+    uint256 hashPrevBlock = InsecureRand256();
+
+    uint512 stage;
+    HashX20RStage(GetHashSelection(hashPrevBlock, 0), header, sizeof(header), stage);
+    for (int i = 1; i < 20; i++) {
+        uint512 input = stage;
+        HashX20RStage(GetHashSelection(hashPrevBlock, i), &input, 64, stage);
+    }
+    BOOST_CHECK(stage.trim256() == HashX20R(header, header + sizeof(header), hashPrevBlock));
+
+    // Every stage is counted while stats are on, and nothing while they are off
+    X20RAlgoStats stats[20];
+    GetX20RStats(stats, true);
+    fX20RStats = true;
+    HashX20R(header, header + sizeof(header), hashPrevBlock);
+    fX20RStats = false;
+    HashX20R(header, header + sizeof(header), hashPrevBlock);
+    GetX20RStats(stats, true);
+    uint64_t nCalls = 0;
+    for (int i = 0; i < 20; i++)
+        nCalls += stats[i].nCalls;
+    BOOST_CHECK_EQUAL(nCalls, 20U);
+    BOOST_CHECK(stats[GetHashSelection(hashPrevBlock, 0)].nCalls >= 1);
+}
+
+BOOST_AUTO_TEST_CASE(block_header_hash_cache)
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashPrevBlock = InsecureRand256();
+    header.hashMerkleRoot = InsecureRand256();
+    header.nTime = 1543437000;
+    header.nBits = 0x1e00ffff;
+
+    const uint256 hash = header.GetHash();
+    BOOST_CHECK(header.GetHash() == hash);
+    BOOST_CHECK(HashX20R(BEGIN(header.nVersion), END(header.nNonce), header.hashPrevBlock) == hash);
+
+    // Copies carry the cached hash
+    CBlock block(header);
+    BOOST_CHECK(block.GetHash() == hash);
+    BOOST_CHECK(block.GetBlockHeader().GetHash() == hash);
+
+    // A write to any field, after the hash was cached, changes it
+    auto check_changed = [&](const CBlockHeader& changed) {
+        BOOST_CHECK(changed.GetHash() != hash);
+        BOOST_CHECK(changed.GetHash() == HashX20R(BEGIN(changed.nVersion), END(changed.nNonce), changed.hashPrevBlock));
+    };
+    CBlockHeader changed = header;
+    changed.nVersion = 5;
+    check_changed(changed);
+    changed = header;
+    changed.hashPrevBlock = InsecureRand256();
+    check_changed(changed);
+    changed = header;
+    changed.hashMerkleRoot = InsecureRand256();
+    check_changed(changed);
+    changed = header;
+    ++changed.nTime;
+    check_changed(changed);
+    changed = header;
+    changed.nBits = 0x1d00ffff;
+    check_changed(changed);
+    changed = header;
+    ++changed.nNonce;
+    check_changed(changed);
+    --changed.nNonce;
+    BOOST_CHECK(changed.GetHash() == hash);
+
+    // So does deserializing into a header
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ++block.nNonce;
+    ss << block.GetBlockHeader();
+    ss >> header;
+    BOOST_CHECK(header.GetHash() == block.GetHash());
+    BOOST_CHECK(header.GetHash() != hash);
+}
+
+BOOST_AUTO_TEST_CASE(block_header_hash_cache_threads)
+{
+    // A const header may be hashed from several threads at once
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashPrevBlock = InsecureRand256();
+    header.hashMerkleRoot = InsecureRand256();
+    header.nBits = 0x1e00ffff;
+    const CBlockHeader& shared = header;
+    const uint256 hash = HashX20R(BEGIN(header.nVersion), END(header.nNonce), header.hashPrevBlock);
+
+    std::atomic<int> nWrong(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&shared, &hash, &nWrong]() {
+            for (int j = 0; j < 100; j++) {
+                CBlockHeader copy = shared;
+                if (shared.GetHash() != hash || copy.GetHash() != hash)
+                    ++nWrong;
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    BOOST_CHECK_EQUAL(nWrong, 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
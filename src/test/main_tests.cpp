@@ -4,8 +4,13 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chainparams.h"
+#include "clientversion.h"
+#include "consensus/validation.h"
 #include "validation.h"
 #include "net.h"
+#include "streams.h"
+#include "txdb.h"
+#include "assets/assets.h"
 
 #include "test/test_astral.h"
 
@@ -75,4 +80,87 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+typedef std::vector<std::pair<uint256, CDiskBlockPos> > ImportedChain;
+
+static void WriteBlockRecord(CAutoFile& fileout, const CBlock& block)
+{
+    fileout << FLATDATA(Params().MessageStart()) << (unsigned int)GetSerializeSize(fileout, block) << block;
+}
+
+/** Reindex block file nFile from scratch, reading it nBatchSize bytes at a time. Returns the active chain with where each block was found. */
+static ImportedChain ReindexBlockFile(int nFile, size_t nBatchSize)
+{
+    UnloadBlockIndex();
+    delete pcoinsTip;
+    delete pcoinsdbview;
+    delete pblocktree;
+    delete passets;
+    pblocktree = new CBlockTreeDB(1 << 20, true);
+    pcoinsdbview = new CCoinsViewDB(1 << 23, true);
+    pcoinsTip = new CCoinsViewCache(pcoinsdbview);
+    passets = new CAssetsCache();
+
+    CDiskBlockPos pos(nFile, 0);
+    FILE* file = OpenBlockFile(pos, true);
+    BOOST_REQUIRE(file);
+    BOOST_CHECK(LoadExternalBlockFile(Params(), file, &pos, nBatchSize));
+    CValidationState state;
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+
+    LOCK(cs_main);
+    ImportedChain chain;
+    for (CBlockIndex* pindex = chainActive.Genesis(); pindex; pindex = chainActive.Next(pindex))
+        chain.emplace_back(pindex->GetBlockHash(), pindex->GetBlockPos());
+    return chain;
+}
+
+BOOST_FIXTURE_TEST_CASE(loadexternalblockfile_reindex, TestChain100Setup)
+{
+    std::vector<CBlock> vBlocks;
+    {
+        LOCK(cs_main);
+        for (CBlockIndex* pindex = chainActive.Genesis(); pindex; pindex = chainActive.Next(pindex)) {
+            vBlocks.emplace_back();
+            BOOST_REQUIRE(ReadBlockFromDisk(vBlocks.back(), pindex, Params().GetConsensus()));
+        }
+    }
+    BOOST_REQUIRE_EQUAL(vBlocks.size(), 101U);
+
+    // Copy the chain to a new block file with block 4 ahead of its parent, garbage around and
+    // between the blocks, a header with an impossible size and a record that doesn't deserialize.
+    // The bad record claims more bytes than it has, so block 3 is only found by rescanning.
+    const int nFile = 1;
+    {
+        CAutoFile fileout(fsbridge::fopen(GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk"), "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_REQUIRE(!fileout.IsNull());
+        const std::vector<unsigned char> vGarbage(100, 0x5a);
+        // A header followed by a transaction count too large to read
+        const std::vector<unsigned char> vCorrupt(::GetSerializeSize(CBlockHeader(), SER_DISK, CLIENT_VERSION) + 9, 0xff);
+
+        fileout.write((const char*)vGarbage.data(), vGarbage.size());
+        for (int i = 0; i <= 2; i++)
+            WriteBlockRecord(fileout, vBlocks[i]);
+        fileout << FLATDATA(Params().MessageStart()) << (unsigned int)0xffffffff;
+        fileout.write((const char*)vGarbage.data(), vGarbage.size());
+        WriteBlockRecord(fileout, vBlocks[4]);
+        fileout << FLATDATA(Params().MessageStart()) << (unsigned int)1000;
+        fileout.write((const char*)vCorrupt.data(), vCorrupt.size());
+        WriteBlockRecord(fileout, vBlocks[3]);
+        for (size_t i = 5; i < vBlocks.size(); i++)
+            WriteBlockRecord(fileout, vBlocks[i]);
+        fileout.write((const char*)vGarbage.data(), vGarbage.size());
+    }
+
+    // One block per batch is the same as handling each block as soon as it is read
+    ImportedChain serial = ReindexBlockFile(nFile, 1);
+    BOOST_REQUIRE_EQUAL(serial.size(), vBlocks.size());
+    for (size_t i = 0; i < vBlocks.size(); i++) {
+        BOOST_CHECK(serial[i].first == vBlocks[i].GetHash());
+        BOOST_CHECK_EQUAL(serial[i].second.nFile, nFile);
+    }
+
+    ImportedChain batched = ReindexBlockFile(nFile, BLOCK_IMPORT_BATCH_SIZE);
+    BOOST_CHECK(batched == serial);
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -62,6 +62,43 @@ public:
     }
 };
 
+struct CConnmanTest
+{
+    static size_t SocketSendData(CConnman& connman, CNode* pnode)
+    {
+        LOCK(pnode->cs_vSend);
+        return connman.SocketSendData(pnode);
+    }
+#ifdef USE_EPOLL
+    static void AddListenSocket(CConnman& connman, SOCKET hSocket)
+    {
+        connman.vhListenSocket.push_back(CConnman::ListenSocket(hSocket, false));
+    }
+    static bool InitEpoll(CConnman& connman)
+    {
+        return connman.InitEpoll();
+    }
+    static void SocketEventsEpoll(CConnman& connman, std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+    {
+        connman.SocketEventsEpoll(recv_set, send_set, error_set);
+    }
+#endif
+    static void SocketEventsSelect(CConnman& connman, std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+    {
+        connman.SocketEventsSelect(recv_set, send_set, error_set);
+    }
+    static void AddNode(CConnman& connman, CNode* pnode)
+    {
+        LOCK(connman.cs_vNodes);
+        connman.vNodes.push_back(pnode);
+    }
+    static void ClearNodes(CConnman& connman)
+    {
+        LOCK(connman.cs_vNodes);
+        connman.vNodes.clear();
+    }
+};
+
 CDataStream AddrmanToStream(CAddrManSerializationMock& _addrman)
 {
     CDataStream ssPeersIn(SER_DISK, CLIENT_VERSION);
@@ -186,4 +223,303 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+BOOST_AUTO_TEST_CASE(cnetmessage_read_pieces)
+{
+    CSerializedNetMsg block;
+    block.command = "block";
+    block.data.resize(1000);
+    for (size_t i = 0; i < block.data.size(); i++)
+        block.data[i] = i & 0xff;
+    const std::vector<unsigned char>& payload = block.data;
+    const uint256 hash = Hash(payload.begin(), payload.end());
+    std::vector<unsigned char> wire;
+    AppendWireMessage(wire, block);
+
+    // The header is parsed straight from the received data when it all
+    // arrived at once, and through the header buffer when it trickles in.
+    for (unsigned int nChunk : {(unsigned int)wire.size(), 100U, 7U, 1U}) {
+        CNetMessage msg(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+        const char* pch = (const char*)wire.data();
+        unsigned int nBytes = wire.size();
+        while (nBytes > 0) {
+            unsigned int nAvail = std::min(nChunk, nBytes);
+            while (nAvail > 0) {
+                int handled = msg.in_data ? msg.readData(pch, nAvail) : msg.readHeader(pch, nAvail);
+                BOOST_REQUIRE(handled > 0);
+                pch += handled;
+                nAvail -= handled;
+                nBytes -= handled;
+            }
+        }
+        BOOST_REQUIRE(msg.complete());
+        BOOST_CHECK_EQUAL(msg.hdr.GetCommand(), "block");
+        BOOST_CHECK_EQUAL(msg.hdr.nMessageSize, payload.size());
+        BOOST_CHECK(msg.GetMessageHash() == hash);
+        BOOST_CHECK(std::equal(msg.vRecv.begin(), msg.vRecv.end(), (const char*)payload.data()));
+        BOOST_CHECK_EQUAL(msg.vRecv.size(), payload.size());
+    }
+
+    // A header with a bad size is still rejected on the direct path
+    CMessageHeader hdrBig(Params().MessageStart(), "block", MAX_SIZE + 1);
+    CDataStream ssBig(SER_NETWORK, PROTOCOL_VERSION);
+    ssBig << hdrBig;
+    CNetMessage msgBig(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+    BOOST_CHECK_EQUAL(msgBig.readHeader(&ssBig[0], ssBig.size()), -1);
+}
+
+BOOST_AUTO_TEST_CASE(cnetmessage_receive_in_place)
+{
+    // Larger than the 256 KiB the buffer grows ahead, and than a recycled buffer
+    CSerializedNetMsg block;
+    block.command = "block";
+    block.data.resize(600 * 1000);
+    for (size_t i = 0; i < block.data.size(); i++)
+        block.data[i] = (i * 7) & 0xff;
+    const std::vector<unsigned char>& payload = block.data;
+    const uint256 hash = Hash(payload.begin(), payload.end());
+    // The header and only the start of the payload have arrived
+    std::vector<unsigned char> wire;
+    AppendWireMessage(wire, block);
+    wire.resize(CMessageHeader::HEADER_SIZE + 1000);
+
+    // The socket handler only receives into a message whose header is in and
+    // that has enough payload left
+    CAddress addr(CService(CNetAddr(), 7777), NODE_NETWORK);
+    CNode node(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", true);
+    unsigned int nSpace = 256 * 1024;
+    BOOST_CHECK(node.GetRecvDataSpace(0x10000, nSpace) == nullptr);
+    bool fComplete;
+    BOOST_REQUIRE(node.ReceiveMsgBytes((const char*)wire.data(), wire.size(), fComplete));
+    BOOST_CHECK(!fComplete);
+    BOOST_CHECK(node.GetRecvDataSpace(payload.size(), nSpace) == nullptr);
+    BOOST_CHECK(node.GetRecvDataSpace(0x10000, nSpace) != nullptr);
+    BOOST_CHECK_EQUAL(nSpace, 256U * 1024);
+
+    // Receive the payload in place, with the end coming through readData as usual
+    CNetMessage msg(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+    BOOST_REQUIRE_EQUAL(msg.readHeader((const char*)wire.data(), wire.size()), (int)CMessageHeader::HEADER_SIZE);
+    size_t nPos = 0;
+    while (payload.size() - nPos > 100) {
+        nSpace = 100 * 1000;
+        char* pch = msg.GetDataSpace(nSpace);
+        BOOST_REQUIRE(nSpace > 0 && nSpace <= payload.size() - nPos);
+        nSpace = std::min(nSpace, (unsigned int)(payload.size() - nPos - 100));
+        memcpy(pch, payload.data() + nPos, nSpace);
+        BOOST_REQUIRE_EQUAL(msg.readData(pch, nSpace), (int)nSpace);
+        nPos += nSpace;
+    }
+    BOOST_CHECK(!msg.complete());
+    BOOST_REQUIRE_EQUAL(msg.readData((const char*)payload.data() + nPos, 100), 100);
+    BOOST_REQUIRE(msg.complete());
+    BOOST_CHECK(msg.GetMessageHash() == hash);
+    BOOST_CHECK_EQUAL(msg.vRecv.size(), payload.size());
+    BOOST_CHECK(std::equal(msg.vRecv.begin(), msg.vRecv.end(), (const char*)payload.data()));
+}
+
+BOOST_AUTO_TEST_CASE(pushmessage_coalesces_small_payloads)
+{
+    CConnman connman(0x1337, 0x1337);
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    CAddress addr = CAddress(CService(ipv4Addr, 7777), NODE_NETWORK);
+    std::unique_ptr<CNode> pnode(new CNode(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", false));
+
+    // A small payload is queued in the same buffer as its header
+    CSerializedNetMsg small;
+    small.command = "ping";
+    small.data.assign(8, 0x01);
+    connman.PushMessage(pnode.get(), std::move(small));
+    BOOST_REQUIRE_EQUAL(pnode->vSendMsg.size(), 1U);
+    BOOST_CHECK_EQUAL(pnode->vSendMsg[0].size(), (size_t)CMessageHeader::HEADER_SIZE + 8);
+    BOOST_CHECK(std::all_of(pnode->vSendMsg[0].begin() + CMessageHeader::HEADER_SIZE, pnode->vSendMsg[0].end(), [](unsigned char c) { return c == 0x01; }));
+
+    // A large one keeps its own buffer
+    CSerializedNetMsg large;
+    large.command = "block";
+    large.data.assign(100000, 0x02);
+    connman.PushMessage(pnode.get(), std::move(large));
+    BOOST_REQUIRE_EQUAL(pnode->vSendMsg.size(), 3U);
+    BOOST_CHECK_EQUAL(pnode->vSendMsg[1].size(), (size_t)CMessageHeader::HEADER_SIZE);
+    BOOST_CHECK_EQUAL(pnode->vSendMsg[2].size(), 100000U);
+    BOOST_CHECK_EQUAL(pnode->nSendSize, (size_t)(2 * CMessageHeader::HEADER_SIZE + 8 + 100000));
+}
+
+#ifndef WIN32
+static void ReadAvailable(SOCKET hSocket, std::vector<unsigned char>& received)
+{
+    unsigned char buf[4096];
+    ssize_t nBytes;
+    while ((nBytes = recv(hSocket, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        received.insert(received.end(), buf, buf + nBytes);
+}
+
+BOOST_AUTO_TEST_CASE(socketsenddata_short_write)
+{
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    int nSendBuf = 4096;
+    BOOST_REQUIRE_EQUAL(setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &nSendBuf, sizeof(nSendBuf)), 0);
+
+    CConnman connman(0x1337, 0x1337);
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    CAddress addr = CAddress(CService(ipv4Addr, 7777), NODE_NETWORK);
+    std::unique_ptr<CNode> pnode(new CNode(0, NODE_NETWORK, 0, fds[0], addr, 0, 0, CAddress(), "", false));
+
+    std::vector<unsigned char> wire;
+    std::vector<unsigned char> received;
+
+    // A message that fits goes out at once, and its buffer is kept for the next one
+    CSerializedNetMsg ping;
+    ping.command = "ping";
+    ping.data.assign(8, 0x01);
+    AppendWireMessage(wire, ping);
+    connman.PushMessage(pnode.get(), std::move(ping));
+    BOOST_CHECK(pnode->vSendMsg.empty());
+    BOOST_CHECK_EQUAL(pnode->nSendSize, 0U);
+    BOOST_CHECK_EQUAL(pnode->vSendBufferPool.size(), 1U);
+
+    // A large one only partly fits in the socket buffer. Its header is sent and
+    // back in the pool, the payload waits at nSendOffset
+    CSerializedNetMsg block;
+    block.command = "block";
+    block.data.resize(100000);
+    for (size_t i = 0; i < block.data.size(); i++)
+        block.data[i] = i & 0xff;
+    AppendWireMessage(wire, block);
+    connman.PushMessage(pnode.get(), std::move(block));
+    BOOST_REQUIRE_EQUAL(pnode->vSendMsg.size(), 1U);
+    BOOST_CHECK(pnode->nSendOffset > 0);
+    BOOST_CHECK_EQUAL(pnode->vSendBufferPool.size(), 1U);
+
+    // Messages queued behind it wait for the next SocketSendData
+    for (int i = 0; i < 3; i++) {
+        CSerializedNetMsg pong;
+        pong.command = "pong";
+        pong.data.assign(8, 0x10 + i);
+        AppendWireMessage(wire, pong);
+        connman.PushMessage(pnode.get(), std::move(pong));
+    }
+
+    int nCalls = 0;
+    while (!pnode->vSendMsg.empty()) {
+        // Whatever was sent is off the queue and counted out of nSendSize,
+        // and nSendOffset points at the first byte still to go
+        size_t nQueued = 0;
+        for (const std::vector<unsigned char>& buf : pnode->vSendMsg)
+            nQueued += buf.size();
+        BOOST_CHECK_EQUAL(pnode->nSendSize, nQueued);
+        BOOST_REQUIRE(pnode->nSendOffset < pnode->vSendMsg.front().size());
+        ReadAvailable(fds[1], received);
+        BOOST_CHECK_EQUAL(received.size() + nQueued - pnode->nSendOffset, wire.size());
+
+        BOOST_REQUIRE(++nCalls < 1000);
+        CConnmanTest::SocketSendData(connman, pnode.get());
+    }
+    ReadAvailable(fds[1], received);
+    BOOST_CHECK(nCalls > 1);
+
+    // The peer got every byte in order, and the small buffers are back in the pool
+    BOOST_CHECK(received == wire);
+    BOOST_CHECK_EQUAL(pnode->nSendSize, 0U);
+    BOOST_CHECK_EQUAL(pnode->nSendOffset, 0U);
+    BOOST_CHECK_EQUAL(pnode->vSendBufferPool.size(), 3U);
+    for (const std::vector<unsigned char>& buf : pnode->vSendBufferPool)
+        BOOST_CHECK(buf.empty());
+
+    close(fds[1]);
+}
+
+#ifdef USE_EPOLL
+struct SocketEventSets
+{
+    std::set<SOCKET> recv, send, error;
+};
+
+/** Wait for socket events with both backends, check they agree and return what they saw. */
+static SocketEventSets CheckSocketEvents(CConnman& connman)
+{
+    SocketEventSets select, epoll;
+    CConnmanTest::SocketEventsSelect(connman, select.recv, select.send, select.error);
+    CConnmanTest::SocketEventsEpoll(connman, epoll.recv, epoll.send, epoll.error);
+    BOOST_CHECK(select.recv == epoll.recv);
+    BOOST_CHECK(select.send == epoll.send);
+    BOOST_CHECK(select.error == epoll.error);
+    return epoll;
+}
+
+BOOST_AUTO_TEST_CASE(socketevents_epoll_matches_select)
+{
+    CConnman connman(0x1337, 0x1337);
+
+    SOCKET hListenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    BOOST_REQUIRE(hListenSocket != INVALID_SOCKET);
+    struct sockaddr_in sockaddr;
+    memset(&sockaddr, 0, sizeof(sockaddr));
+    sockaddr.sin_family = AF_INET;
+    sockaddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(sockaddr);
+    BOOST_REQUIRE_EQUAL(bind(hListenSocket, (struct sockaddr*)&sockaddr, len), 0);
+    BOOST_REQUIRE_EQUAL(listen(hListenSocket, SOMAXCONN), 0);
+    BOOST_REQUIRE_EQUAL(getsockname(hListenSocket, (struct sockaddr*)&sockaddr, &len), 0);
+    CConnmanTest::AddListenSocket(connman, hListenSocket);
+    BOOST_REQUIRE(CConnmanTest::InitEpoll(connman));
+
+    // Nothing to accept yet
+    SocketEventSets events = CheckSocketEvents(connman);
+    BOOST_CHECK(events.recv.empty() && events.send.empty() && events.error.empty());
+
+    // A pending connection makes the listening socket readable
+    SOCKET hClientSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    BOOST_REQUIRE(hClientSocket != INVALID_SOCKET);
+    BOOST_REQUIRE_EQUAL(connect(hClientSocket, (struct sockaddr*)&sockaddr, len), 0);
+    events = CheckSocketEvents(connman);
+    BOOST_CHECK(events.recv == std::set<SOCKET>{hListenSocket});
+    BOOST_CHECK(events.send.empty() && events.error.empty());
+
+    SOCKET hSocket = accept(hListenSocket, nullptr, nullptr);
+    BOOST_REQUIRE(hSocket != INVALID_SOCKET);
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = htonl(INADDR_LOOPBACK);
+    CAddress addr = CAddress(CService(ipv4Addr, 7777), NODE_NETWORK);
+    std::unique_ptr<CNode> pnode(new CNode(0, NODE_NETWORK, 0, hSocket, addr, 0, 0, CAddress(), "", true));
+    CConnmanTest::AddNode(connman, pnode.get());
+
+    // Once accepted, an idle peer reports nothing
+    events = CheckSocketEvents(connman);
+    BOOST_CHECK(events.recv.empty() && events.send.empty() && events.error.empty());
+
+    // Data from the peer makes its socket readable
+    const char msg[] = "ping";
+    BOOST_CHECK_EQUAL(send(hClientSocket, msg, sizeof(msg), 0), (ssize_t)sizeof(msg));
+    events = CheckSocketEvents(connman);
+    BOOST_CHECK(events.recv == std::set<SOCKET>{hSocket});
+    BOOST_CHECK(events.send.empty() && events.error.empty());
+
+    // With a send queued only writability is waited for, even with data to read
+    {
+        LOCK(pnode->cs_vSend);
+        pnode->vSendMsg.emplace_back(8, 0x01);
+        pnode->nSendSize += 8;
+    }
+    events = CheckSocketEvents(connman);
+    BOOST_CHECK(events.send == std::set<SOCKET>{hSocket});
+    BOOST_CHECK(events.recv.empty() && events.error.empty());
+
+    // With nothing to send and receiving paused the data is left waiting
+    {
+        LOCK(pnode->cs_vSend);
+        pnode->vSendMsg.clear();
+        pnode->nSendSize = 0;
+    }
+    pnode->fPauseRecv = true;
+    events = CheckSocketEvents(connman);
+    BOOST_CHECK(events.recv.empty() && events.send.empty() && events.error.empty());
+
+    CConnmanTest::ClearNodes(connman);
+    close(hClientSocket);
+}
+#endif
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
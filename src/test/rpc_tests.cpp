@@ -7,11 +7,15 @@
 #include "rpc/client.h"
 
 #include "base58.h"
+#include "chainparams.h"
 #include "core_io.h"
 #include "netbase.h"
 
 #include "test/test_astral.h"
 
+#include <set>
+#include <thread>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/test/unit_test.hpp>
 
@@ -38,6 +42,13 @@ UniValue CallRPC(std::string args)
     }
 }
 
+/** Let tableRPC.execute() run commands; warmup may already be over from an earlier case. */
+static void EndRPCWarmup()
+{
+    if (RPCIsInWarmup(nullptr))
+        SetRPCWarmupFinished();
+}
+
 BOOST_FIXTURE_TEST_SUITE(rpc_tests, TestingSetup)
 
 BOOST_AUTO_TEST_CASE(rpc_rawparams)
@@ -362,4 +373,201 @@ BOOST_AUTO_TEST_CASE(rpc_convert_values_generatetoaddress)
     BOOST_CHECK_EQUAL(result[2].get_int(), 9);
 }
 
+BOOST_AUTO_TEST_CASE(rpc_batch_order)
+{
+    EndRPCWarmup();
+
+    UniValue batch(UniValue::VARR);
+    const char* methods[] = {"getblockcount", "getbestblockhash", "getblockhash", "nosuchmethod",
+                             "getblockcount", "getblockhash", "getbestblockhash", "getblockcount"};
+    for (int i = 0; i < 8; i++) {
+        UniValue req(UniValue::VOBJ);
+        req.pushKV("method", methods[i]);
+        UniValue params(UniValue::VARR);
+        if (std::string(methods[i]) == "getblockhash")
+            params.push_back(0);
+        req.pushKV("params", params);
+        req.pushKV("id", i);
+        batch.push_back(req);
+    }
+
+    std::vector<std::thread> threads;
+    auto runner = [&threads](std::function<void()> func) {
+        threads.emplace_back(func);
+        return true;
+    };
+    UniValue serial, parallel;
+    BOOST_CHECK(serial.read(JSONRPCExecBatch(JSONRPCRequest(), batch)));
+    BOOST_CHECK(parallel.read(JSONRPCExecBatch(JSONRPCRequest(), batch, runner)));
+    for (std::thread& thread : threads)
+        thread.join();
+    // Each of the two runs of parallel calls gets helpers
+    BOOST_CHECK(!threads.empty());
+
+    BOOST_CHECK_EQUAL(parallel.write(), serial.write());
+    BOOST_CHECK_EQUAL(parallel.size(), 8U);
+    for (int i = 0; i < 8; i++) {
+        BOOST_CHECK_EQUAL(find_value(parallel[i], "id").get_int(), i);
+        BOOST_CHECK_EQUAL(find_value(parallel[i], "error").isNull(), i != 3);
+    }
+    BOOST_CHECK_EQUAL(find_value(parallel[2], "result").get_str(), Params().GenesisBlock().GetHash().GetHex());
+    BOOST_CHECK_EQUAL(find_value(parallel[7], "result").get_int(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_batch_order_errors)
+{
+    EndRPCWarmup();
+
+    // Failing elements in the middle of a parallel run keep their place too
+    const std::string genesis = Params().GenesisBlock().GetHash().GetHex();
+    const std::string unknown = uint256S("0xabcdef").GetHex();
+    const std::vector<std::pair<std::string, std::vector<UniValue>>> calls = {
+        {"getblockheader", {genesis, false}},
+        {"getblockheader", {unknown}},
+        {"getrawtransaction", {unknown}},
+        {"getblockheader", {genesis, true}},
+        {"getrawtransaction", {genesis, "verbose"}},
+        {"getblockhash", {0}},
+        {"getblockheader", {unknown, false}},
+        {"getblockheader", {genesis}},
+    };
+    UniValue batch(UniValue::VARR);
+    for (size_t i = 0; i < calls.size(); i++) {
+        UniValue req(UniValue::VOBJ);
+        req.pushKV("method", calls[i].first);
+        UniValue params(UniValue::VARR);
+        for (const UniValue& param : calls[i].second)
+            params.push_back(param);
+        req.pushKV("params", params);
+        req.pushKV("id", (int)i);
+        batch.push_back(req);
+    }
+
+    std::vector<std::thread> threads;
+    auto runner = [&threads](std::function<void()> func) {
+        threads.emplace_back(func);
+        return true;
+    };
+    UniValue serial, parallel;
+    BOOST_CHECK(serial.read(JSONRPCExecBatch(JSONRPCRequest(), batch)));
+    BOOST_CHECK(parallel.read(JSONRPCExecBatch(JSONRPCRequest(), batch, runner)));
+    for (std::thread& thread : threads)
+        thread.join();
+    BOOST_CHECK(!threads.empty());
+
+    BOOST_CHECK_EQUAL(parallel.write(), serial.write());
+    BOOST_CHECK_EQUAL(parallel.size(), calls.size());
+    const std::set<int> failing = {1, 2, 4, 6};
+    for (int i = 0; i < (int)calls.size(); i++) {
+        BOOST_CHECK_EQUAL(find_value(parallel[i], "id").get_int(), i);
+        BOOST_CHECK_EQUAL(find_value(parallel[i], "error").isNull(), !failing.count(i));
+    }
+    BOOST_CHECK_EQUAL(find_value(parallel[1], "error")["code"].get_int(), RPC_INVALID_ADDRESS_OR_KEY);
+    BOOST_CHECK_EQUAL(find_value(parallel[4], "error")["code"].get_int(), RPC_TYPE_ERROR);
+    BOOST_CHECK_EQUAL(find_value(parallel[3], "result")["hash"].get_str(), genesis);
+    BOOST_CHECK_EQUAL(find_value(parallel[5], "result").get_str(), genesis);
+    BOOST_CHECK_EQUAL(find_value(parallel[7], "result")["hash"].get_str(), genesis);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_json_stream)
+{
+    UniValue inner(UniValue::VOBJ);
+    inner.pushKV("a", 1);
+    inner.pushKV("quote\"d", "x\ny");
+    UniValue arr(UniValue::VARR);
+    arr.push_back(inner);
+    arr.push_back(UniValue(UniValue::VARR));
+    arr.push_back(NullUniValue);
+
+    // Flush often to check that pieces are handed over in order
+    std::string out;
+    size_t nPieces = 0;
+    JSONStreamWriter writer([&out, &nPieces](const std::string& piece) { out += piece; nPieces++; }, 8);
+    writer.BeginObject();
+    writer.KeyValue("first", arr);
+    writer.Key("list");
+    writer.BeginArray();
+    for (int i = 0; i < 3; i++)
+        writer.Value(inner);
+    writer.BeginObject();
+    writer.EndObject();
+    writer.EndArray();
+    writer.KeyValues(inner);
+    writer.EndObject();
+    writer.Flush();
+
+    UniValue list(UniValue::VARR);
+    for (int i = 0; i < 3; i++)
+        list.push_back(inner);
+    list.push_back(UniValue(UniValue::VOBJ));
+    UniValue expected(UniValue::VOBJ);
+    expected.pushKV("first", arr);
+    expected.pushKV("list", list);
+    expected.pushKVs(inner);
+
+    BOOST_CHECK_EQUAL(out, expected.write());
+    BOOST_CHECK(nPieces > 1);
+    BOOST_CHECK(writer.Flushed());
+}
+
+BOOST_AUTO_TEST_CASE(rpc_univalue_writer)
+{
+    UniValue inner(UniValue::VOBJ);
+    inner.pushKV("a", 1);
+    inner.pushKV("b", "c");
+
+    // The same calls as on a JSONStreamWriter build the document as a UniValue
+    UniValueWriter writer;
+    writer.BeginObject();
+    writer.Key("list");
+    writer.BeginArray();
+    writer.Value(inner);
+    writer.BeginArray();
+    writer.EndArray();
+    writer.EndArray();
+    writer.Key("nested");
+    writer.BeginObject();
+    writer.KeyValues(inner);
+    writer.EndObject();
+    writer.KeyValue("last", NullUniValue);
+    writer.EndObject();
+
+    UniValue list(UniValue::VARR);
+    list.push_back(inner);
+    list.push_back(UniValue(UniValue::VARR));
+    UniValue expected(UniValue::VOBJ);
+    expected.pushKV("list", list);
+    expected.pushKV("nested", inner);
+    expected.pushKV("last", NullUniValue);
+    BOOST_CHECK_EQUAL(writer.Result().write(), expected.write());
+
+    UniValueWriter scalar;
+    scalar.Value("x");
+    BOOST_CHECK_EQUAL(scalar.Result().get_str(), "x");
+}
+
+BOOST_AUTO_TEST_CASE(rpc_stream_matches_execute)
+{
+    EndRPCWarmup();
+
+    JSONRPCRequest request;
+    request.strMethod = "getblock";
+    request.params = UniValue(UniValue::VARR);
+    request.params.push_back(Params().GenesisBlock().GetHash().GetHex());
+    request.params.push_back(2);
+
+    std::string out;
+    JSONStreamWriter writer([&out](const std::string& piece) { out += piece; }, 16);
+    BOOST_CHECK(tableRPC.executeStream(request, writer));
+    writer.Flush();
+    BOOST_CHECK_EQUAL(out, tableRPC.execute(request).write());
+
+    // Other verbosities are left to the regular handler
+    request.params = UniValue(UniValue::VARR);
+    request.params.push_back(Params().GenesisBlock().GetHash().GetHex());
+    request.params.push_back(1);
+    BOOST_CHECK(!tableRPC.executeStream(request, writer));
+    BOOST_CHECK(writer.TakeBuffer().empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
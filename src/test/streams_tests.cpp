@@ -72,6 +72,28 @@ BOOST_AUTO_TEST_CASE(streams_vector_writer)
     vch.clear();
 }
 
+BOOST_AUTO_TEST_CASE(streams_span_reader)
+{
+    const char data[] = {1, 2, 3, 4, 5, 6, 7};
+    CSpanReader reader(SER_NETWORK, INIT_PROTO_VERSION, data, data + sizeof(data));
+    BOOST_CHECK_EQUAL(reader.size(), 7U);
+
+    unsigned char a;
+    uint32_t b;
+    reader >> a >> b;
+    BOOST_CHECK_EQUAL(a, 1);
+    BOOST_CHECK_EQUAL(b, 0x05040302U);
+    BOOST_CHECK_EQUAL(reader.size(), 2U);
+
+    // Reading past the end throws and leaves the remaining data alone
+    BOOST_CHECK_THROW(reader >> b, std::ios_base::failure);
+    BOOST_CHECK_EQUAL(reader.size(), 2U);
+    uint16_t c;
+    reader >> c;
+    BOOST_CHECK_EQUAL(c, 0x0706);
+    BOOST_CHECK(reader.empty());
+}
+
 BOOST_AUTO_TEST_CASE(streams_serializedata_xor)
 {
     std::vector<char> in;
@@ -9,10 +9,12 @@
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
 #include "crypto/sha256.h"
+#include "hash.h"
 #include "fs.h"
 #include "key.h"
 #include "validation.h"
 #include "miner.h"
+#include "net.h"
 #include "net_processing.h"
 #include "pubkey.h"
 #include "random.h"
@@ -23,6 +25,7 @@
 #include "rpc/server.h"
 #include "rpc/register.h"
 #include "script/sigcache.h"
+#include "workerpool.h"
 
 #include <memory>
 
@@ -35,6 +38,7 @@ extern void noui_connect();
 BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
 {
         SHA256AutoDetect();
+        X20RAutoDetect();
         RandomInit();
         ECC_Start();
         SetupEnvironment();
@@ -87,6 +91,10 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
     nScriptCheckThreads = 3;
     for (int i=0; i < nScriptCheckThreads-1; i++)
         threadGroup.create_thread(&ThreadScriptCheck);
+    for (int i=0; i < 2; i++)
+        threadGroup.create_thread(&ThreadWorkerPool);
+    while (workerpool.ThreadCount() < 2)
+        MilliSleep(1);
     g_connman = std::unique_ptr<CConnman>(new CConnman(0x1337, 0x1337)); // Deterministic randomness for tests.
     connman = g_connman.get();
     peerLogic.reset(new PeerLogicValidation(connman));
@@ -174,3 +182,12 @@ CBlock getBlock13b8a()
     stream >> block;
     return block;
 }
+
+void AppendWireMessage(std::vector<unsigned char>& data, const CSerializedNetMsg& msg)
+{
+    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), msg.data.size());
+    uint256 hash = Hash(msg.data.begin(), msg.data.end());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, data, data.size(), hdr};
+    data.insert(data.end(), msg.data.begin(), msg.data.end());
+}
@@ -114,4 +114,9 @@ struct TestMemPoolEntryHelper
 
 CBlock getBlock13b8a();
 
+struct CSerializedNetMsg;
+
+/** Append msg to data as it goes over the wire: its header, with the checksum, then the payload. */
+void AppendWireMessage(std::vector<unsigned char>& data, const CSerializedNetMsg& msg);
+
 #endif
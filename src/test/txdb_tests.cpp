@@ -0,0 +1,81 @@
+// Copyright (c) 2017 The Astral Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txdb.h"
+
+#include "arith_uint256.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "test/test_astral.h"
+#include "util.h"
+
+#include <limits>
+#include <map>
+#include <memory>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(txdb_tests, TestingSetup)
+
+namespace {
+
+/** Load the block index in db into a map, the way LoadBlockIndexDB does with mapBlockIndex. */
+bool LoadIndex(CBlockTreeDB& db, std::map<uint256, std::unique_ptr<CBlockIndex> >& index, uint64_t nPowSampleRate)
+{
+    index.clear();
+    return db.LoadBlockIndexGuts(Params().GetConsensus(), [&index](const uint256& hash) {
+        if (hash.IsNull())
+            return (CBlockIndex*)nullptr;
+        std::unique_ptr<CBlockIndex>& pindex = index[hash];
+        if (!pindex) {
+            pindex.reset(new CBlockIndex());
+            pindex->phashBlock = &index.find(hash)->first;
+        }
+        return pindex.get();
+    }, nPowSampleRate);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(blockindex_load_pow_sample)
+{
+    CBlockTreeDB db(1 << 20, true);
+
+    // An entry whose key, the hash the block was stored under, is not the X20R hash of the
+    // header in it. The key alone meets the target, so only re-hashing the header finds this.
+    const uint256 hashKey = ArithToUint256(arith_uint256(1));
+    CBlockIndex entry;
+    entry.phashBlock = &hashKey;
+    entry.nHeight = 1;
+    entry.nVersion = 4;
+    entry.nTime = 1514764800;
+    entry.nBits = UintToArith256(Params().GetConsensus().powLimit).GetCompact();
+    entry.nNonce = 42;
+    BOOST_CHECK(entry.GetBlockHeader().GetHash() != hashKey);
+    BOOST_REQUIRE(db.WriteBatchSync({}, 0, {&entry}));
+
+    std::map<uint256, std::unique_ptr<CBlockIndex> > index;
+
+    // Without -checkblockindexpow an entry that isn't sampled is taken by its key
+    BOOST_CHECK(LoadIndex(db, index, std::numeric_limits<uint64_t>::max()));
+    BOOST_REQUIRE_EQUAL(index.size(), 1U);
+    BOOST_CHECK(index.begin()->first == hashKey);
+    BOOST_CHECK_EQUAL(index.begin()->second->nNonce, 42U);
+
+    // but one that is sampled is re-hashed
+    BOOST_CHECK(!LoadIndex(db, index, 1));
+
+    // -checkblockindexpow re-hashes every entry
+    gArgs.ForceSetArg("-checkblockindexpow", "1");
+    BOOST_CHECK(!LoadIndex(db, index, std::numeric_limits<uint64_t>::max()));
+    gArgs.ForceSetArg("-checkblockindexpow", "0");
+
+    // The proof of work of the key is checked for every entry either way
+    const uint256 hashKeyHigh = ArithToUint256(~arith_uint256(0));
+    entry.phashBlock = &hashKeyHigh;
+    BOOST_REQUIRE(db.WriteBatchSync({}, 0, {&entry}));
+    BOOST_CHECK(!LoadIndex(db, index, std::numeric_limits<uint64_t>::max()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
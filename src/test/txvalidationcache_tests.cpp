@@ -18,6 +18,7 @@
 #include "core_io.h"
 #include "keystore.h"
 #include "policy/policy.h"
+#include "workerpool.h"
 
 #include <boost/test/unit_test.hpp>
 
@@ -97,6 +98,59 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_block_doublespend, TestChain100Setup)
     BOOST_CHECK_EQUAL(mempool.size(), 0);
 }
 
+BOOST_FIXTURE_TEST_CASE(connect_block_worker_pool, TestChain100Setup)
+{
+    // CreateAndProcessBlock keeps the witness commitment of the template
+    TurnOffSegwit();
+
+    // The transactions of a block are prepared, and the coins they spend read, on the worker pool
+    BOOST_REQUIRE(workerpool.ThreadCount() > 0);
+
+    CScript scriptPubKey = CScript() <<  ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    auto spend = [&](const CTransaction& txFrom, uint32_t n, unsigned int nOutputs) {
+        CMutableTransaction tx;
+        tx.nVersion = 1;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(txFrom.GetHash(), n);
+        tx.vout.resize(nOutputs);
+        for (CTxOut& out : tx.vout) {
+            out.nValue = txFrom.vout[n].nValue / (nOutputs + 1);
+            out.scriptPubKey = scriptPubKey;
+        }
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, tx, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        tx.vin[0].scriptSig << vchSig;
+        return tx;
+    };
+
+    // Split a mature coinbase, then spend every output in one block, along with a
+    // transaction spending an output created earlier in that block
+    std::vector<CMutableTransaction> vSplit{spend(coinbaseTxns[0], 0, 40)};
+    CBlock block = CreateAndProcessBlock(vSplit, scriptPubKey);
+    BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == block.GetHash());
+
+    const CTransaction txSplit(vSplit[0]);
+    std::vector<CMutableTransaction> vSpends;
+    for (uint32_t n = 0; n < txSplit.vout.size(); n++)
+        vSpends.push_back(spend(txSplit, n, 2));
+    vSpends.push_back(spend(CTransaction(vSpends[0]), 1, 1));
+    block = CreateAndProcessBlock(vSpends, scriptPubKey);
+    BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == block.GetHash());
+
+    LOCK(cs_main);
+    for (uint32_t n = 0; n < txSplit.vout.size(); n++)
+        BOOST_CHECK(!pcoinsTip->HaveCoin(COutPoint(txSplit.GetHash(), n)));
+    const CTransaction txFirst(vSpends[0]);
+    BOOST_CHECK(pcoinsTip->HaveCoin(COutPoint(txFirst.GetHash(), 0)));
+    BOOST_CHECK(!pcoinsTip->HaveCoin(COutPoint(txFirst.GetHash(), 1)));
+    const CTransaction txLast(vSpends.back());
+    const Coin& coin = pcoinsTip->AccessCoin(COutPoint(txLast.GetHash(), 0));
+    BOOST_CHECK(!coin.IsSpent());
+    BOOST_CHECK_EQUAL(coin.nHeight, chainActive.Height());
+}
+
 // Run CheckInputs (using pcoinsTip) on the given transaction, for all script
 // flags.  Test that CheckInputs passes for all flags that don't overlap with
 // the failing_flags argument, but otherwise fails.
@@ -0,0 +1,89 @@
+// Copyright (c) 2017 The Astral Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "workerpool.h"
+
+#include "test/test_astral.h"
+#include "utiltime.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(workerpool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(workerpool_parallel_for)
+{
+    CWorkerPool pool;
+
+    // Without worker threads the items run on the caller
+    std::vector<int> vRuns(100, 0);
+    BOOST_CHECK(pool.ParallelFor(vRuns.size(), [&vRuns](size_t i) { vRuns[i]++; return true; }));
+    for (int nRuns : vRuns)
+        BOOST_CHECK_EQUAL(nRuns, 1);
+    BOOST_CHECK_THROW(pool.ParallelFor(10, [](size_t) -> bool { throw std::runtime_error("item"); }), std::runtime_error);
+
+    boost::thread_group threadGroup;
+    for (int i = 0; i < 3; i++)
+        threadGroup.create_thread(boost::bind(&CWorkerPool::Thread, &pool));
+    while (pool.ThreadCount() < 3)
+        MilliSleep(1);
+
+    for (int n = 0; n < 100; n++) {
+        std::vector<std::atomic<int> > vCount(1000);
+        for (std::atomic<int>& count : vCount)
+            count = 0;
+        BOOST_CHECK(pool.ParallelFor(vCount.size(), [&vCount](size_t i) { vCount[i]++; return true; }));
+        for (const std::atomic<int>& count : vCount)
+            BOOST_CHECK_EQUAL(count.load(), 1);
+    }
+
+    // A failing item fails the job, and stops the items that haven't started
+    std::atomic<size_t> nRan(0);
+    BOOST_CHECK(!pool.ParallelFor(100000, [&nRan](size_t i) { nRan++; return i != 10; }));
+    BOOST_CHECK(nRan.load() < 100000);
+
+    // So does a throwing one, whichever thread ran it, and the exception reaches the caller.
+    // The workers carry on.
+    for (int n = 0; n < 100; n++) {
+        nRan = 0;
+        BOOST_CHECK_THROW(pool.ParallelFor(1000, [&nRan](size_t i) {
+            nRan++;
+            if (i == 500)
+                throw std::runtime_error("item");
+            return true;
+        }), std::runtime_error);
+        BOOST_CHECK(nRan.load() <= 1000);
+    }
+    BOOST_CHECK_EQUAL(pool.ThreadCount(), 3);
+
+    // Items may run jobs of their own, even when they keep all workers busy
+    std::atomic<int> nInner(0);
+    BOOST_CHECK(pool.ParallelFor(8, [&pool, &nInner](size_t) {
+        return pool.ParallelFor(50, [&nInner](size_t) { nInner++; return true; });
+    }));
+    BOOST_CHECK_EQUAL(nInner.load(), 400);
+
+    // A job runs in the background until it is waited for
+    std::vector<int> vHashed(20, 0);
+    {
+        CWorkerPoolJob job(pool, vHashed.size(), [&vHashed](size_t i) { vHashed[i] = i * 2; return true; });
+        BOOST_CHECK(job.Wait());
+    }
+    for (size_t i = 0; i < vHashed.size(); i++)
+        BOOST_CHECK_EQUAL(vHashed[i], (int)i * 2);
+    {
+        CWorkerPoolJob job(pool, 20, [](size_t) -> bool { throw std::runtime_error("item"); });
+        BOOST_CHECK_THROW(job.Wait(), std::runtime_error);
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -16,6 +16,8 @@
 #include "init.h"
 #include "validation.h"
 
+#include "workerpool.h"
+
 #include <stdint.h>
 
 #include <boost/thread.hpp>
@@ -26,6 +28,7 @@ static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_ADDRESSINDEX = 'a';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSBALANCEINDEX = 'A';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_BLOCKHASHINDEX = 'z';
 static const char DB_SPENTINDEX = 'p';
@@ -33,10 +36,14 @@ static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
+static const char DB_COINS_STATS = 'S';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 
+//! Entries LoadBlockIndexGuts collects to re-hash in one HashX20RHeaders batch
+static const size_t BLOCK_INDEX_HASH_BATCH = 256;
+
 namespace {
 
 struct CoinEntry {
@@ -61,14 +68,43 @@ struct CoinEntry {
 
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true, 2 << 20)
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true, 2 << 20, IsDBCompressionEnabled("chainstate")), fRollingStatsPartial(false)
 {
+    // Statistics left behind by an interrupted flush or an older version are of no use
+    if (!db.Read(DB_COINS_STATS, rollingStats) || rollingStats.hashBlock != GetBestBlock())
+        rollingStats = CRollingCoinsStats();
 }
 
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
     return db.Read(CoinEntry(&outpoint), coin);
 }
 
+//! Batches smaller than this are read on the calling thread
+static const size_t MIN_PARALLEL_COINS_READ = 16;
+
+void CCoinsViewDB::GetCoins(const std::vector<COutPoint> &vOutpoints, std::vector<Coin> &vCoins) const {
+    if (vOutpoints.size() < MIN_PARALLEL_COINS_READ) {
+        CCoinsView::GetCoins(vOutpoints, vCoins);
+        return;
+    }
+
+    vCoins.resize(vOutpoints.size());
+
+    // Visit the keys in database order, neighbouring reads then tend to hit the same blocks
+    std::vector<size_t> vOrder(vOutpoints.size());
+    for (size_t i = 0; i < vOrder.size(); i++)
+        vOrder[i] = i;
+    std::sort(vOrder.begin(), vOrder.end(), [&vOutpoints](size_t a, size_t b) { return vOutpoints[a] < vOutpoints[b]; });
+
+    // A read error is rethrown here, as if the read had been done on this thread
+    workerpool.ParallelFor(vOrder.size(), [this, &vOutpoints, &vCoins, &vOrder](size_t i) {
+        const size_t n = vOrder[i];
+        if (!db.Read(CoinEntry(&vOutpoints[n]), vCoins[n]))
+            vCoins[n].Clear();
+        return true;
+    });
+}
+
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
     return db.Exists(CoinEntry(&outpoint));
 }
@@ -111,6 +147,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     // A vector is used for future extensibility, as we may want to support
     // interrupting after partial writes from multiple independent reorgs.
     batch.Erase(DB_BEST_BLOCK);
+    batch.Erase(DB_COINS_STATS);
     batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, old_tip});
 
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
@@ -142,6 +179,8 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     // In the last batch, mark the database as consistent with hashBlock again.
     batch.Erase(DB_HEAD_BLOCKS);
     batch.Write(DB_BEST_BLOCK, hashBlock);
+    if (rollingStats.hashBlock == hashBlock && !fRollingStatsPartial)
+        batch.Write(DB_COINS_STATS, rollingStats);
 
     LogPrint(BCLog::COINDB, "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
     bool ret = db.WriteBatch(batch);
@@ -154,7 +193,7 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, size_t maxFileSize) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, false, maxFileSize) {
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, size_t maxFileSize) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, false, maxFileSize, IsDBCompressionEnabled("blockindex")) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -177,6 +216,76 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
     return Read(DB_LAST_BLOCK, nFile);
 }
 
+static CDataStream SerializeCoin(const COutPoint &outpoint, const Coin &coin)
+{
+    CDataStream ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << outpoint << coin;
+    return ss;
+}
+
+static uint64_t CoinBogoSize(const Coin &coin)
+{
+    return 32 /* txid */ + 4 /* vout index */ + 4 /* height + coinbase */ + 8 /* amount */ +
+           2 /* scriptPubKey len */ + coin.out.scriptPubKey.size() /* scriptPubKey */;
+}
+
+void CRollingCoinsStats::AddCoin(const COutPoint &outpoint, const Coin &coin)
+{
+    nTransactionOutputs++;
+    if (coin.out.scriptPubKey.IsAssetScript())
+        nAssetOutputs++;
+    nBogoSize += CoinBogoSize(coin);
+    nTotalAmount += coin.out.nValue;
+    CDataStream ss = SerializeCoin(outpoint, coin);
+    muhash.Insert((const unsigned char*)ss.data(), ss.size());
+}
+
+void CRollingCoinsStats::RemoveCoin(const COutPoint &outpoint, const Coin &coin)
+{
+    nTransactionOutputs--;
+    if (coin.out.scriptPubKey.IsAssetScript())
+        nAssetOutputs--;
+    nBogoSize -= CoinBogoSize(coin);
+    nTotalAmount -= coin.out.nValue;
+    CDataStream ss = SerializeCoin(outpoint, coin);
+    muhash.Remove((const unsigned char*)ss.data(), ss.size());
+}
+
+void CRollingCoinsStats::Merge(const CRollingCoinsStats &other)
+{
+    // The counters of changes may have wrapped around, adding them still gives the right total
+    nTransactionOutputs += other.nTransactionOutputs;
+    nAssetOutputs += other.nAssetOutputs;
+    nBogoSize += other.nBogoSize;
+    nTotalAmount += other.nTotalAmount;
+    muhash *= other.muhash;
+}
+
+uint256 CRollingCoinsStats::GetMuHash() const
+{
+    MuHash3072 finalized = muhash;
+    uint256 hash;
+    finalized.Finalize(hash.begin());
+    return hash;
+}
+
+bool ComputeRollingCoinsStats(CCoinsViewCursor *pcursor, CRollingCoinsStats &stats)
+{
+    stats = CRollingCoinsStats();
+    stats.hashBlock = pcursor->GetBestBlock();
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        COutPoint key;
+        Coin coin;
+        if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+            return error("%s: unable to read value", __func__);
+        }
+        stats.AddCoin(key, coin);
+        pcursor->Next();
+    }
+    return true;
+}
+
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
 {
     CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(db).NewIterator(), GetBestBlock());
@@ -308,20 +417,133 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
     return true;
 }
 
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
+bool CBlockTreeDB::ScanAddressUnspentIndex(const CAddressUnspentKey &start,
+                                           std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)> fn) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, start));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressUnspentKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX ||
+            key.second.type != start.type || key.second.hashBytes != start.hashBytes) {
+            break;
+        }
+        CAddressUnspentValue nValue;
+        if (!pcursor->GetValue(nValue)) {
+            return error("failed to get address unspent value");
+        }
+        if (!fn(key.second, nValue)) {
+            break;
+        }
+        pcursor->Next();
+    }
+
+    return true;
+}
+
+typedef std::map<std::pair<unsigned int, uint160>, CAddressBalanceValue> AddressBalanceDeltaMap;
+
+//! Fold per-address deltas into the stored balance records as part of batch
+static void ApplyAddressBalanceDeltas(CDBWrapper& db, CDBBatch& batch, const AddressBalanceDeltaMap& mapDeltas)
+{
+    for (const auto& delta : mapDeltas) {
+        auto key = std::make_pair(DB_ADDRESSBALANCEINDEX, CAddressIndexIteratorKey(delta.first.first, delta.first.second));
+        CAddressBalanceValue value;
+        if (!db.Read(key, value))
+            value.SetNull();
+        value += delta.second;
+        if (value.IsNull())
+            batch.Erase(key);
+        else
+            batch.Write(key, value);
+    }
+}
+
+bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect, bool fCheckExisting) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+    AddressBalanceDeltaMap mapDeltas;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        if (!fCheckExisting || !Exists(std::make_pair(DB_ADDRESSINDEX, it->first)))
+            mapDeltas[std::make_pair(it->first.type, it->first.hashBytes)].Add(it->second);
         batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
+    }
+    ApplyAddressBalanceDeltas(*this, batch, mapDeltas);
     return WriteBatch(batch);
 }
 
 bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+    AddressBalanceDeltaMap mapDeltas;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        // Take the amount from disk so the balance always matches the entries
+        CAmount nValue;
+        if (Read(std::make_pair(DB_ADDRESSINDEX, it->first), nValue))
+            mapDeltas[std::make_pair(it->first.type, it->first.hashBytes)].Remove(nValue);
         batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
+    }
+    ApplyAddressBalanceDeltas(*this, batch, mapDeltas);
     return WriteBatch(batch);
 }
 
+bool CBlockTreeDB::ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value) {
+    if (!Read(std::make_pair(DB_ADDRESSBALANCEINDEX, CAddressIndexIteratorKey(type, addressHash)), value))
+        value.SetNull();
+    return true;
+}
+
+bool CBlockTreeDB::BuildAddressBalanceIndex() {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey()));
+
+    CDBBatch batch(*this);
+    std::pair<unsigned int, uint160> current;
+    CAddressBalanceValue value;
+    size_t nAddresses = 0;
+    bool fHaveCurrent = false;
+
+    // Entries are sorted by (type, hash), so each address is a single run
+    while (true) {
+        std::pair<char,CAddressIndexKey> key;
+        bool fValid = pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX;
+        if (fHaveCurrent && (!fValid || key.second.type != current.first || key.second.hashBytes != current.second)) {
+            auto balanceKey = std::make_pair(DB_ADDRESSBALANCEINDEX, CAddressIndexIteratorKey(current.first, current.second));
+            if (value.IsNull())
+                batch.Erase(balanceKey);
+            else
+                batch.Write(balanceKey, value);
+            nAddresses++;
+            fHaveCurrent = false;
+            if (batch.SizeEstimate() > (size_t)nDefaultDbBatchSize) {
+                if (!WriteBatch(batch))
+                    return error("%s: failed to write address balances", __func__);
+                batch.Clear();
+            }
+        }
+        if (!fValid)
+            break;
+
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("%s: failed to get address index value", __func__);
+        if (!fHaveCurrent) {
+            current = std::make_pair(key.second.type, key.second.hashBytes);
+            value.SetNull();
+            fHaveCurrent = true;
+        }
+        value.Add(nValue);
+        pcursor->Next();
+    }
+
+    if (!WriteBatch(batch, true))
+        return error("%s: failed to write address balances", __func__);
+
+    LogPrintf("%s: built balances for %u addresses\n", __func__, (unsigned int)nAddresses);
+    return true;
+}
+
 bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                                     int start, int end) {
@@ -356,6 +578,36 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
+bool CBlockTreeDB::ScanAddressIndex(const CAddressIndexKey &start, int end,
+                                    std::function<bool(const CAddressIndexKey&, CAmount)> fn) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, start));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX ||
+            key.second.type != start.type || key.second.hashBytes != start.hashBytes) {
+            break;
+        }
+        if (end > 0 && key.second.blockHeight > end) {
+            break;
+        }
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue)) {
+            return error("failed to get address index value");
+        }
+        if (!fn(key.second, nValue)) {
+            break;
+        }
+        pcursor->Next();
+    }
+
+    return true;
+}
+
 bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
     CDBBatch batch(*this);
     batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
@@ -417,12 +669,36 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex,
+                                      uint64_t nPowSampleRate)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
+    // Entries are keyed by their block hash, which was checked against the
+    // header before the entry was written. Re-hashing every header with X20R
+    // dominates startup time, so unless asked to check everything only a
+    // random sample is re-hashed to catch a database that doesn't match.
+    const bool fCheckAll = gArgs.GetBoolArg("-checkblockindexpow", DEFAULT_CHECKBLOCKINDEXPOW);
+    FastRandomContext rng;
+
+    // Headers to re-hash and the keys they must match, checked a batch at a time
+    std::vector<CBlockHeader> vCheckHeaders;
+    std::vector<uint256> vCheckKeys;
+    vCheckHeaders.reserve(BLOCK_INDEX_HASH_BATCH);
+    vCheckKeys.reserve(BLOCK_INDEX_HASH_BATCH);
+    auto checkBatch = [&vCheckHeaders, &vCheckKeys]() {
+        CBlockHeader::CacheHashes(vCheckHeaders.data(), vCheckHeaders.size());
+        for (size_t i = 0; i < vCheckHeaders.size(); i++) {
+            if (vCheckHeaders[i].GetHash() != vCheckKeys[i])
+                return error("LoadBlockIndexGuts: block index entry %s does not match its header, restart with -reindex", vCheckKeys[i].ToString());
+        }
+        vCheckHeaders.clear();
+        vCheckKeys.clear();
+        return true;
+    };
+
     // Load mapBlockIndex
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
@@ -430,8 +706,15 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
         if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
             CDiskBlockIndex diskindex;
             if (pcursor->GetValue(diskindex)) {
+                if (fCheckAll || rng.randrange(nPowSampleRate) == 0) {
+                    vCheckHeaders.push_back(diskindex.GetBlockHeader());
+                    vCheckKeys.push_back(key.second);
+                    if (vCheckHeaders.size() >= BLOCK_INDEX_HASH_BATCH && !checkBatch())
+                        return false;
+                }
+
                 // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
+                CBlockIndex* pindexNew = insertBlockIndex(key.second);
                 pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
                 pindexNew->nHeight        = diskindex.nHeight;
                 pindexNew->nFile          = diskindex.nFile;
@@ -457,7 +740,7 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
         }
     }
 
-    return true;
+    return checkBatch();
 }
 
 namespace {
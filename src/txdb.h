@@ -8,12 +8,14 @@
 #define RAVEN_TXDB_H
 
 #include "coins.h"
+#include "crypto/muhash.h"
 #include "dbwrapper.h"
 #include "chain.h"
 #include "addressindex.h"
 #include "spentindex.h"
 #include "timestampindex.h"
 
+#include <functional>
 #include <map>
 #include <string>
 #include <utility>
@@ -29,6 +31,10 @@ static constexpr int MAX_BLOCK_COINSDB_USAGE = 10;
 static const int64_t nDefaultDbCache = 450;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -checkblockindexpow default
+static const bool DEFAULT_CHECKBLOCKINDEXPOW = false;
+//! Without -checkblockindexpow, re-hash about one in this many block index entries on load
+static const int BLOCK_INDEX_POW_SAMPLE_RATE = 1000;
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
@@ -67,15 +73,62 @@ struct CDiskTxPos : public CDiskBlockPos
     }
 };
 
+/**
+ * Statistics over the UTXO set that are updated as blocks are connected and disconnected, so
+ * that reporting them doesn't need a scan of the whole chainstate. muhash is a MuHash3072 of the
+ * serialized outpoint and coin of every unspent coin, so it doesn't depend on the order coins
+ * were added in and spending a coin divides it out again.
+ */
+struct CRollingCoinsStats
+{
+    //! Block the statistics describe the UTXO set at; null while they are unknown
+    uint256 hashBlock;
+    uint64_t nTransactionOutputs;
+    uint64_t nAssetOutputs;
+    uint64_t nBogoSize;
+    CAmount nTotalAmount;
+    MuHash3072 muhash;
+
+    CRollingCoinsStats() : nTransactionOutputs(0), nAssetOutputs(0), nBogoSize(0), nTotalAmount(0) {}
+
+    void AddCoin(const COutPoint &outpoint, const Coin &coin);
+    void RemoveCoin(const COutPoint &outpoint, const Coin &coin);
+    //! Add the changes collected in other, on top of these statistics
+    void Merge(const CRollingCoinsStats &other);
+    //! Hash of the UTXO set. Finalizing is slow (it takes a modular inverse), so only do it on request.
+    uint256 GetMuHash() const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashBlock);
+        READWRITE(nTransactionOutputs);
+        READWRITE(nAssetOutputs);
+        READWRITE(nBogoSize);
+        READWRITE(nTotalAmount);
+        READWRITE(muhash);
+    }
+};
+
+/** Recompute stats from scratch by scanning the coins pcursor visits. */
+bool ComputeRollingCoinsStats(CCoinsViewCursor *pcursor, CRollingCoinsStats &stats);
+
 /** CCoinsView backed by the coin database (chainstate/) */
 class CCoinsViewDB final : public CCoinsView
 {
 protected:
     CDBWrapper db;
+    //! Written along with the best block whenever it describes that block
+    CRollingCoinsStats rollingStats;
+    //! Set while BuildRollingCoinsStats scans the coins, rollingStats then only holds the changes since
+    bool fRollingStatsPartial;
 public:
     explicit CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    //! Reads the outpoints in key order, spread over the coins read threads
+    void GetCoins(const std::vector<COutPoint> &vOutpoints, std::vector<Coin> &vCoins) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
@@ -85,6 +138,13 @@ public:
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
+    //! Store the whole database again with the current options, see CDBWrapper::Rewrite
+    void Rewrite() { db.Rewrite(); }
+
+    //! Statistics kept up to date by ConnectTip/DisconnectTip with -coinstatsindex (guarded by cs_main)
+    CRollingCoinsStats& RollingStats() { return rollingStats; }
+    bool IsRollingStatsPartial() const { return fRollingStatsPartial; }
+    void SetRollingStatsPartial(bool fPartial) { fRollingStatsPartial = fPartial; }
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -130,18 +190,31 @@ public:
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
     bool ReadAddressUnspentIndex(uint160 addressHash, int type,
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
-    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
+    //! Visit the unspent outputs of start's address from start onwards, until fn returns false
+    bool ScanAddressUnspentIndex(const CAddressUnspentKey &start,
+                                 std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)> fn);
+    //! fCheckExisting skips entries that are already on disk (blocks connected again at startup,
+    //! e.g. -reindex-chainstate) when updating the balances; otherwise vect is written blindly.
+    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, bool fCheckExisting = false);
     bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                           int start = 0, int end = 0);
+    //! Visit the entries of start's address from start onwards (up to height end, if
+    //! positive), until fn returns false
+    bool ScanAddressIndex(const CAddressIndexKey &start, int end,
+                          std::function<bool(const CAddressIndexKey&, CAmount)> fn);
+    bool ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value);
+    bool BuildAddressBalanceIndex();
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
     bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
     bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    //! Without -checkblockindexpow about one in nPowSampleRate entries is re-hashed
+    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex,
+                            uint64_t nPowSampleRate = BLOCK_INDEX_POW_SAMPLE_RATE);
 };
 
 #endif // RAVEN_TXDB_H
@@ -11,6 +11,7 @@
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
+#include "workerpool.h"
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/tx_verify.h"
@@ -82,6 +83,7 @@ bool fTxIndex = false;
 bool fAddressIndex = false;
 bool fTimestampIndex = false;
 bool fSpentIndex = false;
+bool fCoinStatsIndex = DEFAULT_COINSTATSINDEX;
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
@@ -89,6 +91,7 @@ bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
 size_t nCoinCacheUsage = 5000 * 300;
+size_t nAssetCacheUsage = DEFAULT_ASSET_CACHE << 20;
 uint64_t nPruneTarget = 0;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 bool fEnableReplacement = DEFAULT_ENABLE_REPLACEMENT;
@@ -198,7 +201,7 @@ CBlockTreeDB *pblocktree = nullptr;
 
 CAssetsDB *passetsdb = nullptr;
 CAssetsCache *passets = nullptr;
-CLRUCache<std::string, CDatabasedAssetData> *passetsCache = nullptr;
+CAssetsMetaCache *passetsCache = nullptr;
 
 enum FlushStateMode {
     FLUSH_STATE_NONE,
@@ -1016,6 +1019,32 @@ bool GetAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
+bool ScanAddressIndex(const CAddressIndexKey &start, int end,
+                      std::function<bool(const CAddressIndexKey&, CAmount)> fn)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ScanAddressIndex(start, end, fn))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+bool GetAddressBalance(uint160 addressHash, int type, CAmount &balance, CAmount &received)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    CAddressBalanceValue value;
+    if (!pblocktree->ReadAddressBalance(addressHash, type, value))
+        return error("unable to get balance for address");
+
+    balance = value.balance;
+    received = value.received;
+    return true;
+}
+
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
 {
@@ -1028,6 +1057,18 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     return true;
 }
 
+bool ScanAddressUnspent(const CAddressUnspentKey &start,
+                        std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)> fn)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ScanAddressUnspentIndex(start, fn))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
 /** Return transaction in txOut, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus::Params& consensusParams, uint256 &hashBlock, bool fAllowSlow)
 {
@@ -1152,6 +1193,49 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
+{
+    // The block is preceded by the index header written in WriteBlockToDisk
+    CDiskBlockPos hpos = pos;
+    hpos.nPos -= CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int);
+    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+
+    try {
+        CMessageHeader::MessageStartChars blkStart;
+        unsigned int nSize;
+        filein >> FLATDATA(blkStart) >> nSize;
+
+        if (memcmp(blkStart, messageStart, CMessageHeader::MESSAGE_START_SIZE))
+            return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
+                    HexStr(blkStart, blkStart + CMessageHeader::MESSAGE_START_SIZE),
+                    HexStr(messageStart, messageStart + CMessageHeader::MESSAGE_START_SIZE));
+
+        if (nSize > MAX_SIZE)
+            return error("%s: Block data is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
+                    nSize, MAX_SIZE);
+
+        block.resize(nSize);
+        filein.read((char*)block.data(), nSize);
+    }
+    catch (const std::exception& e) {
+        return error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
+    }
+
+    return true;
+}
+
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart)
+{
+    CDiskBlockPos pos;
+    {
+        LOCK(cs_main);
+        pos = pindex->GetBlockPos();
+    }
+    return ReadRawBlockFromDisk(block, pos, messageStart);
+}
+
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
 {
     int halvings = nHeight / consensusParams.nSubsidyHalvingInterval;
@@ -1325,7 +1409,7 @@ void static InvalidBlockFound(CBlockIndex *pindex, const CValidationState &state
     }
 }
 
-void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txundo, int nHeight, uint256 blockHash, CAssetsCache* assetCache, std::pair<std::string, CBlockAssetUndo>* undoAssetData)
+void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txundo, int nHeight, const uint256& blockHash, CAssetsCache* assetCache, std::pair<std::string, CBlockAssetUndo>* undoAssetData)
 {
     // mark inputs spent
     if (!tx.IsCoinBase()) {
@@ -1629,7 +1713,7 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
     }
 
     std::vector<std::pair<std::string, CBlockAssetUndo> > vUndoData;
-    if (!passetsdb->ReadBlockUndoAssetData(block.GetHash(), vUndoData)) {
+    if (!passetsdb->ReadBlockUndoAssetData(pindex->GetBlockHash(), vUndoData)) {
         error("DisconnectBlock(): block asset undo data inconsistent");
         return DISCONNECT_FAILED;
     }
@@ -1639,7 +1723,7 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
 
     // undo transactions in reverse order
-    CAssetsCache tempCache(*assetsCache);
+    CAssetsCache tempCache(assetsCache);
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = *(block.vtx[i]);
         uint256 hash = tx.GetHash();
@@ -1714,8 +1798,11 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
                         error("%s : Failed to get asset from transaction. TXID : %s", __func__, tx.GetHash().GetHex());
                         return DISCONNECT_FAILED;
                     }
+                    // The asset is the last output of the issuing transaction, its owner token the one before
+                    int assetIndex = tx.vout.size() - 1;
+                    int ownerIndex = assetIndex - 1;
                     if (assetsCache->ContainsAsset(asset)) {
-                        if (!assetsCache->RemoveNewAsset(asset, strAddress)) {
+                        if (!assetsCache->RemoveNewAsset(asset, strAddress, COutPoint(hash, assetIndex))) {
                             error("%s : Failed to Remove Asset. Asset Name : %s", __func__, asset.strName);
                             return DISCONNECT_FAILED;
                         }
@@ -1729,7 +1816,7 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
                         return DISCONNECT_FAILED;
                     }
 
-                    if (!assetsCache->RemoveOwnerAsset(ownerName, ownerAddress)) {
+                    if (!assetsCache->RemoveOwnerAsset(ownerName, ownerAddress, COutPoint(hash, ownerIndex))) {
                         error("%s : Failed to Remove Owner from transaction. TXID : %s", __func__, tx.GetHash().GetHex());
                         return DISCONNECT_FAILED;
                     }
@@ -1765,7 +1852,7 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
                             }
 
                             if (assetsCache->ContainsAsset(asset.strName)) {
-                                if (!assetsCache->RemoveNewAsset(asset, strAddress)) {
+                                if (!assetsCache->RemoveNewAsset(asset, strAddress, COutPoint(hash, n))) {
                                     error("%s : Failed to Undo Unique Asset. Asset Name : %s", __func__, asset.strName);
                                     return DISCONNECT_FAILED;
                                 }
@@ -1900,6 +1987,139 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+/**
+ * The parts of connecting a transaction that only depend on the transaction itself and the
+ * coins it spends. They are worked out for the whole block on the worker pool before the
+ * transactions are applied to the UTXO set one by one.
+ */
+struct CBlockTxPrep
+{
+    //! Copies of the coins spent by each input, taken before any transaction of the block is applied
+    std::vector<Coin> vSpentCoins;
+    std::vector<int> prevheights;
+    PrecomputedTransactionData txdata;
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+};
+
+//! Get the address type and hash the address index uses for a script, 0 if it isn't indexed
+static int GetIndexAddress(const CScript& script, uint160& hashBytes)
+{
+    if (script.IsPayToScriptHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin()+2, script.begin()+22));
+        return 2;
+    } else if (script.IsPayToPublicKeyHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin()+3, script.begin()+23));
+        return 1;
+    } else if (script.IsPayToPublicKey()) {
+        hashBytes = Hash160(script.begin()+1, script.end()-1);
+        return 1;
+    }
+
+    hashBytes.SetNull();
+    return 0;
+}
+
+//! Work out the rest of the CBlockTxPrep of transaction nTx, once its vSpentCoins are known
+static void PrepareBlockTransaction(const CTransaction& tx, unsigned int nTx, int nHeight, CBlockTxPrep& prep)
+{
+    const uint256 txhash = tx.GetHash();
+
+    prep.txdata = PrecomputedTransactionData(tx);
+
+    if (!tx.IsCoinBase()) {
+        prep.prevheights.resize(tx.vin.size());
+        for (size_t j = 0; j < tx.vin.size(); j++) {
+            const Coin &coin = prep.vSpentCoins[j];
+            prep.prevheights[j] = coin.nHeight;
+
+            if (!fAddressIndex && !fSpentIndex)
+                continue;
+
+            const CTxIn &input = tx.vin[j];
+            uint160 hashBytes;
+            int addressType = GetIndexAddress(coin.out.scriptPubKey, hashBytes);
+
+            if (fAddressIndex && addressType > 0) {
+                // record spending activity
+                prep.addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, nHeight, nTx, txhash, j, true), coin.out.nValue * -1));
+
+                // remove address from unspent index
+                prep.addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
+            }
+
+            if (fSpentIndex) {
+                // add the spent index to determine the txid and input that spent an output
+                // and to find the amount and address from an input
+                prep.spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, nHeight, coin.out.nValue, addressType, hashBytes)));
+            }
+        }
+    }
+
+    if (fAddressIndex) {
+        for (unsigned int k = 0; k < tx.vout.size(); k++) {
+            const CTxOut &out = tx.vout[k];
+            uint160 hashBytes;
+            int addressType = GetIndexAddress(out.scriptPubKey, hashBytes);
+            if (addressType == 0)
+                continue;
+
+            // record receiving activity
+            prep.addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, nHeight, nTx, txhash, k, false), out.nValue));
+
+            // record unspent output
+            prep.addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight)));
+        }
+    }
+}
+
+/**
+ * Copy the coins spent by every transaction of the block into vPrep, and work out the rest of
+ * CBlockTxPrep on the worker pool. Coins created earlier in the same block aren't in the
+ * view yet, they are taken from the block itself. All other coins are requested from the view in
+ * one batch, so whatever isn't cached is read from the database together instead of one input at
+ * a time. Inputs that don't resolve get an empty coin, the serial checks in ConnectBlock reject those.
+ */
+static void PrepareBlockTransactions(const CBlock& block, const CCoinsViewCache& view, int nHeight, std::vector<CBlockTxPrep>& vPrep)
+{
+    vPrep.resize(block.vtx.size());
+
+    std::vector<COutPoint> vOutpoints;
+    std::vector<Coin*> vDest;
+    std::unordered_map<uint256, unsigned int, SaltedTxidHasher> mapBlockTxs;
+    mapBlockTxs.reserve(block.vtx.size());
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction &tx = *(block.vtx[i]);
+        if (!tx.IsCoinBase()) {
+            vPrep[i].vSpentCoins.resize(tx.vin.size());
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const COutPoint &prevout = tx.vin[j].prevout;
+                auto it = mapBlockTxs.find(prevout.hash);
+                if (it != mapBlockTxs.end()) {
+                    const CTransaction &txPrev = *(block.vtx[it->second]);
+                    if (prevout.n < txPrev.vout.size())
+                        vPrep[i].vSpentCoins[j] = Coin(txPrev.vout[prevout.n], nHeight, it->second == 0);
+                } else {
+                    vOutpoints.push_back(prevout);
+                    vDest.push_back(&vPrep[i].vSpentCoins[j]);
+                }
+            }
+        }
+        mapBlockTxs.emplace(tx.GetHash(), i);
+    }
+
+    std::vector<Coin> vCoins;
+    view.GetCoins(vOutpoints, vCoins);
+    for (size_t k = 0; k < vDest.size(); k++)
+        *vDest[k] = std::move(vCoins[k]);
+
+    workerpool.ParallelFor(block.vtx.size(), [&block, nHeight, &vPrep](size_t i) {
+        PrepareBlockTransaction(*(block.vtx[i]), i, nHeight, vPrep[i]);
+        return true;
+    });
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -1986,6 +2206,7 @@ static unsigned int GetBlockScriptFlags(const CBlockIndex* pindex, const Consens
 
 static int64_t nTimeCheck = 0;
 static int64_t nTimeForks = 0;
+static int64_t nTimePrepare = 0;
 static int64_t nTimeVerify = 0;
 static int64_t nTimeConnect = 0;
 static int64_t nTimeIndex = 0;
@@ -2002,9 +2223,10 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
     AssertLockHeld(cs_main);
     assert(pindex);
+    const uint256 hashBlock = block.GetHash();
     // pindex->phashBlock can be null if called by CreateNewBlock/TestBlockValidity
     assert((pindex->phashBlock == nullptr) ||
-           (*pindex->phashBlock == block.GetHash()));
+           (*pindex->phashBlock == hashBlock));
     int64_t nTimeStart = GetTimeMicros();
 
     // Check it again in case a previous version let a bad block in
@@ -2017,7 +2239,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
     // Special case for the genesis block, skipping connection of its transactions
     // (its coinbase is unspendable)
-    if (block.GetHash() == chainparams.GetConsensus().hashGenesisBlock) {
+    if (hashBlock == chainparams.GetConsensus().hashGenesisBlock) {
         if (!fJustCheck)
             view.SetBestBlock(pindex->GetBlockHash());
         return true;
@@ -2109,7 +2331,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
 
-    std::vector<int> prevheights;
     CAmount nFees = 0;
     int nInputs = 0;
     int64_t nSigOpsCost = 0;
@@ -2117,8 +2338,13 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     std::vector<std::pair<uint256, CDiskTxPos> > vPos;
     vPos.reserve(block.vtx.size());
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
-    std::vector<PrecomputedTransactionData> txdata;
-    txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
+
+    // Sized once, so pointers to individual PrecomputedTransactionData don't get invalidated
+    std::vector<CBlockTxPrep> vPrep;
+    PrepareBlockTransactions(block, view, pindex->nHeight, vPrep);
+
+    int64_t nTimePrep = GetTimeMicros(); nTimePrepare += nTimePrep - nTime2;
+    LogPrint(BCLog::BENCH, "      - Prepare %u transactions: %.2fms [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTimePrep - nTime2), nTimePrepare * MICRO, nTimePrepare * MILLI / nBlocksTotal);
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
@@ -2127,7 +2353,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *(block.vtx[i]);
-        const uint256 txhash = tx.GetHash();
+        CBlockTxPrep &prep = vPrep[i];
 
         nInputs += tx.vin.size();
 
@@ -2162,55 +2388,10 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             // Check that transaction is BIP68 final
             // BIP68 lock checks (as opposed to nLockTime checks) must
             // be in ConnectBlock because they require the UTXO set
-            prevheights.resize(tx.vin.size());
-            for (size_t j = 0; j < tx.vin.size(); j++) {
-                prevheights[j] = view.AccessCoin(tx.vin[j].prevout).nHeight;
-            }
-
-            if (!SequenceLocks(tx, nLockTimeFlags, &prevheights, *pindex)) {
+            if (!SequenceLocks(tx, nLockTimeFlags, &prep.prevheights, *pindex)) {
                 return state.DoS(100, error("%s: contains a non-BIP68-final transaction", __func__),
                                  REJECT_INVALID, "bad-txns-nonfinal");
             }
-
-            if (fAddressIndex || fSpentIndex)
-            {
-                for (size_t j = 0; j < tx.vin.size(); j++) {
-
-                    const CTxIn input = tx.vin[j];
-                    const CTxOut &prevout = view.AccessCoin(tx.vin[j].prevout).out;
-                    uint160 hashBytes;
-                    int addressType;
-
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        hashBytes = uint160(std::vector <unsigned char>(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22));
-                        addressType = 2;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        hashBytes = uint160(std::vector <unsigned char>(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23));
-                        addressType = 1;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        hashBytes = Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1);
-                        addressType = 1;
-                    } else {
-                        hashBytes.SetNull();
-                        addressType = 0;
-                    }
-
-                    if (fAddressIndex && addressType > 0) {
-                        // record spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
-
-                        // remove address from unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                    }
-
-                    if (fSpentIndex) {
-                        // add the spent index to determine the txid and input that spent an output
-                        // and to find the amount and address from an input
-                        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, pindex->nHeight, prevout.nValue, addressType, hashBytes)));
-                    }
-                }
-
-            }
         }
 
         // GetTransactionSigOpCost counts 3 types of sigops:
@@ -2222,12 +2403,11 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             return state.DoS(100, error("ConnectBlock(): too many sigops"),
                              REJECT_INVALID, "bad-blk-sigops");
 
-        txdata.emplace_back(tx);
         if (!tx.IsCoinBase())
         {
             std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
-            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, fCacheResults, txdata[i], nScriptCheckThreads ? &vChecks : nullptr))
+            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, fCacheResults, prep.txdata, nScriptCheckThreads ? &vChecks : nullptr))
                 return error("ConnectBlock(): CheckInputs on %s failed with %s",
                     tx.GetHash().ToString(), FormatStateMessage(state));
             control.Add(vChecks);
@@ -2300,38 +2480,11 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             }
         }
         /** ASTRAL END */
-        if (fAddressIndex) {
-            for (unsigned int k = 0; k < tx.vout.size(); k++) {
-                const CTxOut &out = tx.vout[k];
 
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, txhash, k, false), out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-                } else {
-                    continue;
-                }
-
-            }
-        }
+        // Index records were built during preparation, keep them in block order
+        addressIndex.insert(addressIndex.end(), prep.addressIndex.begin(), prep.addressIndex.end());
+        addressUnspentIndex.insert(addressUnspentIndex.end(), prep.addressUnspentIndex.begin(), prep.addressUnspentIndex.end());
+        spentIndex.insert(spentIndex.end(), prep.spentIndex.begin(), prep.spentIndex.end());
 
         CTxUndo undoDummy;
         if (i > 0) {
@@ -2343,7 +2496,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         std::pair<std::string, CBlockAssetUndo>* undoAssetData = &undoPair;
         /** ASTRAL END */
 
-        UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight, block.GetHash(), assetsCache, undoAssetData);
+        UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight, hashBlock, assetsCache, undoAssetData);
 
         /** ASTRAL START */
         if (!undoAssetData->first.empty()) {
@@ -2354,8 +2507,8 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         vPos.push_back(std::make_pair(tx.GetHash(), pos));
         pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
     }
-    int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
-    LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
+    int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTimePrep;
+    LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTimePrep), MILLI * (nTime3 - nTimePrep) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTimePrep) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
 
     CAmount blockReward = nFees + GetBlockSubsidy(pindex->nHeight, chainparams.GetConsensus());
     if (block.vtx[0]->GetValueOut() > blockReward)
@@ -2388,7 +2541,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         }
 
         if (vUndoAssetData.size()) {
-            if (!passetsdb->WriteBlockUndoAssetData(block.GetHash(), vUndoAssetData))
+            if (!passetsdb->WriteBlockUndoAssetData(hashBlock, vUndoAssetData))
                 return AbortNode(state, "Failed to write asset undo data");
         }
 
@@ -2401,7 +2554,9 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             return AbortNode(state, "Failed to write transaction index");
 
     if (!ignoreAddressIndex && fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
+        // Blocks connected while importing (-reindex-chainstate, or catching the chainstate up
+        // after an unclean shutdown) can have their entries on disk already
+        if (!pblocktree->WriteAddressIndex(addressIndex, fImporting || fReindex)) {
             return AbortNode(state, "Failed to write address index");
         }
 
@@ -2499,12 +2654,15 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
         bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
         // The cache is over the limit, we have to write now.
         bool fCacheCritical = mode == FLUSH_STATE_IF_NEEDED && cacheSize > nTotalSpace;
+        // The asset address caches are over their share of -dbcache, write them so they can be trimmed.
+        // Only count what trimming can free, or a large mapMyUnspentAssets would force a flush every block.
+        bool fAssetCacheCritical = mode == FLUSH_STATE_IF_NEEDED && passets && passets->AddressCacheMemoryUsage() > nAssetCacheUsage;
         // It's been a while since we wrote the block index to disk. Do this frequently, so we don't need to redownload after a crash.
         bool fPeriodicWrite = mode == FLUSH_STATE_PERIODIC && nNow > nLastWrite + (int64_t)DATABASE_WRITE_INTERVAL * 1000000;
         // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
         bool fPeriodicFlush = mode == FLUSH_STATE_PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
         // Combine all conditions that result in a full cache flush.
-        fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
+        fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fAssetCacheCritical || fPeriodicFlush || fFlushForPrune;
         // Write blocks and block index to disk.
         if (fDoFullFlush || fPeriodicWrite) {
             // Depend on nMinDiskSpace to ensure we can write block index
@@ -2664,6 +2822,91 @@ void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
 
 }
 
+/**
+ * Update the rolling UTXO set statistics for connecting block (or disconnecting it, if
+ * fDisconnect is set). Coins created by the block are rebuilt from its outputs; coins it spends
+ * from earlier blocks are looked up in inputs, which must still hold them: the tip before the
+ * block was connected, or the view it was disconnected into.
+ * Outputs both created and spent inside the block never reach the UTXO set and are skipped.
+ */
+static void UpdateRollingCoinsStats(CRollingCoinsStats& stats, const CBlock& block, int nHeight, const CCoinsViewCache& inputs, bool fDisconnect)
+{
+    std::set<uint256> setBlockTxids;
+    std::set<COutPoint> setSpentInBlock;
+    for (const auto& tx : block.vtx) {
+        setBlockTxids.insert(tx->GetHash());
+        if (!tx->IsCoinBase()) {
+            for (const CTxIn& txin : tx->vin)
+                setSpentInBlock.insert(txin.prevout);
+        }
+    }
+
+    for (const auto& tx : block.vtx) {
+        const uint256& txid = tx->GetHash();
+        for (size_t i = 0; i < tx->vout.size(); i++) {
+            COutPoint out(txid, i);
+            if (tx->vout[i].scriptPubKey.IsUnspendable() || setSpentInBlock.count(out))
+                continue;
+            Coin coin(tx->vout[i], nHeight, tx->IsCoinBase());
+            if (fDisconnect)
+                stats.RemoveCoin(out, coin);
+            else
+                stats.AddCoin(out, coin);
+        }
+        if (tx->IsCoinBase())
+            continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (setBlockTxids.count(txin.prevout.hash))
+                continue;
+            const Coin& coin = inputs.AccessCoin(txin.prevout);
+            assert(!coin.IsSpent());
+            if (fDisconnect)
+                stats.AddCoin(txin.prevout, coin);
+            else
+                stats.RemoveCoin(txin.prevout, coin);
+        }
+    }
+}
+
+bool BuildRollingCoinsStats()
+{
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    uint256 hashSnapshot;
+    {
+        LOCK(cs_main);
+        CRollingCoinsStats& stats = pcoinsdbview->RollingStats();
+        // Without a tip, connecting the genesis block starts the statistics
+        if (!chainActive.Tip() || stats.hashBlock == chainActive.Tip()->GetBlockHash())
+            return true;
+
+        FlushStateToDisk();
+        // The cursor reads a snapshot of the database as it is now, blocks connected from here on
+        // collect their changes in stats
+        pcursor.reset(pcoinsdbview->Cursor());
+        hashSnapshot = chainActive.Tip()->GetBlockHash();
+        stats = CRollingCoinsStats();
+        stats.hashBlock = hashSnapshot;
+        pcoinsdbview->SetRollingStatsPartial(true);
+    }
+
+    LogPrintf("%s: computing UTXO set statistics at %s\n", __func__, hashSnapshot.ToString());
+    CRollingCoinsStats computed;
+    bool fOk = ComputeRollingCoinsStats(pcursor.get(), computed);
+
+    LOCK(cs_main);
+    CRollingCoinsStats& stats = pcoinsdbview->RollingStats();
+    pcoinsdbview->SetRollingStatsPartial(false);
+    if (!fOk) {
+        stats = CRollingCoinsStats();
+        return false;
+    }
+    computed.hashBlock = stats.hashBlock;
+    computed.Merge(stats);
+    stats = computed;
+    LogPrintf("%s: done, %u transaction outputs\n", __func__, stats.nTransactionOutputs);
+    return true;
+}
+
 /** Disconnect chainActive's tip.
   * After calling, the mempool will be in an inconsistent state, with
   * transactions from disconnected blocks being added to disconnectpool.  You
@@ -2688,11 +2931,16 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
     {
         CCoinsViewCache view(pcoinsTip);
 
-        CAssetsCache assetCache(*passets);
+        CAssetsCache assetCache(passets);
 
         assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
         if (DisconnectBlock(block, pindexDelete, view, &assetCache) != DISCONNECT_OK)
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
+        CRollingCoinsStats& stats = pcoinsdbview->RollingStats();
+        if (fCoinStatsIndex && stats.hashBlock == pindexDelete->GetBlockHash()) {
+            UpdateRollingCoinsStats(stats, block, pindexDelete->nHeight, view, true);
+            stats.hashBlock = pindexDelete->pprev->GetBlockHash();
+        }
         bool flushed = view.Flush();
         assert(flushed);
 
@@ -2824,7 +3072,6 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
 
     /** ASTRAL START */
     // Initialize sets used from removing asset entries from the mempool
-    std::set<CAssetCacheNewAsset> prevNewAssets;
     std::set<CAssetCacheNewAsset> afterNewAsset;
     /** ASTRAL END */
 
@@ -2832,8 +3079,7 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
         CCoinsViewCache view(pcoinsTip);
 
         /** ASTRAL START */
-        CAssetsCache assetCache(*passets);
-        prevNewAssets = assetCache.setNewAssetsToAdd; // List of newly cached assets before block is connected
+        CAssetsCache assetCache(passets); // Starts empty, so it only collects the changes made by this block
         /** ASTRAL END */
 
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, &assetCache);
@@ -2847,10 +3093,6 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
         /** ASTRAL START */
         // Get the newly created assets, from the connectblock assetCache
         afterNewAsset = assetCache.setNewAssetsToAdd;
-        for (auto it : prevNewAssets) {
-            if (afterNewAsset.count(it))
-                afterNewAsset.erase(it);
-        }
 
         for (auto tx : blockConnecting.vtx) {
             uint256 txHash = tx->GetHash();
@@ -2861,6 +3103,18 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
         }
         /** ASTRAL END */
 
+        // The genesis block's outputs are never added to the UTXO set
+        CRollingCoinsStats& stats = pcoinsdbview->RollingStats();
+        if (!fCoinStatsIndex) {
+            // Not kept up to date, so it can't describe this block
+        } else if (!pindexNew->pprev) {
+            stats = CRollingCoinsStats();
+            stats.hashBlock = pindexNew->GetBlockHash();
+        } else if (stats.hashBlock == pindexNew->pprev->GetBlockHash()) {
+            UpdateRollingCoinsStats(stats, blockConnecting, pindexNew->nHeight, *pcoinsTip, false);
+            stats.hashBlock = pindexNew->GetBlockHash();
+        }
+
         nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
         LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTime2) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
         bool flushed = view.Flush();
@@ -3285,6 +3539,20 @@ static CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
     return pindexNew;
 }
 
+void SetBlockHaveWitness(CBlockIndex* pindex, const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+    pindex->nStatus &= ~BLOCK_HAVE_WITNESS;
+    pindex->nStatus |= BLOCK_WITNESS_KNOWN;
+    for (const CTransactionRef& tx : block.vtx) {
+        if (tx->HasWitness()) {
+            pindex->nStatus |= BLOCK_HAVE_WITNESS;
+            break;
+        }
+    }
+    setDirtyBlockIndex.insert(pindex);
+}
+
 /** Mark a block as having its data received and checked (up to BLOCK_VALID_TRANSACTIONS). */
 static bool ReceivedBlockTransactions(const CBlock &block, CValidationState& state, CBlockIndex *pindexNew, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
 {
@@ -3297,6 +3565,7 @@ static bool ReceivedBlockTransactions(const CBlock &block, CValidationState& sta
     if (IsWitnessEnabled(pindexNew->pprev, consensusParams)) {
         pindexNew->nStatus |= BLOCK_OPT_WITNESS;
     }
+    SetBlockHaveWitness(pindexNew, block);
     pindexNew->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
     setDirtyBlockIndex.insert(pindexNew);
 
@@ -3769,6 +4038,38 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
     return true;
 }
 
+//! HashBlockHeaders hashes batches of fewer headers than this on the calling thread
+static const size_t HEADERS_PARALLEL_HASH_MIN = 8;
+//! Headers HashBlockHeaders hands to HashX20RHeaders at once. Large enough for most X20R stages
+//! to find a few headers on the same primitive to share its multi-lane kernel, small enough that
+//! a full headers message still spreads over the worker pool.
+static const size_t HEADERS_HASH_BATCH = 128;
+
+void HashBlockHeaders(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams)
+{
+    // The hash of each header is cached on it, so neither the caller nor AcceptBlockHeader have
+    // to work it out again. The outcome is left to AcceptBlockHeader, so that a header failing the
+    // check is reported (and the headers before it accepted) just as if it were checked there. A
+    // failure does stop the remaining batches from being hashed here, as they won't get far anyway.
+    auto hashBatch = [&headers, &consensusParams](size_t nBatch) {
+        const size_t nBegin = nBatch * HEADERS_HASH_BATCH;
+        const size_t nEnd = std::min(headers.size(), nBegin + HEADERS_HASH_BATCH);
+        CBlockHeader::CacheHashes(&headers[nBegin], nEnd - nBegin);
+        for (size_t i = nBegin; i < nEnd; i++) {
+            if (!CheckProofOfWork(headers[i].GetHash(), headers[i].nBits, consensusParams))
+                return false;
+        }
+        return true;
+    };
+    if (headers.size() < HEADERS_PARALLEL_HASH_MIN) {
+        // Not worth waking the worker pool for, such as a new block being announced
+        if (!headers.empty())
+            hashBatch(0);
+        return;
+    }
+    workerpool.ParallelFor((headers.size() + HEADERS_HASH_BATCH - 1) / HEADERS_HASH_BATCH, hashBatch);
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex)
 {
@@ -3918,7 +4219,7 @@ bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams,
     indexDummy.nHeight = pindexPrev->nHeight + 1;
 
     /** ASTRAL START */
-    CAssetsCache assetCache(*passets);
+    CAssetsCache assetCache(passets);
     /** ASTRAL END */
 
     // NOTE: CheckBlockHeader is called by CheckBlock
@@ -4252,6 +4553,20 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
 
+    // Databases created before the address balance records existed need them
+    // built once from the address index
+    if (fAddressIndex) {
+        bool fAddressBalanceIndex = false;
+        pblocktree->ReadFlag("addressbalanceindex", fAddressBalanceIndex);
+        if (!fAddressBalanceIndex) {
+            LogPrintf("%s: building address balance index...\n", __func__);
+            uiInterface.InitMessage(_("Building address balance index..."));
+            if (!pblocktree->BuildAddressBalanceIndex())
+                return false;
+            pblocktree->WriteFlag("addressbalanceindex", true);
+        }
+    }
+
     // Check whether we have a timestamp index
     pblocktree->ReadFlag("timestampindex", fTimestampIndex);
     LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
@@ -4319,7 +4634,7 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
     CValidationState state;
     int reportDone = 0;
 
-    CAssetsCache assetCache(*passets);
+    CAssetsCache assetCache(passets);
     LogPrintf("[0%%]...");
     for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev)
     {
@@ -4423,7 +4738,7 @@ bool ReplayBlocks(const CChainParams& params, CCoinsView* view)
     LOCK(cs_main);
 
     CCoinsViewCache cache(view);
-    CAssetsCache assetsCache(*passets);
+    CAssetsCache assetsCache(passets);
 
     std::vector<uint256> hashHeads = view->GetHeadBlocks();
     if (hashHeads.empty()) return true; // We're already in a consistent state.
@@ -4634,6 +4949,7 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         // Use the provided setting for -addressindex in the new database
         fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
         pblocktree->WriteFlag("addressindex", fAddressIndex);
+        pblocktree->WriteFlag("addressbalanceindex", fAddressIndex);
         LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
 
         // Use the provided setting for -timestampindex in the new database
@@ -4681,7 +4997,66 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
     return true;
 }
 
-bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
+/** A block read by LoadExternalBlockFile, along with where it was found */
+struct CImportedBlock
+{
+    std::shared_ptr<CBlock> pblock;
+    CDiskBlockPos pos;
+};
+
+/**
+ * Read the blocks of blkdat from nRewind on, until vBatch holds nMaxBatchSize bytes of them.
+ * Returns false once there are no more blocks in the file.
+ */
+static bool ReadImportBatch(const CChainParams& chainparams, CBufferedFile& blkdat, uint64_t& nRewind, const CDiskBlockPos* dbp, size_t nMaxBatchSize, std::vector<CImportedBlock>& vBatch)
+{
+    size_t nBatchSize = 0;
+    while (nBatchSize < nMaxBatchSize) {
+        boost::this_thread::interruption_point();
+
+        if (blkdat.eof())
+            return false;
+        blkdat.SetPos(nRewind);
+        nRewind++; // start one byte further next time, in case of failure
+        blkdat.SetLimit(); // remove former limit
+        unsigned int nSize = 0;
+        try {
+            // locate a header
+            unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+            blkdat.FindByte(chainparams.MessageStart()[0]);
+            nRewind = blkdat.GetPos()+1;
+            blkdat >> FLATDATA(buf);
+            if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                continue;
+            // read size
+            blkdat >> nSize;
+            if (nSize < 80 || nSize > GetMaxBlockSerializedSize())
+                continue;
+        } catch (const std::exception&) {
+            // no valid block header found; don't complain
+            return false;
+        }
+        try {
+            // read block
+            uint64_t nBlockPos = blkdat.GetPos();
+            blkdat.SetLimit(nBlockPos + nSize);
+            blkdat.SetPos(nBlockPos);
+            CImportedBlock imported;
+            imported.pblock = std::make_shared<CBlock>();
+            blkdat >> *imported.pblock;
+            nRewind = blkdat.GetPos();
+            if (dbp)
+                imported.pos = CDiskBlockPos(dbp->nFile, nBlockPos);
+            vBatch.push_back(std::move(imported));
+            nBatchSize += nSize;
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+        }
+    }
+    return true;
+}
+
+bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp, size_t nBatchSize)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
     static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
@@ -4692,105 +5067,103 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2*GetMaxBlockSerializedSize(), GetMaxBlockSerializedSize()+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > GetMaxBlockSerializedSize())
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                            block.hashPrevBlock.ToString());
-                    if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                    continue;
-                }
+        // Blocks are handled a batch at a time: while the blocks of one batch are accepted in
+        // file order, the worker pool hashes those of the next one.
+        std::vector<CImportedBlock> vBatch;
+        bool fMore = true;
+        bool fAbort = false;
+        do {
+            std::vector<CImportedBlock> vNextBatch;
+            if (fMore)
+                fMore = ReadImportBatch(chainparams, blkdat, nRewind, dbp, nBatchSize, vNextBatch);
+
+            // Hash the next batch while this one is accepted. CheckBlock is left to AcceptBlock: it
+            // looks up assets in passets, which isn't safe to do while the chain is being connected,
+            // and its outcome is cached in fChecked.
+            CWorkerPoolJob hashNext(workerpool, vNextBatch.size(), [&vNextBatch](size_t i) {
+                vNextBatch[i].pblock->GetHash();
+                return true;
+            });
+
+            for (CImportedBlock& imported : vBatch) {
+                boost::this_thread::interruption_point();
+
+                CDiskBlockPos* pos = dbp ? &imported.pos : nullptr;
+                try {
+                    std::shared_ptr<CBlock> pblock = imported.pblock;
+                    CBlock& block = *pblock;
+
+                    // detect out of order blocks, and store them for later
+                    uint256 hash = block.GetHash();
+                    if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+                        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                                block.hashPrevBlock.ToString());
+                        if (pos)
+                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *pos));
+                        continue;
+                    }
 
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    LOCK(cs_main);
-                    CValidationState state;
-                    if (AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr)) {
-                        nLoaded++;
+                    // process in case the block isn't known yet
+                    if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+                        LOCK(cs_main);
+                        CValidationState state;
+                        if (AcceptBlock(pblock, state, chainparams, nullptr, true, pos, nullptr)) {
+                            nLoaded++;
+                        }
+                        if (state.IsError()) {
+                            fAbort = true;
+                            break;
+                        }
+                    } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
+                        LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
                     }
-                    if (state.IsError())
-                        break;
-                } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
-                }
 
-                // Activate the genesis block so normal node progress can continue
-                if (hash == chainparams.GetConsensus().hashGenesisBlock) {
-                    CValidationState state;
-                    if (!ActivateBestChain(state, chainparams)) {
-                        break;
+                    // Activate the genesis block so normal node progress can continue
+                    if (hash == chainparams.GetConsensus().hashGenesisBlock) {
+                        CValidationState state;
+                        if (!ActivateBestChain(state, chainparams)) {
+                            fAbort = true;
+                            break;
+                        }
                     }
-                }
 
-                NotifyHeaderTip();
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
-                        {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            CValidationState dummy;
-                            if (AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr))
+                    NotifyHeaderTip();
+
+                    // Recursively process earlier encountered successors of this block
+                    std::deque<uint256> queue;
+                    queue.push_back(hash);
+                    while (!queue.empty()) {
+                        uint256 head = queue.front();
+                        queue.pop_front();
+                        std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+                        while (range.first != range.second) {
+                            std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+                            std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+                            if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
                             {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
+                                LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                                        head.ToString());
+                                LOCK(cs_main);
+                                CValidationState dummy;
+                                if (AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr))
+                                {
+                                    nLoaded++;
+                                    queue.push_back(pblockrecursive->GetHash());
+                                }
                             }
+                            range.first++;
+                            mapBlocksUnknownParent.erase(it);
+                            NotifyHeaderTip();
                         }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip();
                     }
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
                 }
-            } catch (const std::exception& e) {
-                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
-        }
+
+            hashNext.Wait();
+            vBatch.swap(vNextBatch);
+        } while (!fAbort && !vBatch.empty());
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
     }
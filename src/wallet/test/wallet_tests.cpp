@@ -11,6 +11,7 @@
 #include <utility>
 #include <vector>
 
+#include "assets/assets.h"
 #include "consensus/validation.h"
 #include "rpc/server.h"
 #include "test/test_astral.h"
@@ -597,6 +598,47 @@ BOOST_AUTO_TEST_CASE(LoadReceiveRequests)
     BOOST_CHECK_EQUAL(values[1], "val_rr1");
 }
 
+BOOST_AUTO_TEST_CASE(UpdatePossibleAssets_wallet)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    AddKey(*pwalletMain, key);
+
+    CScript scriptMine = GetScriptForDestination(key.GetPubKey().GetID());
+    CAssetTransfer("POSSIBLE", 100).ConstructTransaction(scriptMine);
+    CScript scriptOther = GetScriptForDestination(CKeyID());
+    CAssetTransfer("POSSIBLE", 100).ConstructTransaction(scriptOther);
+
+    const COutPoint outMine(uint256S("01"), 0), outOther(uint256S("02"), 0), outSpent(uint256S("03"), 0), outLater(uint256S("04"), 0);
+    {
+        LOCK(cs_main);
+        pcoinsTip->AddCoin(outMine, Coin(CTxOut(0, scriptMine), 1, false), false);
+        pcoinsTip->AddCoin(outOther, Coin(CTxOut(0, scriptOther), 1, false), false);
+    }
+
+    // Outputs seen before the wallet is loaded are kept for it, spent ones included
+    fTrackPossiblyMine = true;
+    BOOST_CHECK(passets->AddPossibleOutPoint(CAssetCachePossibleMine("POSSIBLE", outMine, CTxOut(0, scriptMine))));
+    BOOST_CHECK(passets->AddPossibleOutPoint(CAssetCachePossibleMine("POSSIBLE", outOther, CTxOut(0, scriptOther))));
+    BOOST_CHECK(passets->AddPossibleOutPoint(CAssetCachePossibleMine("POSSIBLE", outSpent, CTxOut(0, scriptMine))));
+    BOOST_CHECK_EQUAL(passets->setPossiblyMineAdd.size(), 3U);
+
+    // Once the wallet is loaded init checks them against it once, keeping only the unspent one it owns
+    vpwallets.insert(vpwallets.begin(), pwalletMain);
+    UpdatePossibleAssets();
+    BOOST_CHECK(passets->setPossiblyMineAdd.empty());
+    BOOST_CHECK(fTrackPossiblyMine);
+    BOOST_CHECK(passets->mapMyUnspentAssets["POSSIBLE"] == std::set<COutPoint>{outMine});
+
+    // Later outputs go straight to the wallet's set, so a second pass has nothing to add
+    BOOST_CHECK(passets->AddPossibleOutPoint(CAssetCachePossibleMine("POSSIBLE", outLater, CTxOut(0, scriptMine))));
+    BOOST_CHECK(passets->setPossiblyMineAdd.empty());
+    UpdatePossibleAssets();
+    BOOST_CHECK(passets->mapMyUnspentAssets["POSSIBLE"] == (std::set<COutPoint>{outMine, outLater}));
+
+    vpwallets.erase(vpwallets.begin());
+}
+
 class ListCoinsTestingSetup : public TestChain100Setup
 {
 public:
@@ -0,0 +1,171 @@
+// Copyright (c) 2017 The Astral Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "workerpool.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <boost/thread.hpp>
+
+struct CWorkerPool::Job
+{
+    const ItemFunc fn;
+    const size_t nCount;
+
+    //! The next item to start
+    std::atomic<size_t> nNext;
+    std::atomic<bool> fAllOk;
+
+    //! Protects nDone and exception
+    boost::mutex mutex;
+    //! The submitting thread waits on this for the items others are running
+    boost::condition_variable condDone;
+    size_t nDone;
+    //! What the first item that threw threw
+    std::exception_ptr exception;
+
+    Job(const ItemFunc& fnIn, size_t nCountIn) : fn(fnIn), nCount(nCountIn), nNext(0), fAllOk(true), nDone(0) {}
+
+    //! Run items until none are left to start
+    void Run()
+    {
+        size_t nRan = 0;
+        for (size_t i = nNext++; i < nCount; i = nNext++) {
+            // Once one failed there is no point in running the rest
+            if (fAllOk) {
+                try {
+                    if (!fn(i))
+                        fAllOk = false;
+                } catch (...) {
+                    boost::unique_lock<boost::mutex> lock(mutex);
+                    if (!exception)
+                        exception = std::current_exception();
+                    fAllOk = false;
+                }
+            }
+            nRan++;
+        }
+        if (nRan) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            nDone += nRan;
+            if (nDone == nCount)
+                condDone.notify_all();
+        }
+    }
+};
+
+CWorkerPool::CWorkerPool() : nWorkers(0)
+{
+}
+
+void CWorkerPool::Thread()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nWorkers++;
+    }
+    try {
+        while (true) {
+            std::shared_ptr<Job> job;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (queue.empty())
+                    condWorker.wait(lock); // interruption point
+                job = queue.front();
+            }
+            {
+                // The submitting thread waits for the items started here
+                boost::this_thread::disable_interruption noInterrupt;
+                job->Run();
+            }
+            Remove(job);
+        }
+    } catch (const boost::thread_interrupted&) {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nWorkers--;
+        throw;
+    }
+}
+
+void CWorkerPool::Remove(const std::shared_ptr<Job>& job)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    auto it = std::find(queue.begin(), queue.end(), job);
+    if (it != queue.end())
+        queue.erase(it);
+}
+
+bool CWorkerPool::ParallelFor(size_t nCount, const ItemFunc& fn)
+{
+    CWorkerPoolJob job(*this, nCount, fn);
+    return job.Wait();
+}
+
+int CWorkerPool::ThreadCount()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return nWorkers;
+}
+
+CWorkerPoolJob::CWorkerPoolJob(CWorkerPool& poolIn, size_t nCount, const CWorkerPool::ItemFunc& fn) :
+    pool(poolIn), job(std::make_shared<CWorkerPool::Job>(fn, nCount)), fQueued(false), fOk(true)
+{
+    // A single item is run by Wait, there is nobody to share it with
+    if (nCount < 2)
+        return;
+    boost::unique_lock<boost::mutex> lock(pool.mutex);
+    if (pool.nWorkers == 0)
+        return;
+    pool.queue.push_back(job);
+    fQueued = true;
+    pool.condWorker.notify_all();
+}
+
+CWorkerPoolJob::~CWorkerPoolJob()
+{
+    Finish();
+}
+
+void CWorkerPoolJob::Finish()
+{
+    if (!job)
+        return;
+
+    {
+        // The items refer to the caller's data, so don't leave while any of them is running
+        boost::this_thread::disable_interruption noInterrupt;
+        job->Run();
+        boost::unique_lock<boost::mutex> lock(job->mutex);
+        while (job->nDone < job->nCount)
+            job->condDone.wait(lock);
+        exception = job->exception;
+    }
+    if (fQueued)
+        pool.Remove(job);
+
+    fOk = job->fAllOk;
+    job.reset();
+}
+
+bool CWorkerPoolJob::Wait()
+{
+    Finish();
+    if (exception) {
+        std::exception_ptr e = exception;
+        exception = nullptr;
+        std::rethrow_exception(e);
+    }
+    return fOk;
+}
+
+CWorkerPool workerpool;
+
+void ThreadWorkerPool()
+{
+    RenameThread("astral-worker");
+    workerpool.Thread();
+}
@@ -0,0 +1,105 @@
+// Copyright (c) 2017 The Astral Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAVEN_WORKERPOOL_H
+#define RAVEN_WORKERPOOL_H
+
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+class CWorkerPoolJob;
+
+//! -workerthreads default
+static const int DEFAULT_WORKER_THREADS = 0;
+//! Maximum number of worker threads
+static const int MAX_WORKER_THREADS = 64;
+
+/**
+ * Threads shared by the parts of the node that split independent work over several cores.
+ *
+ * Work is handed over as jobs of nCount items, the items of a job are run by whichever threads
+ * are free while the thread that submitted the job works through them as well. That thread
+ * only waits for the items others have already started, so a job finishes even when all
+ * workers are busy, and an item may submit a job of its own. Without worker threads the
+ * submitting thread runs all items itself.
+ */
+class CWorkerPool
+{
+public:
+    //! Runs item i of a job, returning false stops the items of the job that haven't started yet.
+    //! So does throwing, the first exception is rethrown to the thread that waits for the job.
+    typedef std::function<bool(size_t)> ItemFunc;
+
+    CWorkerPool();
+
+    CWorkerPool(const CWorkerPool&) = delete;
+    CWorkerPool& operator=(const CWorkerPool&) = delete;
+
+    //! Worker thread
+    void Thread();
+
+    //! Run fn for every index below nCount and wait for it. Returns false if any of them did.
+    bool ParallelFor(size_t nCount, const ItemFunc& fn);
+
+    //! The number of worker threads serving the pool
+    int ThreadCount();
+
+private:
+    friend class CWorkerPoolJob;
+    struct Job;
+
+    //! Mutex to protect the inner state
+    boost::mutex mutex;
+
+    //! Worker threads block on this when out of work
+    boost::condition_variable condWorker;
+
+    //! Jobs that may have items left, the workers take on the oldest first
+    std::deque<std::shared_ptr<Job> > queue;
+
+    //! The number of worker threads
+    int nWorkers;
+
+    void Remove(const std::shared_ptr<Job>& job);
+};
+
+/**
+ * A job running on a CWorkerPool from its construction on, for callers that have something else
+ * to do in the meantime. Wait (or the destructor) helps with the items left and waits for the rest.
+ */
+class CWorkerPoolJob
+{
+private:
+    CWorkerPool& pool;
+    std::shared_ptr<CWorkerPool::Job> job;
+    bool fQueued;
+    bool fOk;
+    std::exception_ptr exception;
+
+    void Finish();
+
+public:
+    CWorkerPoolJob(CWorkerPool& poolIn, size_t nCount, const CWorkerPool::ItemFunc& fn);
+    ~CWorkerPoolJob();
+
+    CWorkerPoolJob(const CWorkerPoolJob&) = delete;
+    CWorkerPoolJob& operator=(const CWorkerPoolJob&) = delete;
+
+    //! Returns whether every item succeeded, rethrows the exception of an item that threw.
+    //! The destructor only waits.
+    bool Wait();
+};
+
+/** The pool the node's worker threads serve */
+extern CWorkerPool workerpool;
+
+/** Run an instance of the worker thread of workerpool */
+void ThreadWorkerPool();
+
+#endif // RAVEN_WORKERPOOL_H
@@ -190,6 +190,27 @@ class AddressIndexTest(AstralTestFramework):
         deltas = self.nodes[1].getaddressdeltas({"addresses": [address2], "start": 113, "end": 113})
         assert_equal(len(deltas), 1)
 
+        # A start without an end is ignored, as it is by getaddresstxids
+        assert_equal(self.nodes[1].getaddressdeltas({"addresses": [address2], "start": 113}), deltasAll)
+        assert_equal(self.nodes[1].getaddresstxids({"addresses": [address2], "start": 113}),
+                     self.nodes[1].getaddresstxids({"addresses": [address2]}))
+
+        # getaddressdeltas rejects a range that isn't positive or ends before it starts
+        assert_raises_rpc_error(-5, "Start and end is expected to be greater than zero",
+                                self.nodes[1].getaddressdeltas, {"addresses": [address2], "start": 0, "end": 113})
+        assert_raises_rpc_error(-5, "Start and end is expected to be greater than zero",
+                                self.nodes[1].getaddressdeltas, {"addresses": [address2], "start": 113, "end": -1})
+        assert_raises_rpc_error(-5, "End value is expected to be greater than start",
+                                self.nodes[1].getaddressdeltas, {"addresses": [address2], "start": 113, "end": 112})
+        assert_raises_rpc_error(-5, "End value is expected to be greater than start",
+                                self.nodes[1].getaddressdeltas, {"addresses": [address2], "start": 113, "end": 112, "limit": 2})
+
+        # getaddresstxids ignores a range that isn't positive, and one that ends before it starts is empty
+        txidsAll = self.nodes[1].getaddresstxids({"addresses": [address2]})
+        assert_equal(self.nodes[1].getaddresstxids({"addresses": [address2], "start": 0, "end": 113}), txidsAll)
+        assert_equal(self.nodes[1].getaddresstxids({"addresses": [address2], "start": 113, "end": -1}), txidsAll)
+        assert_equal(self.nodes[1].getaddresstxids({"addresses": [address2], "start": 113, "end": 112}), [])
+
         # Check that unspent outputs can be queried
         print("Testing utxos...")
         utxos = self.nodes[1].getaddressutxos({"addresses": [address2]})
@@ -345,6 +366,36 @@ class AddressIndexTest(AstralTestFramework):
         assert_equal(utxos_with_info["height"], 267)
         assert_equal(utxos_with_info["hash"], expected_tip_block_hash)
 
+        # Page through results with limit and cursor
+        print("Testing paginated results...")
+
+        def get_all_pages(method, params, field):
+            items = []
+            page = method(dict(params, limit=2))
+            while True:
+                assert(len(page[field]) <= 2)
+                items += page[field]
+                if "next" not in page:
+                    return items
+                page = method(dict(params, limit=2, cursor=page["next"]))
+
+        multi = {"addresses": ["2N2JD6wb56AfK4tfmM6PwdVmoYk2dCKf4Br", "mo9ncXisMeAoXwqcV5EWuyncbmCcQN4rVs"]}
+        paged_deltas = get_all_pages(self.nodes[1].getaddressdeltas, multi, "deltas")
+        assert_equal(paged_deltas, self.nodes[1].getaddressdeltas(multi))
+
+        paged_txids = get_all_pages(self.nodes[1].getaddresstxids, {"addresses": [address2]}, "txids")
+        assert_equal(paged_txids, self.nodes[1].getaddresstxids({"addresses": [address2]}))
+
+        paged_deltas = get_all_pages(self.nodes[1].getaddressdeltas, dict(multi, start=1, end=200, chainInfo=True), "deltas")
+        assert_equal(paged_deltas, self.nodes[1].getaddressdeltas(dict(multi, start=1, end=200)))
+
+        paged_txids = get_all_pages(self.nodes[1].getaddresstxids, multi, "txids")
+        assert_equal(paged_txids, self.nodes[1].getaddresstxids(multi))
+
+        paged_utxos = get_all_pages(self.nodes[1].getaddressutxos, {"addresses": [address2]}, "utxos")
+        assert_equal(sorted(u["txid"] for u in paged_utxos),
+                     sorted(u["txid"] for u in self.nodes[1].getaddressutxos({"addresses": [address2]})))
+
         print("Passed\n")
 
 
@@ -22,6 +22,7 @@ from decimal import Decimal
 import http.client
 import subprocess
 
+from test_framework.authproxy import JSONRPCException
 from test_framework.test_framework import AstralTestFramework
 from test_framework.util import (
     assert_equal,
@@ -31,12 +32,13 @@ from test_framework.util import (
     assert_raises_rpc_error,
     assert_is_hex_string,
     assert_is_hash_string,
+    wait_until,
 )
 
 class BlockchainTest(AstralTestFramework):
     def set_test_params(self):
         self.num_nodes = 1
-        self.extra_args = [['-stopatheight=207', '-prune=1']]
+        self.extra_args = [['-stopatheight=207', '-prune=1', '-coinstatsindex']]
 
     def run_test(self):
         self._test_getblockchaininfo()
@@ -131,7 +133,7 @@ class BlockchainTest(AstralTestFramework):
 
     def _test_gettxoutsetinfo(self):
         node = self.nodes[0]
-        res = node.gettxoutsetinfo()
+        res = node.gettxoutsetinfo("hash_serialized_2")
 
         assert_equal(res['total_amount'], Decimal('872500.00000000'))
         assert_equal(res['transactions'], 200)
@@ -145,11 +147,27 @@ class BlockchainTest(AstralTestFramework):
         assert_equal(len(res['bestblock']), 64)
         assert_equal(len(res['hash_serialized_2']), 64)
 
+        self.log.info("Test that the default gettxoutsetinfo() is the full scan")
+        default = node.gettxoutsetinfo()
+        for key in ['transactions', 'hash_serialized_2', 'total_amount', 'height', 'txouts', 'bogosize', 'bestblock']:
+            assert_equal(default[key], res[key])
+
+        self.log.info("Test that the muhash gettxoutsetinfo() agrees with a full scan")
+        # The cached chain was built without -coinstatsindex, so the statistics are computed at startup
+        wait_until(lambda: self._coinstats_ready(node))
+        rolling = node.gettxoutsetinfo("muhash")
+        for key in ['total_amount', 'height', 'txouts', 'bogosize', 'bestblock']:
+            assert_equal(rolling[key], res[key])
+        assert_equal(rolling['asset_txouts'], 0)
+        assert_is_hash_string(rolling['muhash'])
+        assert 'hash_serialized_2' not in rolling
+        assert_raises_rpc_error(-8, "Unknown hash_type", node.gettxoutsetinfo, "sha256")
+
         self.log.info("Test that gettxoutsetinfo() works for blockchain with just the genesis block")
         b1hash = node.getblockhash(1)
         node.invalidateblock(b1hash)
 
-        res2 = node.gettxoutsetinfo()
+        res2 = node.gettxoutsetinfo("hash_serialized_2")
         assert_equal(res2['transactions'], 0)
         assert_equal(res2['total_amount'], Decimal('0'))
         assert_equal(res2['height'], 0)
@@ -158,10 +176,17 @@ class BlockchainTest(AstralTestFramework):
         assert_equal(res2['bestblock'], node.getblockhash(0))
         assert_equal(len(res2['hash_serialized_2']), 64)
 
+        rolling2 = node.gettxoutsetinfo("muhash")
+        assert_equal(rolling2['txouts'], 0)
+        assert_equal(rolling2['total_amount'], Decimal('0'))
+        assert_equal(rolling2['bestblock'], node.getblockhash(0))
+        # MuHash3072 of the empty set
+        assert_equal(rolling2['muhash'], 'dd5ad2a105c2d29495f577245c357409002329b9f4d6182c0af3dc2f462555c8')
+
         self.log.info("Test that gettxoutsetinfo() returns the same result after invalidate/reconsider block")
         node.reconsiderblock(b1hash)
 
-        res3 = node.gettxoutsetinfo()
+        res3 = node.gettxoutsetinfo("hash_serialized_2")
         assert_equal(res['total_amount'], res3['total_amount'])
         assert_equal(res['transactions'], res3['transactions'])
         assert_equal(res['height'], res3['height'])
@@ -169,6 +194,25 @@ class BlockchainTest(AstralTestFramework):
         assert_equal(res['bogosize'], res3['bogosize'])
         assert_equal(res['bestblock'], res3['bestblock'])
         assert_equal(res['hash_serialized_2'], res3['hash_serialized_2'])
+        assert_equal(node.gettxoutsetinfo("muhash")['muhash'], rolling['muhash'])
+
+        self.log.info("Test that the rolling statistics survive a restart")
+        self.restart_node(0)
+        assert_equal(self.nodes[0].gettxoutsetinfo("muhash")['muhash'], rolling['muhash'])
+
+        self.log.info("Test that muhash needs -coinstatsindex")
+        self.restart_node(0, ['-stopatheight=207', '-prune=1'])
+        assert_raises_rpc_error(-1, "requires -coinstatsindex", self.nodes[0].gettxoutsetinfo, "muhash")
+        self.restart_node(0)
+
+    def _coinstats_ready(self, node):
+        try:
+            node.gettxoutsetinfo("muhash")
+        except JSONRPCException as e:
+            # RPC_IN_WARMUP while the statistics are being computed
+            assert_equal(e.error['code'], -28)
+            return False
+        return True
 
     def _test_getblockheader(self):
         node = self.nodes[0]